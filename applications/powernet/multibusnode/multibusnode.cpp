@@ -598,18 +598,52 @@ struct BusInfo {
 };
 
 
+/* Load the bus definitions from a CSV file.
+ The file is parsed into a table shared by all the multi-bus nodes on this host (see OBNnode::SharedData), so that only the first node parses it.
+ Each row of the table contains the bus name, the number of users and the constant values.
+ */
 std::map<std::string, BusInfo> load_csv_bus_defs(const char* t_file) {
-    CsvParser *csvparser = CsvParser_new(t_file, ",", false);
-    
     std::map<std::string, BusInfo> v, empty_result;
-    CsvRow *row;
-    int krow = 0;
     
-    while ((row = CsvParser_getRow(csvparser)) ) {
-        char **rowFields = CsvParser_getFields(row);
-        ++krow;
+    std::unique_ptr<SharedTable> table;
+    try {
+        auto data = SharedData::get(SharedData::fileKey(t_file, "multibus-csv"), [t_file](std::string& out) {
+            SharedTable::Writer w;
+            CsvParser *csvparser = CsvParser_new(t_file, ",", false);
+            CsvRow *row;
+            
+            while ((row = CsvParser_getRow(csvparser)) ) {
+                char **rowFields = CsvParser_getFields(row);
+                int n = CsvParser_getNumFields(row);
+                
+                w.new_row();
+                for (int i = 0; i < n; ++i) {
+                    if (i == 0) {
+                        w.add_string(OBNsim::Utils::trim(std::string(rowFields[0])));
+                    } else if (i == 1) {
+                        w.add_int(std::strtol(rowFields[1], nullptr, 0));
+                    } else {
+                        w.add_double(std::strtod(rowFields[i], nullptr));
+                    }
+                }
+                
+                CsvParser_destroy_row(row);
+            }
+            
+            CsvParser_destroy(csvparser);
+            w.write(out);
+        });
+        table.reset(new SharedTable(data));
+    }
+    catch (std::exception& e) {
+        std::cout << "[ERROR] Could not load the CSV file: " << e.what() << std::endl;
+        return empty_result;
+    }
+    
+    for (std::size_t r = 0; r < table->rows(); ++r) {
+        int krow = r + 1;
         
-        int n = CsvParser_getNumFields(row);
+        int n = table->cols(r);
         if (n < 2) {
             // At least two fields must be provided
             std::cout << "[ERROR] Row #" << krow << " in the CSV file has fewer than 2 required fields." << std::endl;
@@ -617,7 +651,7 @@ std::map<std::string, BusInfo> load_csv_bus_defs(const char* t_file) {
         }
         
         BusInfo curBus;
-        std::string curBusName = OBNsim::Utils::trim(std::string(rowFields[0]));
+        std::string curBusName = table->get_string(r, 0);
         
         // Check if the bus's name already existed in the map
         if (v.find(curBusName) != v.end()) {
@@ -626,7 +660,7 @@ std::map<std::string, BusInfo> load_csv_bus_defs(const char* t_file) {
         }
         
         // The number of users
-        int nUsers = std::strtol(rowFields[1], nullptr, 0);
+        int nUsers = table->get_int(r, 1);
         if (nUsers < 0) {
             std::cout << "[ERROR] Row #" << krow << " in the CSV file has a negative number of users." << std::endl;
             return empty_result;
@@ -640,17 +674,14 @@ std::map<std::string, BusInfo> load_csv_bus_defs(const char* t_file) {
                 return empty_result;
             }
             for (int i = 2; i < n; ++i) {
-                curBus.const_values.emplace_back(std::strtod(rowFields[i], nullptr));
+                curBus.const_values.emplace_back(table->get_double(r, i));
             }
         }
         
         curBus.nUsers = nUsers;
         v.emplace(curBusName, curBus);
-        
-        CsvParser_destroy_row(row);
     }
     
-    CsvParser_destroy(csvparser);
     return v;
 }
 
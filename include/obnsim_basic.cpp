@@ -11,6 +11,22 @@
 #include <cassert>
 #include <obnsim_basic.h>
 #include <cctype>
+#include <cstdlib>      // getenv
+#include <fstream>
+#include <mutex>
+#include <map>
+#include <memory>
+#include <thread>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 // Name of the GC port on any node
 const char *OBNsim::NODE_GC_PORT_NAME = "_gc_";
@@ -67,6 +83,21 @@ bool OBNsim::Utils::isValidNodeName(const std::string &name) {
     return (name.find("//") == std::string::npos) && (name.find("/_") == std::string::npos);
 }
 
+std::string OBNsim::Utils::encodeState(const std::vector<double>& state) {
+    return std::string(reinterpret_cast<const char*>(state.data()), state.size() * sizeof(double));
+}
+
+bool OBNsim::Utils::decodeState(const std::string& bytes, std::vector<double>& state) {
+    if (bytes.size() % sizeof(double) != 0) {
+        return false;
+    }
+    state.resize(bytes.size() / sizeof(double));
+    if (!state.empty()) {
+        std::memcpy(state.data(), bytes.data(), bytes.size());
+    }
+    return true;
+}
+
 void OBNsim::ResizableBuffer::allocateData(std::size_t newsize) {
     m_data_size = newsize;
     
@@ -85,4 +116,410 @@ void OBNsim::ResizableBuffer::allocateData(std::size_t newsize) {
         assert(m_data_allocsize >= m_data_size);
         m_data = new char[m_data_allocsize];
     }
-}
\ No newline at end of file
+}
+
+/* ================== Tracing ================== */
+
+std::atomic_bool OBNsim::Trace::g_enabled{false};
+
+namespace {
+    std::mutex trace_mutex;         // Protects the trace file
+    std::ofstream trace_file;
+    int trace_users = 0;            // Number of users of the trace (see acquireFromEnvironment()); protected by trace_mutex
+    std::atomic_int trace_next_tid{0};
+    thread_local int trace_track = -1;  // Track of the calling thread set by setThreadTrack(), -1 for its own
+    
+    // Small sequential ID of the calling thread (or its current track), which is more readable in the trace than the system thread ID
+    int trace_tid() {
+        static thread_local int tid = trace_next_tid++;
+        return (trace_track >= 0)?trace_track:tid;
+    }
+    
+    // Escape a string for JSON
+    std::string trace_escape(const std::string& s) {
+        std::string r;
+        r.reserve(s.size());
+        for (char c: s) {
+            switch (c) {
+                case '"': r += "\\\""; break;
+                case '\\': r += "\\\\"; break;
+                case '\n': r += "\\n"; break;
+                default:
+                    if (static_cast<unsigned char>(c) >= 0x20) {
+                        r += c;
+                    }
+            }
+        }
+        return r;
+    }
+    
+    // Write one line to the trace file
+    void trace_write(const std::string& line) {
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        if (trace_file.is_open()) {
+            trace_file << line << '\n';
+        }
+    }
+}
+
+bool OBNsim::Trace::start(const std::string& filename, const std::string& process_name) {
+    {
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        if (trace_file.is_open()) {
+            return false;
+        }
+        trace_file.open(filename, std::ios::out | std::ios::trunc);
+        if (!trace_file) {
+            trace_file.close();
+            return false;
+        }
+        // Name of the track; the merging tool assigns the process IDs
+        trace_file << "{\"name\":\"process_name\",\"ph\":\"M\",\"tid\":0,\"args\":{\"name\":\"" << trace_escape(process_name) << "\"}}\n";
+    }
+    g_enabled = true;
+    return true;
+}
+
+bool OBNsim::Trace::startFromEnvironment(const std::string& process_name) {
+    const char* dir = std::getenv("OBN_TRACE_DIR");
+    if (dir == nullptr || *dir == '\0') {
+        return false;
+    }
+    std::string filename(process_name);
+    for (auto& c: filename) {
+        if (c == '/') c = '.';
+    }
+    return start(std::string(dir) + '/' + filename + ".trace.json", process_name);
+}
+
+void OBNsim::Trace::stop() {
+    g_enabled = false;
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    trace_users = 0;
+    if (trace_file.is_open()) {
+        trace_file.close();
+    }
+}
+
+bool OBNsim::Trace::acquireFromEnvironment(const std::string& process_name) {
+    if (!enabled()) {
+        startFromEnvironment(process_name);
+    }
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (!trace_file.is_open()) {
+        return false;
+    }
+    ++trace_users;
+    return true;
+}
+
+void OBNsim::Trace::release() {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (trace_users > 0 && --trace_users == 0) {
+        g_enabled = false;
+        trace_file.close();
+    }
+}
+
+int OBNsim::Trace::newTrack(const std::string& name) {
+    if (!enabled()) return -1;
+    int track = trace_next_tid++;
+    trace_write("{\"name\":\"thread_name\",\"ph\":\"M\",\"tid\":" + std::to_string(track) +
+                ",\"args\":{\"name\":\"" + trace_escape(name) + "\"}}");
+    return track;
+}
+
+int OBNsim::Trace::setThreadTrack(int track) {
+    int prev = trace_track;
+    trace_track = track;
+    return prev;
+}
+
+void OBNsim::Trace::setThreadName(const std::string& name) {
+    if (!enabled()) return;
+    trace_write("{\"name\":\"thread_name\",\"ph\":\"M\",\"tid\":" + std::to_string(trace_tid()) +
+                ",\"args\":{\"name\":\"" + trace_escape(name) + "\"}}");
+}
+
+void OBNsim::Trace::complete(const std::string& name, const char* cat, int64_t ts, int64_t dur, const std::string& args) {
+    if (!enabled()) return;
+    trace_write("{\"name\":\"" + trace_escape(name) + "\",\"cat\":\"" + cat + "\",\"ph\":\"X\",\"ts\":" + std::to_string(ts) +
+                ",\"dur\":" + std::to_string(dur) + ",\"tid\":" + std::to_string(trace_tid()) +
+                ",\"args\":{" + args + "}}");
+}
+
+void OBNsim::Trace::instant(const std::string& name, const char* cat, const std::string& args) {
+    if (!enabled()) return;
+    trace_write("{\"name\":\"" + trace_escape(name) + "\",\"cat\":\"" + cat + "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" + std::to_string(now()) +
+                ",\"tid\":" + std::to_string(trace_tid()) + ",\"args\":{" + args + "}}");
+}
+
+/* ================== Metrics ================== */
+
+std::atomic_bool OBNsim::Metrics::g_enabled{false};
+
+namespace {
+    // A registered metric
+    struct MetricEntry {
+        enum { COUNTER, HISTOGRAM, GAUGE } type;
+        std::string help;
+        std::unique_ptr<OBNsim::Metrics::Counter> counter;
+        std::unique_ptr<OBNsim::Metrics::Histogram> histogram;
+        std::function<double ()> gauge;
+    };
+    
+    // All metrics, ordered by name then labels so that the metrics of the same name are written together
+    std::mutex metrics_mutex;
+    std::map<std::pair<std::string, std::string>, MetricEntry> metrics_registry;
+    
+    // The server
+    std::mutex metrics_server_mutex;    // Protects the server's state
+    std::thread metrics_server_thread;
+    std::atomic_bool metrics_server_stop{false};
+    int metrics_server_fd = -1;
+    std::string metrics_server_unix_path;
+    
+    MetricEntry& metrics_entry(const std::string& name, const std::string& labels, const std::string& help) {
+        auto& e = metrics_registry[std::make_pair(name, labels)];
+        if (!help.empty()) {
+            e.help = help;
+        }
+        return e;
+    }
+    
+    std::string metrics_name(const std::string& name, const std::string& labels) {
+        return labels.empty()?name:(name + '{' + labels + '}');
+    }
+    
+#ifndef _WIN32
+    // Serve the metrics until stopped: one HTTP/1.0 response per connection, whatever the request
+    void metrics_server_main(int fd) {
+        OBNsim::Trace::setThreadName("metrics");
+        while (!metrics_server_stop) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, 200) <= 0) {
+                continue;
+            }
+            int client = accept(fd, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            
+            // Read (and ignore) the request
+            char buf[1024];
+            pollfd cfd{client, POLLIN, 0};
+            if (poll(&cfd, 1, 1000) > 0) {
+                (void)!read(client, buf, sizeof(buf));
+            }
+            
+            std::string body = OBNsim::Metrics::render();
+            std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            const char* p = response.data();
+            std::size_t left = response.size();
+            while (left > 0) {
+                auto n = write(client, p, left);
+                if (n <= 0) {
+                    break;
+                }
+                p += n;
+                left -= n;
+            }
+            close(client);
+        }
+    }
+#endif
+}
+
+void OBNsim::Metrics::Histogram::observe(int64_t us) {
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(us, std::memory_order_relaxed);
+    
+    // The smallest bucket k with us <= 2^k
+    int k = 0;
+    while (k < NBUCKETS && us > (int64_t(1) << k)) {
+        ++k;
+    }
+    if (k < NBUCKETS) {
+        m_buckets[k].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void OBNsim::Metrics::Histogram::render(std::string& out, const std::string& name, const std::string& labels) const {
+    std::string prefix = labels.empty()?std::string():(labels + ',');
+    uint64_t cumulative = 0;
+    for (int k = 0; k < NBUCKETS; ++k) {
+        cumulative += m_buckets[k].load(std::memory_order_relaxed);
+        out += name + "_bucket{" + prefix + "le=\"" + std::to_string((int64_t(1) << k) * 1e-6) + "\"} " + std::to_string(cumulative) + '\n';
+    }
+    auto count = m_count.load(std::memory_order_relaxed);
+    out += name + "_bucket{" + prefix + "le=\"+Inf\"} " + std::to_string(count) + '\n';
+    out += metrics_name(name + "_sum", labels) + ' ' + std::to_string(m_sum.load(std::memory_order_relaxed) * 1e-6) + '\n';
+    out += metrics_name(name + "_count", labels) + ' ' + std::to_string(count) + '\n';
+}
+
+OBNsim::Metrics::Counter& OBNsim::Metrics::counter(const std::string& name, const std::string& labels, const std::string& help) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    auto& e = metrics_entry(name, labels, help);
+    if (!e.counter) {
+        e.type = MetricEntry::COUNTER;
+        e.counter.reset(new Counter());
+    }
+    return *e.counter;
+}
+
+OBNsim::Metrics::Histogram& OBNsim::Metrics::histogram(const std::string& name, const std::string& labels, const std::string& help) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    auto& e = metrics_entry(name, labels, help);
+    if (!e.histogram) {
+        e.type = MetricEntry::HISTOGRAM;
+        e.histogram.reset(new Histogram());
+    }
+    return *e.histogram;
+}
+
+void OBNsim::Metrics::gauge(const std::string& name, const std::string& labels, std::function<double ()> f, const std::string& help) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    auto& e = metrics_entry(name, labels, help);
+    e.type = MetricEntry::GAUGE;
+    e.gauge = f;
+}
+
+void OBNsim::Metrics::removeGauge(const std::string& name, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    auto it = metrics_registry.find(std::make_pair(name, labels));
+    if (it != metrics_registry.end() && it->second.type == MetricEntry::GAUGE) {
+        metrics_registry.erase(it);
+    }
+}
+
+std::string OBNsim::Metrics::render() {
+    std::string out;
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    const std::string* last_name = nullptr;
+    for (auto& m: metrics_registry) {
+        const std::string& name = m.first.first;
+        const auto& e = m.second;
+        if (!last_name || *last_name != name) {
+            // Header of a new metric family
+            if (!e.help.empty()) {
+                out += "# HELP " + name + ' ' + e.help + '\n';
+            }
+            out += "# TYPE " + name + ((e.type == MetricEntry::COUNTER)?" counter\n":((e.type == MetricEntry::HISTOGRAM)?" histogram\n":" gauge\n"));
+            last_name = &name;
+        }
+        switch (e.type) {
+            case MetricEntry::COUNTER:
+                out += metrics_name(name, m.first.second) + ' ' + std::to_string(e.counter->value()) + '\n';
+                break;
+            case MetricEntry::HISTOGRAM:
+                e.histogram->render(out, name, m.first.second);
+                break;
+            case MetricEntry::GAUGE:
+                out += metrics_name(name, m.first.second) + ' ' + std::to_string(e.gauge()) + '\n';
+                break;
+        }
+    }
+    return out;
+}
+
+bool OBNsim::Metrics::startServer(const std::string& address) {
+#ifdef _WIN32
+    return false;
+#else
+    std::lock_guard<std::mutex> lock(metrics_server_mutex);
+    if (metrics_server_fd >= 0 || address.empty()) {
+        return false;
+    }
+    
+    int fd;
+    if (address.compare(0, 5, "unix:") == 0) {
+        // Unix socket
+        std::string path = address.substr(5);
+        sockaddr_un addr;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            return false;
+        }
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        unlink(path.c_str());   // Remove a stale socket of a previous run
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return false;
+        }
+        metrics_server_unix_path = path;
+    } else {
+        // TCP port on localhost only
+        char* end;
+        long port = std::strtol(address.c_str(), &end, 10);
+        if (*end != '\0' || port <= 0 || port > 65535) {
+            return false;
+        }
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return false;
+        }
+    }
+    
+    if (listen(fd, 8) != 0) {
+        close(fd);
+        return false;
+    }
+    
+    metrics_server_fd = fd;
+    metrics_server_stop = false;
+    metrics_server_thread = std::thread(metrics_server_main, fd);
+    g_enabled = true;
+    return true;
+#endif
+}
+
+bool OBNsim::Metrics::startServerFromEnvironment(const std::string& process_name) {
+    const char* dir = std::getenv("OBN_METRICS_DIR");
+    if (dir == nullptr || *dir == '\0') {
+        return false;
+    }
+    std::string filename(process_name);
+    for (auto& c: filename) {
+        if (c == '/') c = '.';
+    }
+    return startServer("unix:" + std::string(dir) + '/' + filename + ".metrics.sock");
+}
+
+void OBNsim::Metrics::stopServer() {
+#ifndef _WIN32
+    std::lock_guard<std::mutex> lock(metrics_server_mutex);
+    if (metrics_server_fd < 0) {
+        return;
+    }
+    g_enabled = false;
+    metrics_server_stop = true;
+    if (metrics_server_thread.joinable()) {
+        metrics_server_thread.join();
+    }
+    close(metrics_server_fd);
+    metrics_server_fd = -1;
+    if (!metrics_server_unix_path.empty()) {
+        unlink(metrics_server_unix_path.c_str());
+        metrics_server_unix_path.clear();
+    }
+#endif
+}
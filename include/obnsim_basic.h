@@ -14,6 +14,9 @@
 #include <cstdint>
 #include <string>
 #include <chrono>
+#include <atomic>
+#include <functional>
+#include <vector>
 
 namespace OBNsim {
     // Some constants
@@ -57,8 +60,203 @@ namespace OBNsim {
          \return true if name is a valid node name.
          */
         bool isValidNodeName(const std::string &name);
+        
+        /** \brief Encode the state of a node (a vector of doubles) into a string of bytes, as sent in SIM_INIT and SIM_STATE_ACK messages.
+         The doubles are stored in the byte order of the host, so states are exchanged between hosts of the same byte order.
+         */
+        std::string encodeState(const std::vector<double>& state);
+        
+        /** \brief Decode the state of a node from a string of bytes encoded by encodeState().
+         \param bytes The string of bytes.
+         \param state The decoded state.
+         \return false if the string is not a valid encoded state.
+         */
+        bool decodeState(const std::string& bytes, std::vector<double>& state);
     }
     
+    /** \brief Optional tracing of the simulation execution.
+     
+     Trace events are written in the Chrome trace event format (which Perfetto also reads), one JSON object per line,
+     with timestamps in microseconds of the monotonic clock so that traces of processes on the same host line up.
+     Each process (the SMN, every node) writes its own file; the tool in utils/obntrace merges them into one trace
+     with a track per process.
+     Tracing is off until start() is called; when it is off, every tracing call is a single relaxed atomic load.
+     */
+    namespace Trace {
+        extern std::atomic_bool g_enabled;      ///< Do not use directly; use enabled()
+        
+        /** Returns true if tracing is on. */
+        inline bool enabled() {
+            return g_enabled.load(std::memory_order_relaxed);
+        }
+        
+        /** Start tracing to a file (overwritten), naming this process's track.
+         \return true if successful; false if tracing is already on or the file can't be opened.
+         */
+        bool start(const std::string& filename, const std::string& process_name);
+        
+        /** Start tracing if the environment variable OBN_TRACE_DIR is set, to the file <OBN_TRACE_DIR>/<name>.trace.json
+         where slashes in the process name are replaced by dots.
+         \return true if tracing has started.
+         */
+        bool startFromEnvironment(const std::string& process_name);
+        
+        /** Stop tracing and close the file. */
+        void stop();
+        
+        /** Start tracing as startFromEnvironment() if it is not on yet, then count the caller as a user of the trace.
+         This is for processes hosting several nodes (e.g. the external interface), which share the trace file of the process.
+         \return true if tracing is on, in which case the caller must call release() when it terminates.
+         */
+        bool acquireFromEnvironment(const std::string& process_name);
+        
+        /** Release the trace acquired by acquireFromEnvironment(); the last user stops tracing. */
+        void release();
+        
+        /** Create a new named track in the trace, e.g. for a node hosted in a thread shared with other nodes.
+         \return The ID of the track, or -1 if tracing is off.
+         */
+        int newTrack(const std::string& name);
+        
+        /** Make the events of the calling thread go to a track (created by newTrack()), or to the thread's own track if track < 0.
+         \return The previous track of the thread (-1 for its own).
+         */
+        int setThreadTrack(int track);
+        
+        /** Current timestamp in microseconds of the monotonic clock. */
+        inline int64_t now() {
+            return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        
+        /** Name the track of the calling thread. */
+        void setThreadName(const std::string& name);
+        
+        /** Write a complete (duration) event.
+         \param args Body of the JSON args object, e.g. "\"t\":10", or empty.
+         */
+        void complete(const std::string& name, const char* cat, int64_t ts, int64_t dur, const std::string& args = std::string());
+        
+        /** Write an instant event at the current time. */
+        void instant(const std::string& name, const char* cat, const std::string& args = std::string());
+        
+        /** A complete event covering the lifetime of this object, if tracing was on at its construction. */
+        class Scope {
+            const char* m_name;
+            const char* m_cat;
+            int64_t m_start;
+            std::string m_args;
+        public:
+            Scope(const char* name, const char* cat): m_name(name), m_cat(cat), m_start(enabled()?now():-1) { }
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            
+            ~Scope() {
+                if (m_start >= 0) {
+                    complete(m_name, m_cat, m_start, now() - m_start, m_args);
+                }
+            }
+            
+            /** Returns true if this scope will be written; build arguments only if it is. */
+            bool active() const { return m_start >= 0; }
+            
+            /** Set the body of the args object. */
+            void args(const std::string& a) { m_args = a; }
+        };
+        
+        /** Sets the track of the calling thread (see setThreadTrack()) for the lifetime of this object, then restores the previous one. */
+        class TrackScope {
+            int m_prev;
+        public:
+            explicit TrackScope(int track): m_prev(setThreadTrack(track)) { }
+            TrackScope(const TrackScope&) = delete;
+            TrackScope& operator=(const TrackScope&) = delete;
+            
+            ~TrackScope() {
+                setThreadTrack(m_prev);
+            }
+        };
+    }
+
+    /** \brief Optional live metrics of the simulation execution.
+
+     Counters, histograms and gauges are registered by name (and an optional label set, e.g. "port=\"/n/u\"") and served
+     in the Prometheus text format by a small HTTP server on a localhost TCP port or a Unix socket, so that a running
+     SMN or node can be watched (e.g. with curl or Prometheus) without attaching a debugger.
+     Metrics are off until startServer() is called; instrumented code checks enabled() and registers its metrics lazily,
+     keeping the returned references, so that when metrics are off every call site is a single relaxed atomic load.
+     Registered counters and histograms are never destroyed.
+     */
+    namespace Metrics {
+        extern std::atomic_bool g_enabled;      ///< Do not use directly; use enabled()
+
+        /** Returns true if the metrics server is running. */
+        inline bool enabled() {
+            return g_enabled.load(std::memory_order_relaxed);
+        }
+
+        /** A monotonic counter. */
+        class Counter {
+            std::atomic<uint64_t> m_value{0};
+        public:
+            void inc(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+            uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+        };
+
+        /** A histogram of durations in microseconds, with power-of-two buckets from 1 us to about 8 s. */
+        class Histogram {
+        public:
+            static constexpr int NBUCKETS = 24;     ///< Bucket k counts the values <= 2^k us; larger values are only in the total count
+        private:
+            std::atomic<uint64_t> m_buckets[NBUCKETS];
+            std::atomic<uint64_t> m_count{0};
+            std::atomic<int64_t> m_sum{0};
+        public:
+            Histogram() {
+                for (auto& b: m_buckets) {
+                    b.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            /** Record a duration in microseconds. */
+            void observe(int64_t us);
+
+            /** Write this histogram in the Prometheus text format (values in seconds). */
+            void render(std::string& out, const std::string& name, const std::string& labels) const;
+        };
+
+        /** Get (registering if necessary) the counter with the given name and labels. */
+        Counter& counter(const std::string& name, const std::string& labels = std::string(), const std::string& help = std::string());
+
+        /** Get (registering if necessary) the histogram with the given name and labels. */
+        Histogram& histogram(const std::string& name, const std::string& labels = std::string(), const std::string& help = std::string());
+
+        /** Register (or replace) a gauge whose value is computed by a function when the metrics are read.
+         The function is called from the server thread, so it must be thread-safe; it must be removed with removeGauge() before the objects it uses are destroyed.
+         */
+        void gauge(const std::string& name, const std::string& labels, std::function<double ()> f, const std::string& help = std::string());
+
+        /** Remove a gauge; when this function returns, its function is not being called and will not be called again. */
+        void removeGauge(const std::string& name, const std::string& labels = std::string());
+
+        /** All metrics in the Prometheus text format. */
+        std::string render();
+
+        /** Start serving the metrics.
+         \param address A TCP port number on localhost (e.g. "9100") or a Unix socket path prefixed by "unix:" (e.g. "unix:/tmp/smn.sock").
+         \return true if successful; false if the server is already running or the address can't be used.
+         */
+        bool startServer(const std::string& address);
+
+        /** Start serving the metrics if the environment variable OBN_METRICS_DIR is set, on the Unix socket <OBN_METRICS_DIR>/<name>.metrics.sock
+         where slashes in the process name are replaced by dots.
+         \return true if the server has started.
+         */
+        bool startServerFromEnvironment(const std::string& process_name);
+
+        /** Stop the server. */
+        void stopServer();
+    }
+
     /** A resizable buffer, used to store data for messages. */
     class ResizableBuffer {
         /** The binary data of the message */
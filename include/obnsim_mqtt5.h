@@ -0,0 +1,138 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief MQTT v5 support shared by the MQTT clients of the SMN and of the nodes: client creation, connection options and topic aliases.
+ *
+ * Requires the Paho MQTT C library (asynchronous API).
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#ifndef OBNSIM_MQTT5_H
+#define OBNSIM_MQTT5_H
+
+#include <string>
+#include <mutex>
+#include <unordered_map>
+
+#include "MQTTAsync.h"
+
+namespace OBNsim {
+    namespace MQTT5 {
+
+        /** Create an MQTT client, with MQTT v5 if v5 is true (e.g. to use topic aliases), otherwise with the default version.
+         \return The result code of the Paho library.
+         */
+        inline int createClient(MQTTAsync* client, const std::string& address, const std::string& client_id, bool v5) {
+            if (!v5) {
+                return MQTTAsync_create(client, address.c_str(), client_id.c_str(), MQTTCLIENT_PERSISTENCE_NONE, NULL);
+            }
+            MQTTAsync_createOptions create_opts = MQTTAsync_createOptions_initializer;
+            create_opts.MQTTVersion = MQTTVERSION_5;
+            return MQTTAsync_createWithOptions(client, address.c_str(), client_id.c_str(), MQTTCLIENT_PERSISTENCE_NONE, NULL, &create_opts);
+        }
+
+        /** The callbacks of a connection request, in both MQTT versions; the client calls those of the version it was created with. */
+        struct ConnectCallbacks {
+            MQTTAsync_onSuccess* onSuccess;
+            MQTTAsync_onFailure* onFailure;
+            MQTTAsync_onSuccess5* onSuccess5;
+            MQTTAsync_onFailure5* onFailure5;
+        };
+
+        /** Start connecting a client created by createClient(), with a clean session and the given callbacks.
+         \return The result code of the Paho library.
+         */
+        inline int connect(MQTTAsync client, bool v5, const ConnectCallbacks& callbacks, void* context) {
+            MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
+            if (v5) {
+                MQTTAsync_connectOptions conn_opts5 = MQTTAsync_connectOptions_initializer5;
+                conn_opts = conn_opts5;
+                conn_opts.cleanstart = 1;
+                conn_opts.onSuccess5 = callbacks.onSuccess5;
+                conn_opts.onFailure5 = callbacks.onFailure5;
+            } else {
+                conn_opts.cleansession = 1;
+                conn_opts.onSuccess = callbacks.onSuccess;
+                conn_opts.onFailure = callbacks.onFailure;
+            }
+            conn_opts.keepAliveInterval = 20;
+            conn_opts.context = context;
+
+            return MQTTAsync_connect(client, &conn_opts);
+        }
+
+        /** Convert the failure data of MQTT v5 to that of the default version, so that a v5 failure callback can forward to the default one. */
+        inline MQTTAsync_failureData failureData(const MQTTAsync_failureData5* response) {
+            MQTTAsync_failureData data;
+            data.token = response?response->token:0;
+            data.code = response?response->code:0;
+            data.message = response?response->message:nullptr;
+            return data;
+        }
+
+        /** \brief Topic aliases of an MQTT v5 client.
+
+         The first message to a topic carries the topic and its alias, the next messages only carry the alias.
+         Aliases are valid for the current network connection only, so they must be reset whenever the client (re)connects.
+         The object is thread-safe.
+         */
+        class TopicAliases {
+            int m_max{0};           ///< Maximum topic alias accepted by the broker (0 if the broker does not accept aliases)
+            std::unordered_map<std::string, int> m_aliases;    ///< Aliases of the topics published so far
+            std::mutex m_mutex;     ///< Mutex to access the aliases; also keeps the order of the messages sent by different threads
+
+        public:
+            /** Reset the aliases after a (re)connection, given the CONNACK properties of the broker (nullptr if none). */
+            void reset(const MQTTProperties* props) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_aliases.clear();
+
+                // The broker does not accept aliases if it does not send its Topic Alias Maximum
+                int alias_max = props?MQTTProperties_getNumericValue(const_cast<MQTTProperties*>(props), MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM):0;
+                m_max = (alias_max > 0)?alias_max:0;
+            }
+
+            /** Maximum topic alias accepted by the broker (0 if the broker does not accept aliases). */
+            int max() {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_max;
+            }
+
+            /** Send a message, with the alias of its topic (assigning one if possible).
+             \param pubmsg The message; its properties must be empty, and are left empty.
+             \return The result code of the Paho library.
+             */
+            int send(MQTTAsync client, const std::string& topic, MQTTAsync_message& pubmsg, MQTTAsync_responseOptions* opts) {
+                // The lock is held until the message is queued so that a message without topic can't overtake the message that sets its alias
+                std::lock_guard<std::mutex> lock(m_mutex);
+                const char* topicName = topic.c_str();
+                int alias = 0;
+                auto found = m_aliases.find(topic);
+                if (found != m_aliases.end()) {
+                    alias = found->second;
+                    topicName = "";     // Only the alias is sent
+                } else if (static_cast<int>(m_aliases.size()) < m_max) {
+                    alias = m_aliases.size() + 1;
+                    m_aliases.emplace(topic, alias);    // This message sets the alias
+                }
+
+                if (alias > 0) {
+                    MQTTProperty property;
+                    property.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS;
+                    property.value.integer2 = alias;
+                    MQTTProperties_add(&pubmsg.properties, &property);
+                }
+
+                // Request to send the message; the properties are copied
+                int rc = MQTTAsync_sendMessage(client, topicName, &pubmsg, opts);
+                MQTTProperties_free(&pubmsg.properties);
+                return rc;
+            }
+        };
+    }
+}
+
+#endif // OBNSIM_MQTT5_H
@@ -360,6 +360,8 @@ namespace NodeChai {
     /** API bindings for general IO utility functions. */
     std::shared_ptr<chaiscript::Module> nodechai_api_utils_io(std::shared_ptr<chaiscript::Module> m) {
         m->add(fun(&NodeChai::extras::load_csv_into_chai), "load_csv_file");
+        m->add(fun(&NodeChai::extras::load_csv_shared), "load_csv_shared");
+        NodeChai::extras::bind_SharedTable(m);
         NodeChai::extras::bind_CSVFileWriter(m);
         
         return m;
@@ -421,7 +423,7 @@ namespace NodeChai {
         switch (global_variables.comm_protocol) {
             case OBNnode::COMM_MQTT:
 #ifdef OBNNODE_COMM_MQTT
-                global_variables.node_factory.reset(new NodeFactoryMQTT(global_variables.mqtt_server));
+                global_variables.node_factory.reset(new NodeFactoryMQTT(global_variables.mqtt_server, global_variables.mqtt_topic_aliases));
 #else
                 throw nodechai_exception("MQTT is not supported.");
 #endif
@@ -481,6 +483,13 @@ namespace NodeChai {
             global_variables.mqtt_server = s;
         }), "set_comm_mqtt");
         
+        m->add(fun([](bool b) {
+            if (global_variables.node_created) {
+                throw nodechai_exception("set_mqtt_topic_aliases can only be called before a node is created.");
+            }
+            global_variables.mqtt_topic_aliases = b;
+        }), "set_mqtt_topic_aliases");
+        
         m->add(fun([](const double to) { global_variables.timeout = to; }), "set_timeout");
         
         ////// Function to actually create the node
@@ -509,6 +518,192 @@ namespace NodeChai {
         m->add(fun(&T::clearMsgRcvCallback), "clear_callback_msgrcv");
     }
     
+    /* Bulk access to vector/matrix ports: the data is moved between the port buffers and existing Eigen objects (MatrixD in scripts)
+     in one operation, without creating new matrices on each call. */
+    
+    /** Throw if matrix x does not have the given size. */
+    void check_port_operand(const std::string& port, const Eigen::MatrixXd& x, Eigen::DenseIndex rows, Eigen::DenseIndex cols) {
+        if (x.rows() != rows || x.cols() != cols) {
+            throw nodechai_exception("Operand of size " + std::to_string(x.rows()) + "x" + std::to_string(x.cols()) +
+                                     " does not match port " + port + " of size " + std::to_string(rows) + "x" + std::to_string(cols) + ".");
+        }
+    }
+    
+    /** Check if two dense Eigen objects share (part of) their storage, e.g. when a script passes the same matrix as the destination and an operand.
+     A product must then be evaluated into a temporary, i.e. assigned without noalias(). */
+    template <typename A, typename B>
+    bool shares_storage(const A& a, const B& b) {
+        if (a.size() == 0 || b.size() == 0) {
+            return false;
+        }
+        const double* pa = a.data();
+        const double* pb = b.data();
+        return pa < pb + b.size() && pb < pa + a.size();
+    }
+    
+    template <typename T>
+    void bindings_for_eigen_nonstrict_input(std::shared_ptr<chaiscript::Module> m) {
+        // Read the current value into an existing matrix (reusing its storage if the size is unchanged)
+        m->add(fun([](T& p, Eigen::MatrixXd& dst) {
+            auto v = p.lock_and_get();
+            dst = *v;
+        }), "read_into");
+        
+        // dst = A * value, computed directly on the port buffer
+        m->add(fun([](T& p, const Eigen::MatrixXd& A, Eigen::MatrixXd& dst) {
+            auto v = p.lock_and_get();
+            if (A.cols() != (*v).rows()) {
+                throw nodechai_exception("Matrix of " + std::to_string(A.cols()) + " columns cannot multiply port " + p.getPortName() + " of " + std::to_string((*v).rows()) + " rows.");
+            }
+            if (shares_storage(dst, A)) {
+                dst = A * (*v);
+            } else {
+                dst.noalias() = A * (*v);
+            }
+        }), "mult_into");
+    }
+    
+    template <typename T>
+    void bindings_for_eigen_strict_input(std::shared_ptr<chaiscript::Module> m) {
+        // Pop the front value into an existing matrix; returns false if the queue is empty
+        m->add(fun([](T& p, Eigen::MatrixXd& dst) {
+            if (p.size() == 0) {
+                return false;
+            }
+            auto v = p.pop();
+            dst = *v;
+            return true;
+        }), "pop_into");
+    }
+    
+    /** In-place operations on the value of a vector output port. Matrix operands must be column or row vectors of the right size. */
+    template <typename T>
+    void bindings_for_eigen_vector_output(std::shared_ptr<chaiscript::Module> m) {
+        // Write to vector output directly: the value must be a row or column vector
+        m->add(fun([](T& p, const Eigen::MatrixXd& v) {
+            if (v.cols() == 1) {
+                *p = v.col(0);
+            } else if (v.rows() == 1) {
+                *p = v.row(0).transpose();
+            } else {
+                throw nodechai_exception(std::string("Vector output port ") + p.getPortName() + " expects a vector but got a matrix.");
+            }
+        }), "set");
+        m->add(fun([](T& p, Eigen::MatrixXd& dst) { dst = p(); }), "read_into");
+        m->add(fun([](T& p) { (*p).setZero(); }), "set_zero");
+        m->add(fun([](T& p, const double a) { *p *= a; }), "scale");
+        
+        // value += a * x
+        m->add(fun([](T& p, const double a, const Eigen::MatrixXd& x) {
+            auto& v = *p;
+            if (x.size() != v.size() || (x.cols() != 1 && x.rows() != 1)) {
+                check_port_operand(p.getPortName(), x, v.size(), 1);
+            }
+            v += a * Eigen::Map<const Eigen::VectorXd>(x.data(), x.size());
+        }), "add_scaled");
+        
+        // value = A * x
+        m->add(fun([](T& p, const Eigen::MatrixXd& A, const Eigen::MatrixXd& x) {
+            if (x.cols() != 1 || A.cols() != x.rows()) {
+                throw nodechai_exception("Product for vector output port " + p.getPortName() + " needs a matrix and a column vector of matching sizes.");
+            }
+            auto& v = *p;
+            if (shares_storage(v, A) || shares_storage(v, x)) {
+                v = A * x.col(0);
+            } else {
+                v.noalias() = A * x.col(0);
+            }
+        }), "set_product");
+    }
+    
+    /** In-place operations on the value of a matrix output port. */
+    template <typename T>
+    void bindings_for_eigen_matrix_output(std::shared_ptr<chaiscript::Module> m) {
+        m->add(fun([](T& p, const Eigen::MatrixXd& v) { *p = v; }), "set");
+        m->add(fun([](T& p, Eigen::MatrixXd& dst) { dst = p(); }), "read_into");
+        
+        // Direct reference to the port's matrix (marks the port as changed), for any other operation of MatrixD
+        m->add(fun([](T& p) -> Eigen::MatrixXd& { return *p; }), "value");
+        
+        m->add(fun([](T& p) { (*p).setZero(); }), "set_zero");
+        m->add(fun([](T& p, const double a) { *p *= a; }), "scale");
+        
+        // value += a * x
+        m->add(fun([](T& p, const double a, const Eigen::MatrixXd& x) {
+            auto& v = *p;
+            check_port_operand(p.getPortName(), x, v.rows(), v.cols());
+            v += a * x;
+        }), "add_scaled");
+        
+        // value = A * B
+        m->add(fun([](T& p, const Eigen::MatrixXd& A, const Eigen::MatrixXd& B) {
+            if (A.cols() != B.rows()) {
+                throw nodechai_exception("Product for matrix output port " + p.getPortName() + " has operands of incompatible sizes.");
+            }
+            auto& v = *p;
+            if (shares_storage(v, A) || shares_storage(v, B)) {
+                v = A * B;     // e.g. p.set_product(A, p.value())
+            } else {
+                v.noalias() = A * B;
+            }
+        }), "set_product");
+    }
+    
+    /** Throw if k is not a valid index of the vectors in a port array. */
+    template <typename T>
+    std::size_t check_array_index(const T& p, const int k) {
+        if (k < 0 || static_cast<std::size_t>(k) >= p.size()) {
+            throw nodechai_exception("Index " + std::to_string(k) + " is out of range for port array " + p.getPortName() + " of size " + std::to_string(p.size()) + ".");
+        }
+        return static_cast<std::size_t>(k);
+    }
+    
+    /** Bindings of a port array of vectors, whose values are stored in the columns of a matrix. */
+    template <typename T>
+    void bindings_for_input_array(const char* TNAME, std::shared_ptr<chaiscript::Module> m) {
+        m->add(user_type<T>(), TNAME);
+        m->add(fun([](const T& p) { return p.isValuePending(); }), "pending");
+        m->add(fun([](const T& p, const int k) { return p.isValuePending(check_array_index(p, k)); }), "pending");
+        m->add(fun([](const T& p) { return static_cast<int>(p.numValuesPending()); }), "num_pending");
+        m->add(fun([](T& p, const std::function<void ()>& f) { p.setMsgRcvCallback(f, true); }), "callback_msgrcv");
+        m->add(fun(&T::clearMsgRcvCallback), "clear_callback_msgrcv");
+        m->add(fun([](const T& p) { return static_cast<int>(p.size()); }), "size");
+        m->add(fun([](const T& p) { return static_cast<int>(p.width()); }), "width");
+        m->add(fun([](T& p) { return Eigen::MatrixXd(p.get()); }), "get");
+        m->add(fun([](T& p, const int k) { return Eigen::MatrixXd(p.get(check_array_index(p, k))); }), "get");
+        bindings_for_eigen_nonstrict_input<T>(m);
+    }
+    
+    /** Bindings of an output port array; the size of its matrix can't be changed, so there is no direct access to it. */
+    template <typename T>
+    void bindings_for_output_array(const char* TNAME, std::shared_ptr<chaiscript::Module> m) {
+        m->add(user_type<T>(), TNAME);
+        m->add(fun([](const T& p) { return static_cast<int>(p.size()); }), "size");
+        m->add(fun([](const T& p) { return static_cast<int>(p.width()); }), "width");
+        m->add(fun([](const T& p) { return Eigen::MatrixXd(p()); }), "get");
+        m->add(fun([](const T& p, const int k) { return Eigen::MatrixXd(p().col(check_array_index(p, k))); }), "get");
+        m->add(fun([](const T& p, Eigen::MatrixXd& dst) { dst = p(); }), "read_into");
+        
+        // Set all the vectors (a width x N matrix)
+        m->add(fun([](T& p, const Eigen::MatrixXd& v) {
+            check_port_operand(p.getPortName(), v, p.width(), p.size());
+            p.set(v);
+        }), "set");
+        
+        // Set the k-th vector only (a row or column vector of the array's width)
+        m->add(fun([](T& p, const int k, const Eigen::MatrixXd& v) {
+            const auto i = check_array_index(p, k);
+            if (v.size() != static_cast<Eigen::DenseIndex>(p.width()) || (v.cols() != 1 && v.rows() != 1)) {
+                check_port_operand(p.getPortName(), v, p.width(), 1);
+            }
+            p.set(i, Eigen::Map<const Eigen::VectorXd>(v.data(), v.size()));
+        }), "set");
+        
+        m->add(fun([](T& p) { (*p).setZero(); }), "set_zero");
+        m->add(fun([](T& p, const double a) { *p *= a; }), "scale");
+        m->add(fun(&T::sendSync), "sendSync");
+    }
+    
     std::shared_ptr<chaiscript::Module> NodeFactoryMQTT::create_bindings(std::shared_ptr<chaiscript::Module> m) {
         
         ////////////////////////////////////////////////////////////////
@@ -528,35 +723,33 @@ namespace NodeChai {
         
         bindings_for_nonstrict_input<NodeFactoryMQTT::InputVectorDouble>("InputVectorDouble", m);
         m->add(fun([](NodeFactoryMQTT::InputVectorDouble& p) { return Eigen::MatrixXd(p.get()); }), "get");
+        bindings_for_eigen_nonstrict_input<NodeFactoryMQTT::InputVectorDouble>(m);
         
         bindings_for_strict_input<NodeFactoryMQTT::InputVectorDoubleStrict>("InputVectorDoubleStrict", m);
         m->add(fun([](NodeFactoryMQTT::InputVectorDoubleStrict& p) { return Eigen::MatrixXd(*p.pop()); }), "pop");
+        bindings_for_eigen_strict_input<NodeFactoryMQTT::InputVectorDoubleStrict>(m);
         
         m->add(user_type<NodeFactoryMQTT::OutputVectorDouble>(), "OutputVectorDouble");
         m->add(fun([](NodeFactoryMQTT::OutputVectorDouble& p) { return Eigen::MatrixXd(p()); }), "get");
-        // Write to vector output: the value must be a row or column vector
-        m->add(fun([](NodeFactoryMQTT::OutputVectorDouble& p, const Eigen::MatrixXd& v) {
-            if (v.cols() == 1) {
-                p = Eigen::VectorXd(v);
-            } else if (v.rows() == 1) {
-                p = Eigen::VectorXd(v.transpose());
-            } else {
-                throw nodechai_exception(std::string("Vector output port ") + p.getPortName() + " expects a vector but got a matrix.");
-            }
-        }), "set");
+        bindings_for_eigen_vector_output<NodeFactoryMQTT::OutputVectorDouble>(m);
         m->add(fun(&NodeFactoryMQTT::OutputVectorDouble::sendSync), "sendSync");
         
         bindings_for_nonstrict_input<NodeFactoryMQTT::InputMatrixDouble>("InputMatrixDouble", m);
         m->add(fun(&NodeFactoryMQTT::InputMatrixDouble::get), "get");
+        bindings_for_eigen_nonstrict_input<NodeFactoryMQTT::InputMatrixDouble>(m);
         
         bindings_for_strict_input<NodeFactoryMQTT::InputMatrixDoubleStrict>("InputMatrixDoubleStrict", m);
         m->add(fun([](NodeFactoryMQTT::InputMatrixDoubleStrict& p) { return *p.pop(); }), "pop");
+        bindings_for_eigen_strict_input<NodeFactoryMQTT::InputMatrixDoubleStrict>(m);
 
         m->add(user_type<NodeFactoryMQTT::OutputMatrixDouble>(), "OutputMatrixDouble");
         m->add(fun([](NodeFactoryMQTT::OutputMatrixDouble& p) { return p(); }), "get");
-        m->add(fun([](NodeFactoryMQTT::OutputMatrixDouble& p, const Eigen::MatrixXd& v) { p = v; }), "set");
+        bindings_for_eigen_matrix_output<NodeFactoryMQTT::OutputMatrixDouble>(m);
         m->add(fun(&NodeFactoryMQTT::OutputMatrixDouble::sendSync), "sendSync");
         
+        bindings_for_input_array<NodeFactoryMQTT::InputArrayDouble>("InputArrayDouble", m);
+        bindings_for_output_array<NodeFactoryMQTT::OutputArrayDouble>("OutputArrayDouble", m);
+        
         ////////////////////////////////////////////////////////////////
         // Methods to create ports
         ////////////////////////////////////////////////////////////////
@@ -572,6 +765,20 @@ namespace NodeChai {
         m->add(fun(&NodeFactoryMQTT::chai_create_input<InputMatrixDouble>, this), "new_input_double_matrix");
         m->add(fun(&NodeFactoryMQTT::chai_create_input<InputMatrixDoubleStrict>, this), "new_input_double_matrix_strict");
         m->add(fun(&NodeFactoryMQTT::chai_create_output<OutputMatrixDouble>, this), "new_output_double_matrix");
+        
+        // Port arrays of n vectors of the given width: new_input_double_array(name, n, width)
+        m->add(fun([this](const std::string& t_name, const int n, const int width) {
+            if (n < 0 || width < 0) {
+                throw nodechai_exception("Port array " + t_name + " must have a non-negative size and width.");
+            }
+            return chai_create_input<InputArrayDouble>(t_name, static_cast<std::size_t>(n), static_cast<std::size_t>(width));
+        }), "new_input_double_array");
+        m->add(fun([this](const std::string& t_name, const int n, const int width) {
+            if (n < 0 || width < 0) {
+                throw nodechai_exception("Port array " + t_name + " must have a non-negative size and width.");
+            }
+            return chai_create_output<OutputArrayDouble>(t_name, static_cast<std::size_t>(n), static_cast<std::size_t>(width));
+        }), "new_output_double_array");
 
         return m;
     }
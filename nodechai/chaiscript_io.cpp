@@ -11,6 +11,8 @@
 #include <csvparser/csvparser.h>
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <functional>
 #include "nodechai.h"
 #include "chaiscript_io.h"
 #include <chaiscript/chaiscript.hpp>
@@ -21,88 +23,160 @@ using namespace NodeChai;
 //**************************************
 //* Implementation of loading a CSV file
 //**************************************
+namespace {
+    /** Parse a CSV file, calling a function for each non-empty row with its fields, at most as many as the characters of t_format.
+     The arguments are the same as load_csv_into_chai(); if there is any error, an exception will be thrown.
+     */
+    void parse_csv(const std::string& t_file, const std::string& t_format, const std::string& t_delimiter, bool t_header,
+                   const std::function<void (char** fields, int n)>& f)
+    {
+        // Check delimiter
+        const char *delimiter = NULL;
+        if (!t_delimiter.empty()) {
+            delimiter = t_delimiter.c_str();
+        }
+        
+        // Check format string
+        if (t_format.empty()) {
+            throw nodechai_exception("The format string must be specified.");
+        }
+        
+        std::size_t pos = t_format.find_first_not_of("dis");
+        if (pos != std::string::npos) {
+            throw nodechai_exception(std::string("The format string contains an invalid character: ") + t_format[pos]);
+        }
+        
+        int nfields = t_format.size();
+        
+        CsvParser *csvparser = CsvParser_new(t_file.c_str(), delimiter, t_header);
+        
+        if (t_header) {
+            CsvRow *header = CsvParser_getHeader(csvparser);
+            if (header == NULL) {
+                throw nodechai_exception(CsvParser_getErrorMessage(csvparser));
+            }
+            //char **headerFields = CsvParser_getFields(header);
+            //for (auto i = 0 ; i < CsvParser_getNumFields(header) ; i++) {
+            //    //printf("TITLE: %s\n", headerFields[i]);
+            //}
+            
+            // Do NOT destroy the headear manually if you plan to destroy the parser later.
+            // If you destroy both header and parser, you will get double free runtime error
+            // CsvParser_destroy_row(header);
+        }
+        
+        CsvRow *row;
+        
+        while ((row = CsvParser_getRow(csvparser)) ) {
+            int n = CsvParser_getNumFields(row);
+            if (n > 0) {
+                f(CsvParser_getFields(row), std::min(n, nfields));
+            }
+            
+            CsvParser_destroy_row(row);
+        }
+        
+        CsvParser_destroy(csvparser);
+    }
+}
+
 NodeChai::extras::TChaiVector NodeChai::extras::load_csv_into_chai(const std::string& t_file,
                                                                    const std::string& t_format,
                                                                    const std::string& t_delimiter,
                                                                    bool t_header)
 {
-    // Check delimiter
-    const char *delimiter = NULL;
-    if (!t_delimiter.empty()) {
-        delimiter = t_delimiter.c_str();
-    }
-    
-    // Check format string
-    if (t_format.empty()) {
-        throw nodechai_exception("The format string must be specified.");
-    }
-    
-    std::size_t pos = t_format.find_first_not_of("dis");
-    if (pos != std::string::npos) {
-        throw nodechai_exception(std::string("The format string contains an invalid character: ") + t_format[pos]);
-    }
-    
-    auto nfields = t_format.size();
-    
-    CsvParser *csvparser = CsvParser_new(t_file.c_str(), delimiter, t_header);
-    
-    if (t_header) {
-        CsvRow *header = CsvParser_getHeader(csvparser);
-        if (header == NULL) {
-            throw nodechai_exception(CsvParser_getErrorMessage(csvparser));
-        }
-        //char **headerFields = CsvParser_getFields(header);
-        //for (auto i = 0 ; i < CsvParser_getNumFields(header) ; i++) {
-        //    //printf("TITLE: %s\n", headerFields[i]);
-        //}
-        
-        // Do NOT destroy the headear manually if you plan to destroy the parser later.
-        // If you destroy both header and parser, you will get double free runtime error
-        // CsvParser_destroy_row(header);
-    }
-    
     // The Chaiscript's object
     NodeChai::extras::TChaiVector v;  // The entire table
     NodeChai::extras::TChaiVector vr; // Each row
     
-    CsvRow *row;
-    
-    while ((row = CsvParser_getRow(csvparser)) ) {
-        char **rowFields = CsvParser_getFields(row);
-        
-        int n = CsvParser_getNumFields(row);
-        if (n > 0) {
-            vr.clear();
-            for (int i = 0 ; i < n ; ++i) {
-                if (i >= nfields) {
-                    break;  // from reading the current row
-                }
-                switch (t_format[i]) {
-                    case 'd':  // double value
-                        vr.emplace_back(std::strtod(rowFields[i], nullptr));
-                        break;
-                        
-                    case 'i':  // integer value
-                        vr.emplace_back(std::strtol(rowFields[i], nullptr, 0));
-                        break;
-                        
-                    default:  // string
-                        vr.emplace_back(std::string(rowFields[i]));
-                        break;
-                }
+    parse_csv(t_file, t_format, t_delimiter, t_header, [&](char** rowFields, int n) {
+        vr.clear();
+        for (int i = 0 ; i < n ; ++i) {
+            switch (t_format[i]) {
+                case 'd':  // double value
+                    vr.emplace_back(std::strtod(rowFields[i], nullptr));
+                    break;
+                    
+                case 'i':  // integer value
+                    vr.emplace_back(std::strtol(rowFields[i], nullptr, 0));
+                    break;
+                    
+                default:  // string
+                    vr.emplace_back(std::string(rowFields[i]));
+                    break;
             }
-            // Insert the row vector to the result vector
-            v.emplace_back(vr);
         }
-        
-        CsvParser_destroy_row(row);
-    }
+        // Insert the row vector to the result vector
+        v.emplace_back(vr);
+    });
     
-    CsvParser_destroy(csvparser);
     return v;
 }
 
 
+OBNnode::SharedTable NodeChai::extras::load_csv_shared(const std::string& t_file,
+                                                       const std::string& t_format,
+                                                       const std::string& t_delimiter,
+                                                       bool t_header)
+{
+    std::shared_ptr<const OBNnode::SharedData> data;
+    try {
+        auto key = OBNnode::SharedData::fileKey(t_file, "csv:" + t_format + ':' + t_delimiter + ':' + (t_header?'1':'0'));
+        data = OBNnode::SharedData::get(key, [&](std::string& out) {
+            OBNnode::SharedTable::Writer w;
+            parse_csv(t_file, t_format, t_delimiter, t_header, [&](char** rowFields, int n) {
+                w.new_row();
+                for (int i = 0 ; i < n ; ++i) {
+                    switch (t_format[i]) {
+                        case 'd':
+                            w.add_double(std::strtod(rowFields[i], nullptr));
+                            break;
+                            
+                        case 'i':
+                            w.add_int(std::strtoll(rowFields[i], nullptr, 0));
+                            break;
+                            
+                        default:
+                            w.add_string(rowFields[i]);
+                            break;
+                    }
+                }
+            });
+            w.write(out);
+        });
+    }
+    catch (std::runtime_error& e) {
+        throw nodechai_exception(std::string("Could not load the shared CSV file: ") + e.what());
+    }
+    return OBNnode::SharedTable(data);
+}
+
+
+std::shared_ptr<chaiscript::Module> NodeChai::extras::bind_SharedTable(std::shared_ptr<chaiscript::Module> m) {
+    using namespace chaiscript;
+    using OBNnode::SharedTable;
+    
+    m->add(user_type<SharedTable>(), "SharedTable");
+    m->add(fun([](const SharedTable& t) { return int(t.rows()); }), "rows");
+    m->add(fun([](const SharedTable& t, int r) { return int(t.cols(r)); }), "cols");
+    
+    // A cell is returned as a double, an integer or a string, according to its type
+    m->add(fun([](const SharedTable& t, int r, int c) -> Boxed_Value {
+        switch (t.type(r, c)) {
+            case SharedTable::DOUBLE:
+                return Boxed_Value(t.get_double(r, c));
+            case SharedTable::INT:
+                return Boxed_Value(int(t.get_int(r, c)));
+            default:
+                return Boxed_Value(t.get_string(r, c));
+        }
+    }), "get");
+    m->add(fun([](const SharedTable& t, int r, int c) { return t.get_double(r, c); }), "get_double");
+    
+    return m;
+}
+
+
 //*****************************************
 //* Implementation of writing to CSV file
 //*****************************************
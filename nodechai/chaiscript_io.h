@@ -13,6 +13,7 @@
 
 #include <cstdio>
 #include <vector>
+#include <obnnode_shareddata.h>
 
 namespace chaiscript {
     class Boxed_Value;
@@ -34,6 +35,17 @@ namespace NodeChai {
         TChaiVector load_csv_into_chai(const std::string& t_file, const std::string& t_format,
                                        const std::string& t_delimiter, bool t_header);
         
+        /** \brief Load a CSV file into a table shared by all node processes on this host (see OBNnode::SharedData).
+         
+         The file is parsed only by the first process that loads it with the same arguments; the others map the parsed table read-only.
+         The arguments are the same as load_csv_into_chai(); the cells are read with get(row, col) in Chaiscript.
+         \return The shared table; if there is any error, an exception will be thrown.
+         */
+        OBNnode::SharedTable load_csv_shared(const std::string& t_file, const std::string& t_format,
+                                             const std::string& t_delimiter, bool t_header);
+        
+        std::shared_ptr<chaiscript::Module> bind_SharedTable(std::shared_ptr<chaiscript::Module> m = std::make_shared<chaiscript::Module>());
+        
         /** \brief Class to write numeric data to CSV file.
          */
         class CSVFileWriter {
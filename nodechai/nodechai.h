@@ -84,6 +84,7 @@ namespace NodeChai {
         // Common settings
         OBNnode::CommProtocol comm_protocol{OBNnode::COMM_MQTT};
         std::string mqtt_server{"tcp://localhost:1883"};
+        bool mqtt_topic_aliases{false};  // Whether to use MQTT v5 and topic aliases for publishing
         std::string node_name{""};
         std::string workspace{""};
         double timeout{-1.0}; // The timeout value for the node
@@ -39,6 +39,7 @@ namespace NodeChai {
     /** The abstract factory class for creating nodes. */
     class NodeFactoryMQTT: public NodeFactoryBase<MQTTNodeChai> {
         std::string m_mqtt_server;  ///< Address of the MQTT server
+        bool m_topic_aliases;       ///< Whether to use MQTT v5 and topic aliases for publishing
     public:
         typedef OBNnode::MQTTInput<OBNnode::OBN_PB, double> InputScalarDouble;
         typedef OBNnode::MQTTInput<OBNnode::OBN_PB, double, true> InputScalarDoubleStrict;
@@ -52,8 +53,11 @@ namespace NodeChai {
         typedef OBNnode::MQTTInput<OBNnode::OBN_PB, OBNnode::obn_matrix<double>, true> InputMatrixDoubleStrict;
         typedef OBNnode::MQTTOutput<OBNnode::OBN_PB, OBNnode::obn_matrix<double> > OutputMatrixDouble;
         
-        /** Constructor of MQTTNode factory, with given MQTT server address. */
-        NodeFactoryMQTT(const std::string& t_mqttserver): m_mqtt_server(t_mqttserver) { }
+        typedef OBNnode::MQTTInputArray<double> InputArrayDouble;
+        typedef OBNnode::MQTTOutputArray<double> OutputArrayDouble;
+        
+        /** Constructor of MQTTNode factory, with given MQTT server address and whether to use topic aliases. */
+        NodeFactoryMQTT(const std::string& t_mqttserver, bool t_topic_aliases = false): m_mqtt_server(t_mqttserver), m_topic_aliases(t_topic_aliases) { }
         
         /** Create an MQTTNode object. */
         virtual bool create_node(const std::string& t_name, const std::string& t_workspace) override {
@@ -72,6 +76,7 @@ namespace NodeChai {
             
             // Set the server settings
             m_node->setServerAddress(m_mqtt_server);
+            m_node->setTopicAliases(m_topic_aliases);
             
             // Try to open the GC port
             if (m_node->openSMNPort()) {
@@ -88,9 +93,10 @@ namespace NodeChai {
         /* These methods create inputs and outputs of various types.
          It's guaranteed that create_node() was called successfully before any of these methods is called, so the node object should have existed.
          The methods should return valid port objects if successful.
+         The extra arguments, if any, are passed to the constructor of the port after its name (e.g. the size and width of a port array).
          */
-        template <typename T>
-        std::shared_ptr<T> create_input(const std::string& t_name) {
+        template <typename T, typename... Args>
+        std::shared_ptr<T> create_input(const std::string& t_name, Args... t_args) {
             if (!check_node_object()) {
                 return nullptr;
             }
@@ -105,7 +111,7 @@ namespace NodeChai {
                 return nullptr;
             }
             
-            auto port = std::make_shared<T>(t_name);
+            auto port = std::make_shared<T>(t_name, t_args...);
             if (!port) {
                 m_last_error = std::string("Error while creating input ") + t_name + ".";
                 return nullptr;
@@ -122,17 +128,17 @@ namespace NodeChai {
             }
         }
         
-        template <typename T>
-        std::shared_ptr<T> chai_create_input(const std::string& t_name) {
-            auto p = create_input<T>(t_name);
+        template <typename T, typename... Args>
+        std::shared_ptr<T> chai_create_input(const std::string& t_name, Args... t_args) {
+            auto p = create_input<T>(t_name, t_args...);
             if (p) {
                 return p;
             }
             throw nodechai_exception(m_last_error);
         }
         
-        template <typename T>
-        std::shared_ptr<T> create_output(const std::string& t_name) {
+        template <typename T, typename... Args>
+        std::shared_ptr<T> create_output(const std::string& t_name, Args... t_args) {
             if (!check_node_object()) {
                 return nullptr;
             }
@@ -147,7 +153,7 @@ namespace NodeChai {
                 return nullptr;
             }
             
-            auto port = std::make_shared<T>(t_name);
+            auto port = std::make_shared<T>(t_name, t_args...);
             if (!port) {
                 m_last_error = std::string("Error while creating input ") + t_name + ".";
                 return nullptr;
@@ -164,9 +170,9 @@ namespace NodeChai {
             }
         }
         
-        template <typename T>
-        std::shared_ptr<T> chai_create_output(const std::string& t_name) {
-            auto p = create_output<T>(t_name);
+        template <typename T, typename... Args>
+        std::shared_ptr<T> chai_create_output(const std::string& t_name, Args... t_args) {
+            auto p = create_output<T>(t_name, t_args...);
             if (p) {
                 return p;
             }
@@ -8,6 +8,8 @@
  * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
  */
 
+#include <obnnode_shareddata.h>
+
 #ifdef OBNNODE_COMM_YARP
 #include <obnnode_yarpport.h>
 #endif
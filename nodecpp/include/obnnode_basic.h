@@ -21,7 +21,13 @@
 #include <functional>
 #include <vector>
 #include <deque>
+#include <algorithm>
+#include <limits>
 #include <exception>
+#include <cstring>              // memcpy
+#include <type_traits>
+#include <cstdint>              // uintptr_t
+#include <cassert>
 
 #include <obnsim_basic.h>
 
@@ -29,6 +35,7 @@
 #include <obnsim_io.pb.h>
 
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
 
 namespace OBNnode {
     typedef OBNsim::simtime_t simtime_t;  ///< Simulation time type, as number of nano-seconds from beginning.
@@ -80,6 +87,27 @@ namespace OBNnode {
          */
         bool open();
         
+        OBNsim::Metrics::Counter* m_metrics_msgs = nullptr;     ///< Messages through this port, registered on first use if the metrics server is running
+        OBNsim::Metrics::Counter* m_metrics_bytes = nullptr;    ///< Bytes through this port
+        
+        /** Count a message through this port if the metrics server is running.
+         A port only counts in one direction, always from the same thread (the main thread for outputs, the communication thread for inputs).
+         \param bytes Size of the message in bytes.
+         \param sent True if the message is sent by this port, false if it is received.
+         */
+        void metrics_count(std::size_t bytes, bool sent) {
+            if (OBNsim::Metrics::enabled()) {
+                if (!m_metrics_msgs) {
+                    metrics_register(sent);
+                }
+                m_metrics_msgs->inc();
+                m_metrics_bytes->inc(bytes);
+            }
+        }
+        
+        /** Register the counters of this port. */
+        void metrics_register(bool sent);
+        
         friend class NodeBase;
         
     public:
@@ -111,6 +139,17 @@ namespace OBNnode {
          See the message N2SMN:SYS_PORT_CONNECT_ACK for details.
          */
         virtual std::pair<int, std::string> connect_from_port(const std::string& source) = 0;
+        
+        /** \brief Request to establish a connection from a given port to an element of this port, if it is a port array.
+         
+         The SMN refers to element k of a port as "port[k]" (see MQTTInputArray and MQTTOutputArray).
+         \param k The index of the element.
+         \param source The full path of the source port.
+         \return A pair of the connection result and an optional error message, as connect_from_port(); by default the port is not an array.
+         */
+        virtual std::pair<int, std::string> connect_element_from_port(std::size_t k, const std::string& source) {
+            return std::make_pair(-1, "Port " + m_name + " is not a port array.");
+        }
     };
     
     /** \brief Base class for an openBuildNet input port.
@@ -160,15 +199,73 @@ namespace OBNnode {
         //void callMsgRcvCallback();
     };
     
+    /** \brief Precision of the double values of an output port on the wire.
+     
+     Double vectors and matrices can be sent with reduced precision: as float32, or in fixed point with a given scale (each value is sent as the nearest integer multiple of the scale).
+     The input ports widen the values back to double automatically, so the receiving nodes need no change.
+     Every message is checked against the error bounds before it is sent; if a value can't be represented within the bounds, or is out of range, that message is sent in full precision.
+     */
+    struct obn_precision {
+        enum precision_mode {
+            FULL,           ///< Full (64-bit) precision
+            FLOAT32,        ///< Values sent as float32
+            FIXED_POINT     ///< Values sent as integer multiples of scale
+        } mode;
+        double scale;           ///< The quantization step of FIXED_POINT (must be positive)
+        double max_abs_error;   ///< Maximum absolute error of each value, 0 if not checked
+        double max_rel_error;   ///< Maximum relative error of each value, 0 if not checked
+        
+        obn_precision(precision_mode t_mode = FULL, double t_scale = 0.0, double t_abs = 0.0, double t_rel = 0.0):
+        mode(t_mode), scale(t_scale), max_abs_error(t_abs), max_rel_error(t_rel) { }
+        
+        static obn_precision float32(double t_abs = 0.0, double t_rel = 0.0) {
+            return obn_precision(FLOAT32, 0.0, t_abs, t_rel);
+        }
+        
+        static obn_precision fixed_point(double t_scale, double t_abs = 0.0, double t_rel = 0.0) {
+            return obn_precision(FIXED_POINT, t_scale, t_abs, t_rel);
+        }
+        
+        bool isValid() const {
+            return (mode != FIXED_POINT || scale > 0.0) && max_abs_error >= 0.0 && max_rel_error >= 0.0;
+        }
+        
+        /** Check if x represents v within the error bounds. If no bound is set, only the range is checked. */
+        bool accepts(double v, double x) const {
+            if (!std::isfinite(v) || !std::isfinite(x)) {
+                // Only float32 can represent the non-finite values, exactly
+                return mode == FLOAT32 && (std::isnan(v)?std::isnan(x):(x == v));
+            }
+            if (max_abs_error <= 0.0 && max_rel_error <= 0.0) {
+                return true;
+            }
+            double e = std::abs(v - x);
+            return (max_abs_error > 0.0 && e <= max_abs_error) || (max_rel_error > 0.0 && e <= max_rel_error * std::abs(v));
+        }
+    };
+    
     /** \brief Base class for an openBuildNet output port.
      */
     class OutputPortBase: public PortBase {
     protected:
         /** Whether the value of this output has been changed (and not yet sent out).
-         The subclass should set this variable to true whenever a value is assigned, and set this variable to false whenever it sends the value out.
+         The subclass should call markChanged() whenever a value is assigned, and set this variable to false whenever it sends the value out.
          */
         bool m_isChanged;
         
+        /** The period at whose multiples the port is published, in the simulation time unit; 0 if every change is published (see setPublishPeriod()). */
+        simtime_t m_publish_period = 0;
+        
+        /** Mark the value of this output as changed, and queue the port in the list of changed outputs of its node (if not yet queued),
+         so that after an update the node only walks the ports that have been changed, instead of all its outputs.
+         */
+        inline void markChanged();
+        
+    private:
+        bool m_queued = false;  ///< Whether the port is in the list of changed outputs of its node
+        
+        friend class NodeBase;
+        
     public:
         virtual std::pair<int, std::string> connect_from_port(const std::string& source) override {
             // Connection to an output port is forbidden
@@ -182,6 +279,35 @@ namespace OBNnode {
             return m_isChanged;
         }
         
+        /** \brief Publish the port only at the multiples of a period (output decimation).
+         
+         The SMN sets this period (with the system message SYS_PORT_DECIMATE) when all the consumers of the port sample it only at the multiples of the period,
+         so the values produced in between would never be read. A changed value which is not published stays changed, so the latest value is published at the next multiple.
+         \param period The period in the simulation time unit; 0 to publish every change.
+         */
+        void setPublishPeriod(simtime_t period) {
+            m_publish_period = (period > 0)?period:0;
+        }
+        
+        simtime_t publishPeriod() const {
+            return m_publish_period;
+        }
+        
+        /** Whether a changed value must be published at the given simulation time (see setPublishPeriod()). */
+        bool isPublishedAt(simtime_t t) const {
+            return m_publish_period == 0 || t % m_publish_period == 0;
+        }
+        
+        /** \brief Set the precision of the values of this port on the wire (see obn_precision).
+         
+         The SMN sets it with the system message SYS_PORT_PRECISION, or the node can set it directly.
+         Only the ports of double vectors and matrices support reduced precision, so by default only the full precision is accepted.
+         \return true if successful; false if the precision is invalid or not supported by the port.
+         */
+        virtual bool setPrecision(const obn_precision& prec) {
+            return prec.mode == obn_precision::FULL;
+        }
+        
         /** Send the data out in a synchronous manner.
          The function should wait until the data has been sent out successfully and, if ACK is required, all ACKs have been received.
          For asynchronous sending (does not wait until writing is complete and/or all ACKs have been received), \see sendAsync().
@@ -279,6 +405,35 @@ namespace OBNnode {
             return static_cast<int64_t>(std::floor( _initial_wallclock + (_timeunit * 1.0e-6) * _current_sim_time ));
         }
         
+        /** \brief Iteration number of the current time window in the waveform relaxation coupling.
+         
+         In the waveform relaxation coupling, a node computes in UPDATE_Y the trajectories of its outputs over a whole time window (e.g. with obn_trajectory ports), from the trajectories of its inputs.
+         If its outputs have not converged, it calls requestWindowIteration() and the GC repeats the UPDATE_Y of the window with the next iteration number (up to a maximum number of iterations).
+         UPDATE_Y must therefore start from the state at the beginning of the window, which is committed only in UPDATE_X, after the window has converged.
+         \return 0 for the first pass of a window, 1 for the first repetition, etc.
+         */
+        unsigned int windowIteration() const {
+            return _window_iteration;
+        }
+        
+        /** \brief Request the GC to repeat the current time window because the outputs have not converged.
+         
+         Must be called during UPDATE_Y. See windowIteration().
+         */
+        void requestWindowIteration() {
+            _window_converged = false;
+        }
+        
+        /** \brief Index of the current micro-step at the current simulation time (superdense time).
+         
+         A node can request an update at the current simulation time (e.g. requestMicroStep() of MQTTNodeBase), for instance for the next iteration of an iterative algorithm.
+         The GC then runs the requested blocks in a micro-step right after the current step, without advancing the simulation time.
+         \return 0 for a regular update, 1 for the first micro-step at the current time, etc.
+         */
+        unsigned int microStep() const {
+            return _microstep;
+        }
+        
         /** Returns the current state of the node. */
         NODE_STATE nodeState() const {
             return _node_state;
@@ -351,6 +506,17 @@ namespace OBNnode {
         /** List of physical output ports: the second bool field specifies if the node owns the port object and should delete it when done. */
         std::forward_list< std::pair<OutputPortBase*, bool> > _output_ports;
         
+        /** Output ports whose values have been changed since they were last sent, in the order of their changes (see OutputPortBase::markChanged()).
+         A port may stay in the list after it has been sent by other means (then it's no longer changed and is skipped).
+         */
+        std::vector<OutputPortBase*> _changed_outputs;
+        friend class OutputPortBase;
+        
+        /** Send the values of the changed output ports, walking only the list of changed outputs.
+         \param decimate If true, a decimated port is only sent at the multiples of its period, otherwise it stays changed (see OutputPortBase::setPublishPeriod()).
+         */
+        void sendChangedOutputs(bool decimate);
+        
         /** Attach a port object to this node. */
         bool attachAndOpenPort(PortBase * port);
         
@@ -370,6 +536,15 @@ namespace OBNnode {
         /** The simulation time unit, in microseconds. */
         simtime_t _timeunit = 1;
         
+        /** Iteration number of the current time window (see windowIteration()). */
+        unsigned int _window_iteration = 0;
+        
+        /** False if the node requested a repetition of the current time window (see requestWindowIteration()). */
+        bool _window_converged = true;
+        
+        /** Micro-step index of the current update (see microStep()). */
+        unsigned int _microstep = 0;
+        
         /** \brief Initialize node for simulation. */
         virtual bool initializeForSimulation();
         
@@ -404,6 +579,19 @@ namespace OBNnode {
         std::size_t m_runUntilMsgRcv_counter{0};
         std::vector<bool> m_runUntilMsgRcv_bits;        ///< Bit set for recording the events, accessed from the main thread so no thread-safety measure is needed.
         
+        /* ================== Live metrics ================= */
+        
+        OBNsim::Metrics::Counter* m_metrics_events = nullptr;   ///< Events executed by this node; null if metrics are off
+        bool m_metrics_gauge = false;                           ///< Whether the gauge of the event queue depth is registered
+        
+        /** Register the metrics of this node if the metrics server is running.
+         The gauge of the event queue calls eventqueue_size(), so the class that owns the queue must call metrics_unregister() in its destructor.
+         */
+        void metrics_register();
+        
+        /** Remove the gauge of the event queue of this node. */
+        void metrics_unregister();
+        
         /* ================== Support for Node Events ================= */
     protected:
         /** Event parent class.
@@ -420,39 +608,69 @@ namespace OBNnode {
             virtual ~NodeEvent() { }                    // VERY IMPORTANT because NodeEvent will be derived; this is to make sure child classes will be destroyed cleanly
             virtual void executeMain(NodeBase*) { }     ///< Main Execution of the event
             virtual void executePost(NodeBase*) { }     ///< Post-Execution of the event
+            virtual const char* traceName() const { return "event"; }  ///< Name of the event in execution traces
             
             // Set the result of the event processing (depending on the event)
             void set_result(int64_t r) { _run_result = r; }
 
         };
         
-        /* An implementation of a node should manage a queue of NodeEvent objects, and implements the following methods. */
+        /** Priority classes of the events in the queue.
+         The main thread always executes the oldest event of the highest non-empty class, so that the commands of the GC are not delayed by bursts of events of the ports
+         and the latency of the lockstep does not depend on the data traffic of the node.
+         */
+        enum EventClass: unsigned int {
+            EVENT_CLASS_CONTROL = 0,    ///< Commands from the SMN/GC (updates, initialization, termination, port requests) and errors
+            EVENT_CLASS_COMPLETION,     ///< Callbacks and other internal events of the node
+            EVENT_CLASS_PORT,           ///< Message received events of the ports
+            NUM_EVENT_CLASSES
+        };
+        
+        /* An implementation of a node should manage a queue of NodeEvent objects, with NUM_EVENT_CLASSES priority classes, and implements the following methods. */
         
-        /** \brief Push an event object to the event queue.
+        /** \brief Push an event object to the back of its class in the event queue.
          
          This function must be implemented in a thread-safe manner w.r.t. the communication library used because it's usually called in a callback of the communication library (e.g. a Yarp thread or MQTT thread).
          */
-        virtual void eventqueue_push(NodeEvent *) = 0;
+        virtual void eventqueue_push(NodeEvent *, EventClass) = 0;
         
-        /** \brief Push an event object to the front of the event queue.
+        /** \brief Push an event object to the front of its class in the event queue.
          
          This function must be implemented in a thread-safe manner w.r.t. the communication library used because it's usually called in a callback of the communication library (e.g. a Yarp thread or MQTT thread).
          */
-        virtual void eventqueue_push_front(NodeEvent *) = 0;
+        virtual void eventqueue_push_front(NodeEvent *, EventClass) = 0;
         
-        /** \brief Wait until an event exists in the queue and pop it; may wait forever.
+        /** \brief Wait until an event exists in the queue and pop the oldest event of the highest non-empty class; may wait forever.
          
          This function is called from the main thread, not from the communication callback.
          */
         virtual std::shared_ptr<NodeEvent> eventqueue_wait_and_pop() = 0;
         
-        /** \brief Wait until an event exists in the queue and pop it; may time out.
+        /** \brief Wait until an event exists in the queue and pop the oldest event of the highest non-empty class; may time out.
          
          \param timeout In seconds.
          This function is called from the main thread, not from the communication callback.
          */
         virtual std::shared_ptr<NodeEvent> eventqueue_wait_and_pop(double timeout) = 0;
         
+        /** \brief Number of events in the event queue.
+         
+         This function may be called from any thread (e.g. the metrics server); the default implementation returns 0.
+         */
+        virtual std::size_t eventqueue_size() const {
+            return 0;
+        }
+        
+        /** Execute an event popped from the queue (main and post execution), on the main thread. */
+        void executeEvent(NodeEvent* pEvent) {
+            OBNsim::Trace::Scope trace(pEvent->traceName(), "node");
+            if (m_metrics_events) {
+                m_metrics_events->inc();
+            }
+            pEvent->executeMain(this);
+            pEvent->executePost(this);
+        }
+        
         /** Parent event class for SMN events. */
         class NodeEventSMN: public NodeEvent {
         protected:
@@ -478,11 +696,16 @@ namespace OBNnode {
         /** Event class for cosimulation's UPDATE_Y messages. */
         class NodeEvent_UPDATEY: public NodeEventSMN {
             updatemask_t _updates;
+            unsigned int _iteration;    ///< Iteration of the time window (waveform relaxation)
+            unsigned int _microstep;    ///< Micro-step at the current time
         public:
             virtual void executeMain(NodeBase*) override;
             virtual void executePost(NodeBase*) override;
+            virtual const char* traceName() const override { return "UPDATE_Y"; }
             NodeEvent_UPDATEY(const OBNSimMsg::SMN2N& msg): NodeEventSMN(msg) {
                 _updates = msg.has_i()?msg.i():0;
+                _iteration = (msg.has_data() && msg.data().has_i())?msg.data().i():0;
+                _microstep = (msg.has_data() && msg.data().has_t())?msg.data().t():0;
             }
         };
         friend NodeEvent_UPDATEY;
@@ -490,11 +713,14 @@ namespace OBNnode {
         /** Event class for cosimulation's UPDATE_X messages. */
         class NodeEvent_UPDATEX: public NodeEventSMN {
             updatemask_t _updates;
+            unsigned int _microstep;    ///< Micro-step at the current time
         public:
             virtual void executeMain(NodeBase*) override;
             virtual void executePost(NodeBase*) override;
+            virtual const char* traceName() const override { return "UPDATE_X"; }
             NodeEvent_UPDATEX(const OBNSimMsg::SMN2N& msg): NodeEventSMN(msg) {
                 _updates = msg.has_i()?msg.i():0;
+                _microstep = (msg.has_data() && msg.data().has_t())?msg.data().t():0;
             }
         };
         friend NodeEvent_UPDATEX;
@@ -503,11 +729,14 @@ namespace OBNnode {
         class NodeEvent_INITIALIZE: public NodeEventSMN {
             int64_t _wallclock;
             simtime_t _timeunit;
+            std::string _state;     ///< Encoded initial state of the node
             bool _has_wallclock = false;
             bool _has_timeunit = false;
+            bool _has_state = false;
         public:
             virtual void executeMain(NodeBase*) override;
             virtual void executePost(NodeBase*) override;
+            virtual const char* traceName() const override { return "INITIALIZE"; }
             NodeEvent_INITIALIZE(const OBNSimMsg::SMN2N& msg): NodeEventSMN(msg) {
                 if (msg.has_data()) {
                     if ((_has_wallclock = msg.data().has_t())) {
@@ -516,16 +745,29 @@ namespace OBNnode {
                     if ((_has_timeunit = msg.has_i())) {
                         _timeunit = msg.i();
                     }
+                    if ((_has_state = msg.data().has_b())) {
+                        _state = msg.data().b();
+                    }
                 }
             }
         };
         friend NodeEvent_INITIALIZE;
         
+        /** Event class for cosimulation's STATE messages (request of the state of the node). */
+        class NodeEvent_STATE: public NodeEventSMN {
+        public:
+            virtual void executeMain(NodeBase*) override;
+            virtual const char* traceName() const override { return "STATE"; }
+            NodeEvent_STATE(const OBNSimMsg::SMN2N& msg): NodeEventSMN(msg) { }
+        };
+        friend NodeEvent_STATE;
+        
         /** Event class for cosimulation's TERMINATE messages. */
         class NodeEvent_TERMINATE: public NodeEventSMN {
         public:
             virtual void executeMain(NodeBase*) override;
             virtual void executePost(NodeBase*) override;
+            virtual const char* traceName() const override { return "TERMINATE"; }
             NodeEvent_TERMINATE(const OBNSimMsg::SMN2N& msg): NodeEventSMN(msg) { }
         };
         friend NodeEvent_TERMINATE;
@@ -538,6 +780,7 @@ namespace OBNnode {
             bool _valid_msg;  ///< true if the received request message is valid
         public:
             virtual void executeMain(NodeBase*) override;
+            virtual const char* traceName() const override { return "PORT_CONNECT"; }
             
             NodeEvent_PORT_CONNECT(const OBNSimMsg::SMN2N& msg): NodeEventSMN(msg) {
                 // Extract the names of the ports
@@ -554,6 +797,45 @@ namespace OBNnode {
         };
         friend NodeEvent_PORT_CONNECT;
         
+        /** Event class for system's SYS_PORT_DECIMATE messages. */
+        class NodeEvent_PORT_DECIMATE: public NodeEventSMN {
+            std::string _myport;
+            simtime_t _period;
+            bool _valid_msg;  ///< true if the received request message is valid
+        public:
+            virtual void executeMain(NodeBase*) override;
+            virtual const char* traceName() const override { return "PORT_DECIMATE"; }
+            
+            NodeEvent_PORT_DECIMATE(const OBNSimMsg::SMN2N& msg): NodeEventSMN(msg) {
+                _valid_msg = msg.has_data() && msg.data().has_t() && msg.data().has_b() && !msg.data().b().empty();
+                if (_valid_msg) {
+                    _myport = msg.data().b();
+                    _period = msg.data().t();
+                }
+            }
+        };
+        friend NodeEvent_PORT_DECIMATE;
+        
+        /** Event class for system's SYS_PORT_PRECISION messages. */
+        class NodeEvent_PORT_PRECISION: public NodeEventSMN {
+            std::string _myport;
+            obn_precision _precision;
+            bool _valid_msg;  ///< true if the received request message is valid
+        public:
+            virtual void executeMain(NodeBase*) override;
+            virtual const char* traceName() const override { return "PORT_PRECISION"; }
+            
+            NodeEvent_PORT_PRECISION(const OBNSimMsg::SMN2N& msg): NodeEventSMN(msg) {
+                _valid_msg = msg.has_data() && msg.data().has_i() && msg.data().has_b() && !msg.data().b().empty() &&
+                msg.data().i() >= obn_precision::FULL && msg.data().i() <= obn_precision::FIXED_POINT && msg.data().d_size() == 3;
+                if (_valid_msg) {
+                    _myport = msg.data().b();
+                    _precision = obn_precision(static_cast<obn_precision::precision_mode>(msg.data().i()), msg.data().d(0), msg.data().d(1), msg.data().d(2));
+                }
+            }
+        };
+        friend NodeEvent_PORT_PRECISION;
+        
         
         /** Event class for any exception (error) thrown anywhere in the program but must be caught by the main thread. */
         class NodeEventException: public NodeEvent {
@@ -564,6 +846,7 @@ namespace OBNnode {
             }
             
             virtual void executeMain(NodeBase*) override;
+            virtual const char* traceName() const override { return "exception"; }
         };
         
         /** Event class for a callback, e.g. a communication event callback, to be called on the main thread. */
@@ -575,6 +858,7 @@ namespace OBNnode {
             }
             
             virtual void executeMain(NodeBase*) override;
+            virtual const char* traceName() const override { return "callback"; }
         };
         
     public:
@@ -589,17 +873,22 @@ namespace OBNnode {
         
         /** Create an event of an exception / error at the front of the queue. */
         void postExceptionEvent(std::exception_ptr e) {
-            eventqueue_push_front(new NodeEventException(e));
+            eventqueue_push_front(new NodeEventException(e), EVENT_CLASS_CONTROL);
         }
         
-        /** Create a callback event, which will call a given function when it's processed, at the front of the queue. */
+        /** Create a callback event, which will call a given function when it's processed, at the front of the queue of internal events (after the commands of the GC). */
         void postCallbackEvent(std::function<void ()> f) {
-            eventqueue_push_front(new NodeEventCallback(f));
+            eventqueue_push_front(new NodeEventCallback(f), EVENT_CLASS_COMPLETION);
+        }
+        
+        /** Create a callback event of a port (e.g. its message received callback), at the back of the queue of port events, which have the lowest priority. */
+        void postPortCallbackEvent(std::function<void ()> f) {
+            eventqueue_push(new NodeEventCallback(f), EVENT_CLASS_PORT);
         }
         
         /** Post an empty event in order to wake up the thread. */
         void postWakeupEvent() {
-            eventqueue_push(new NodeEvent());
+            eventqueue_push(new NodeEvent(), EVENT_CLASS_COMPLETION);
         }
         
     public:
@@ -641,6 +930,24 @@ namespace OBNnode {
          */
         virtual int64_t onRestart() { return -1; }
         
+        /** \brief Callback to get the state of the node, as a vector of doubles.
+         
+         This callback is called at the end of a simulation when the SMN requests the final state of the node (e.g. for time-parallel simulation, where the final state of a time slice is the initial state of the next slice).
+         The state must be complete: setting it with onSetState() and simulating must give the same results as continuing the simulation.
+         \param state The state of the node.
+         \return true if successful; the default callback returns false (the node does not support getting its state).
+         */
+        virtual bool onGetState(std::vector<double>& state) { return false; }
+        
+        /** \brief Callback to set the state of the node, as a vector of doubles.
+         
+         This callback is called after the node is initialized (after onInitialization() or onRestart()) if the SMN gives an initial state to the node.
+         The state is one obtained from onGetState() of the same node, possibly corrected.
+         \param state The state of the node.
+         \return true if successful; the default callback returns false (the node does not support setting its state), which is an error of initialization.
+         */
+        virtual bool onSetState(const std::vector<double>& state) { return false; }
+        
         
         /** \brief Callback before the node's current simulation is terminated.
          
@@ -715,6 +1022,14 @@ namespace OBNnode {
         }
     };
     
+    inline void OutputPortBase::markChanged() {
+        m_isChanged = true;
+        if (!m_queued && m_node) {
+            m_queued = true;
+            m_node->_changed_outputs.push_back(this);
+        }
+    }
+    
     /** Define all details of an update type. */
     struct UpdateType {
         bool enabled = false;   ///< If this update is enabled
@@ -795,7 +1110,11 @@ namespace OBNnode {
                 if ((m & (1 << idx)) && m_updates[idx].enabled) {
                     // Call the y_callback
                     if (m_updates[idx].y_callback) {
+                        int64_t trace_start = OBNsim::Trace::enabled()?OBNsim::Trace::now():-1;
                         m_updates[idx].y_callback();
+                        if (trace_start >= 0) {
+                            OBNsim::Trace::complete(traceUpdateName(idx) + ".y", "update", trace_start, OBNsim::Trace::now() - trace_start);
+                        }
                     }
                     // Update flag m
                     m ^= (1 << idx);
@@ -811,7 +1130,11 @@ namespace OBNnode {
                 if ((m & (1 << idx)) && m_updates[idx].enabled) {
                     // Call the x_callback
                     if (m_updates[idx].x_callback) {
+                        int64_t trace_start = OBNsim::Trace::enabled()?OBNsim::Trace::now():-1;
                         m_updates[idx].x_callback();
+                        if (trace_start >= 0) {
+                            OBNsim::Trace::complete(traceUpdateName(idx) + ".x", "update", trace_start, OBNsim::Trace::now() - trace_start);
+                        }
                     }
                     // Update flag m
                     m ^= (1 << idx);
@@ -820,6 +1143,13 @@ namespace OBNnode {
             }
         }
         
+    private:
+        /** Name of an update in execution traces: its name if given, otherwise its index. */
+        std::string traceUpdateName(int idx) const {
+            return m_updates[idx].name.empty()?("update" + std::to_string(idx)):m_updates[idx].name;
+        }
+        
+    public:
         // Some constants for specifying the update's sampling time
         static constexpr double MILLISECOND = 1e3;
         static constexpr double SECOND = 1e6;
@@ -843,6 +1173,7 @@ namespace OBNnode {
     template <typename T> struct obn_scalar_PB_message_class;
     template <typename T> struct obn_vector_PB_message_class;
     template <typename T> struct obn_matrix_PB_message_class;
+    template <typename T> struct obn_sparse_matrix_PB_message_class;
     
     template <> struct obn_scalar_PB_message_class<bool> { using theclass = OBNSimIOMsg::ScalarBool; };
     template <> struct obn_scalar_PB_message_class<int32_t> { using theclass = OBNSimIOMsg::ScalarInt32; };
@@ -868,6 +1199,148 @@ namespace OBNnode {
     template <> struct obn_matrix_PB_message_class<float> { using theclass = OBNSimIOMsg::MatrixFloat; };
     template <> struct obn_matrix_PB_message_class<double> { using theclass = OBNSimIOMsg::MatrixDouble; };
     
+    template <typename T> struct obn_array_PB_message_class;
+    template <> struct obn_array_PB_message_class<bool> { using theclass = OBNSimIOMsg::ArrayBool; };
+    template <> struct obn_array_PB_message_class<int32_t> { using theclass = OBNSimIOMsg::ArrayInt32; };
+    template <> struct obn_array_PB_message_class<uint32_t> { using theclass = OBNSimIOMsg::ArrayUInt32; };
+    template <> struct obn_array_PB_message_class<int64_t> { using theclass = OBNSimIOMsg::ArrayInt64; };
+    template <> struct obn_array_PB_message_class<uint64_t> { using theclass = OBNSimIOMsg::ArrayUInt64; };
+    template <> struct obn_array_PB_message_class<float> { using theclass = OBNSimIOMsg::ArrayFloat; };
+    template <> struct obn_array_PB_message_class<double> { using theclass = OBNSimIOMsg::ArrayDouble; };
+    
+    template <> struct obn_sparse_matrix_PB_message_class<bool> { using theclass = OBNSimIOMsg::SparseMatrixBool; };
+    template <> struct obn_sparse_matrix_PB_message_class<int32_t> { using theclass = OBNSimIOMsg::SparseMatrixInt32; };
+    template <> struct obn_sparse_matrix_PB_message_class<uint32_t> { using theclass = OBNSimIOMsg::SparseMatrixUInt32; };
+    template <> struct obn_sparse_matrix_PB_message_class<int64_t> { using theclass = OBNSimIOMsg::SparseMatrixInt64; };
+    template <> struct obn_sparse_matrix_PB_message_class<uint64_t> { using theclass = OBNSimIOMsg::SparseMatrixUInt64; };
+    template <> struct obn_sparse_matrix_PB_message_class<float> { using theclass = OBNSimIOMsg::SparseMatrixFloat; };
+    template <> struct obn_sparse_matrix_PB_message_class<double> { using theclass = OBNSimIOMsg::SparseMatrixDouble; };
+    
+    template <typename T> struct obn_trajectory_PB_message_class;
+    template <> struct obn_trajectory_PB_message_class<float> { using theclass = OBNSimIOMsg::TrajectoryFloat; };
+    template <> struct obn_trajectory_PB_message_class<double> { using theclass = OBNSimIOMsg::TrajectoryDouble; };
+    
+    
+    /** \brief Reduced-precision encoding and decoding of the ProtoBuf messages of double vectors and matrices (see obn_precision).
+     
+     The functions accept the messages of all types; those without reduced-precision fields are always in full precision.
+     */
+    namespace reduced_precision {
+        /** Whether a ProtoBuf message class supports reduced precision. */
+        template <typename MSG> struct supported: std::false_type { };
+        template <> struct supported<OBNSimIOMsg::VectorDouble>: std::true_type { };
+        template <> struct supported<OBNSimIOMsg::MatrixDouble>: std::true_type { };
+        template <> struct supported<OBNSimIOMsg::ArrayDouble>: std::true_type { };
+        
+        template <typename MSG>
+        bool is_reduced(const MSG&, std::false_type) { return false; }
+        
+        template <typename MSG>
+        bool is_reduced(const MSG& msg, std::true_type) { return msg.fvalue_size() > 0 || msg.qvalue_size() > 0; }
+        
+        /** Whether the values in the message are in reduced precision. */
+        template <typename MSG>
+        bool is_reduced(const MSG& msg) { return is_reduced(msg, supported<MSG>()); }
+        
+        template <typename MSG>
+        int count(const MSG& msg, std::false_type) { return msg.value_size(); }
+        
+        template <typename MSG>
+        int count(const MSG& msg, std::true_type) {
+            return (msg.fvalue_size() > 0)?msg.fvalue_size():((msg.qvalue_size() > 0)?msg.qvalue_size():msg.value_size());
+        }
+        
+        /** Number of values in the message, in whichever precision. */
+        template <typename MSG>
+        int count(const MSG& msg) { return count(msg, supported<MSG>()); }
+        
+        template <typename MSG, typename OutputIter>
+        void copy(const MSG& msg, std::size_t n, OutputIter out, std::false_type) {
+            std::copy_n(msg.value().begin(), n, out);
+        }
+        
+        template <typename MSG, typename OutputIter>
+        void copy(const MSG& msg, std::size_t n, OutputIter out, std::true_type) {
+            if (msg.fvalue_size() > 0) {
+                std::copy_n(msg.fvalue().begin(), n, out);
+            } else if (msg.qvalue_size() > 0) {
+                double scale = msg.scale();
+                std::transform(msg.qvalue().begin(), msg.qvalue().begin() + n, out, [scale](int64_t q) { return q * scale; });
+            } else {
+                std::copy_n(msg.value().begin(), n, out);
+            }
+        }
+        
+        /** Copy the first n values of the message, widened to full precision if needed. */
+        template <typename MSG, typename OutputIter>
+        void copy(const MSG& msg, std::size_t n, OutputIter out) { copy(msg, n, out, supported<MSG>()); }
+        
+        template <typename MSG, typename OutputIter>
+        void copy_from(const MSG& msg, std::size_t first, std::size_t n, OutputIter out, std::false_type) {
+            std::copy_n(msg.value().begin() + first, n, out);
+        }
+        
+        template <typename MSG, typename OutputIter>
+        void copy_from(const MSG& msg, std::size_t first, std::size_t n, OutputIter out, std::true_type) {
+            if (msg.fvalue_size() > 0) {
+                std::copy_n(msg.fvalue().begin() + first, n, out);
+            } else if (msg.qvalue_size() > 0) {
+                double scale = msg.scale();
+                std::transform(msg.qvalue().begin() + first, msg.qvalue().begin() + first + n, out, [scale](int64_t q) { return q * scale; });
+            } else {
+                std::copy_n(msg.value().begin() + first, n, out);
+            }
+        }
+        
+        /** Copy n values of the message starting at the given position, widened to full precision if needed. */
+        template <typename MSG, typename OutputIter>
+        void copy_from(const MSG& msg, std::size_t first, std::size_t n, OutputIter out) { copy_from(msg, first, n, out, supported<MSG>()); }
+        
+        template <typename MSG>
+        bool reduce(MSG&, const obn_precision&, std::false_type) { return false; }
+        
+        template <typename MSG>
+        bool reduce(MSG& msg, const obn_precision& prec, std::true_type) {
+            const auto& values = msg.value();
+            int n = values.size();
+            if (prec.mode == obn_precision::FLOAT32) {
+                auto dest = msg.mutable_fvalue();
+                dest->Resize(n, 0.0f);
+                for (int k = 0; k < n; ++k) {
+                    float x = static_cast<float>(values.Get(k));
+                    if (!prec.accepts(values.Get(k), x)) {
+                        msg.clear_fvalue();
+                        return false;
+                    }
+                    dest->Set(k, x);
+                }
+            } else if (prec.mode == obn_precision::FIXED_POINT) {
+                const double qmax = 9.0e18;     // within the range of int64_t
+                auto dest = msg.mutable_qvalue();
+                dest->Resize(n, 0);
+                for (int k = 0; k < n; ++k) {
+                    double q = std::round(values.Get(k) / prec.scale);
+                    if (!(std::abs(q) < qmax) || !prec.accepts(values.Get(k), q * prec.scale)) {
+                        msg.clear_qvalue();
+                        return false;
+                    }
+                    dest->Set(k, static_cast<int64_t>(q));
+                }
+                msg.set_scale(prec.scale);
+            } else {
+                return false;
+            }
+            msg.clear_value();
+            return true;
+        }
+        
+        /** Convert the full-precision values in the message to the given precision, if they are within its error bounds.
+         \return true if the message is now in reduced precision; false if it is unchanged (full precision).
+         */
+        template <typename MSG>
+        bool reduce(MSG& msg, const obn_precision& prec) { return reduce(msg, prec, supported<MSG>()); }
+    }
+    
     
     /** \brief Utility structure that manages raw arrays. */
     template <typename T>
@@ -969,6 +1442,134 @@ namespace OBNnode {
         }
     };
     
+    /** \brief Storage for a vector or a matrix whose data is 64-byte aligned and padded.
+     
+     The capacity is rounded up to a multiple of 64 bytes and the padding elements past the end are kept at zero,
+     so vectorized code may safely load whole SIMD registers up to the capacity.
+     The data is exposed as aligned Eigen maps, which let Eigen use aligned loads and stores directly on the storage.
+     \tparam T Element type (an arithmetic type).
+     \tparam C Number of columns: 1 for a column vector, Eigen::Dynamic for a matrix.
+     */
+    template <typename T, int C>
+    class aligned_eigen_storage {
+        static_assert(std::is_arithmetic<T>::value, "aligned_eigen_storage only supports arithmetic element types.");
+        
+    public:
+        static constexpr std::size_t alignment = 64;    ///< Alignment and padding granularity, in bytes
+        static_assert(alignment % sizeof(T) == 0, "Element size must divide the alignment.");
+        
+        using matrix_type = Eigen::Matrix<T, Eigen::Dynamic, C>;
+        
+        /** Alignment option of the maps: Eigen 3.3+ is told the full 64-byte alignment; older versions (e.g. the bundled 3.2) only know Eigen::Aligned, i.e. aligned to their packet size. */
+#if EIGEN_VERSION_AT_LEAST(3,3,0)
+        static constexpr int map_options = Eigen::Aligned64;
+#else
+        static constexpr int map_options = Eigen::Aligned;
+#endif
+        using map_type = Eigen::Map<matrix_type, map_options>;
+        using const_map_type = Eigen::Map<const matrix_type, map_options>;
+        
+        aligned_eigen_storage() { }
+        
+        aligned_eigen_storage(std::size_t nrows, std::size_t ncols = 1) {
+            resize(nrows, ncols);
+        }
+        
+        // Copy constructor always copy the data
+        aligned_eigen_storage(const aligned_eigen_storage& c) {
+            assign(c.data(), c.rows(), c.cols());
+        }
+        
+        aligned_eigen_storage(aligned_eigen_storage&& c) noexcept {
+            swap(c);
+        }
+        
+        // Construct from any Eigen expression
+        template <typename Derived>
+        aligned_eigen_storage(const Eigen::DenseBase<Derived>& x) {
+            *this = x;
+        }
+        
+        ~aligned_eigen_storage() {
+            ::operator delete(m_raw);
+        }
+        
+        aligned_eigen_storage& operator= (const aligned_eigen_storage& c) {
+            if (this != &c) {
+                assign(c.data(), c.rows(), c.cols());
+            }
+            return *this;
+        }
+        
+        aligned_eigen_storage& operator= (aligned_eigen_storage&& c) noexcept {
+            swap(c);
+            return *this;
+        }
+        
+        /** Evaluate an Eigen expression into the storage. */
+        template <typename Derived>
+        aligned_eigen_storage& operator= (const Eigen::DenseBase<Derived>& x) {
+            resize(x.rows(), x.cols());
+            map() = x;
+            return *this;
+        }
+        
+        void swap(aligned_eigen_storage& c) noexcept {
+            std::swap(m_raw, c.m_raw);
+            std::swap(m_data, c.m_data);
+            std::swap(m_capacity, c.m_capacity);
+            std::swap(m_rows, c.m_rows);
+            std::swap(m_cols, c.m_cols);
+        }
+        
+        /** Resize the storage. The memory is only reallocated if the capacity is not enough, in which case the current values are lost. */
+        void resize(std::size_t nrows, std::size_t ncols = 1) {
+            assert(C != 1 || ncols == 1);
+            std::size_t n = nrows * ncols;
+            if (n > m_capacity) {
+                // Round the capacity up to a multiple of the alignment, then align the start of the data
+                std::size_t cap = (n * sizeof(T) + alignment - 1) / alignment * (alignment / sizeof(T));
+                void* raw = ::operator new(cap * sizeof(T) + alignment - 1);
+                ::operator delete(m_raw);
+                m_raw = raw;
+                m_data = reinterpret_cast<T*>((reinterpret_cast<std::uintptr_t>(raw) + alignment - 1) & ~std::uintptr_t(alignment - 1));
+                m_capacity = cap;
+            }
+            m_rows = nrows;
+            m_cols = ncols;
+            std::fill(m_data + n, m_data + m_capacity, T(0));  // keep the padding zeroed
+        }
+        
+        /** Copy nrows*ncols values (column-major) into the storage. */
+        template <typename InputIter>
+        T* assign(InputIter p, std::size_t nrows, std::size_t ncols = 1) {
+            resize(nrows, ncols);
+            std::copy_n(p, nrows * ncols, m_data);
+            return m_data;
+        }
+        
+        /** Aligned Eigen view of the data, which can be used and modified in place. */
+        map_type map() { return map_type(m_data, m_rows, m_cols); }
+        const_map_type map() const { return const_map_type(m_data, m_rows, m_cols); }
+        
+        T* data() { return m_data; }
+        const T* data() const { return m_data; }
+        
+        std::size_t rows() const { return m_rows; }
+        std::size_t cols() const { return m_cols; }
+        std::size_t size() const { return m_rows * m_cols; }
+        std::size_t capacity() const { return m_capacity; }   ///< Number of elements allocated, including the padding
+        
+    private:
+        void* m_raw{nullptr};   // the allocated memory block
+        T* m_data{nullptr};     // the aligned start of the data in the block
+        std::size_t m_capacity{0};  // number of elements available from m_data
+        std::size_t m_rows{0}, m_cols{C == 1 ? 1u : 0u};
+    };
+    
+    template <typename T, int C>
+    constexpr std::size_t aligned_eigen_storage<T, C>::alignment;
+    
     /** \brief Template class for input data as a scalar of a given type. */
     template <typename T>
     class obn_scalar {
@@ -1026,6 +1627,7 @@ namespace OBNnode {
         struct input_data_container {
             using data_type = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1> >;  // const because this is read-only
             data_type v{nullptr, 0};
+            input_data_type buffer;     // values widened from a reduced-precision message, to which v points
         };
         
         /** The output data type for writing from the given type to an encoded format (e.g. ProtoBuf).
@@ -1052,6 +1654,14 @@ namespace OBNnode {
          It works with raw arrays as much as possible because speed is important.
          */
         static bool readPBMessage(input_data_container& data, const PB_message_class& msg) {
+            if (reduced_precision::is_reduced(msg)) {
+                auto sz = reduced_precision::count(msg);
+                data.buffer.resize(sz);
+                reduced_precision::copy(msg, sz, data.buffer.data());
+                new (&data.v) typename input_data_container::data_type(data.buffer.data(), sz);
+                return true;
+            }
+            
             auto sz = msg.value_size();
             new (&data.v) typename input_data_container::data_type(msg.value().data(), sz);
             
@@ -1073,7 +1683,7 @@ namespace OBNnode {
         
         /** Static function to read data from a ProtoBuf message to the queue. */
         static bool readPBMessageStrict(input_queue_type& data, const PB_message_class& msg) {
-            auto sz = msg.value_size();
+            auto sz = reduced_precision::count(msg);
             data.emplace_back(new input_data_type(sz, 1));   // create a vector with the right size
             auto& elem = data.back();
             if (sz != elem->size()) {
@@ -1081,7 +1691,7 @@ namespace OBNnode {
                 return false;
             }
             if (sz > 0) {
-                std::copy_n(msg.value().begin(), sz, elem->data());
+                reduced_precision::copy(msg, sz, elem->data());
             }
             return true;
         }
@@ -1126,6 +1736,13 @@ namespace OBNnode {
          It works with raw arrays as much as possible because speed is important.
          */
         static bool readPBMessage(input_data_container& data, PB_message_class& msg) {
+            if (reduced_precision::is_reduced(msg)) {
+                // Widen the values into the message itself, then attach them
+                auto sz = reduced_precision::count(msg);
+                auto dest = msg.mutable_value();
+                dest->Resize(sz, T());
+                reduced_precision::copy(msg, sz, dest->begin());
+            }
             auto sz = msg.value_size();
             data.v.assign(msg.mutable_value()->begin(), sz, false);
             return true;
@@ -1137,6 +1754,13 @@ namespace OBNnode {
         
         /** Static function to read data from a ProtoBuf message to the queue. */
         static bool readPBMessageStrict(input_queue_type& data, const PB_message_class& msg) {
+            if (reduced_precision::is_reduced(msg)) {
+                std::size_t sz = reduced_precision::count(msg);
+                std::unique_ptr<T[]> values(new T[sz]);     // not std::vector, which has no data() for bool
+                reduced_precision::copy(msg, sz, values.get());
+                data.emplace_back(new input_data_type(values.get(), sz));
+                return true;
+            }
             data.emplace_back(new input_data_type(msg.value().data(), msg.value_size()));   // copy the data from msg
             return true;
         }
@@ -1157,6 +1781,7 @@ namespace OBNnode {
         struct input_data_container {
             using data_type = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> >;  // const because this is read-only
             data_type v{nullptr, 0, 0};
+            input_data_type buffer;     // values widened from a reduced-precision message, to which v points
         };
         
         /** The output data type for writing from the given type to an encoded format (e.g. ProtoBuf).
@@ -1184,7 +1809,14 @@ namespace OBNnode {
             auto nrows = msg.nrows();
             auto ncols = msg.ncols();
             auto sz = nrows * ncols;
-            if (msg.value_size() < sz) return false;
+            if (reduced_precision::count(msg) < sz) return false;
+            
+            if (reduced_precision::is_reduced(msg)) {
+                data.buffer.resize(nrows, ncols);
+                reduced_precision::copy(msg, sz, data.buffer.data());
+                new (&data.v) typename input_data_container::data_type(data.buffer.data(), nrows, ncols);
+                return true;
+            }
             
             new (&data.v) typename input_data_container::data_type(msg.value().data(), nrows, ncols);
             
@@ -1210,7 +1842,7 @@ namespace OBNnode {
             auto nrows = msg.nrows();
             auto ncols = msg.ncols();
             auto sz = nrows * ncols;
-            if (msg.value_size() < sz) return false;
+            if (reduced_precision::count(msg) < sz) return false;
             
             data.emplace_back(new input_data_type(nrows, ncols));   // create a matrix of the given size
             auto& elem = data.back();
@@ -1220,7 +1852,7 @@ namespace OBNnode {
             }
             
             if (sz > 0) {
-                std::copy_n(msg.value().begin(), sz, elem->data());
+                reduced_precision::copy(msg, sz, elem->data());
             }
             return true;
         }
@@ -1298,8 +1930,14 @@ namespace OBNnode {
             int nrows = msg.nrows();
             int ncols = msg.ncols();
             int sz = nrows * ncols;
-            if (msg.value_size() < sz) return false;
+            if (reduced_precision::count(msg) < sz) return false;
             
+            if (reduced_precision::is_reduced(msg)) {
+                // Widen the values into the message itself, then attach them
+                auto dest = msg.mutable_value();
+                dest->Resize(sz, T());
+                reduced_precision::copy(msg, sz, dest->begin());
+            }
             data.v.data.assign(msg.mutable_value()->begin(), sz, false);
             data.v.nrows = nrows;
             data.v.ncols = ncols;
@@ -1316,32 +1954,74 @@ namespace OBNnode {
             auto nrows = msg.nrows();
             auto ncols = msg.ncols();
             auto sz = nrows * ncols;
-            if (msg.value_size() < sz) return false;
+            if (reduced_precision::count(msg) < sz) return false;
             
+            if (reduced_precision::is_reduced(msg)) {
+                std::unique_ptr<T[]> values(new T[sz]);     // not std::vector, which has no data() for bool
+                reduced_precision::copy(msg, sz, values.get());
+                data.emplace_back(new input_data_type(values.get(), nrows, ncols));
+                return true;
+            }
             data.emplace_back(new input_data_type(msg.value().data(), nrows, ncols));   // create a matrix of the given size and assign data
             return true;
         }
     };
     
     
-    /** \brief Template class for input data as a fixed-length vector of a given type. */
-    template <typename T, const std::size_t N>
-    class obn_vector_fixed {
+    /** \brief Template class for input data as a vector of a given type, stored in aligned memory.
+     
+     Unlike obn_vector, which maps the unaligned storage inside the ProtoBuf message, the decoder copies the values
+     into a 64-byte aligned and padded buffer (see aligned_eigen_storage) and the port exposes an aligned Eigen map over it.
+     The output value is an aligned_eigen_storage that can be filled in place through its map().
+     */
+    template <typename T>
+    class obn_vector_aligned {
     public:
-        static_assert(N > 0, "Vector length must be positive.");
+        /** The aligned storage type. */
+        using storage_type = aligned_eigen_storage<T, 1>;
         
-        /** The input data type: a vector. For fixed size types, to be safe, we use an actual vector, not a Map. This is because the user can access the input port when it hasn't been initialized (by an input message), potentially crashing the program. */
-        using input_data_type = Eigen::Matrix<T, N, 1, Eigen::DontAlign>; // Disable alignment to be safe
+        /** The input data type for reading from an encoded format (e.g. ProtoBuf) into the given type. */
+        using input_data_type = Eigen::Matrix<T, Eigen::Dynamic, 1>;
         
-        /** Container and Initializer for the input type. */
+        /** Container and Initializer for the input type.
+         The map v always points to the aligned buffer, which is owned by the container; copying or moving a container re-points the map at its own buffer. */
         struct input_data_container {
-            using data_type = input_data_type;
-            data_type v;
+            storage_type buffer;    // the aligned buffer filled by the decoder
+            using data_type = typename storage_type::const_map_type;  // const because this is read-only
+            data_type v{nullptr, 0};
+            
+            input_data_container() { }
+            
+            input_data_container(const input_data_container& c): buffer(c.buffer) {
+                repoint();
+            }
+            
+            input_data_container(input_data_container&& c) noexcept: buffer(std::move(c.buffer)) {
+                repoint();
+                c.repoint();
+            }
+            
+            input_data_container& operator= (const input_data_container& c) {
+                buffer = c.buffer;
+                repoint();
+                return *this;
+            }
+            
+            input_data_container& operator= (input_data_container&& c) noexcept {
+                buffer = std::move(c.buffer);
+                repoint();
+                c.repoint();
+                return *this;
+            }
+            
+            /** Point the map v at the current data of the buffer. */
+            void repoint() {
+                new (&v) data_type(buffer.data(), buffer.size());
+            }
         };
         
-        /** The output data type for writing from the given type to an encoded format (e.g. ProtoBuf).
-         We use an Eigen variable as a buffer, and will only write it to the message on demand. */
-        using output_data_type = Eigen::Matrix<T, N, 1, Eigen::DontAlign>;
+        /** The output data type for writing from the given type to an encoded format (e.g. ProtoBuf). */
+        using output_data_type = storage_type;
         
         /** The class type of the ProtoBuf message. */
         using PB_message_class = typename obn_vector_PB_message_class<T>::theclass;
@@ -1349,28 +2029,182 @@ namespace OBNnode {
         /** Static function to write data to a ProtoBuf message. */
         static void writePBMessage(const output_data_type& data, PB_message_class& msg) {
             msg.Clear();
+            auto sz = data.size();
             auto dest = msg.mutable_value();
-            dest->Resize(N, T());    // resize the field in msg to hold the values
-            std::copy_n(data.data(), N, dest->begin());
+            dest->Resize(sz, T());    // resize the field in msg to hold the values
+            if (sz > 0) {
+                std::copy_n(data.data(), sz, dest->begin());
+            }
+        }
+        
+        /** Static function to read data from a ProtoBuf message into the aligned buffer. */
+        static bool readPBMessage(input_data_container& data, const PB_message_class& msg) {
+            auto sz = reduced_precision::count(msg);
+            data.buffer.resize(sz);
+            reduced_precision::copy(msg, sz, data.buffer.data());
+            data.repoint();
+            return true;
         }
         
         /** The type for the queue in strict ports. */
-        using input_queue_elem_type = std::unique_ptr<input_data_type>;
+        using input_queue_elem_type = std::unique_ptr<storage_type>;
         using input_queue_type = std::deque<input_queue_elem_type>;
         
-        /** Static function to read data from a ProtoBuf message which really copies the data. */
+        /** Static function to read data from a ProtoBuf message to the queue. */
         static bool readPBMessageStrict(input_queue_type& data, const PB_message_class& msg) {
-            if (msg.value_size() < N) return false;
-            data.emplace_back(new input_data_type());   // Create the vector whose size is fixed
-            std::copy_n(msg.value().begin(), N, data.back()->data());
+            auto sz = reduced_precision::count(msg);
+            data.emplace_back(new storage_type(sz));
+            reduced_precision::copy(msg, sz, data.back()->data());
             return true;
         }
-        
-        /** Static function to read data from a ProtoBuf message. */
-        static bool readPBMessage(input_data_container& data, const PB_message_class& msg) {
-            if (msg.value_size() < N) return false;
-            std::copy_n(msg.value().begin(), N, data.v.data());
-            return true;
+    };
+    
+    /** \brief Template class for input data as a dynamic-sized matrix of a given type, stored in aligned memory.
+     
+     This is the matrix counterpart of obn_vector_aligned.
+     */
+    template <typename T>
+    class obn_matrix_aligned {
+    public:
+        /** The aligned storage type. */
+        using storage_type = aligned_eigen_storage<T, Eigen::Dynamic>;
+        
+        /** The input data type for reading from an encoded format (e.g. ProtoBuf) into the given type. */
+        using input_data_type = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+        
+        /** Container and Initializer for the input type.
+         The map v always points to the aligned buffer, which is owned by the container; copying or moving a container re-points the map at its own buffer. */
+        struct input_data_container {
+            storage_type buffer;    // the aligned buffer filled by the decoder
+            using data_type = typename storage_type::const_map_type;  // const because this is read-only
+            data_type v{nullptr, 0, 0};
+            
+            input_data_container() { }
+            
+            input_data_container(const input_data_container& c): buffer(c.buffer) {
+                repoint();
+            }
+            
+            input_data_container(input_data_container&& c) noexcept: buffer(std::move(c.buffer)) {
+                repoint();
+                c.repoint();
+            }
+            
+            input_data_container& operator= (const input_data_container& c) {
+                buffer = c.buffer;
+                repoint();
+                return *this;
+            }
+            
+            input_data_container& operator= (input_data_container&& c) noexcept {
+                buffer = std::move(c.buffer);
+                repoint();
+                c.repoint();
+                return *this;
+            }
+            
+            /** Point the map v at the current data of the buffer. */
+            void repoint() {
+                new (&v) data_type(buffer.data(), buffer.rows(), buffer.cols());
+            }
+        };
+        
+        /** The output data type for writing from the given type to an encoded format (e.g. ProtoBuf). */
+        using output_data_type = storage_type;
+        
+        /** The class type of the ProtoBuf message. */
+        using PB_message_class = typename obn_matrix_PB_message_class<T>::theclass;
+        
+        /** Static function to write data to a ProtoBuf message. */
+        static void writePBMessage(const output_data_type& data, PB_message_class& msg) {
+            msg.Clear();
+            msg.set_nrows(data.rows());
+            msg.set_ncols(data.cols());
+            auto sz = data.size();
+            auto dest = msg.mutable_value();
+            dest->Resize(sz, T());    // resize the field in msg to hold the values
+            if (sz > 0) {
+                std::copy_n(data.data(), sz, dest->begin());
+            }
+        }
+        
+        /** Static function to read data from a ProtoBuf message into the aligned buffer. */
+        static bool readPBMessage(input_data_container& data, const PB_message_class& msg) {
+            auto nrows = msg.nrows();
+            auto ncols = msg.ncols();
+            auto sz = nrows * ncols;
+            if (reduced_precision::count(msg) < sz) return false;
+            
+            data.buffer.resize(nrows, ncols);
+            reduced_precision::copy(msg, sz, data.buffer.data());
+            data.repoint();
+            return true;
+        }
+        
+        /** The type for the queue in strict ports. */
+        using input_queue_elem_type = std::unique_ptr<storage_type>;
+        using input_queue_type = std::deque<input_queue_elem_type>;
+        
+        /** Static function to read data from a ProtoBuf message which really copies the data. */
+        static bool readPBMessageStrict(input_queue_type& data, const PB_message_class& msg) {
+            auto nrows = msg.nrows();
+            auto ncols = msg.ncols();
+            if (reduced_precision::count(msg) < nrows * ncols) return false;
+            
+            data.emplace_back(new storage_type(nrows, ncols));
+            reduced_precision::copy(msg, nrows * ncols, data.back()->data());
+            return true;
+        }
+    };
+    
+    
+    /** \brief Template class for input data as a fixed-length vector of a given type. */
+    template <typename T, const std::size_t N>
+    class obn_vector_fixed {
+    public:
+        static_assert(N > 0, "Vector length must be positive.");
+        
+        /** The input data type: a vector. For fixed size types, to be safe, we use an actual vector, not a Map. This is because the user can access the input port when it hasn't been initialized (by an input message), potentially crashing the program. */
+        using input_data_type = Eigen::Matrix<T, N, 1, Eigen::DontAlign>; // Disable alignment to be safe
+        
+        /** Container and Initializer for the input type. */
+        struct input_data_container {
+            using data_type = input_data_type;
+            data_type v;
+        };
+        
+        /** The output data type for writing from the given type to an encoded format (e.g. ProtoBuf).
+         We use an Eigen variable as a buffer, and will only write it to the message on demand. */
+        using output_data_type = Eigen::Matrix<T, N, 1, Eigen::DontAlign>;
+        
+        /** The class type of the ProtoBuf message. */
+        using PB_message_class = typename obn_vector_PB_message_class<T>::theclass;
+        
+        /** Static function to write data to a ProtoBuf message. */
+        static void writePBMessage(const output_data_type& data, PB_message_class& msg) {
+            msg.Clear();
+            auto dest = msg.mutable_value();
+            dest->Resize(N, T());    // resize the field in msg to hold the values
+            std::copy_n(data.data(), N, dest->begin());
+        }
+        
+        /** The type for the queue in strict ports. */
+        using input_queue_elem_type = std::unique_ptr<input_data_type>;
+        using input_queue_type = std::deque<input_queue_elem_type>;
+        
+        /** Static function to read data from a ProtoBuf message which really copies the data. */
+        static bool readPBMessageStrict(input_queue_type& data, const PB_message_class& msg) {
+            if (reduced_precision::count(msg) < N) return false;
+            data.emplace_back(new input_data_type());   // Create the vector whose size is fixed
+            reduced_precision::copy(msg, N, data.back()->data());
+            return true;
+        }
+        
+        /** Static function to read data from a ProtoBuf message. */
+        static bool readPBMessage(input_data_container& data, const PB_message_class& msg) {
+            if (reduced_precision::count(msg) < N) return false;
+            reduced_precision::copy(msg, N, data.v.data());
+            return true;
         }
     };
     
@@ -1416,11 +2250,11 @@ namespace OBNnode {
         
         /** Static function to read data from a ProtoBuf message which really copies the data. */
         static bool readPBMessageStrict(input_queue_type& data, const PB_message_class& msg) {
-            if (msg.nrows() != NR || msg.ncols() != NC || msg.value_size() < NR*NC) return false;
+            if (msg.nrows() != NR || msg.ncols() != NC || reduced_precision::count(msg) < NR*NC) return false;
             data.emplace_back(new input_data_type());
             auto& elem = data.back();
             auto sz = elem->size();
-            std::copy_n(msg.value().begin(), sz, elem->data());
+            reduced_precision::copy(msg, sz, elem->data());
             return true;
         }
         
@@ -1428,13 +2262,455 @@ namespace OBNnode {
         static bool readPBMessage(input_data_container& data, const PB_message_class& msg) {
             if (msg.nrows() != NR || msg.ncols() != NC) return false;
             auto sz = data.v.size();
-            if (msg.value_size() < sz) return false;
-            std::copy_n(msg.value().begin(), sz, data.v.data());
+            if (reduced_precision::count(msg) < sz) return false;
+            reduced_precision::copy(msg, sz, data.v.data());
+            return true;
+        }
+        
+    };
+    
+    
+    /** \brief Template class for input data as a sparse matrix of a given type, using Eigen's SparseMatrix.
+     
+     The matrix is transferred in Compressed Sparse Column (CSC) format, which is the native (compressed) storage of Eigen::SparseMatrix, so encoding and decoding are plain array copies and the size of a message scales with the number of non-zeros rather than with the dimensions of the matrix.
+     */
+    template <typename T>
+    class obn_sparse_matrix {
+    public:
+        /** The input data type for reading from an encoded format (e.g. ProtoBuf) into the given type. */
+        using input_data_type = Eigen::SparseMatrix<T, Eigen::ColMajor>;
+        
+        /** Index type of the sparse matrix, used for the inner and outer indices: StorageIndex in Eigen 3.3+ (where Index is std::ptrdiff_t), Index in older versions (e.g. the bundled 3.2). */
+#if EIGEN_VERSION_AT_LEAST(3,3,0)
+        using index_type = typename input_data_type::StorageIndex;
+#else
+        using index_type = typename input_data_type::Index;
+#endif
+        static_assert(std::is_same<index_type, int32_t>::value, "The index arrays of sparse matrices are exposed as int32_t arrays by the external interface.");
+        
+        /** Container and Initializer for the input type.
+         Unlike obn_matrix, the data are copied into a SparseMatrix object (in compressed mode) because Eigen has no read-only map of a sparse matrix over external storage.
+         The copy is O(number of non-zeros) and needs no sorting. */
+        struct input_data_container {
+            using data_type = input_data_type;
+            data_type v;
+        };
+        
+        /** The output data type for writing from the given type to an encoded format (e.g. ProtoBuf).
+         The matrix does not need to be compressed, but writing a compressed matrix is faster. */
+        using output_data_type = input_data_type;
+        
+        /** The class type of the ProtoBuf message. */
+        using PB_message_class = typename obn_sparse_matrix_PB_message_class<T>::theclass;
+        
+        /** Assign a sparse matrix from raw CSC arrays, after checking that the arrays are consistent.
+         \param m The sparse matrix to be assigned; it will be in compressed mode afterwards.
+         \param nrows Number of rows.
+         \param ncols Number of columns.
+         \param nnz Number of non-zeros, i.e. the lengths of inner and values.
+         \param outer Array of ncols+1 column start indices.
+         \param inner Array of nnz row indices, strictly increasing in each column.
+         \param values Array of nnz values.
+         \return true if successful; false if the arrays are not a valid CSC matrix (m is then left empty).
+         */
+        template <typename I1, typename I2, typename V>
+        static bool assignCSC(input_data_type& m, std::size_t nrows, std::size_t ncols, std::size_t nnz, I1 outer, I2 inner, V values) {
+            m.resize(nrows, ncols);     // empty and compressed
+            
+            // Check the column pointers: they must start at 0, be non-decreasing and end at nnz
+            if (outer[0] != 0 || std::size_t(outer[ncols]) != nnz) return false;
+            for (std::size_t j = 0; j < ncols; ++j) {
+                if (outer[j+1] < outer[j]) return false;
+            }
+            
+            m.resizeNonZeros(nnz);
+            std::copy_n(outer, ncols + 1, m.outerIndexPtr());
+            if (nnz > 0) {
+                std::copy_n(inner, nnz, m.innerIndexPtr());
+                std::copy_n(values, nnz, m.valuePtr());
+            }
+            
+            // Check the row indices: within range, and strictly increasing in each column (Eigen requires sorted indices without duplicates)
+            const index_type* pouter = m.outerIndexPtr();
+            const index_type* pinner = m.innerIndexPtr();
+            for (std::size_t j = 0; j < ncols; ++j) {
+                for (index_type k = pouter[j]; k < pouter[j+1]; ++k) {
+                    if (pinner[k] < 0 || std::size_t(pinner[k]) >= nrows || (k > pouter[j] && pinner[k] <= pinner[k-1])) {
+                        m.resize(0, 0);
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+        
+        /** Static function to write data to a ProtoBuf message. */
+        static void writePBMessage(const output_data_type& data, PB_message_class& msg) {
+            msg.Clear();
+            msg.set_nrows(data.rows());
+            msg.set_ncols(data.cols());
+            
+            auto ncols = data.outerSize();
+            auto nnz = data.nonZeros();
+            auto outer = msg.mutable_outer();
+            auto inner = msg.mutable_inner();
+            auto value = msg.mutable_value();
+            outer->Resize(ncols + 1, 0);
+            inner->Resize(nnz, 0);
+            value->Resize(nnz, T());
+            
+            if (data.isCompressed()) {
+                // Direct copy of the compressed storage
+                std::copy_n(data.outerIndexPtr(), ncols + 1, outer->begin());
+                if (nnz > 0) {
+                    std::copy_n(data.innerIndexPtr(), nnz, inner->begin());
+                    std::copy_n(data.valuePtr(), nnz, value->begin());
+                }
+            } else {
+                // Uncompressed mode (e.g. after insert()): walk the non-zeros column by column
+                index_type k = 0;
+                for (index_type j = 0; j < ncols; ++j) {
+                    outer->Set(j, k);
+                    for (typename output_data_type::InnerIterator it(data, j); it; ++it, ++k) {
+                        inner->Set(k, it.index());
+                        value->Set(k, it.value());
+                    }
+                }
+                outer->Set(ncols, k);
+            }
+        }
+        
+        /** Static function to read data from a ProtoBuf message. */
+        static bool readPBMessage(input_data_container& data, const PB_message_class& msg) {
+            std::size_t ncols = msg.ncols();
+            std::size_t nnz = msg.value_size();
+            if (std::size_t(msg.outer_size()) != ncols + 1 || std::size_t(msg.inner_size()) != nnz) return false;
+            
+            return assignCSC(data.v, msg.nrows(), ncols, nnz, msg.outer().begin(), msg.inner().begin(), msg.value().begin());
+        }
+        
+        /** The type for the queue in strict ports. */
+        using input_queue_elem_type = std::unique_ptr<input_data_type>;
+        using input_queue_type = std::deque<input_queue_elem_type>;
+        
+        /** Static function to read data from a ProtoBuf message which really copies the data. */
+        static bool readPBMessageStrict(input_queue_type& data, const PB_message_class& msg) {
+            std::size_t ncols = msg.ncols();
+            std::size_t nnz = msg.value_size();
+            if (std::size_t(msg.outer_size()) != ncols + 1 || std::size_t(msg.inner_size()) != nnz) return false;
+            
+            input_queue_elem_type elem(new input_data_type());
+            if (!assignCSC(*elem, msg.nrows(), ncols, nnz, msg.outer().begin(), msg.inner().begin(), msg.value().begin())) {
+                return false;
+            }
+            data.push_back(std::move(elem));
+            return true;
+        }
+    };
+    
+    
+    /** \brief A trajectory: a sequence of samples (vectors of a fixed dimension) at increasing simulation times.
+     
+     Trajectories are exchanged by nodes in the waveform relaxation coupling (see NodeBase::windowIteration()): in one time window, a node computes the whole trajectory of its outputs over the window, from the trajectories of its inputs.
+     Between the samples, the trajectory is interpolated linearly; before the first and after the last sample, it is held constant.
+     */
+    template <typename T>
+    class trajectory {
+    public:
+        /** Type of a sample. */
+        using sample_type = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+        
+        /** Construct an empty trajectory of a given dimension. */
+        explicit trajectory(std::size_t dim = 1): m_dim(dim) { }
+        
+        /** Dimension of each sample. */
+        std::size_t dim() const { return m_dim; }
+        
+        /** Number of samples. */
+        std::size_t size() const { return m_time.size(); }
+        
+        bool empty() const { return m_time.empty(); }
+        
+        /** Remove all samples. */
+        void clear() {
+            m_time.clear();
+            m_value.clear();
+        }
+        
+        /** Remove all samples and change the dimension. */
+        void reset(std::size_t dim) {
+            m_dim = dim;
+            clear();
+        }
+        
+        /** Reserve memory for a number of samples. */
+        void reserve(std::size_t n) {
+            m_time.reserve(n);
+            m_value.reserve(n * m_dim);
+        }
+        
+        /** Append a sample at the end.
+         \param t Simulation time of the sample, which must be later than the last sample.
+         \param v The sample, of size dim().
+         \return false if the time or the size of the sample is invalid.
+         */
+        template <typename Derived>
+        bool append(simtime_t t, const Eigen::DenseBase<Derived>& v) {
+            if (std::size_t(v.size()) != m_dim || (!m_time.empty() && t <= m_time.back())) {
+                return false;
+            }
+            m_time.push_back(t);
+            for (typename Derived::Index k = 0; k < v.size(); ++k) {
+                m_value.push_back(v.derived().coeff(k));
+            }
+            return true;
+        }
+        
+        /** Append a sample to a scalar trajectory (dim() == 1). */
+        bool append(simtime_t t, T v) {
+            if (m_dim != 1 || (!m_time.empty() && t <= m_time.back())) {
+                return false;
+            }
+            m_time.push_back(t);
+            m_value.push_back(v);
+            return true;
+        }
+        
+        /** Time of the k-th sample. */
+        simtime_t time(std::size_t k) const { return m_time[k]; }
+        
+        /** Times of all samples. */
+        const std::vector<simtime_t>& times() const { return m_time; }
+        
+        /** The k-th sample. */
+        Eigen::Map<const sample_type> sample(std::size_t k) const {
+            return Eigen::Map<const sample_type>(m_value.data() + k * m_dim, m_dim);
+        }
+        
+        /** All samples as a matrix, one column for each sample. */
+        Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> > samples() const {
+            return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> >(m_value.data(), m_dim, m_time.size());
+        }
+        
+        /** Value of the trajectory at a given time; a zero vector if the trajectory is empty. */
+        sample_type at(simtime_t t) const {
+            if (m_time.empty()) {
+                return sample_type::Zero(m_dim);
+            }
+            auto it = std::upper_bound(m_time.begin(), m_time.end(), t);
+            if (it == m_time.begin()) {
+                return sample(0);
+            }
+            if (it == m_time.end()) {
+                return sample(m_time.size() - 1);
+            }
+            std::size_t k = it - m_time.begin();
+            T alpha = T(t - m_time[k-1]) / T(m_time[k] - m_time[k-1]);
+            return (T(1) - alpha) * sample(k-1) + alpha * sample(k);
+        }
+        
+        /** The largest absolute difference to another trajectory, evaluated at the sample times of both trajectories.
+         This is the usual convergence measure of the waveform relaxation iterations.
+         It is infinite if the dimensions are different or only one of the trajectories is empty.
+         */
+        T distance(const trajectory& other) const {
+            if (m_dim != other.m_dim || m_time.empty() != other.m_time.empty()) {
+                return std::numeric_limits<T>::infinity();
+            }
+            T d = 0;
+            for (std::size_t k = 0; k < m_time.size(); ++k) {
+                d = std::max(d, (sample(k) - other.at(m_time[k])).cwiseAbs().maxCoeff());
+            }
+            for (std::size_t k = 0; k < other.m_time.size(); ++k) {
+                d = std::max(d, (other.sample(k) - at(other.m_time[k])).cwiseAbs().maxCoeff());
+            }
+            return d;
+        }
+        
+    private:
+        std::size_t m_dim;              ///< Dimension of each sample
+        std::vector<simtime_t> m_time;  ///< Times of the samples
+        std::vector<T> m_value;         ///< Values of the samples, column-major (dim x size)
+        
+        template <typename> friend class obn_trajectory;
+    };
+    
+    /** \brief Template class for data as a trajectory (see trajectory<T>) of float or double values.
+     
+     Unlike obn_vector, which transfers one value per update, a whole trajectory over a time window is transferred in one message.
+     The samples are checked when a message is read: the times must be strictly increasing and the number of values must match.
+     */
+    template <typename T>
+    class obn_trajectory {
+    public:
+        static_assert(std::is_floating_point<T>::value, "obn_trajectory requires float or double.");
+        
+        /** The input data type. */
+        using input_data_type = trajectory<T>;
+        
+        /** Container and Initializer for the input type. The data are copied because the trajectory has its own storage. */
+        struct input_data_container {
+            using data_type = input_data_type;
+            data_type v;
+        };
+        
+        /** The output data type. */
+        using output_data_type = trajectory<T>;
+        
+        /** The class type of the ProtoBuf message. */
+        using PB_message_class = typename obn_trajectory_PB_message_class<T>::theclass;
+        
+        /** Assign a trajectory from a ProtoBuf message, after checking it.
+         \return false if the message is not a valid trajectory (v is then left empty).
+         */
+        static bool assign(input_data_type& v, const PB_message_class& msg) {
+            std::size_t dim = msg.dim(), n = msg.time_size();
+            v.reset(dim);
+            if (dim == 0 || std::size_t(msg.value_size()) != dim * n) return false;
+            for (std::size_t k = 1; k < n; ++k) {
+                if (msg.time(k) <= msg.time(k-1)) return false;
+            }
+            v.m_time.assign(msg.time().begin(), msg.time().end());
+            v.m_value.assign(msg.value().begin(), msg.value().end());
+            return true;
+        }
+        
+        /** Static function to write data to a ProtoBuf message. */
+        static void writePBMessage(const output_data_type& data, PB_message_class& msg) {
+            msg.Clear();
+            msg.set_dim(data.m_dim);
+            auto time = msg.mutable_time();
+            time->Resize(data.m_time.size(), 0);
+            std::copy(data.m_time.begin(), data.m_time.end(), time->begin());
+            auto value = msg.mutable_value();
+            value->Resize(data.m_value.size(), T());
+            std::copy(data.m_value.begin(), data.m_value.end(), value->begin());
+        }
+        
+        /** Static function to read data from a ProtoBuf message. */
+        static bool readPBMessage(input_data_container& data, const PB_message_class& msg) {
+            return assign(data.v, msg);
+        }
+        
+        /** The type for the queue in strict ports. */
+        using input_queue_elem_type = std::unique_ptr<input_data_type>;
+        using input_queue_type = std::deque<input_queue_elem_type>;
+        
+        /** Static function to read data from a ProtoBuf message to the queue. */
+        static bool readPBMessageStrict(input_queue_type& data, const PB_message_class& msg) {
+            input_queue_elem_type elem(new input_data_type());
+            if (!assign(*elem, msg)) {
+                return false;
+            }
+            data.push_back(std::move(elem));
             return true;
         }
+    };
+    
+    
+    /** \brief Declares the layout signature of a struct type used with obn_struct<T>.
+     
+     By default the layout of a struct is identified only by its size and alignment.
+     A more robust check is obtained by specializing this template (see macro OBN_STRUCT_LAYOUT) to return a string describing the fields of the struct, e.g. "double P; double Q; int32_t status".
+     Both sides of a connection must use the same signature.
+     */
+    template <typename T>
+    struct obn_struct_layout {
+        static const char* signature() { return ""; }
+    };
+    
+    /** \brief Template class for data as a plain-old-data struct, transferred as raw bytes (use with format OBN_BIN).
+     
+     T must be trivially copyable. A message consists of an 8-byte layout hash followed by the bytes of the struct, so encoding and decoding are simple memory copies.
+     The layout hash is computed from the size, the alignment and the layout signature (obn_struct_layout<T>) of the struct; a message whose hash does not match is rejected by the input port, hence incompatible connections are detected on the first message after connecting.
+     The struct is copied in the native byte order of the machine, so both nodes must run on platforms with the same byte order and compatible ABIs (a mismatch in byte order is also detected by the layout hash).
+     */
+    template <typename T>
+    class obn_struct {
+    public:
+        static_assert(std::is_trivially_copyable<T>::value, "obn_struct requires a trivially copyable type.");
+        
+        /** The input data type. */
+        using input_data_type = T;
+        
+        /** Container and Initializer for the input type. */
+        struct input_data_container {
+            using data_type = input_data_type;
+            data_type v{};
+        };
+        
+        /** The output data type. */
+        using output_data_type = T;
+        
+        /** The type for the queue in strict ports. */
+        using input_queue_elem_type = input_data_type;
+        using input_queue_type = std::deque< input_queue_elem_type >;
+        
+        /** Size in bytes of the layout hash at the beginning of each message. */
+        static constexpr std::size_t header_size = sizeof(uint64_t);
+        
+        /** Size in bytes of a message. */
+        static constexpr std::size_t message_size = header_size + sizeof(T);
+        
+        /** Returns the layout hash of T (64-bit FNV-1a of the size, alignment and layout signature). */
+        static uint64_t layout_hash() {
+            static const uint64_t h = compute_layout_hash();
+            return h;
+        }
+        
+        /** Static function to write data to a binary message of message_size bytes. */
+        static void writeBinaryMessage(const output_data_type& data, char* buf) {
+            const uint64_t h = layout_hash();
+            std::memcpy(buf, &h, header_size);
+            std::memcpy(buf + header_size, &data, sizeof(T));
+        }
         
+        /** Static function to read data from a binary message; returns false if the size or the layout hash does not match. */
+        static bool readBinaryMessage(input_data_container& data, const char* buf, std::size_t len) {
+            if (!checkBinaryMessage(buf, len)) return false;
+            std::memcpy(&data.v, buf + header_size, sizeof(T));
+            return true;
+        }
+        
+        /** Static function to read data from a binary message to the queue. */
+        static bool readBinaryMessageStrict(input_queue_type& data, const char* buf, std::size_t len) {
+            if (!checkBinaryMessage(buf, len)) return false;
+            data.emplace_back();
+            std::memcpy(&data.back(), buf + header_size, sizeof(T));
+            return true;
+        }
+        
+        /** Check the size and the layout hash of a binary message. */
+        static bool checkBinaryMessage(const char* buf, std::size_t len) {
+            if (buf == nullptr || len != message_size) return false;
+            uint64_t h;
+            std::memcpy(&h, buf, header_size);
+            return h == layout_hash();
+        }
+        
+    private:
+        static uint64_t compute_layout_hash() {
+            uint64_t h = 14695981039346656037ULL;     // FNV offset basis
+            auto mix = [&h](const void* p, std::size_t n) {
+                const unsigned char* c = static_cast<const unsigned char*>(p);
+                for (std::size_t i = 0; i < n; ++i) {
+                    h ^= c[i];
+                    h *= 1099511628211ULL;             // FNV prime
+                }
+            };
+            // Sizes are mixed as 64-bit integers in native byte order
+            uint64_t sz = sizeof(T), al = alignof(T);
+            mix(&sz, sizeof(sz));
+            mix(&al, sizeof(al));
+            const char* sig = obn_struct_layout<T>::signature();
+            mix(sig, std::strlen(sig));
+            return h;
+        }
     };
     
+    template <typename T> constexpr std::size_t obn_struct<T>::header_size;
+    template <typename T> constexpr std::size_t obn_struct<T>::message_size;
+    
     
     /** This templated type is the wrapper class for the data type, e.g. obn_scalar<D> or obn_vector<D>.
      It defines input_data_type, PB_message_class, and read and write functions.
@@ -1443,6 +2719,64 @@ namespace OBNnode {
     using OBN_DATA_TYPE_CLASS = typename std::conditional<std::is_arithmetic<D>::value, obn_scalar<D>, D>::type;
     
     
+    /** \brief A buffer of a non-strict ProtoBuf input port: the received message and the value read from it.
+     The value may refer directly to the data of the message (e.g. an Eigen map of a vector), so each buffer has its own message.
+     */
+    template <typename D>
+    struct PBInputBuffer {
+        typename OBN_DATA_TYPE_CLASS<D>::PB_message_class msg;
+        typename OBN_DATA_TYPE_CLASS<D>::input_data_container value;
+    };
+    
+    
+    /** \brief Wait-free triple buffer between one writer thread and one reader thread.
+
+     The writer fills the write buffer and publishes it; the reader takes the most recently published buffer, which then stays unchanged until the reader takes another one.
+     The writer and the reader never wait for each other and never copy the value: publishing and taking a buffer are single atomic exchanges of buffer indices.
+     Used by the non-strict input ports, where the communication thread writes and the node's thread reads.
+     */
+    template <typename T>
+    class TripleBuffer {
+        T m_buffers[3];
+        std::atomic<unsigned int> m_middle{1};   ///< Index of the buffer in the middle, with the flag NEW_DATA if it has been published but not taken
+        unsigned int m_write = 0;   ///< Index of the buffer owned by the writer
+        unsigned int m_read = 2;    ///< Index of the buffer owned by the reader
+
+        static constexpr unsigned int NEW_DATA = 4;
+
+    public:
+        /** The buffer to be written by the writer thread. */
+        T& write_buffer() {
+            return m_buffers[m_write];
+        }
+
+        /** Publish the write buffer (by the writer thread), which becomes available to the reader. */
+        void publish() {
+            m_write = m_middle.exchange(m_write | NEW_DATA, std::memory_order_acq_rel) & ~NEW_DATA;
+        }
+
+        /** Take the most recently published buffer (by the reader thread), if there is one.
+         \return true if a new buffer has been taken.
+         */
+        bool update() {
+            if ((m_middle.load(std::memory_order_relaxed) & NEW_DATA) == 0) {
+                return false;
+            }
+            m_read = m_middle.exchange(m_read, std::memory_order_acq_rel) & ~NEW_DATA;
+            return true;
+        }
+
+        /** The buffer owned by the reader thread; it does not change until the next update(). */
+        T& read_buffer() {
+            return m_buffers[m_read];
+        }
+
+        const T& read_buffer() const {
+            return m_buffers[m_read];
+        }
+    };
+
+
     /** This class allows thread-safe access to the port's value by locking the mutex upon its creation, and unlock the mutex when it's deleted. */
     template <typename V, typename M>
     class LockedAccess {
@@ -1600,5 +2934,11 @@ int OBNnode::OBNNodeBase<NB>::addUpdate(const OBNnode::UpdateType::UPDATE_CALLBA
     return idx;
 }
 
+/** Declares the layout signature of struct type T for obn_struct<T>; must be used at global scope.
+ Example: OBN_STRUCT_LAYOUT(MyRecord, "double P; double Q; int32_t status")
+ */
+#define OBN_STRUCT_LAYOUT(T, SIG) \
+namespace OBNnode { template <> struct obn_struct_layout<T> { static const char* signature() { return SIG; } }; }
+
 #endif // OBNNODE_BASIC_H
 
@@ -44,11 +44,23 @@ extern "C" {
 
     /* === Node interface === */
 
+    // Thread safety: the functions of different nodes (e.g. simRunStep and the port accessors) may be called in parallel from different threads.
+    // The calls on the same node must be serialized by the host, and a node must not be deleted while it is used by another thread.
+    // Node IDs are never reused for a different node, so a stale ID is safely rejected; they are below 2^52 (exactly representable as doubles).
+
     // Create a new node object, given nodeName, workspace, and optional server address.
     // Returns 0 if successful; >0 if node already exists; <0 if error.
     // id stores the ID of the new node.
     int createOBNNode(const char* name, const char* workspace, const char* server, size_t* id);
 
+    // Options of a new node, combined with bitwise OR
+    enum OBNEI_NodeOption {
+        OBNEI_NodeOption_MQTTTopicAliases = 1   // Use MQTT v5 and topic aliases for publishing (the broker must support MQTT v5)
+    };
+
+    // Same as createOBNNode, with options (a bitwise OR of OBNEI_NodeOption values, 0 for the defaults).
+    int createOBNNodeWithOptions(const char* name, const char* workspace, const char* server, unsigned int options, size_t* id);
+
     // Delete a node, given its ID
     // Returns 0 if successful; <0 if node doesn't exist.
     int deleteOBNNode(size_t id);
@@ -99,6 +111,13 @@ extern "C" {
     // *time receives the current wallclock time as a POSIX time value.
     int nodeWallClockTime(size_t nodeid, int64_t* T);
 
+    // Get a pollable file descriptor of the node, which is readable while node or port events are pending.
+    // The host can wait on it (e.g. with epoll) together with other nodes and its own I/O in one thread, then call simRunStep or simGetPortEvent with a small positive timeout (e.g. 1e-6) until it returns a timeout.
+    // The descriptor is owned by the node: do not read from or close it. Not supported on Windows.
+    // Args: node ID, int* fd
+    // Returns: 0 if successful, <0 if error.
+    int nodeEventFD(size_t nodeid, int* fd);
+
 
     /* === Node simulation control interface === */
 
@@ -128,6 +147,28 @@ extern "C" {
     // Returns: status of the request: 0 if successful (accepted), -1 if timeout (failed), -2 if request is invalid, >0 if other errors (failed, see OBN documents for details).
     int simRequestFutureUpdate(size_t nodeid, OBNSimTimeType t, OBNUpdateMask mask, double timeout);
 
+    // Returns the iteration number of the current time window in the waveform relaxation coupling (0 for the first pass).
+    // Args: node ID, unsigned int* iteration (must not be null)
+    // Returns: 0 if successful; -1 if the node ID is invalid; -2 if iteration is null.
+    int simWindowIteration(size_t nodeid, unsigned int* iteration);
+
+    // Request the GC to repeat the current time window because the outputs have not converged (waveform relaxation coupling).
+    // Must be called while processing a Y event.
+    // Args: node ID
+    // Returns: 0 if successful; <0 if error (e.g., node ID is invalid).
+    int simRequestWindowIteration(size_t nodeid);
+
+    // Request an update at the current time, which the GC runs in a micro-step right after the current step without advancing the time (superdense time).
+    // This is a blocking call, possibly with a timeout, that waits until it receives the response from the SMN or until a timeout.
+    // Args: node ID, update mask of the requested update, timeout (double, can be <= 0)
+    // Returns: status of the request: 0 if successful (accepted), -1 if timeout (failed), >0 if other errors (3 if micro-steps are not available or too many), <-1000 if the node ID is invalid.
+    int simRequestMicroStep(size_t nodeid, OBNUpdateMask mask, double timeout);
+
+    // Returns the index of the micro-step of the current update at the current time (0 for a regular update).
+    // Args: node ID, unsigned int* microstep
+    // Returns: 0 if successful; <0 if error (e.g., node ID is invalid).
+    int simMicroStep(size_t nodeid, unsigned int* microstep);
+
 
     /* === Port interface === */
 
@@ -143,7 +184,8 @@ extern "C" {
         OBNEI_Container_Scalar = 0,
         OBNEI_Container_Vector = 1,
         OBNEI_Container_Matrix = 2,
-        OBNEI_Container_Binary = 3      // Raw bytes
+        OBNEI_Container_Binary = 3,     // Raw bytes
+        OBNEI_Container_SparseMatrix = 4    // Sparse matrix in compressed sparse column (CSC) format
     };
 
     /** Element type. */
@@ -283,6 +325,32 @@ extern "C" {
     void inputMatrixUInt64Release(void* pMan, uint64_t* pBuf);
 
 
+    /** These functions read (or pop) the value from a non-strict (or strict) sparse matrix input port.
+     They work in the same way as those for matrix ports, but the matrix is given in compressed sparse column (CSC) format with zero-based indices:
+     - pVals receives the nnz non-zero values, column by column.
+     - pRowIdx receives the nnz row indices of the non-zero values.
+     - pColPtr receives the ncols+1 column pointers: the non-zeros of column j are at positions pColPtr[j] to pColPtr[j+1]-1, and pColPtr[ncols] = nnz.
+     Any of pVals, pRowIdx, pColPtr can be NULL if not needed.  Similarly, *Release(pMan, pVals, pRowIdx, pColPtr) copies the arrays to the non-null buffers before releasing the management object.
+     */
+    int inputSparseMatrixDoubleGet(size_t nodeid, size_t portid, void** pMan, const double** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz);      // Float64
+    void inputSparseMatrixDoubleRelease(void* pMan, double* pVals, int32_t* pRowIdx, int32_t* pColPtr);
+
+    int inputSparseMatrixBoolGet(size_t nodeid, size_t portid, void** pMan, const bool** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz);          // C++ bool (1 byte)
+    void inputSparseMatrixBoolRelease(void* pMan, bool* pVals, int32_t* pRowIdx, int32_t* pColPtr);
+
+    int inputSparseMatrixInt32Get(size_t nodeid, size_t portid, void** pMan, const int32_t** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz);      // Int32
+    void inputSparseMatrixInt32Release(void* pMan, int32_t* pVals, int32_t* pRowIdx, int32_t* pColPtr);
+
+    int inputSparseMatrixInt64Get(size_t nodeid, size_t portid, void** pMan, const int64_t** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz);      // Int64
+    void inputSparseMatrixInt64Release(void* pMan, int64_t* pVals, int32_t* pRowIdx, int32_t* pColPtr);
+
+    int inputSparseMatrixUInt32Get(size_t nodeid, size_t portid, void** pMan, const uint32_t** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz);    // UInt32
+    void inputSparseMatrixUInt32Release(void* pMan, uint32_t* pVals, int32_t* pRowIdx, int32_t* pColPtr);
+
+    int inputSparseMatrixUInt64Get(size_t nodeid, size_t portid, void** pMan, const uint64_t** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz);    // UInt64
+    void inputSparseMatrixUInt64Release(void* pMan, uint64_t* pVals, int32_t* pRowIdx, int32_t* pColPtr);
+
+
     /** These functions read (or pop) the array of bytes from a non-strict (or strict) binary input port.
      These work in the same way as those for vector/matrix ports, but with byte arrays.
      In other words, consider a binary input port as a vector-of-bytes input port.
@@ -325,6 +393,19 @@ extern "C" {
     int outputMatrixUInt64Set(size_t nodeid, size_t portid, const uint64_t* pval, size_t nrows, size_t ncols);    // UInt64
 
 
+    /** These functions set the value of a sparse matrix output port, but does not send it immediately.
+     The matrix is given in compressed sparse column (CSC) format with zero-based indices (see inputSparseMatrix*Get); the arrays are checked for consistency and copied over to the port's internal memory.
+     Args: node ID, port's ID, <elem-type>* values (nnz), int32_t* row indices (nnz), int32_t* column pointers (ncols+1), size_t nrows, size_t ncols, size_t nnz
+     Returns: 0 if successful; <0 if error
+     */
+    int outputSparseMatrixDoubleSet(size_t nodeid, size_t portid, const double* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz);      // Float64
+    int outputSparseMatrixBoolSet(size_t nodeid, size_t portid, const bool* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz);          // C++ bool (1 byte)
+    int outputSparseMatrixInt32Set(size_t nodeid, size_t portid, const int32_t* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz);      // Int32
+    int outputSparseMatrixInt64Set(size_t nodeid, size_t portid, const int64_t* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz);      // Int64
+    int outputSparseMatrixUInt32Set(size_t nodeid, size_t portid, const uint32_t* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz);    // UInt32
+    int outputSparseMatrixUInt64Set(size_t nodeid, size_t portid, const uint64_t* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz);    // UInt64
+
+
     /** This function sets the binary value of a binary output port, but does not send it immediately.
      Usually the value will be sent out at the end of the event callback (UPDATE_Y).
      Args: node ID, port's ID, const char* source, size_t nbytes
@@ -333,11 +414,38 @@ extern "C" {
     int outputBinarySet(size_t nodeid, size_t portid, const char* pval, size_t nbytes);
 
 
+    /* === Host-wide shared data === */
+    // Read-only data blocks shared by all processes on the host through memory-mapped files (see OBNnode::SharedData).
+    // A block is identified by a key; if file is not NULL, the content of the file is hashed into the key, so that a modified file gets a new block.
+    // A typical use: sharedDataOpen(); if the block is not found, parse the file into a buffer and sharedDataCreate() it; sharedDataRelease() when done.
+    // When sharedDataOpen does not find a block, the calling process holds the lock to build it, and the other processes opening the same block wait until it calls
+    // sharedDataCreate (or sharedDataCancel if it can't build the block), so that a block is built only once on the host.
+    // The pointer to the data remains valid until the block is released.
+
+    // Map the block of a key if it is in the cache, waiting while another process builds it.
+    // Args: const char* key, const char* file (or NULL), size_t* id, const char** data, size_t* size
+    // Returns: 0 if successful; >0 if the block is not in the cache (the caller must then create or cancel it); <0 if error
+    int sharedDataOpen(const char* key, const char* file, size_t* id, const char** pData, size_t* size);
+
+    // Store a block in the cache (replacing any block of the same key) and map it.
+    // Args: const char* key, const char* file (or NULL), const char* data, size_t size, size_t* id, const char** data (the mapped copy)
+    // Returns: 0 if successful; <0 if error
+    int sharedDataCreate(const char* key, const char* file, const char* data, size_t size, size_t* id, const char** pData);
+
+    // Give up building a block after sharedDataOpen did not find it, so that other processes can build it.
+    // Returns: 0 if successful; <0 if error
+    int sharedDataCancel(const char* key, const char* file);
+
+    // Release a block obtained from sharedDataOpen or sharedDataCreate.
+    // Returns: 0 if successful; <0 if error
+    int sharedDataRelease(size_t id);
+
+
     /* === Misc === */
     // Returns the maximum ID allowed for an update type.
     int maxUpdateID();
 
-    // Returns the last error/warning message as a C null-terminated string.
+    // Returns the last error/warning message reported in the calling thread, as a C null-terminated string.
     // Do not try to modify the string.
     const char* lastErrorMessage();
     const char* lastWarningMessage();
@@ -362,6 +470,7 @@ extern "C" {
 #endif
 
 // Report an error and may terminate.
+// This function and reportWarning are defined by the host; they must be thread-safe if nodes are used from multiple threads.
 void reportError(const char* msg);
 
 // Report a warning
@@ -14,6 +14,11 @@
 #include <memory>       // smart pointer
 #include <vector>
 #include <functional>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <cstdint>
+#include <limits>
 
 namespace OBNNodeExtInt {
     
@@ -24,75 +29,134 @@ namespace OBNNodeExtInt {
      Note that unlocking a pointer does not delete the pointer; it simply removes the lock.
      
      Example: for Matlab's MEX interface, these correspond to mexLock() and mexUnlock(), and the pointer argument is not used.
+     If the host uses nodes from multiple threads, these functions must be thread-safe.
      */
     void lockPointer(void*);
     void unlockPointer(void*);
     
-    /** Manage object instances. Inspired by MEXPLUS. */
+    /** Manage object instances. Inspired by MEXPLUS.
+     
+     The registry is thread-safe, so that a host (e.g. Julia, Python) can drive many instances from multiple threads:
+     - get() and exist(id) are lock-free; create(), destroy(), exist(pred) and clear() are serialized by a mutex.
+     - The instances are stored in fixed slots which are allocated by chunks and never moved, so a slot remains valid while other instances are created or destroyed.
+     - An ID is the index of its slot tagged with the generation of the slot, which is incremented when the instance is destroyed, so a stale ID of a destroyed instance is never resolved to a new instance reusing the same slot.
+     IDs stay below 2^52, so they are exactly representable as double values in hosts that pass numbers as doubles.
+     An instance must not be destroyed while it is being used by another thread: the host must serialize the operations on the same instance.
+     */
     template<class T>
     class Session {
-    public:
-        typedef std::vector< std::unique_ptr<T> > InstanceList;
+        static constexpr unsigned int INDEX_BITS = 20;      ///< Number of bits of the slot index in an ID; the generation takes the next 32 bits
+        static constexpr unsigned int CHUNK_BITS = 8;       ///< Each chunk contains 2^CHUNK_BITS slots
+        static constexpr std::size_t CHUNK_SIZE = std::size_t(1) << CHUNK_BITS;
+        static constexpr std::size_t MAX_CHUNKS = (std::size_t(1) << INDEX_BITS) / CHUNK_SIZE;
+        static_assert(std::numeric_limits<std::size_t>::digits >= INDEX_BITS + 32, "An ID must hold the slot index and the 32-bit generation, which requires a 64-bit size_t.");
+        
+        /** A slot of an instance. */
+        struct Slot {
+            std::atomic<T*> instance{nullptr};
+            std::atomic<uint32_t> generation{0};
+        };
+        
+        /** The storage of all slots. */
+        struct Storage {
+            std::atomic<Slot*> chunks[MAX_CHUNKS];  ///< Chunks of slots, allocated on demand
+            std::size_t nslots = 0;                 ///< Number of slots in use or freed so far (protected by mutex)
+            std::vector<std::size_t> freeslots;     ///< Indices of the free slots (protected by mutex)
+            std::mutex mutex;                       ///< Mutex for modifying the storage
+            
+            Storage() {
+                for (auto& c: chunks) {
+                    c.store(nullptr, std::memory_order_relaxed);
+                }
+            }
+            
+            ~Storage() {
+                for (auto& c: chunks) {
+                    delete [] c.load(std::memory_order_relaxed);
+                }
+            }
+        };
         
+    public:
         /** Create an instance.
+         \return The ID of the new instance; throws std::length_error if the registry is full.
          */
         static std::size_t create(T* instance) {
-            InstanceList* instances = getInstances();
+            Storage* storage = getStorage();
+            std::lock_guard<std::mutex> lock(storage->mutex);
             
-            // Find an empty slot
-            std::size_t id = 0;
-            auto sz = instances->size();
-            for (; id < sz; ++id) {
-                if (!(instances->at(id)))
-                    break;
-            }
-            if (id < sz) {
-                instances->at(id).reset(instance);      // Assign new pointer to this empty slot
+            // Reuse a free slot, or take a new one
+            std::size_t index;
+            if (!storage->freeslots.empty()) {
+                index = storage->freeslots.back();
+                storage->freeslots.pop_back();
             } else {
-                instances->emplace_back(instance);      // Add new element
+                index = storage->nslots;
+                if ((index >> CHUNK_BITS) >= MAX_CHUNKS) {
+                    throw std::length_error("Too many instances in the session.");
+                }
+                if ((index & (CHUNK_SIZE-1)) == 0) {
+                    // Allocate a new chunk
+                    storage->chunks[index >> CHUNK_BITS].store(new Slot[CHUNK_SIZE], std::memory_order_release);
+                }
+                ++storage->nslots;
             }
+            
+            Slot& slot = storage->chunks[index >> CHUNK_BITS].load(std::memory_order_relaxed)[index & (CHUNK_SIZE-1)];
+            slot.instance.store(instance, std::memory_order_release);
             lockPointer(static_cast<void*>(instance));
-            return id;
+            return index | (std::size_t(slot.generation.load(std::memory_order_relaxed)) << INDEX_BITS);
         }
         /** Destroy an instance.
          */
         static bool destroy(std::size_t id) {
-            T* p = get(id);     // Get the pointer to unlock
-            if (p) {
-                unlockPointer(static_cast<void*>(p));
-                // Destroy the object and reset the shared_ptr to null (i.e., empty)
-                getInstances()->at(id).reset();
-                return true;
+            Storage* storage = getStorage();
+            T* p;
+            {
+                std::lock_guard<std::mutex> lock(storage->mutex);
+                Slot* slot = getSlot(id);
+                if (!slot) {
+                    return false;
+                }
+                p = slot->instance.exchange(nullptr, std::memory_order_acq_rel);
+                if (!p) {
+                    return false;
+                }
+                // Invalidate the ID, then free the slot
+                slot->generation.fetch_add(1, std::memory_order_acq_rel);
+                storage->freeslots.push_back(id & ((std::size_t(1) << INDEX_BITS) - 1));
             }
-            return false;
+            
+            // Destroy the object outside the lock, as it may take a while (e.g. stopping the communication)
+            unlockPointer(static_cast<void*>(p));
+            delete p;
+            return true;
         }
         /** Retrieve an instance or nullptr if no instance is found.
          */
         static T* get(std::size_t id) {
-            InstanceList* instances = getInstances();
-            if (id < instances->size() && id >= 0) {
-                auto& p = instances->at(id);
-                if (p) {
-                    return p.get();
-                }
+            Slot* slot = getSlot(id);
+            if (!slot) {
+                return nullptr;
             }
-            return nullptr;
+            // The instance is loaded before checking the generation: if the slot has been reused by a new instance, its generation has already changed
+            T* p = slot->instance.load(std::memory_order_acquire);
+            return (slot->generation.load(std::memory_order_acquire) == (id >> INDEX_BITS))?p:nullptr;
         }
         /** Check if the given id exists.
          */
         static bool exist(std::size_t id) {
-            InstanceList* instances = getInstances();
-            return id < instances->size() && id >= 0 && instances->at(id);
+            return get(id) != nullptr;
         }
         /** Check if an element exists with a predicate function.
          */
         static bool exist(std::function<bool(const T&)> pred) {
-            InstanceList* instances = getInstances();
-            for (auto it = instances->begin(); it != instances->end(); ++it) {
-                if (*it) {
-                    if (pred(*(*it))) {
-                        return true;
-                    }
+            Storage* storage = getStorage();
+            std::lock_guard<std::mutex> lock(storage->mutex);
+            for (std::size_t index = 0; index < storage->nslots; ++index) {
+                T* p = storage->chunks[index >> CHUNK_BITS].load(std::memory_order_relaxed)[index & (CHUNK_SIZE-1)].instance.load(std::memory_order_acquire);
+                if (p && pred(*p)) {
+                    return true;
                 }
             }
             return false;
@@ -100,13 +164,24 @@ namespace OBNNodeExtInt {
         /** Clear all session instances.
          */
         static void clear() {
-            InstanceList* instances = getInstances();
-            for (auto it = instances->begin(); it != instances->end(); ++it) {
-                if (*it) {
-                    unlockPointer(static_cast<void*>(it->get()));
+            Storage* storage = getStorage();
+            std::vector<T*> instances;
+            {
+                std::lock_guard<std::mutex> lock(storage->mutex);
+                for (std::size_t index = 0; index < storage->nslots; ++index) {
+                    Slot& slot = storage->chunks[index >> CHUNK_BITS].load(std::memory_order_relaxed)[index & (CHUNK_SIZE-1)];
+                    T* p = slot.instance.exchange(nullptr, std::memory_order_acq_rel);
+                    if (p) {
+                        slot.generation.fetch_add(1, std::memory_order_acq_rel);
+                        storage->freeslots.push_back(index);
+                        instances.push_back(p);
+                    }
                 }
             }
-            instances->clear();
+            for (auto p: instances) {
+                unlockPointer(static_cast<void*>(p));
+                delete p;
+            }
         }
         
     private:
@@ -115,11 +190,27 @@ namespace OBNNodeExtInt {
         Session() {}
         ~Session() {}
         
+        /** Get the slot of an ID, or nullptr if the ID is invalid or stale. Lock-free.
+         */
+        static Slot* getSlot(std::size_t id) {
+            std::size_t index = id & ((std::size_t(1) << INDEX_BITS) - 1);
+            std::size_t generation = id >> INDEX_BITS;
+            if (generation > std::numeric_limits<uint32_t>::max()) {
+                return nullptr;
+            }
+            Slot* chunk = getStorage()->chunks[index >> CHUNK_BITS].load(std::memory_order_acquire);
+            if (!chunk) {
+                return nullptr;
+            }
+            Slot* slot = chunk + (index & (CHUNK_SIZE-1));
+            return (slot->generation.load(std::memory_order_acquire) == generation)?slot:nullptr;
+        }
+        
         /** Get static instance storage.
          */
-        static InstanceList* getInstances() {
-            static InstanceList instances;
-            return &instances;
+        static Storage* getStorage() {
+            static Storage storage;
+            return &storage;
         }
     };
 }
@@ -19,6 +19,7 @@
 
 #include <cstdio>       // printf
 #include <vector>
+#include <atomic>
 
 #include <obnnode.h>    // node.C++ framework
 #include <obnnode_ext.h>    // The external interface: all types and function definitions used by external language
@@ -81,6 +82,18 @@ public:
     
     bool _ml_pending_event = false;     ///< if there is a external interface event pending
     bool _node_is_stopping = false;     ///< true if the node is going to stop (node's state is already STOPPED but we still need to push the TERM event to external interface)
+    int64_t m_trace_external_start = -1;   ///< Trace timestamp when the pending event was handed to the external interface (-1 if not traced)
+    bool m_trace_acquired = false;      ///< If this node uses the trace of the process (see OBNsim::Trace::acquireFromEnvironment())
+    int m_trace_track = -1;             ///< Track of this node in the trace of the process, shared by all nodes of the process
+    
+    /** Release the trace of the process if this node uses it. */
+    void traceRelease() {
+        if (m_trace_acquired) {
+            m_trace_acquired = false;
+            m_trace_track = -1;
+            OBNsim::Trace::release();
+        }
+    }
     
     /** This variable stores the current node event in the event queue. This is because while this node is running, whenever it needs to execute a callback in external interface, which is usually in the middle of an event's execution, it must return to external interface, so later on, when the node is called again, it must resume the current event's execution. Therefore we must save the event object to return to it (to run its post-execution. */
     std::shared_ptr<NodeEvent> _current_node_event;
@@ -100,6 +113,46 @@ public:
     /** \brief Get the next port event; often used to process port events inside node event callback. */
     std::unique_ptr<PortEvent> getNextPortEvent(double timeout);
     
+    /* =========== Pollable event descriptor =========== */
+    
+    /** \brief Get a file descriptor that is readable while node or port events are pending, creating it on the first call.
+     
+     The host can wait on this descriptor (e.g. with epoll/poll/select) together with its own I/O, then call runStep() or getNextPortEvent() with a small timeout to process the events.
+     The descriptor is owned by the node: the host must not read from or close it.
+     \return The descriptor, or -1 if it could not be created or is not supported on this platform.
+     */
+    int eventFD();
+    
+private:
+    int m_event_fd[2] = {-1, -1};               ///< The event descriptor: an eventfd (both elements), or a pipe (read end, write end)
+    std::atomic_bool m_event_fd_enabled{false}; ///< Whether the event descriptor is used
+    
+    /** Make the event descriptor readable (thread-safe). */
+    void signalEventFD() {
+        if (m_event_fd_enabled.load(std::memory_order_acquire)) {
+            writeEventFD();
+        }
+    }
+    
+    void writeEventFD();
+    
+    /** Make the event descriptor readable if and only if there are pending node or port events; called by the node's thread after consuming events. */
+    void rearmEventFD();
+    
+protected:
+    // Override the event queue methods to signal the event descriptor
+    virtual void eventqueue_push(NodeEvent *pev, EventClass cls) override {
+        MQTTNodeBase::eventqueue_push(pev, cls);
+        signalEventFD();
+    }
+    
+    virtual void eventqueue_push_front(NodeEvent *pev, EventClass cls) override {
+        MQTTNodeBase::eventqueue_push_front(pev, cls);
+        signalEventFD();
+    }
+    
+public:
+    
     /** Override stopSimulation. */
     void stopSimulation() {
         MQTTNodeBase::stopSimulation();
@@ -169,6 +222,7 @@ public:
      */
     void extint_inputport_msgrcvd_callback(const std::size_t idx) {
         m_port_events.push(new PortEvent{PortEvent::RCV, idx});
+        signalEventFD();
     }
     
     
@@ -50,6 +50,11 @@ namespace OBNnode {
             mqtt_client.setServerAddress(addr);
         }
         
+        /** Use MQTT v5 and topic aliases for publishing (see MQTTClient::setTopicAliases); must be set before the MQTT communication starts. */
+        void setTopicAliases(bool b) {
+            mqtt_client.setTopicAliases(b);
+        }
+        
         /** Start the MQTT communication. */
         bool startMQTT();
         
@@ -168,6 +173,9 @@ namespace OBNnode {
         /** \brief Request a future irregular update from the Global Clock. */
         WaitForCondition* requestFutureUpdate(simtime_t t, updatemask_t m, bool waiting=true);
         
+        /** \brief Request an update at the current time, in a micro-step (superdense time). */
+        WaitForCondition* requestMicroStep(updatemask_t m, bool waiting=true);
+        
         /** \brief Get the result of a pending request for a future update. */
         int64_t resultFutureUpdate(WaitForCondition*, double timeout=-1.0);
         
@@ -180,24 +188,27 @@ namespace OBNnode {
         
         /** Check the given message against the list of wait-for conditions. */
         virtual void checkWaitForCondition(const OBNSimMsg::SMN2N&) override;
+        
+        /** Send a request for an irregular update at time t and register the wait-for condition of its ACK. */
+        WaitForCondition* requestUpdate(simtime_t t, updatemask_t m, bool waiting);
 
-        /** The event queue, which contains smart pointers to event objects. */
-        shared_queue<NodeEvent> _event_queue;
+        /** The event queue, which contains smart pointers to event objects, in priority classes (see EventClass). */
+        shared_queue<NodeEvent, NUM_EVENT_CLASSES> _event_queue;
         
-        /** \brief Push an event object to the event queue.
+        /** \brief Push an event object to the back of its class in the event queue.
          
          This function must be implemented in a thread-safe manner w.r.t. the communication library used because it's usually called in a callback of the communication library (e.g. a MQTT thread or MQTT thread).
          */
-        virtual void eventqueue_push(NodeEvent *pev) override {
-            _event_queue.push(pev);
+        virtual void eventqueue_push(NodeEvent *pev, EventClass cls) override {
+            _event_queue.push(pev, cls);
         }
         
-        /** \brief Push an event object to the front of the event queue.
+        /** \brief Push an event object to the front of its class in the event queue.
          
          This function must be implemented in a thread-safe manner w.r.t. the communication library used because it's usually called in a callback of the communication library (e.g. a MQTT thread or MQTT thread).
          */
-        virtual void eventqueue_push_front(NodeEvent *pev) override {
-            _event_queue.push_front(pev);
+        virtual void eventqueue_push_front(NodeEvent *pev, EventClass cls) override {
+            _event_queue.push_front(pev, cls);
         }
         
         /** \brief Wait until an event exists in the queue and pop it; may wait forever.
@@ -216,6 +227,11 @@ namespace OBNnode {
         virtual std::shared_ptr<NodeEvent> eventqueue_wait_and_pop(double timeout) override {
             return _event_queue.wait_and_pop_timeout(timeout);
         }
+        
+        /** \brief Number of events in the event queue; may be called from any thread. */
+        virtual std::size_t eventqueue_size() const override {
+            return _event_queue.size();
+        }
     };
     
     
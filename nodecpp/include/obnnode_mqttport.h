@@ -25,8 +25,10 @@
 
 #include <unordered_map>
 #include <vector>
+#include <memory>
 
 #include "MQTTAsync.h"
+#include <obnsim_mqtt5.h>
 
 #include "obnnode_exceptions.h"
 #include "obnnode_basic.h"
@@ -44,6 +46,9 @@ namespace OBNnode {
          \param msglen Number of bytes of the message data.
          */
         virtual void parse_message(void* msg, int msglen) = 0;
+        
+        /** Count a received message in the live metrics; called only when the metrics server is running. */
+        virtual void count_message(int msglen) { }
     };
     
     /** \brief The object that manages all MQTT communications (i.e. the MQTT communication thread).
@@ -90,6 +95,12 @@ namespace OBNnode {
         
         std::mutex m_topics_mutex;  ///< Mutex to access the list of topics
         
+        bool m_use_topic_aliases{false};    ///< Whether to connect with MQTT v5 and use topic aliases when publishing
+        OBNsim::MQTT5::TopicAliases m_topic_aliases;  ///< Topic aliases of the current connection (MQTT v5)
+        
+        /** \brief Start connecting to the server, with the MQTT version and the callbacks for a new connection or a reconnection. */
+        int connect(bool reconnect);
+        
         /** \brief Subscribe to all topics of the current input ports.
          \param resubscribe Set to true if this is a resubscription request => if still fails, it's communication error
          */
@@ -139,6 +150,18 @@ namespace OBNnode {
             m_server_address = addr;
         }
         
+        /** Use MQTT v5 and topic aliases for publishing, if the broker accepts them.
+         Topic aliases replace the topic of each message by a small integer, which saves bandwidth and topic matching for high-rate small messages.
+         Must be set before initialize(); the broker must support MQTT v5.
+         */
+        void setTopicAliases(bool b) {
+            m_use_topic_aliases = b;
+        }
+        
+        bool topicAliases() const {
+            return m_use_topic_aliases;
+        }
+        
         /** Set the associated node object. */
         void setNodeObject(NodeBase* pnode) {
             m_node = pnode;
@@ -192,9 +215,15 @@ namespace OBNnode {
         /** Called when the connection with the server is established successfully. */
         static void onConnect(void* context, MQTTAsync_successData* response);
         
+        /** Called when the connection with the server is established successfully, in MQTT v5. */
+        static void onConnect5(void* context, MQTTAsync_successData5* response);
+        
         /** Called when a connection attempt failed. */
         static void onConnectFailure(void* context, MQTTAsync_failureData* response);
         
+        /** Called when a connection attempt failed, in MQTT v5. */
+        static void onConnectFailure5(void* context, MQTTAsync_failureData5* response);
+        
         /** Called when subscription succeeds. */
         static void onSubscribe(void* context, MQTTAsync_successData* response);
         
@@ -204,9 +233,15 @@ namespace OBNnode {
         /** Called when the re-connection with the server is established successfully. */
         static void onReconnect(void* context, MQTTAsync_successData* response);
         
+        /** Called when the re-connection with the server is established successfully, in MQTT v5. */
+        static void onReconnect5(void* context, MQTTAsync_successData5* response);
+        
         /** Called when a re-connection attempt failed. */
         static void onReconnectFailure(void* context, MQTTAsync_failureData* response);
         
+        /** Called when a re-connection attempt failed, in MQTT v5. */
+        static void onReconnectFailure5(void* context, MQTTAsync_failureData5* response);
+        
         /** Called when resubscription fails. */
         static void onReSubscribeFailure(void* context, MQTTAsync_failureData* response);
         
@@ -282,6 +317,15 @@ namespace OBNnode {
         
         virtual std::pair<int, std::string> connect_from_port(const std::string& source) override;
         
+        virtual void count_message(int msglen) override {
+            metrics_count(msglen, false);
+        }
+        
+        /** Remove all the subscriptions of this port from the MQTT client; called by MQTTNodeBase::removePort(). */
+        virtual void remove_subscriptions(MQTTClient& client) {
+            client.removeSubscription(this);
+        }
+        
         /** Set the MQTT client of this node, only if the client has not been set. Returns true if successful. */
         bool set_mqtt_client(MQTTClient* p) {
             if (!m_mqtt_client && p) {
@@ -313,6 +357,12 @@ namespace OBNnode {
         }
         
         std::string m_topicName{};    ///< The MQTT topic of this port
+        
+        /** Send a message on the topic of this port, counting it in the live metrics. */
+        bool sendToTopic(void *data, int size) {
+            metrics_count(size, true);
+            return m_mqtt_client->sendData(data, size, portTopicName());
+        }
     public:
         MQTTOutputPortBase(const std::string& t_name): OutputPortBase(t_name) { }
         //virtual ~MQTTOutputPortBase() { }
@@ -325,6 +375,17 @@ namespace OBNnode {
             return isValid()?m_node->fullPortName(m_name):"";
         }
         
+        /** \brief Set the topic on which this port publishes.
+         
+         An output port does not accept incoming connections; instead, in MQTT, a connection request to an output port assigns the topic of the port, so that the SMN can replace the full port names by compact topics.
+         \param source The new topic of the port.
+         */
+        virtual std::pair<int, std::string> connect_from_port(const std::string& source) override {
+            assert(!source.empty());
+            m_topicName = source;
+            return std::make_pair(0, std::string());
+        }
+        
         /** Returns the topic of this port in MQTT. */
         const std::string& portTopicName() {
             if (m_topicName.empty() && isValid()) {
@@ -359,9 +420,12 @@ namespace OBNnode {
      . obn_vector<t> where t is one of the above types: a variable-length vector of elements of such type.
      . obn_vector_fixed<t, N> where t is one of the above type and N is a constant positive integer: a fixed-length vector of elements of such type. The data is statically allocated, hence more efficient. Incoming data will be checked and an error will be raised if its length is different than N.
      . obn_matrix<t> similar to obn_vector<t> but for a 2-D matrix.
+     . obn_vector_aligned<t> and obn_matrix_aligned<t> similar to obn_vector<t> and obn_matrix<t> but the data is stored in 64-byte aligned, padded memory and exposed as aligned Eigen maps.
      . obn_matrix_fixed<t, M, N> similar to obn_vector_fixed<t, N> but for a matrix of fixed numbers of rows (M) and columns (N).
+     . obn_sparse_matrix<t> a sparse matrix (Eigen::SparseMatrix) of elements of such type, transferred in compressed sparse column format so that the message size scales with the number of non-zeros.
+     . obn_trajectory<t> a time-stamped trajectory of vectors of such type (float or double), used by the waveform relaxation coupling.
      + If FORMAT is OBN_PB_USER then DATATYPE must be a ProtoBuf class generated by protoc. This may not be checked at compile time, but certain necessary methods of a ProtoBuf class for encoding and decoding data must be present. The data read from this port will be an object of this ProtoBuf class. The user is responsible for extracting values from the object.
-     + If FORMAT is OBN_BIN then DATATYPE is irrelevant because the data read from this input port will be a binary string.
+     + If FORMAT is OBN_BIN then DATATYPE is usually irrelevant because the data read from this input port will be a binary string, except if DATATYPE is obn_struct<T> for a trivially copyable struct T, in which case the value is the struct, transferred as raw bytes with a layout check.
      - STRICT is a boolean value: if it is false (default), the input port is nonstrict, which means that any new incoming data will immediately replace the current datum (even if it has not been accessed); if it is true, the input port is strict, i.e. new incoming messages will not replace past messages but be queued to be accessed later.
      */
     template <typename F, typename D, const bool S=false>
@@ -382,9 +446,12 @@ namespace OBNnode {
      . obn_vector<t> where t is one of the above types: a variable-length vector of elements of such type.
      . obn_vector_fixed<t, N> where t is one of the above type and N is a constant positive integer: a fixed-length vector of elements of such type. The data is statically allocated, hence more efficient.
      . obn_matrix<t> similar to obn_vector<t> but for a 2-D matrix.
+     . obn_vector_aligned<t> and obn_matrix_aligned<t> similar to obn_vector<t> and obn_matrix<t> but the data is stored in 64-byte aligned, padded memory and exposed as aligned Eigen maps.
      . obn_matrix_fixed<t, M, N> similar to obn_vector_fixed<t, N> but for a matrix of fixed numbers of rows (M) and columns (N).
+     . obn_sparse_matrix<t> a sparse matrix (Eigen::SparseMatrix) of elements of such type, transferred in compressed sparse column format so that the message size scales with the number of non-zeros.
+     . obn_trajectory<t> a time-stamped trajectory of vectors of such type (float or double), used by the waveform relaxation coupling.
      + If FORMAT is OBN_PB_USER then DATATYPE must be a ProtoBuf class generated by protoc. This may not be checked at compile time, but certain necessary methods of a ProtoBuf class for encoding and decoding data must be present. The data assigned to this port will be an object of this ProtoBuf class. The user is responsible for populating the object with appropriate values.
-     + If FORMAT is OBN_BIN then DATATYPE is irrelevant because the data written to this output port will be a binary string.
+     + If FORMAT is OBN_BIN then DATATYPE is usually irrelevant because the data written to this output port will be a binary string, except if DATATYPE is obn_struct<T> for a trivially copyable struct T, in which case the value is the struct, transferred as raw bytes with a layout check.
      */
     template <typename F, typename D>
     class MQTTOutput;
@@ -400,16 +467,44 @@ namespace OBNnode {
         typedef OBN_DATA_TYPE_CLASS<D> _obn_data_type_class;
         typedef typename _obn_data_type_class::PB_message_class _pb_message_class;
         
-        typename _obn_data_type_class::input_data_container m_cur_value;    ///< The typed value stored in this port
+        /** The messages and typed values stored in this port: the communication thread writes into one buffer while the node's thread reads another one, without locking.
+         Each buffer has its own ProtoBuf message because some data types directly use the data stored in the message, rather than copying the data over. */
+        OBNnode::TripleBuffer<PBInputBuffer<D> > m_values;
         std::atomic_bool m_pending_value{false};    ///< If a new value is pending (hasn't been read)
         
-        /** The ProtoBuf message object to receive the data.
-         This should be a permanent variable (a class member) rather than a temporary variable (in a function)
-         because some implementations directly use the data stored in this message, rather than copying the data over.
-         If a temporary message variable is used, in those cases, the program may crash (invalid access error). */
-        _pb_message_class m_PBMessage;
+        bool m_lazy = false;    ///< If the messages are decoded by the node's thread when the value is read (see setLazyDecoding())
+        OBNnode::TripleBuffer<std::string> m_payloads;  ///< The raw messages stored in this port, if decoding is lazy
+        PBInputBuffer<D> m_decoded[2];  ///< The current value and a spare buffer to decode into, owned by the node's thread, if decoding is lazy
+        unsigned int m_decoded_current = 0;     ///< Index of the current value in m_decoded
         
-        std::mutex m_valueMutex;    ///< Mutex for accessing the value
+        /** Returns the current value, taking the most recent value from the communication thread.
+         If decoding is lazy, the most recent raw message is decoded into the spare buffer, which becomes current only if the decoding succeeds,
+         so that the current value stays valid if the message is erroneous. Messages which are overwritten before being read are never decoded.
+         */
+        typename _obn_data_type_class::input_data_container& current_value() {
+            if (!m_lazy) {
+                m_values.update();
+                return m_values.read_buffer().value;
+            }
+            
+            if (m_payloads.update()) {
+                try {
+                    const std::string& payload = m_payloads.read_buffer();
+                    auto& buffer = m_decoded[1 - m_decoded_current];
+                    if (!buffer.msg.ParseFromArray(payload.data(), payload.size())) {
+                        throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_RAWMSG);
+                    }
+                    if (!OBN_DATA_TYPE_CLASS<D>::readPBMessage(buffer.value, buffer.msg)) {
+                        throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_READVALUE);
+                    }
+                    m_decoded_current = 1 - m_decoded_current;
+                } catch (...) {
+                    // Report the error to the node as if it happened in the communication thread
+                    m_node->postExceptionEvent(std::current_exception());
+                }
+            }
+            return m_decoded[m_decoded_current].value;
+        }
         
     public:
         typedef typename _obn_data_type_class::input_data_type ValueType;
@@ -419,18 +514,30 @@ namespace OBNnode {
             // This managed input port does not generate events in the main thread
             // It simply saves the value in the message to the value
             try {
-                // Parse the ProtoBuf message
-                if (msg == nullptr || msglen < 0 || !m_PBMessage.ParseFromArray(msg, msglen)) {
+                if (m_lazy) {
+                    // Only keep a copy of the raw message; it will be decoded by the node's thread if it is read
+                    if (msg == nullptr || msglen < 0) {
+                        throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_RAWMSG);
+                    }
+                    m_payloads.write_buffer().assign(static_cast<const char*>(msg), msglen);
+                    m_payloads.publish();
+                    m_pending_value = true;
+                    triggerMsgRcvCallback();    // Trigger the Message Received Event Callback
+                    return;
+                }
+                
+                // Parse the ProtoBuf message into the write buffer
+                auto& buffer = m_values.write_buffer();
+                if (msg == nullptr || msglen < 0 || !buffer.msg.ParseFromArray(msg, msglen)) {
                     // Error while parsing the raw message
                     throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_RAWMSG);
                 }
                 
-                // Read from the ProtoBuf message to the value
-                std::unique_lock<std::mutex> mylock(m_valueMutex);
-                bool result = OBN_DATA_TYPE_CLASS<D>::readPBMessage(m_cur_value, m_PBMessage);
-                mylock.unlock();
+                // Read the value from the ProtoBuf message, then publish the buffer
+                bool result = OBN_DATA_TYPE_CLASS<D>::readPBMessage(buffer.value, buffer.msg);
                 
                 if (result) {
+                    m_values.publish();
                     m_pending_value = true;
                     triggerMsgRcvCallback();    // Trigger the Message Received Event Callback
                 } else {
@@ -447,27 +554,44 @@ namespace OBNnode {
     public:
         MQTTInput(const std::string& _name): MQTTInputPortBase(_name) { }
         
+        /** Enable or disable lazy decoding of the messages (disabled by default).
+         By default, each message is decoded by the communication thread as soon as it arrives, which is shared by all ports of the node.
+         With lazy decoding, the port only keeps a copy of the most recent raw message, which is decoded by the node's thread when the value is read:
+         the decoding cost moves off the communication thread, and messages that are overwritten before being read are never decoded.
+         This is worthwhile for ports with large messages (e.g. large vectors or matrices) that arrive more often than they are read.
+         Errors in a message are then reported when the value is read, and the previous value is kept.
+         This must be set before the port receives any message, e.g. right after it is added to the node.
+         */
+        void setLazyDecoding(bool lazy) {
+            m_lazy = lazy;
+        }
+        
+        /** Returns true if lazy decoding is enabled; see setLazyDecoding(). */
+        bool isLazyDecoding() const {
+            return m_lazy;
+        }
+        
         /** Get the current value of the port. If no message has been received, the value is undefined.
-         The value is copied out, which may be inefficient for large data (e.g. a large vector or matrix).
+         The value is copied out, which may be inefficient for large data (e.g. a large vector or matrix); use lock_and_get() to avoid the copy.
+         The value must only be read by the node's thread.
          */
         ValueType operator() () {
-            m_pending_value = false; // the value has been read
-            std::lock_guard<std::mutex> mlock(m_valueMutex);
-            return m_cur_value.v;
+            return get();
         }
         
         ValueType get() {
             m_pending_value = false; // the value has been read
-            std::lock_guard<std::mutex> mlock(m_valueMutex);
-            return m_cur_value.v;
+            return current_value().v;
         }
         
         typedef OBNnode::LockedAccess<typename _obn_data_type_class::input_data_container::data_type, std::mutex> LockedAccess;
         
-        /** Returns a thread-safe direct access to the value of the port. */
+        /** Returns a direct access to the value of the port, without copying or locking.
+         The value does not change, even if new messages arrive, until the port is read again by the node's thread.
+         */
         LockedAccess lock_and_get() {
             m_pending_value = false; // the value has been read
-            return LockedAccess(&m_cur_value.v, &m_valueMutex);
+            return LockedAccess(&current_value().v, nullptr);
         }
         
         /** Check if there is a pending input value (that hasn't been read). */
@@ -578,6 +702,63 @@ namespace OBNnode {
     };
     
     
+    /** Implementation of MQTTInput for a plain-old-data struct transferred as raw bytes (see obn_struct), non-strict reading. */
+    template <typename T>
+    class MQTTInput<OBN_BIN, obn_struct<T>, false>: public MQTTInputPortBase {
+        OBNnode::TripleBuffer<typename obn_struct<T>::input_data_container> m_values;    ///< The struct values stored in this port (see TripleBuffer)
+        std::atomic_bool m_pending_value{false};    ///< If a new value is pending (hasn't been read)
+        
+    public:
+        typedef T ValueType;
+        
+        virtual void parse_message(void* msg, int msglen) override {
+            try {
+                // Check the size and layout hash, then copy the struct
+                bool result = msglen >= 0 && obn_struct<T>::readBinaryMessage(m_values.write_buffer(), static_cast<const char*>(msg), msglen);
+                
+                if (result) {
+                    m_values.publish();
+                    m_pending_value = true;
+                    triggerMsgRcvCallback();    // Trigger the Message Received Event Callback
+                } else {
+                    // Size or layout of the struct doesn't match
+                    throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_READVALUE, "Struct layout or size mismatch.");
+                }
+            } catch (...) {
+                // Catch everything and pass it to the main thread
+                m_node->postExceptionEvent(std::current_exception());
+            }
+        }
+        
+        MQTTInput(const std::string& _name): MQTTInputPortBase(_name) { }
+        
+        /** Returns a copy of the current struct value. If no message has been received, the value is default-initialized. */
+        ValueType operator() () {
+            return get();
+        }
+        
+        ValueType get() {
+            m_pending_value = false; // the value has been read
+            m_values.update();
+            return m_values.read_buffer().v;
+        }
+        
+        typedef OBNnode::LockedAccess<T, std::mutex> LockedAccess;
+        
+        /** Returns a direct access to the value of the port, without copying or locking; it does not change until the port is read again by the node's thread. */
+        LockedAccess lock_and_get() {
+            m_pending_value = false;  // the value has been read
+            m_values.update();
+            return LockedAccess(&m_values.read_buffer().v, nullptr);
+        }
+        
+        /** Check if there is a pending input value (that hasn't been read). */
+        virtual bool isValuePending() const override {
+            return m_pending_value;
+        }
+    };
+    
+    
     /**********************************************************************
      * Strict Input ports (keeping a queue of values).
      **********************************************************************/
@@ -795,6 +976,71 @@ namespace OBNnode {
     };
 
     
+    /** Implementation of MQTTInput for a plain-old-data struct transferred as raw bytes (see obn_struct), strict reading. */
+    template <typename T>
+    class MQTTInput<OBN_BIN, obn_struct<T>, true>: public MQTTInputPortBase {
+    public:
+        typedef T ValueType;
+        
+    private:
+        /** The queue of struct values stored in this port. */
+        typename obn_struct<T>::input_queue_type m_value_queue;
+        
+        std::mutex m_valueMutex;    ///< Mutex for accessing the value
+        
+        // Number of pending values in the queue, kept separately from the queue for quick access
+        std::atomic_uint m_pending_value_count{0};
+        
+    public:
+        virtual void parse_message(void* msg, int msglen) override {
+            try {
+                // Check the size and layout hash, then copy the struct to the queue
+                std::unique_lock<std::mutex> mylock(m_valueMutex);
+                bool result = msglen >= 0 && obn_struct<T>::readBinaryMessageStrict(m_value_queue, static_cast<const char*>(msg), msglen);
+                mylock.unlock();
+                
+                if (result) {
+                    ++m_pending_value_count;
+                    triggerMsgRcvCallback();    // Trigger the Message Received Event Callback
+                } else {
+                    // Size or layout of the struct doesn't match
+                    throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_READVALUE, "Struct layout or size mismatch.");
+                }
+            } catch (...) {
+                // Catch everything and pass it to the main thread
+                m_node->postExceptionEvent(std::current_exception());
+            }
+        }
+        
+        MQTTInput(const std::string& _name): MQTTInputPortBase(_name) { }
+        
+        /** Pop the top / front value of the port.
+         If the queue is empty, a default value is returned (ValueType()).
+         After this, the size of the queue is reduced by 1 if it's non-empty before.
+         */
+        ValueType pop() {
+            if (m_pending_value_count > 0) {
+                std::lock_guard<std::mutex> mylock(m_valueMutex);
+                ValueType val(m_value_queue.front());
+                m_value_queue.pop_front();
+                --m_pending_value_count;
+                return val;
+            }
+            return ValueType();
+        }
+        
+        /** Check if there is a pending input value (that hasn't been read). */
+        virtual bool isValuePending() const override {
+            return m_pending_value_count > 0;
+        }
+        
+        /** Get the number of values in the queue. */
+        std::size_t size() const {
+            return m_pending_value_count;
+        }
+    };
+    
+    
     /**********************************************************************
      * Output ports
      **********************************************************************/
@@ -812,11 +1058,29 @@ namespace OBNnode {
     private:
         ValueType m_cur_value;    ///< The value stored in this port
         typename _obn_data_type_class::PB_message_class m_PBMessage;   ///< The ProtoBuf message object to format the data
+        obn_precision m_precision;  ///< The precision of the values on the wire
 
         OBNsim::ResizableBuffer m_buffer;   ///< The buffer to store data
     public:
         MQTTOutput(const std::string& _name): MQTTOutputPortBase(_name) { }
         
+        /** \brief Set the precision of the values of this port on the wire (see obn_precision).
+         Only double vectors and matrices support reduced precision; the receiving inputs widen the values automatically.
+         \return true if successful; false if the precision is invalid or not supported by the data type.
+         */
+        virtual bool setPrecision(const obn_precision& prec) override {
+            if (prec.mode != obn_precision::FULL &&
+                (!reduced_precision::supported<typename _obn_data_type_class::PB_message_class>::value || !prec.isValid())) {
+                return false;
+            }
+            m_precision = prec;
+            return true;
+        }
+        
+        const obn_precision& precision() const {
+            return m_precision;
+        }
+        
         /** Get the current (read-only) value of the port.
          The value is copied out, which may be inefficient for large data (e.g. a large vector or matrix).
          */
@@ -829,21 +1093,21 @@ namespace OBNnode {
          Once all computations are done, the new value can be assigned to the port using either this operator or the assignment operator.
          */
         ValueType& operator* () {
-            m_isChanged = true;
+            markChanged();
             return m_cur_value;
         }
         
         /** Assign new value to the port. */
         ValueType& operator= (ValueType && rhs) {
             m_cur_value = std::move(rhs);
-            m_isChanged = true;
+            markChanged();
             return m_cur_value;
         }
         
         /** Assign new value to the port. */
         ValueType& operator= (const ValueType & rhs) {
             m_cur_value = rhs;
-            m_isChanged = true;
+            markChanged();
             return m_cur_value;
         }
         
@@ -857,6 +1121,10 @@ namespace OBNnode {
                 
                 // Convert data to message
                 OBN_DATA_TYPE_CLASS<D>::writePBMessage(m_cur_value, m_PBMessage);
+                if (m_precision.mode != obn_precision::FULL) {
+                    // Sent in full precision if the values are not within the error bounds
+                    reduced_precision::reduce(m_PBMessage, m_precision);
+                }
                 
                 // Generate the binary content
                 m_buffer.allocateData(m_PBMessage.ByteSize());
@@ -866,7 +1134,7 @@ namespace OBNnode {
                 }
                 
                 // Send the MQTT message
-                if (!m_mqtt_client->sendData(m_buffer.data(), m_buffer.size(), portTopicName())) {
+                if (!sendToTopic(m_buffer.data(), m_buffer.size())) {
                     // Error while sending the message
                     throw OBNnode::outputport_error(this, OBNnode::outputport_error::ERR_SENDMSG);
                 }
@@ -893,13 +1161,13 @@ namespace OBNnode {
         
         /** Directly access the ProtoBuf message stored in this port; can change it (so it'll be marked as changed). */
         PBCLS& message() {
-            m_isChanged = true;
+            markChanged();
             return m_cur_message;
         }
         
         /** Set the message content. */
         PBCLS& setMessage (const PBCLS& m) {
-            m_isChanged = true;
+            markChanged();
             return (m_cur_message = m);
         }
         
@@ -923,7 +1191,7 @@ namespace OBNnode {
                 }
                 
                 // Send the MQTT message
-                if (!m_mqtt_client->sendData(m_buffer.data(), m_buffer.size(), portTopicName())) {
+                if (!sendToTopic(m_buffer.data(), m_buffer.size())) {
                     // Error while sending the message
                     throw OBNnode::outputport_error(this, OBNnode::outputport_error::ERR_SENDMSG);
                 }
@@ -954,14 +1222,14 @@ namespace OBNnode {
         
         /** Set the binary data content to a std::string */
         void message(const std::string &s) {
-            m_isChanged = true;
+            markChanged();
             m_cur_message.allocateData(s.size());
             s.copy(m_cur_message.data(), s.npos);
         }
         
         /** Set the binary data content to n characters starting from a pointer. */
         void message(const char* s, std::size_t n) {
-            m_isChanged = true;
+            markChanged();
             m_cur_message.allocateData(n);
             if (n > 0) std::copy_n(s, n, m_cur_message.data());
         }
@@ -974,7 +1242,7 @@ namespace OBNnode {
                 }
                 
                 // Send the MQTT message
-                if (!m_mqtt_client->sendData(m_cur_message.data(), m_cur_message.size(), portTopicName())) {
+                if (!sendToTopic(m_cur_message.data(), m_cur_message.size())) {
                     // Error while sending the message
                     throw OBNnode::outputport_error(this, OBNnode::outputport_error::ERR_SENDMSG);
                 }
@@ -986,6 +1254,490 @@ namespace OBNnode {
             }
         }
     };
+    
+    
+    /** Implementation of MQTTOutput for a plain-old-data struct transferred as raw bytes (see obn_struct).
+     This class of MQTTOutput is not thread-safe because usually it's accessed in the main thread only.
+     */
+    template <typename T>
+    class MQTTOutput<OBN_BIN, obn_struct<T>>: public MQTTOutputPortBase {
+    public:
+        typedef T ValueType;
+        
+    private:
+        ValueType m_cur_value{};    ///< The struct value stored in this port
+        char m_buffer[obn_struct<T>::message_size];     ///< The buffer to store the message (layout hash + struct)
+        
+    public:
+        MQTTOutput(const std::string& _name): MQTTOutputPortBase(_name) { }
+        
+        /** Get the current (read-only) value of the port. */
+        ValueType operator() () const {
+            return m_cur_value;
+        }
+        
+        /** Directly access the value stored in this port; can change it (so it'll be marked as changed). */
+        ValueType& operator* () {
+            markChanged();
+            return m_cur_value;
+        }
+        
+        /** Assign new value to the port. */
+        ValueType& operator= (const ValueType & rhs) {
+            m_cur_value = rhs;
+            markChanged();
+            return m_cur_value;
+        }
+        
+        /** Send data synchronously */
+        virtual void sendSync() override {
+            try {
+                if (!m_mqtt_client) {
+                    throw std::runtime_error("Internal error: MQTTClient is null.");
+                }
+                
+                // Layout hash followed by the raw bytes of the struct
+                obn_struct<T>::writeBinaryMessage(m_cur_value, m_buffer);
+                
+                // Send the MQTT message
+                if (!sendToTopic(m_buffer, obn_struct<T>::message_size)) {
+                    // Error while sending the message
+                    throw OBNnode::outputport_error(this, OBNnode::outputport_error::ERR_SENDMSG);
+                }
+                m_isChanged = false;
+            }
+            catch (...) {
+                // Catch everything and pass it to the main thread
+                m_node->postExceptionEvent(std::current_exception());
+            }
+        }
+    };    
+    
+    /**********************************************************************
+     * Port arrays (gather / scatter), for aggregator-style nodes.
+     **********************************************************************/
+    
+    /** \brief An MQTT input port which receives an array of N vectors of the same width, gathered into the columns of one matrix.
+     
+     A hub node (e.g. the master of a distributed algorithm) often receives one vector from each of N other nodes.
+     Instead of N input ports, the vectors are gathered into the columns of one contiguous width x N matrix, which the node reads as a whole or column by column.
+     The port can be connected from:
+     - ordinary vector outputs (e.g. MQTTOutput of obn_vector<T>), each to one element k of the array, which the SMN refers to as "port[k]"
+       (e.g. connect(local.port("x"), hub.port("x", k)) in SMNChai): each of their messages is stored into column k;
+     - output arrays (MQTTOutputArray) of the same size and width, as a whole: each of their messages carries only the vectors which have changed, with their indices
+       (the ArrayXXX messages of obnsim_io.proto), so each of N producers can have an output array in which it only sets its own vector.
+     A message of a different size or width, or with an index out of range, is an error. Reduced-precision messages are widened automatically.
+     */
+    template <typename T>
+    class MQTTInputArray: public MQTTInputPortBase {
+    public:
+        typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> ValueType;
+        typedef Eigen::Matrix<T, Eigen::Dynamic, 1> ElementType;
+        typedef OBNnode::LockedAccess<ValueType, std::mutex> LockedAccess;
+        
+    private:
+        typedef typename obn_array_PB_message_class<T>::theclass _pb_message_class;
+        typedef typename obn_vector_PB_message_class<T>::theclass _pb_element_message_class;
+        
+        /** Subscriber to the topics of the ordinary vector outputs connected to one element of the array. */
+        class ElementSubscriber: public IMQTTInputPort {
+            MQTTInputArray* m_array;
+            std::size_t m_index;
+            _pb_element_message_class m_PBMessage;  ///< The ProtoBuf message object to receive the data
+        public:
+            ElementSubscriber(MQTTInputArray* t_array, std::size_t k): m_array(t_array), m_index(k) { }
+            
+            virtual void parse_message(void* msg, int msglen) override {
+                m_array->parse_element_message(m_index, m_PBMessage, msg, msglen);
+            }
+            
+            virtual void count_message(int msglen) override {
+                m_array->count_message(msglen);
+            }
+        };
+        
+        _pb_message_class m_PBMessage;      ///< The ProtoBuf message object to receive the data from output arrays
+        std::vector< std::unique_ptr<ElementSubscriber> > m_element_subscribers;   ///< The subscribers of the elements connected from ordinary vector outputs (null if none)
+        ValueType m_value;                  ///< The gathered values, one column per vector
+        std::vector<bool> m_pending;        ///< Whether each vector has received a value that hasn't been read
+        std::size_t m_num_pending = 0;
+        mutable std::mutex m_mutex;         ///< Protects the values and the pending flags
+        
+        /** Store width values of a message, starting at the given position, into the k-th vector; must be called with the mutex locked. */
+        template <typename MSG>
+        void store_element(std::size_t k, const MSG& msg, std::size_t first) {
+            if (m_value.rows() > 0) {
+                reduced_precision::copy_from(msg, first, m_value.rows(), m_value.col(k).data());
+            }
+            if (!m_pending[k]) {
+                m_pending[k] = true;
+                ++m_num_pending;
+            }
+        }
+        
+        /** Unpack the vectors in a message from an output array into their columns; called by the communication thread. */
+        bool store(const _pb_message_class& msg) {
+            std::size_t width = m_value.rows(), n = m_value.cols();
+            std::size_t count = msg.index_size();
+            if (msg.width() != width || msg.size() != n || std::size_t(reduced_precision::count(msg)) != count * width) {
+                return false;
+            }
+            for (auto k: msg.index()) {
+                if (k >= n) {
+                    return false;
+                }
+            }
+            
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::size_t i = 0; i < count; ++i) {
+                store_element(msg.index(i), msg, i * width);
+            }
+            return true;
+        }
+        
+        /** Parse a message from an ordinary vector output into the k-th vector; called by the communication thread. */
+        void parse_element_message(std::size_t k, _pb_element_message_class& pbmsg, void* msg, int msglen) {
+            try {
+                // Parse the ProtoBuf message
+                if (msg == nullptr || msglen < 0 || !pbmsg.ParseFromArray(msg, msglen)) {
+                    // Error while parsing the raw message
+                    throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_RAWMSG);
+                }
+                
+                if (std::size_t(reduced_precision::count(pbmsg)) != width()) {
+                    // The vector doesn't have the width of the array
+                    throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_READVALUE);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    store_element(k, pbmsg, 0);
+                }
+                triggerMsgRcvCallback();    // Trigger the Message Received Event Callback
+            } catch (...) {
+                // Catch everything and pass it to the main thread
+                m_node->postExceptionEvent(std::current_exception());
+            }
+        }
+        
+        void clear_pending() {
+            std::fill(m_pending.begin(), m_pending.end(), false);
+            m_num_pending = 0;
+        }
+        
+    public:
+        /** \brief Construct an input array of n vectors of the given width.
+         The values are initially zero.
+         */
+        MQTTInputArray(const std::string& _name, std::size_t n, std::size_t width): MQTTInputPortBase(_name),
+        m_element_subscribers(n), m_value(ValueType::Zero(width, n)), m_pending(n, false) { }
+        
+        virtual ~MQTTInputArray() {
+            // The element subscribers are destroyed with the array, so they must be removed from the MQTT client first
+            if (isValid() && m_mqtt_client) {
+                remove_subscriptions(*m_mqtt_client);
+            }
+        }
+        
+        /** Number of vectors in the array. */
+        std::size_t size() const {
+            return std::size_t(m_value.cols());
+        }
+        
+        /** Length of each vector. */
+        std::size_t width() const {
+            return std::size_t(m_value.rows());
+        }
+        
+        /** Connect an ordinary vector output to the k-th vector of the array. */
+        virtual std::pair<int, std::string> connect_element_from_port(std::size_t k, const std::string& source) override {
+            assert(!source.empty());
+            
+            if (!m_mqtt_client) {
+                return std::make_pair(-2, "Internal error of MQTT port: MQTTClient is null.");
+            }
+            if (k >= size()) {
+                return std::make_pair(-1, "Element " + std::to_string(k) + " is out of the range of port array " + m_name + ".");
+            }
+            
+            // Add the subscription of the element to the client
+            if (!m_element_subscribers[k]) {
+                m_element_subscribers[k].reset(new ElementSubscriber(this, k));
+            }
+            return std::make_pair(m_mqtt_client->addSubscription(m_element_subscribers[k].get(), source), "");
+        }
+        
+        virtual void remove_subscriptions(MQTTClient& client) override {
+            MQTTInputPortBase::remove_subscriptions(client);
+            for (auto& sub: m_element_subscribers) {
+                if (sub) {
+                    client.removeSubscription(sub.get());
+                }
+            }
+        }
+        
+        virtual void parse_message(void* msg, int msglen) override {
+            try {
+                // Parse the ProtoBuf message
+                if (msg == nullptr || msglen < 0 || !m_PBMessage.ParseFromArray(msg, msglen)) {
+                    // Error while parsing the raw message
+                    throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_RAWMSG);
+                }
+                
+                if (!store(m_PBMessage)) {
+                    // The message doesn't match the size or the width of the array
+                    throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_READVALUE);
+                }
+                triggerMsgRcvCallback();    // Trigger the Message Received Event Callback
+            } catch (...) {
+                // Catch everything and pass it to the main thread
+                m_node->postExceptionEvent(std::current_exception());
+            }
+        }
+        
+        /** Get a copy of the gathered values (one column per vector) and mark them as read. */
+        ValueType get() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            clear_pending();
+            return m_value;
+        }
+        
+        /** Get a copy of the k-th vector and mark it as read. */
+        ElementType get(std::size_t k) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending.at(k)) {
+                m_pending[k] = false;
+                --m_num_pending;
+            }
+            return m_value.col(k);
+        }
+        
+        /** Returns a direct access to the gathered values (one column per vector) and mark them as read.
+         The communication thread can't store new values while the returned object exists, so it should be released quickly.
+         */
+        LockedAccess lock_and_get() {
+            LockedAccess access(&m_value, &m_mutex);
+            clear_pending();
+            return access;
+        }
+        
+        /** Check if any vector has received a value that hasn't been read. */
+        virtual bool isValuePending() const override {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_num_pending > 0;
+        }
+        
+        /** Check if the k-th vector has received a value that hasn't been read. */
+        bool isValuePending(std::size_t k) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_pending.at(k);
+        }
+        
+        /** Number of vectors which have received a value that hasn't been read (e.g. to check if all producers have sent their values). */
+        std::size_t numValuesPending() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_num_pending;
+        }
+    };
+    
+    
+    /** \brief An MQTT output port which sends an array of N vectors of the same width, stored in the columns of one matrix.
+     
+     The output counterpart of MQTTInputArray: the node writes the width x N matrix, as a whole or column by column, and the port only sends the vectors that have changed. It can be connected to:
+     - ordinary vector inputs (e.g. MQTTInput of obn_vector<T>), each from one element k of the array, which the SMN refers to as "port[k]"
+       (e.g. connect(hub.port("y", k), local.port("u")) in SMNChai): the k-th vector is sent alone, as an ordinary vector message, on its own topic, so each consumer only receives its own vector;
+     - input arrays (MQTTInputArray) of the same size and width, as a whole: the changed vectors are sent together in one message on the topic of the port.
+     The message of the whole array is not sent if only elements of the array are connected (see publishesArray()).
+     Double values can be sent with reduced precision (see setPrecision()).
+     This class is not thread-safe because usually it's accessed in the main thread only.
+     */
+    template <typename T>
+    class MQTTOutputArray: public MQTTOutputPortBase {
+    public:
+        typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> ValueType;
+        
+    private:
+        typedef typename obn_array_PB_message_class<T>::theclass _pb_message_class;
+        typedef typename obn_vector_PB_message_class<T>::theclass _pb_element_message_class;
+        
+        ValueType m_value;                  ///< The values to send, one column per vector
+        std::vector<bool> m_changed;        ///< Whether each vector has changed since it was last sent
+        std::vector<std::string> m_element_topics;  ///< The topics on which the vectors connected to ordinary inputs are sent (empty if not connected)
+        bool m_array_connected = false;     ///< Whether the whole array has been connected by the SMN
+        _pb_message_class m_PBMessage;      ///< The ProtoBuf message object to format the data of the whole array
+        _pb_element_message_class m_element_PBMessage;  ///< The ProtoBuf message object to format the data of one vector
+        obn_precision m_precision;          ///< The precision of the values on the wire
+        OBNsim::ResizableBuffer m_buffer;   ///< The buffer to store data
+        
+        void markElementChanged(std::size_t k) {
+            m_changed.at(k) = true;
+            markChanged();
+        }
+        
+        /** Serialize a message, with the precision of the port, and send it on a given topic. */
+        template <typename MSG>
+        void sendMessage(MSG& msg, const std::string& topic) {
+            if (m_precision.mode != obn_precision::FULL) {
+                // Sent in full precision if the values are not within the error bounds
+                reduced_precision::reduce(msg, m_precision);
+            }
+            
+            // Generate the binary content
+            m_buffer.allocateData(msg.ByteSize());
+            if (!msg.SerializeToArray(m_buffer.data(), m_buffer.size())) {
+                // Error while serializing the raw message
+                throw OBNnode::outputport_error(this, OBNnode::outputport_error::ERR_SENDMSG);
+            }
+            
+            // Send the MQTT message
+            metrics_count(m_buffer.size(), true);
+            if (!m_mqtt_client->sendData(m_buffer.data(), m_buffer.size(), topic)) {
+                // Error while sending the message
+                throw OBNnode::outputport_error(this, OBNnode::outputport_error::ERR_SENDMSG);
+            }
+        }
+        
+    public:
+        /** \brief Construct an output array of n vectors of the given width.
+         The values are initially zero.
+         */
+        MQTTOutputArray(const std::string& _name, std::size_t n, std::size_t width): MQTTOutputPortBase(_name),
+        m_value(ValueType::Zero(width, n)), m_changed(n, false), m_element_topics(n) { }
+        
+        /** Number of vectors in the array. */
+        std::size_t size() const {
+            return std::size_t(m_value.cols());
+        }
+        
+        /** Length of each vector. */
+        std::size_t width() const {
+            return std::size_t(m_value.rows());
+        }
+        
+        /** Set the topic on which the whole array is sent; the SMN requests it when the whole array is connected. */
+        virtual std::pair<int, std::string> connect_from_port(const std::string& source) override {
+            m_array_connected = true;
+            return MQTTOutputPortBase::connect_from_port(source);
+        }
+        
+        /** Set the topic on which the k-th vector is sent alone; the SMN requests it when the element is connected to an ordinary vector input. */
+        virtual std::pair<int, std::string> connect_element_from_port(std::size_t k, const std::string& source) override {
+            assert(!source.empty());
+            if (k >= size()) {
+                return std::make_pair(-1, "Element " + std::to_string(k) + " is out of the range of port array " + m_name + ".");
+            }
+            m_element_topics[k] = source;
+            return std::make_pair(0, std::string());
+        }
+        
+        /** Whether the message of the whole array is sent: unless only elements of the array have been connected. */
+        bool publishesArray() const {
+            return m_array_connected || std::all_of(m_element_topics.begin(), m_element_topics.end(), [](const std::string& topic) { return topic.empty(); });
+        }
+        
+        /** \brief Set the precision of the values of this port on the wire (see obn_precision); only double arrays support reduced precision.
+         \return true if successful; false if the precision is invalid or not supported by the data type.
+         */
+        virtual bool setPrecision(const obn_precision& prec) override {
+            if (prec.mode != obn_precision::FULL && (!reduced_precision::supported<_pb_message_class>::value || !prec.isValid())) {
+                return false;
+            }
+            m_precision = prec;
+            return true;
+        }
+        
+        const obn_precision& precision() const {
+            return m_precision;
+        }
+        
+        /** Get the current (read-only) values of the array. */
+        const ValueType& operator() () const {
+            return m_value;
+        }
+        
+        /** Directly access the values of the array; all vectors are marked as changed.
+         The size of the matrix must not be changed.
+         */
+        ValueType& operator* () {
+            std::fill(m_changed.begin(), m_changed.end(), true);
+            markChanged();
+            return m_value;
+        }
+        
+        /** Directly access the k-th vector, which is marked as changed. */
+        typename ValueType::ColXpr element(std::size_t k) {
+            markElementChanged(k);
+            return m_value.col(k);
+        }
+        
+        /** Whether the k-th vector has changed since it was last sent. */
+        bool isElementChanged(std::size_t k) const {
+            return m_changed.at(k);
+        }
+        
+        /** Assign new values to the array, which must be a width x N matrix; all vectors are marked as changed. */
+        template <typename Derived>
+        void set(const Eigen::MatrixBase<Derived>& values) {
+            assert(values.rows() == m_value.rows() && values.cols() == m_value.cols());
+            **this = values;
+        }
+        
+        /** Assign a new value to the k-th vector only, which must have the array's width. */
+        template <typename Derived>
+        void set(std::size_t k, const Eigen::MatrixBase<Derived>& value) {
+            assert(value.size() == m_value.rows());
+            element(k) = value;
+        }
+        
+        /** Send the changed vectors synchronously */
+        virtual void sendSync() override {
+            try {
+                if (!m_mqtt_client) {
+                    throw std::runtime_error("Internal error: MQTTClient is null.");
+                }
+                
+                std::size_t width = m_value.rows(), n = m_value.cols();
+                
+                // Send the changed vectors which are connected alone, each on its own topic
+                for (std::size_t k = 0; k < n; ++k) {
+                    if (m_changed[k] && !m_element_topics[k].empty()) {
+                        m_element_PBMessage.Clear();
+                        auto dest = m_element_PBMessage.mutable_value();
+                        dest->Resize(width, T());
+                        if (width > 0) {
+                            std::copy_n(m_value.col(k).data(), width, dest->begin());
+                        }
+                        sendMessage(m_element_PBMessage, m_element_topics[k]);
+                    }
+                }
+                
+                if (publishesArray()) {
+                    // Pack the changed vectors with their indices
+                    m_PBMessage.Clear();
+                    m_PBMessage.set_width(width);
+                    m_PBMessage.set_size(n);
+                    auto index = m_PBMessage.mutable_index();
+                    for (std::size_t k = 0; k < n; ++k) {
+                        if (m_changed[k]) {
+                            index->Add(k);
+                        }
+                    }
+                    auto dest = m_PBMessage.mutable_value();
+                    dest->Resize(index->size() * width, T());
+                    for (int i = 0; i < index->size() && width > 0; ++i) {
+                        std::copy_n(m_value.col(index->Get(i)).data(), width, dest->begin() + i * width);
+                    }
+                    sendMessage(m_PBMessage, portTopicName());
+                }
+                
+                std::fill(m_changed.begin(), m_changed.end(), false);
+                m_isChanged = false;
+            }
+            catch (...) {
+                // Catch everything and pass it to the main thread
+                m_node->postExceptionEvent(std::current_exception());
+            }
+        }
+    };
 }
 
 #endif // OBNNODE_MQTTPORT_H
@@ -0,0 +1,244 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Host-wide cache of read-only data shared by node processes through memory-mapped files.
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#ifndef OBNNODE_SHAREDDATA_H_
+#define OBNNODE_SHAREDDATA_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+
+namespace OBNnode {
+
+    /** \brief A read-only block of data in the host-wide data cache.
+
+     Large read-only data loaded by many nodes on the same host (e.g. bus definitions, lookup tables, weather profiles) are parsed once into a binary block,
+     which is stored in a file of the cache directory and memory-mapped read-only by every process that needs it, so the data are shared at page-cache cost.
+
+     A block is addressed by a key which must determine its content: the key of data derived from a file is obtained by fileKey(), which hashes the content of the file
+     together with a description of how it is parsed, so a modified file gets a new block.
+     The first process that needs a block builds and stores it while holding a lock on the key, and the others wait and map it (see get()).
+     Blocks are written to a temporary file and renamed, so a block is never seen partially written.
+     Before a block is stored, the oldest blocks are removed so that all blocks take at most OBN_DATA_CACHE_SIZE MiB (1024 by default, 0 for no limit);
+     processes that have mapped a removed block keep their mapping, and the others build it again when they need it.
+
+     The cache directory is given by the environment variable OBN_DATA_CACHE_DIR; by default, it is obn-data-<uid> in /dev/shm (or in /tmp if /dev/shm does not exist).
+     It must be a directory owned by the user with mode 0700 (it is created so if it does not exist); otherwise no block is read or stored.
+     Within a process, a block of the same key is mapped only once.
+     On Windows, there is no sharing: each process builds and keeps its own copy of the block.
+     */
+    class SharedData {
+    public:
+        /** Function that builds the content of a block into the given string. It may throw an exception if the data can't be built. */
+        typedef std::function<void (std::string&)> Builder;
+
+        /** \brief Lock of the builder of a block on the host (see acquire()); it is released when the object is destroyed or unlock() is called. */
+        class BuildLock {
+            int m_fd = -1;
+            friend class SharedData;
+        public:
+            BuildLock() = default;
+            BuildLock(const BuildLock&) = delete;
+            BuildLock& operator=(const BuildLock&) = delete;
+            ~BuildLock() {
+                unlock();
+            }
+
+            /** Release the lock, if held. */
+            void unlock();
+        };
+
+        ~SharedData();
+
+        SharedData(const SharedData&) = delete;
+        SharedData& operator=(const SharedData&) = delete;
+
+        /** Pointer to the data. */
+        const char* data() const {
+            return m_data;
+        }
+
+        /** Size of the data in bytes. */
+        std::size_t size() const {
+            return m_size;
+        }
+
+        /** Key of the data. */
+        const std::string& key() const {
+            return m_key;
+        }
+
+        /** \brief Get the block of a key, building and storing it if it is not in the cache.
+
+         \param key The key of the block.
+         \param build The function to build the content of the block if it is not in the cache.
+         \return The block, never null.
+         \exception std::runtime_error The block can't be stored or mapped; an exception thrown by build is passed on.
+         */
+        static std::shared_ptr<const SharedData> get(const std::string& key, const Builder& build);
+
+        /** \brief Get the block of a key, or the lock to build it if it is not in the cache.
+
+         This is the first half of get(), for builders that can't be given as a function (e.g. in the external interface):
+         if the block is not in the cache, the caller holds the lock of the key when this function returns null, and must store the block with put() before releasing the lock,
+         so that the other processes wait for the block instead of building it again.
+         \param key The key of the block.
+         \param lock Receives the lock of the key if the block is not in the cache; released otherwise.
+         \return The block, or null if it is not in the cache.
+         \exception std::runtime_error The cache directory can't be used.
+         */
+        static std::shared_ptr<const SharedData> acquire(const std::string& key, BuildLock& lock);
+
+        /** \brief Get the block of a key if it is in the cache.
+         \return The block, or null if it is not in the cache.
+         \exception std::runtime_error The cache directory can't be used.
+         */
+        static std::shared_ptr<const SharedData> find(const std::string& key);
+
+        /** \brief Store a block in the cache, replacing any existing block of the same key, and map it.
+         \return The block, never null.
+         \exception std::runtime_error The block can't be stored or mapped.
+         */
+        static std::shared_ptr<const SharedData> put(const std::string& key, const void* data, std::size_t size);
+
+        /** \brief Key of the data derived from a file.
+
+         \param file Name of the file, whose content is hashed.
+         \param kind Describes how the data are derived from the file (e.g. the parser and its options).
+         \exception std::runtime_error The file can't be read.
+         */
+        static std::string fileKey(const std::string& file, const std::string& kind);
+
+        /** The cache directory. */
+        static std::string cacheDirectory();
+
+    private:
+        std::string m_key;
+        const char* m_data = nullptr;   ///< Start of the data in the mapping (or in m_copy)
+        std::size_t m_size = 0;
+        void* m_map = nullptr;          ///< The mapping of the whole file, or null if there is no mapping
+        std::size_t m_map_size = 0;
+        std::string m_copy;             ///< Private copy of the data if there is no mapping
+
+        SharedData(const std::string& key): m_key(key) { }
+
+        /** Map the cache file of a key if it exists and is valid; returns null otherwise. */
+        static std::shared_ptr<const SharedData> map(const std::string& key);
+    };
+
+
+    /** \brief A read-only table of numbers and strings (e.g. parsed from a CSV file) stored in a SharedData block.
+
+     Rows may have different numbers of cells; each cell is a double, an integer or a string.
+     The table is read directly from the block without copying, so it can be shared by all processes of the host.
+     */
+    class SharedTable {
+    public:
+        /** Type of a cell. */
+        enum CellType: uint32_t {
+            DOUBLE = 'd',
+            INT = 'i',
+            STRING = 's'
+        };
+
+        /** \brief Writes a table in the binary format of SharedTable, e.g. in the builder of a SharedData block. */
+        class Writer {
+            std::vector<uint64_t> m_rows;   ///< Index of the first cell of each row
+            std::vector<char> m_cells;      ///< The cells, in the binary format
+            std::string m_strings;          ///< The string pool
+
+            void add_cell(uint32_t type, uint32_t len, uint64_t value);
+        public:
+            /** Start a new row. */
+            void new_row();
+
+            /** Add a cell to the current row. */
+            void add_double(double d);
+            void add_int(int64_t i);
+            void add_string(const std::string& s);
+
+            /** Write the table into a string. */
+            void write(std::string& out) const;
+        };
+
+        /** \brief Read a table from a block.
+         \exception std::runtime_error The block is not a valid table.
+         */
+        explicit SharedTable(std::shared_ptr<const SharedData> t_data);
+
+        /** Number of rows. */
+        std::size_t rows() const {
+            return m_nrows;
+        }
+
+        /** Number of cells in a row. */
+        std::size_t cols(std::size_t r) const {
+            check_row(r);
+            return std::size_t(m_rows[r+1] - m_rows[r]);
+        }
+
+        /** Type of a cell. */
+        CellType type(std::size_t r, std::size_t c) const {
+            return CellType(cell(r, c).type);
+        }
+
+        /** Value of a cell as a double (an integer is converted); throws std::out_of_range for a string. */
+        double get_double(std::size_t r, std::size_t c) const;
+
+        /** Value of a cell as an integer (a double is truncated); throws std::out_of_range for a string. */
+        int64_t get_int(std::size_t r, std::size_t c) const;
+
+        /** Value of a string cell; throws std::out_of_range for a number. */
+        std::string get_string(std::size_t r, std::size_t c) const;
+
+        /** The underlying block. */
+        const std::shared_ptr<const SharedData>& data() const {
+            return m_data;
+        }
+
+    private:
+        /** A cell in the binary format. */
+        struct Cell {
+            uint32_t type;
+            uint32_t len;       ///< Length of a string
+            union {
+                double d;
+                int64_t i;
+                uint64_t offset;    ///< Offset of a string in the string pool
+            };
+        };
+        static_assert(sizeof(Cell) == 16, "Unexpected size of SharedTable::Cell");
+
+        std::shared_ptr<const SharedData> m_data;
+        std::size_t m_nrows = 0;
+        const uint64_t* m_rows = nullptr;   ///< nrows+1 indices of the first cells of the rows
+        const Cell* m_cells = nullptr;
+        const char* m_strings = nullptr;
+
+        void check_row(std::size_t r) const {
+            if (r >= m_nrows) {
+                throw std::out_of_range("SharedTable: row index out of range.");
+            }
+        }
+
+        const Cell& cell(std::size_t r, std::size_t c) const {
+            if (c >= cols(r)) {
+                throw std::out_of_range("SharedTable: column index out of range.");
+            }
+            return m_cells[m_rows[r] + c];
+        }
+    };
+}
+
+#endif /* OBNNODE_SHAREDDATA_H_ */
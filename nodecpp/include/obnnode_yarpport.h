@@ -45,9 +45,12 @@ namespace OBNnode {
      . obn_vector<t> where t is one of the above types: a variable-length vector of elements of such type.
      . obn_vector_fixed<t, N> where t is one of the above type and N is a constant positive integer: a fixed-length vector of elements of such type. The data is statically allocated, hence more efficient. Incoming data will be checked and an error will be raised if its length is different than N.
      . obn_matrix<t> similar to obn_vector<t> but for a 2-D matrix.
+     . obn_vector_aligned<t> and obn_matrix_aligned<t> similar to obn_vector<t> and obn_matrix<t> but the data is stored in 64-byte aligned, padded memory and exposed as aligned Eigen maps.
      . obn_matrix_fixed<t, M, N> similar to obn_vector_fixed<t, N> but for a matrix of fixed numbers of rows (M) and columns (N).
+     . obn_sparse_matrix<t> a sparse matrix (Eigen::SparseMatrix) of elements of such type, transferred in compressed sparse column format so that the message size scales with the number of non-zeros.
+     . obn_trajectory<t> a time-stamped trajectory of vectors of such type (float or double), used by the waveform relaxation coupling.
      + If FORMAT is OBN_PB_USER then DATATYPE must be a ProtoBuf class generated by protoc. This may not be checked at compile time, but certain necessary methods of a ProtoBuf class for encoding and decoding data must be present. The data read from this port will be an object of this ProtoBuf class. The user is responsible for extracting values from the object.
-     + If FORMAT is OBN_BIN then DATATYPE is irrelevant because the data read from this input port will be a binary string.
+     + If FORMAT is OBN_BIN then DATATYPE is usually irrelevant because the data read from this input port will be a binary string, except if DATATYPE is obn_struct<T> for a trivially copyable struct T, in which case the value is the struct, transferred as raw bytes with a layout check.
      - STRICT is a boolean value: if it is false (default), the input port is nonstrict, which means that any new incoming data will immediately replace the current datum (even if it has not been accessed); if it is true, the input port is strict, i.e. new incoming messages will not replace past messages but be queued to be accessed later.
      */
     template <typename F, typename D, const bool S=false>
@@ -68,9 +71,12 @@ namespace OBNnode {
      . obn_vector<t> where t is one of the above types: a variable-length vector of elements of such type.
      . obn_vector_fixed<t, N> where t is one of the above type and N is a constant positive integer: a fixed-length vector of elements of such type. The data is statically allocated, hence more efficient.
      . obn_matrix<t> similar to obn_vector<t> but for a 2-D matrix.
+     . obn_vector_aligned<t> and obn_matrix_aligned<t> similar to obn_vector<t> and obn_matrix<t> but the data is stored in 64-byte aligned, padded memory and exposed as aligned Eigen maps.
      . obn_matrix_fixed<t, M, N> similar to obn_vector_fixed<t, N> but for a matrix of fixed numbers of rows (M) and columns (N).
+     . obn_sparse_matrix<t> a sparse matrix (Eigen::SparseMatrix) of elements of such type, transferred in compressed sparse column format so that the message size scales with the number of non-zeros.
+     . obn_trajectory<t> a time-stamped trajectory of vectors of such type (float or double), used by the waveform relaxation coupling.
      + If FORMAT is OBN_PB_USER then DATATYPE must be a ProtoBuf class generated by protoc. This may not be checked at compile time, but certain necessary methods of a ProtoBuf class for encoding and decoding data must be present. The data assigned to this port will be an object of this ProtoBuf class. The user is responsible for populating the object with appropriate values.
-     + If FORMAT is OBN_BIN then DATATYPE is irrelevant because the data written to this output port will be a binary string.
+     + If FORMAT is OBN_BIN then DATATYPE is usually irrelevant because the data written to this output port will be a binary string, except if DATATYPE is obn_struct<T> for a trivially copyable struct T, in which case the value is the struct, transferred as raw bytes with a layout check.
      */
     template <typename F, typename D>
     class YarpOutput;
@@ -87,16 +93,10 @@ namespace OBNnode {
         typedef typename _obn_data_type_class::input_data_type ValueType;
 
     private:
-        typename _obn_data_type_class::input_data_container _cur_value;    ///< The typed value stored in this port
-        bool _pending_value;    ///< If a new value is pending (hasn't been read)
-        
-        /** The ProtoBuf message object to receive the data.
-         This should be a permanent variable (a class member) rather than a temporary variable (in a function)
-         because some implementations directly use the data stored in this message, rather than copying the data over.
-         If a temporary message variable is used, in those cases, the program may crash (invalid access error). */
-        typename _obn_data_type_class::PB_message_class _PBMessage;
-        
-        mutable yarp::os::Mutex _valueMutex;    ///< Mutex for accessing the value
+        /** The messages and typed values stored in this port: the communication thread writes into one buffer while the node's thread reads another one, without locking.
+         Each buffer has its own ProtoBuf message because some data types directly use the data stored in the message, rather than copying the data over. */
+        OBNnode::TripleBuffer<PBInputBuffer<D> > _values;
+        std::atomic_bool _pending_value;    ///< If a new value is pending (hasn't been read)
         
         virtual void onRead(_port_content_type& b) override {
             // printf("Callback[%s]\n", getName().c_str());
@@ -105,21 +105,19 @@ namespace OBNnode {
             // It simply saves the value in the message to the value
             
             try {
-                // Parse the ProtoBuf message
-                if (!b.getMessage(_PBMessage)) {
+                // Parse the ProtoBuf message into the write buffer
+                auto& buffer = _values.write_buffer();
+                if (!b.getMessage(buffer.msg)) {
                     // Error while parsing the raw message
                     throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_RAWMSG);
                 }
                 
-                // Read from the ProtoBuf message to the value
-                _valueMutex.lock();
-                bool result = OBN_DATA_TYPE_CLASS<D>::readPBMessage(_cur_value, _PBMessage);
-                if (result) {
-                    _pending_value = true;
-                }
-                _valueMutex.unlock();
+                // Read the value from the ProtoBuf message, then publish the buffer
+                bool result = OBN_DATA_TYPE_CLASS<D>::readPBMessage(buffer.value, buffer.msg);
                 
                 if (result) {
+                    _values.publish();
+                    _pending_value = true;
                     triggerMsgRcvCallback();    // Trigger the Message Received Event Callback
                 } else {
                     // Error while reading the value, e.g. sizes don't match
@@ -138,26 +136,28 @@ namespace OBNnode {
         }
         
         /** Get the current value of the port. If no message has been received, the value is undefined.
-         The value is copied out, which may be inefficient for large data (e.g. a large vector or matrix).
+         The value is copied out, which may be inefficient for large data (e.g. a large vector or matrix); use lock_and_get() to avoid the copy.
+         The value must only be read by the node's thread.
          */
         ValueType operator() () {
-            yarp::os::LockGuard mlock(_valueMutex);
-            _pending_value = false; // the value has been read
-            return _cur_value.v;
+            return get();
         }
 
         ValueType get() {
-            yarp::os::LockGuard mlock(_valueMutex);
             _pending_value = false; // the value has been read
-            return _cur_value.v;
+            _values.update();
+            return _values.read_buffer().value.v;
         }
         
         typedef OBNnode::LockedAccess<typename _obn_data_type_class::input_data_container::data_type, yarp::os::Mutex> LockedAccess;
         
-        /** Returns a thread-safe direct access to the value of the port. */
+        /** Returns a direct access to the value of the port, without copying or locking.
+         The value does not change, even if new messages arrive, until the port is read again by the node's thread.
+         */
         LockedAccess lock_and_get() {
             _pending_value = false; // the value has been read
-            return LockedAccess(&_cur_value.v, &_valueMutex);
+            _values.update();
+            return LockedAccess(&_values.read_buffer().value.v, nullptr);
         }
         
         /** Check if there is a pending input value (that hasn't been read). */
@@ -338,6 +338,88 @@ namespace OBNnode {
     
     
     
+    /** Implementation of YarpInput for a plain-old-data struct transferred as raw bytes (see obn_struct), non-strict reading. */
+    template <typename T>
+    class YarpInput<OBN_BIN, obn_struct<T>, false>: public YarpPortBase,
+    protected yarp::os::BufferedPort<YARPMsgBin>
+    {
+        typedef YARPMsgBin _port_content_type;
+        
+    public:
+        typedef T ValueType;
+        
+    private:
+        OBNnode::TripleBuffer<typename obn_struct<T>::input_data_container> _values;    ///< The struct values stored in this port (see TripleBuffer)
+        std::atomic_bool _pending_value;    ///< If a new value is pending (hasn't been read)
+        
+        virtual void onRead(_port_content_type& b) override {
+            try {
+                // Check the size and layout hash, then copy the struct
+                bool result = obn_struct<T>::readBinaryMessage(_values.write_buffer(), b.getBinaryData(), b.getBinaryDataSize());
+                
+                if (result) {
+                    _values.publish();
+                    _pending_value = true;
+                    triggerMsgRcvCallback();    // Trigger the Message Received Event Callback
+                } else {
+                    // Size or layout of the struct doesn't match
+                    throw OBNnode::inputport_error(this, OBNnode::inputport_error::ERR_READVALUE, "Struct layout or size mismatch.");
+                }
+            } catch (...) {
+                // Catch everything and pass it to the main thread
+                m_node->postExceptionEvent(std::current_exception());
+            }
+        }
+        
+    public:
+        YarpInput(const std::string& _name): YarpPortBase(_name), _pending_value(false) {
+            
+        }
+        
+        /** Returns a copy of the current struct value. If no message has been received, the value is default-initialized. */
+        ValueType operator() () {
+            return get();
+        }
+        
+        ValueType get() {
+            _pending_value = false; // the value has been read
+            _values.update();
+            return _values.read_buffer().v;
+        }
+        
+        typedef OBNnode::LockedAccess<T, yarp::os::Mutex> LockedAccess;
+        
+        /** Returns a direct access to the value of the port, without copying or locking; it does not change until the port is read again by the node's thread. */
+        LockedAccess lock_and_get() {
+            _pending_value = false;  // the value has been read
+            _values.update();
+            return LockedAccess(&_values.read_buffer().v, nullptr);
+        }
+        
+        /** Check if there is a pending input value (that hasn't been read). */
+        virtual bool isValuePending() const override {
+            return _pending_value;
+        }
+        
+        
+    protected:
+        virtual yarp::os::Contactable& getYarpPort() override {
+            return *this;
+        }
+        
+        virtual const yarp::os::Contactable& getYarpPort() const override {
+            return *this;
+        }
+        
+        virtual bool configure() {
+            // Turn on callback
+            this->useCallback();
+            return true;
+        }
+    };
+    
+    
+    
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////
     //          Implementations of YarpInput for strict reading ports
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -367,12 +449,30 @@ namespace OBNnode {
     private:
         ValueType _cur_value;    ///< The value stored in this port
         typename _obn_data_type_class::PB_message_class _PBMessage;   ///< The ProtoBuf message object to format the data
+        obn_precision _precision;   ///< The precision of the values on the wire
         
     public:
         
         YarpOutput(const std::string& _name): YarpOutputPortBase(_name) {
         }
         
+        /** \brief Set the precision of the values of this port on the wire (see obn_precision).
+         Only double vectors and matrices support reduced precision; the receiving inputs widen the values automatically.
+         \return true if successful; false if the precision is invalid or not supported by the data type.
+         */
+        virtual bool setPrecision(const obn_precision& prec) override {
+            if (prec.mode != obn_precision::FULL &&
+                (!reduced_precision::supported<typename _obn_data_type_class::PB_message_class>::value || !prec.isValid())) {
+                return false;
+            }
+            _precision = prec;
+            return true;
+        }
+        
+        const obn_precision& precision() const {
+            return _precision;
+        }
+        
         /** Get the current (read-only) value of the port.
          The value is copied out, which may be inefficient for large data (e.g. a large vector or matrix).
          */
@@ -385,21 +485,21 @@ namespace OBNnode {
          Once all computations are done, the new value can be assigned to the port using either this operator or the assignment operator.
          */
         ValueType& operator* () {
-            m_isChanged = true;
+            markChanged();
             return _cur_value;
         }
         
         /** Assign new value to the port. */
         ValueType& operator= (ValueType && rhs) {
             _cur_value = std::move(rhs);
-            m_isChanged = true;
+            markChanged();
             return _cur_value;
         }
         
         /** Assign new value to the port. */
         ValueType& operator= (const ValueType & rhs) {
             _cur_value = rhs;
-            m_isChanged = true;
+            markChanged();
             return _cur_value;
         }
         
@@ -409,6 +509,10 @@ namespace OBNnode {
             try {
                 // Convert data to message
                 OBN_DATA_TYPE_CLASS<D>::writePBMessage(_cur_value, _PBMessage);
+                if (_precision.mode != obn_precision::FULL) {
+                    // Sent in full precision if the values are not within the error bounds
+                    reduced_precision::reduce(_PBMessage, _precision);
+                }
                 
                 // Prepare the Yarp message to send
                 _port_content_type & output = this->prepare();
@@ -454,13 +558,13 @@ namespace OBNnode {
         
         /** Directly access the ProtoBuf message stored in this port; can change it (so it'll be marked as changed). */
         PBCLS& message() {
-            m_isChanged = true;
+            markChanged();
             return _cur_message;
         }
         
         /** Set the message content. */
         PBCLS& setMessage (const PBCLS& m) {
-            m_isChanged = true;
+            markChanged();
             return (_cur_message = m);
         }
         
@@ -515,19 +619,19 @@ namespace OBNnode {
         
         /** Directly access the ProtoBuf message stored in this port; can change it (so it'll be marked as changed). */
         std::string& message() {
-            m_isChanged = true;
+            markChanged();
             return _cur_message;
         }
         
         /** Set the binary data content to a std::string */
         std::string& message(const std::string &s) {
-            m_isChanged = true;
+            markChanged();
             return _cur_message.assign(s);
         }
         
         /** Set the binary data content to n characters starting from a pointer. */
         std::string& message(const char* s, std::size_t n) {
-            m_isChanged = true;
+            markChanged();
             return _cur_message.assign(s, n);
         }
         
@@ -552,6 +656,69 @@ namespace OBNnode {
         }
     };
     
+    
+    /** Implementation of YarpOutput for a plain-old-data struct transferred as raw bytes (see obn_struct).
+     This class of YarpOutput is not thread-safe because usually it's accessed in the main thread only.
+     */
+    template <typename T>
+    class YarpOutput<OBN_BIN, obn_struct<T>>: public YarpOutputPortBase,
+    protected yarp::os::BufferedPort< YARPMsgBin >
+    {
+        typedef YARPMsgBin _port_content_type;
+        
+    public:
+        typedef T ValueType;
+        
+    private:
+        ValueType _cur_value{};    ///< The struct value stored in this port
+        char _buffer[obn_struct<T>::message_size];     ///< The buffer to store the message (layout hash + struct)
+        
+    public:
+        YarpOutput(const std::string& _name): YarpOutputPortBase(_name) {
+        }
+        
+        /** Get the current (read-only) value of the port. */
+        ValueType operator() () const {
+            return _cur_value;
+        }
+        
+        /** Directly access the value stored in this port; can change it (so it'll be marked as changed). */
+        ValueType& operator* () {
+            markChanged();
+            return _cur_value;
+        }
+        
+        /** Assign new value to the port. */
+        ValueType& operator= (const ValueType & rhs) {
+            _cur_value = rhs;
+            markChanged();
+            return _cur_value;
+        }
+        
+        /** Send data synchronously */
+        virtual void sendSync() override {
+            // Layout hash followed by the raw bytes of the struct
+            obn_struct<T>::writeBinaryMessage(_cur_value, _buffer);
+            
+            // Prepare the Yarp message to send
+            _port_content_type & output = this->prepare();
+            output.setBinaryData(_buffer, obn_struct<T>::message_size);
+            
+            // Actually send the message
+            this->writeStrict();
+            m_isChanged = false;
+        }
+        
+    protected:
+        virtual yarp::os::Contactable& getYarpPort() override {
+            return *this;
+        }
+        
+        virtual const yarp::os::Contactable& getYarpPort() const override {
+            return *this;
+        }
+    };
+    
 }
 
 
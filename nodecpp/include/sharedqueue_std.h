@@ -30,19 +30,43 @@
  This shared queue contains smart pointers to objects of type T.
  When pushing new objects, remember to dynamically create the objects, not a local scope object. The queue will take ownership of the object pointer.
  Because this uses smart pointers, after popping out an object (actually a pointer to an object), there is no need to delete the object.
+ The queue may have several priority classes, 0 being the highest: an object is always popped from the highest non-empty class, and each class is a FIFO queue of its own.
  \param T Type of the objects (the queue contains smart pointers to these objects, not the objects themselves).
+ \param NCLASSES Number of priority classes.
  */
-template <typename T>
+template <typename T, unsigned int NCLASSES = 1>
 class shared_queue
 {
 public:
     typedef typename std::unique_ptr<T> item_type; ///< Smart pointer type to the objects.
 
 private :
-    std::deque<item_type> mData;
+    std::deque<item_type> mData[NCLASSES];     // one queue per priority class
     mutable std::mutex mMut;
     std::condition_variable mEmptyCondition;   // condition variable to notify after pushing to queue
     
+    // Check if all classes are empty; the caller must have the lock
+    bool empty_with_lock() const {
+        for (const auto& d: mData) {
+            if (!d.empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Pop the oldest element of the highest non-empty class; the caller must have the lock and the queue must be non-empty
+    item_type pop_with_lock() {
+        for (auto& d: mData) {
+            if (!d.empty()) {
+                item_type val(std::move(d.front()));  // move the pointer (and its ownership) to val; the front element in the queue lost the ownership
+                d.pop_front();
+                return val;
+            }
+        }
+        return item_type();
+    }
+    
 public:
     // shared_queue() { }
     
@@ -50,6 +74,7 @@ public:
     /** Push an object into the queue.
      
      \param pValue The object to be pushed, of type T and must be dynamically allocated.
+     \param cls The priority class, less than NCLASSES.
      */
     /*
     void push(T& pValue) // The object of type T must be dynamically allocated
@@ -64,50 +89,51 @@ public:
         mEmptyCondition.notify_all();
     }*/
     
-    void push(T* pValue) // The object of type T must be dynamically allocated
+    void push(T* pValue, unsigned int cls = 0) // The object of type T must be dynamically allocated
     {
         // block execution here, if other thread already locked mMute!
         std::unique_lock<std::mutex> mlock(mMut);
         // if we are here no other thread is owned/locked mMute. so we can modify the internal data
-        mData.emplace_back(pValue);     // Take ownership of the pointer
+        mData[cls].emplace_back(pValue);     // Take ownership of the pointer
         mlock.unlock();  // unlock before notifying to reduce contention
         mEmptyCondition.notify_all();
     }
 
-    void push(item_type&& v) // The object of type T must be dynamically allocated
+    void push(item_type&& v, unsigned int cls = 0) // The object of type T must be dynamically allocated
     {
         // block execution here, if other thread already locked mMute!
         std::unique_lock<std::mutex> mlock(mMut);
         // if we are here no other thread is owned/locked mMute. so we can modify the internal data
-        mData.push_back(v);     // Move the pointer to the queue
+        mData[cls].push_back(std::move(v));     // Move the pointer to the queue
         mlock.unlock();  // unlock before notifying to reduce contention
         mEmptyCondition.notify_all();
     }
     ///@}
     
-    void push_front(T* pValue)
+    /** Push an object at the front of its priority class. */
+    void push_front(T* pValue, unsigned int cls = 0)
     {
         // block execution here, if other thread already locked mMute!
         std::unique_lock<std::mutex> mlock(mMut);
         // if we are here no other thread is owned/locked mMute. so we can modify the internal data
-        mData.emplace_front(pValue);
+        mData[cls].emplace_front(pValue);
         mlock.unlock();  // unlock before notifying to reduce contention
         mEmptyCondition.notify_all();
     }
     
-    void push_front(item_type&& v)
+    void push_front(item_type&& v, unsigned int cls = 0)
     {
         // block execution here, if other thread already locked mMute!
         std::unique_lock<std::mutex> mlock(mMut);
         // if we are here no other thread is owned/locked mMute. so we can modify the internal data
-        mData.push_front(v);
+        mData[cls].push_front(std::move(v));
         mlock.unlock();  // unlock before notifying to reduce contention
         mEmptyCondition.notify_all();
     }
     
     /** \brief Wait until queue is non-empty and pop.
      
-     This function waits, in a thread-safe and idling manner, until the queue is non-empty and pop the oldest element.
+     This function waits, in a thread-safe and idling manner, until the queue is non-empty and pop the oldest element of the highest non-empty class.
      Use try_pop if you don't want to wait.
      \return The oldest item.
      \see try_pop()
@@ -120,14 +146,12 @@ public:
         // unlocks the mMut and waits for signla.
         // because mMute is released other threads have a chance to Push new data into queue
         // ... in notify this condition variable!
-        while (mData.empty()) {
+        while (empty_with_lock()) {
             mEmptyCondition.wait(lock);
         }
         
         // if we are are here, mData is not empty and mMut is locked !
-        item_type val(std::move(mData.front()));  // move the pointer (and its ownership) to val; the front element in the queue lost the ownership
-        mData.pop_front();
-        return val;
+        return pop_with_lock();
     }
     
     /** Block until the queue is non-empty or timeout.
@@ -141,11 +165,9 @@ public:
         // unlocks the mMut and waits for signal or until timeout.
         // because mMute is released other threads have a chance to Push new data into queue
         // ... in notify this condition variable!
-        if (mEmptyCondition.wait_for(lock, std::chrono::milliseconds(int(timeout*1000)), [this](){ return !this->mData.empty(); })) {
+        if (mEmptyCondition.wait_for(lock, std::chrono::milliseconds(int(timeout*1000)), [this](){ return !this->empty_with_lock(); })) {
             // The queue is not empty -> pop
-            item_type val(std::move(mData.front()));  // move the pointer (and its ownership) to val; the front element in the queue lost the ownership
-            mData.pop_front();
-            return val;
+            return pop_with_lock();
         } else {
             // Timeout
             return item_type();
@@ -161,11 +183,7 @@ public:
     {
         std::unique_lock<std::mutex> lock(mMut);
         
-        if (mData.empty())
-            return item_type();  // nil
-        item_type val(std::move(mData.front()));    // move the pointer (and its ownership) to val; the front element in the queue lost the ownership
-        mData.pop_front();
-        return val;
+        return pop_with_lock();     // nil if the queue is empty
     }
     
     /** \brief Try to pop when the caller HAS the lock on the queue access.
@@ -188,7 +206,17 @@ public:
     bool empty() const ///< Check if the queue is empty.
     {
         std::lock_guard<std::mutex> lock(mMut);
-        return mData.empty();
+        return empty_with_lock();
+    }
+    
+    std::size_t size() const ///< Number of items in the queue.
+    {
+        std::lock_guard<std::mutex> lock(mMut);
+        std::size_t n = 0;
+        for (const auto& d: mData) {
+            n += d.size();
+        }
+        return n;
     }
     
     /** \brief Check if the queue is empty when the caller HAS the lock on the queue access.
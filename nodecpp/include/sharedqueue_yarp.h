@@ -26,31 +26,46 @@
  This shared queue contains smart pointers to objects of type T.
  When pushing new objects, remember to dynamically create the objects, not a local scope object. The queue will take ownership of the object pointer.
  Because this uses smart pointers, after popping out an object (actually a pointer to an object), there is no need to delete the object.
+ The queue may have several priority classes, 0 being the highest: an object is always popped from the highest non-empty class, and each class is a FIFO queue of its own.
  \param T Type of the objects (the queue contains smart pointers to these objects, not the objects themselves).
+ \param NCLASSES Number of priority classes.
  */
-template <typename T>
+template <typename T, unsigned int NCLASSES = 1>
 class shared_queue_yarp
 {
 public:
     typedef typename std::unique_ptr<T> item_type; ///< Smart pointer type to the objects.
 
 private :
-    std::deque<item_type> mData;
+    std::deque<item_type> mData[NCLASSES];     // one queue per priority class
     mutable yarp::os::Mutex mMut;
     
     /** The semaphore to signal event, shared. */
     mutable yarp::os::Semaphore mCount;
+    
+    /** Pop the oldest element of the highest non-empty class; the semaphore must have been taken so that the queue is non-empty. */
+    item_type pop_highest() {
+        yarp::os::LockGuard lock(mMut);
+        for (auto& d: mData) {
+            if (!d.empty()) {
+                item_type v(std::move(d.front()));
+                d.pop_front();
+                return v;
+            }
+        }
+        return item_type();
+    }
 public:
     shared_queue_yarp(): mCount(0) { }
     
     /** Push an object into the queue, at the back.
      */
-    void push(item_type&& pValue)
+    void push(item_type&& pValue, unsigned int cls = 0)
     {
         // block execution here, if other thread already locked mMute!
         yarp::os::LockGuard mlock(mMut);
         // if we are here no other thread is owned/locked mMute. so we can modify the internal data
-        mData.push_back(pValue);
+        mData[cls].push_back(std::move(pValue));
         mCount.post();
     }
     
@@ -64,23 +79,23 @@ public:
         mCount.post();
     }*/
     
-    void push(T* pValue) // The object of type T must be dynamically allocated
+    void push(T* pValue, unsigned int cls = 0) // The object of type T must be dynamically allocated
     {
         // block execution here, if other thread already locked mMute!
         yarp::os::LockGuard mlock(mMut);
         // if we are here no other thread is owned/locked mMute. so we can modify the internal data
-        mData.emplace_back(pValue);
+        mData[cls].emplace_back(pValue);
         mCount.post();
     }
     
-    /** Insert an object at the top/front of the queue.
+    /** Insert an object at the top/front of its priority class.
      */
-    void push_front(item_type&& pValue)
+    void push_front(item_type&& pValue, unsigned int cls = 0)
     {
         // block execution here, if other thread already locked mMute!
         yarp::os::LockGuard mlock(mMut);
         // if we are here no other thread is owned/locked mMute. so we can modify the internal data
-        mData.push_front(pValue);
+        mData[cls].push_front(std::move(pValue));
         mCount.post();
     }
     
@@ -94,12 +109,12 @@ public:
         mCount.post();
     }*/
     
-    void push_front(T* pValue) // The object of type T must be dynamically allocated
+    void push_front(T* pValue, unsigned int cls = 0) // The object of type T must be dynamically allocated
     {
         // block execution here, if other thread already locked mMute!
         yarp::os::LockGuard mlock(mMut);
         // if we are here no other thread is owned/locked mMute. so we can modify the internal data
-        mData.emplace_front(pValue);
+        mData[cls].emplace_front(pValue);
         mCount.post();
     }
     
@@ -141,26 +156,37 @@ public:
     bool empty() const ///< Check if the queue is empty.
     {
         yarp::os::LockGuard lock(mMut);
-        return mData.empty();
+        for (const auto& d: mData) {
+            if (!d.empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    std::size_t size() const ///< Number of items in the queue.
+    {
+        yarp::os::LockGuard lock(mMut);
+        std::size_t n = 0;
+        for (const auto& d: mData) {
+            n += d.size();
+        }
+        return n;
     }
     
-    /** Block until the queue is non-empty, then pop and return the first element. */
+    /** Block until the queue is non-empty, then pop and return the first element of the highest non-empty class. */
     item_type wait_and_pop() {
         mCount.wait();
-        item_type v(std::move(mData.front()));
-        mData.pop_front();
-        return v;
+        return pop_highest();
     }
     
     /** Block until the queue is non-empty or timeout.
      \param timeout Timeout in seconds.
-     \return Nil pointer if timeout, otherwise pop and return the first element.
+     \return Nil pointer if timeout, otherwise pop and return the first element of the highest non-empty class.
      */
     item_type wait_and_pop_timeout(double timeout) {
         if (mCount.waitWithTimeout(timeout)) {
-            item_type v(std::move(mData.front()));
-            mData.pop_front();
-            return v;
+            return pop_highest();
         } else {
             return item_type();
         }
@@ -27,6 +27,12 @@ bool PortBase::open() {
     }
 }
 
+void PortBase::metrics_register(bool sent) {
+    std::string labels("port=\"" + fullPortName() + "\",direction=\"" + (sent?"out":"in") + "\"");
+    m_metrics_bytes = &OBNsim::Metrics::counter("obn_port_bytes_total", labels, "Bytes sent or received by a port.");
+    m_metrics_msgs = &OBNsim::Metrics::counter("obn_port_messages_total", labels, "Messages sent or received by a port.");
+}
+
 
 // Set the message received event callback for an input port.
 void InputPortBase::setMsgRcvCallback(const InputPortBase::MSGRCV_CALLBACK& f, bool onMainThread) {
@@ -55,7 +61,7 @@ void InputPortBase::triggerMsgRcvCallback() {
     if (m_msgrcv_callback) {
         if (m_msgrcv_callback_on_mainthread) {
             if (isValid()) {
-                m_node->postCallbackEvent(m_msgrcv_callback);
+                m_node->postPortCallbackEvent(m_msgrcv_callback);
             }
         } else {
             // Call it now
@@ -137,6 +143,12 @@ bool NodeBase::addOutput(OutputPortBase* port, bool owned) {
     if (result) {
         // Add this port to the list of inputs
         _output_ports.emplace_front(port, owned);
+        
+        // Its value may have been set before it was attached
+        port->m_queued = false;
+        if (port->isChanged()) {
+            port->markChanged();
+        }
     }
     else {
         // Detach it, making invalid again
@@ -208,6 +220,39 @@ void NodeBase::removePort(OutputPortBase* port) {
     assert(port);
     
     _output_ports.remove_if([port](decltype(_output_ports)::const_reference pair){ return pair.first == port; });;
+    if (port->m_queued) {
+        _changed_outputs.erase(std::remove(_changed_outputs.begin(), _changed_outputs.end(), port), _changed_outputs.end());
+        port->m_queued = false;
+    }
+}
+
+void NodeBase::sendChangedOutputs(bool decimate) {
+    // Only the ports queued so far are walked; ports changed while sending (e.g. by a callback) are kept for the next time.
+    // The ports which are not sent stay in the list, in their order.
+    const std::size_t n = _changed_outputs.size();
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        OutputPortBase* port = _changed_outputs[i];
+        if (!port->isChanged()) {
+            // Already sent by other means
+            port->m_queued = false;
+            continue;
+        }
+        if (!hasError() && (!decimate || port->isPublishedAt(_current_sim_time))) {
+            //TODO: Should change this to asynchronous send.
+            int64_t trace_start = OBNsim::Trace::enabled()?OBNsim::Trace::now():-1;
+            port->sendSync();
+            if (trace_start >= 0) {
+                OBNsim::Trace::complete("send " + port->getPortName(), "port", trace_start, OBNsim::Trace::now() - trace_start);
+            }
+            if (!port->isChanged()) {
+                port->m_queued = false;
+                continue;
+            }
+        }
+        _changed_outputs[kept++] = port;
+    }
+    _changed_outputs.erase(_changed_outputs.begin() + kept, _changed_outputs.begin() + n);
 }
 
 
@@ -230,6 +275,9 @@ bool NodeBase::initializeForSimulation() {
  \param type The type of the ACK message.
  */
 void NodeBase::sendACK(OBNSimMsg::N2SMN::MSGTYPE type) {
+    if (OBNsim::Trace::enabled()) {
+        OBNsim::Trace::instant("ACK", "node", "\"type\":" + std::to_string(type) + ",\"t\":" + std::to_string(_current_sim_time));
+    }
     _n2smn_message.Clear();
     _n2smn_message.set_msgtype(type);
     _n2smn_message.set_id(_node_id);
@@ -242,6 +290,9 @@ void NodeBase::sendACK(OBNSimMsg::N2SMN::MSGTYPE type) {
  \param I Integer value for MSGDATA.I
  */
 void NodeBase::sendACK(OBNSimMsg::N2SMN::MSGTYPE type, int64_t I) {
+    if (OBNsim::Trace::enabled()) {
+        OBNsim::Trace::instant("ACK", "node", "\"type\":" + std::to_string(type) + ",\"t\":" + std::to_string(_current_sim_time));
+    }
     _n2smn_message.Clear();
     _n2smn_message.set_msgtype(type);
     _n2smn_message.set_id(_node_id);
@@ -285,6 +336,14 @@ void NodeBase::run(double timeout) {
     
     _node_state = NODE_STARTED;     // Node has started, but not yet initialized
     
+    // Trace the execution if requested by the environment (OBN_TRACE_DIR)
+    bool trace_started = !OBNsim::Trace::enabled() && OBNsim::Trace::startFromEnvironment(full_name());
+    OBNsim::Trace::setThreadName("main");
+    
+    // Serve live metrics if requested by the environment (OBN_METRICS_DIR)
+    bool metrics_started = !OBNsim::Metrics::enabled() && OBNsim::Metrics::startServerFromEnvironment(full_name());
+    metrics_register();
+    
     // Looping to process events until the simulation stops or a timeout occurs
     std::shared_ptr<NodeEvent> pEvent;
     if (timeout <= 0.0) {
@@ -292,8 +351,7 @@ void NodeBase::run(double timeout) {
         while (_node_state == NODE_RUNNING || _node_state == NODE_STARTED) {
             pEvent = eventqueue_wait_and_pop();
             assert(pEvent);
-            pEvent->executeMain(this);  // Execute the event
-            pEvent->executePost(this);  // Post-Execute the event
+            executeEvent(pEvent.get());  // Execute the event
         }
     } else {
         // With timeout
@@ -301,21 +359,56 @@ void NodeBase::run(double timeout) {
             pEvent = eventqueue_wait_and_pop(timeout);
             if (pEvent) {
                 // Execute the event if not timeout
-                pEvent->executeMain(this);
-                pEvent->executePost(this);
+                executeEvent(pEvent.get());
             } else {
                 // If timeout then we stop
                 onReportInfo("[NODE] Node's execution has a timeout.");
                 onRunTimeout();
+                if (trace_started) {
+                    OBNsim::Trace::stop();
+                }
+                metrics_unregister();
+                if (metrics_started) {
+                    OBNsim::Metrics::stopServer();
+                }
                 return;
             }
         }
     }
     
+    if (trace_started) {
+        OBNsim::Trace::stop();
+    }
+    metrics_unregister();
+    if (metrics_started) {
+        OBNsim::Metrics::stopServer();
+    }
+    
     // This is the end of the simulation
     onReportInfo("[NODE] Node's execution has stopped.");
 }
 
+void NodeBase::metrics_register() {
+    if (!OBNsim::Metrics::enabled()) {
+        return;
+    }
+    
+    std::string labels("node=\"" + full_name() + "\"");
+    m_metrics_events = &OBNsim::Metrics::counter("obn_node_events_total", labels, "Events executed by a node.");
+    if (!m_metrics_gauge) {
+        OBNsim::Metrics::gauge("obn_node_event_queue_depth", labels, [this]() { return double(eventqueue_size()); },
+                               "Number of events waiting in the event queue of a node.");
+        m_metrics_gauge = true;
+    }
+}
+
+void NodeBase::metrics_unregister() {
+    if (m_metrics_gauge) {
+        OBNsim::Metrics::removeGauge("obn_node_event_queue_depth", "node=\"" + full_name() + "\"");
+        m_metrics_gauge = false;
+    }
+}
+
 int NodeBase::runUntil(std::function<bool ()> pred, double timeout) {
     assert(pred);
     
@@ -337,8 +430,7 @@ int NodeBase::runUntil(std::function<bool ()> pred, double timeout) {
         while (!predResult && (_node_state == NODE_RUNNING || _node_state == NODE_STARTED)) {
             pEvent = eventqueue_wait_and_pop();
             assert(pEvent);
-            pEvent->executeMain(this);  // Execute the event
-            pEvent->executePost(this);  // Post-Execute the event
+            executeEvent(pEvent.get());  // Execute the event
             
             predResult = pred();    // Update the predicate, given new event
         }
@@ -350,8 +442,7 @@ int NodeBase::runUntil(std::function<bool ()> pred, double timeout) {
             pEvent = eventqueue_wait_and_pop(timeout);
             if (pEvent) {
                 // Execute the event if not timeout
-                pEvent->executeMain(this);
-                pEvent->executePost(this);
+                executeEvent(pEvent.get());
                 
                 predResult = pred();    // Update the predicate, given new event
             } else {
@@ -467,11 +558,11 @@ void NodeBase::postEvent(const OBNSimMsg::SMN2N& msg) {
     // The cases should be ordered in the frequency of the message types
     switch (msg.msgtype()) {
         case SMN2N_MSGTYPE_SIM_Y:
-            eventqueue_push(new NodeEvent_UPDATEY(msg));
+            eventqueue_push(new NodeEvent_UPDATEY(msg), EVENT_CLASS_CONTROL);
             break;
             
         case SMN2N_MSGTYPE_SIM_X:
-            eventqueue_push(new NodeEvent_UPDATEX(msg));
+            eventqueue_push(new NodeEvent_UPDATEX(msg), EVENT_CLASS_CONTROL);
             break;
             
         case SMN2N_MSGTYPE_SIM_EVENT_ACK:
@@ -480,16 +571,28 @@ void NodeBase::postEvent(const OBNSimMsg::SMN2N& msg) {
             
         case SMN2N_MSGTYPE_SIM_TERM:
             // Stop the simulation (often at the end of the simulation time, or requested by the user, but not because of a system error
-            eventqueue_push_front(new NodeEvent_TERMINATE(msg));
+            eventqueue_push_front(new NodeEvent_TERMINATE(msg), EVENT_CLASS_CONTROL);
             break;
             
         case SMN2N_MSGTYPE_SIM_INIT:
-            eventqueue_push(new NodeEvent_INITIALIZE(msg));
+            eventqueue_push(new NodeEvent_INITIALIZE(msg), EVENT_CLASS_CONTROL);
+            break;
+            
+        case SMN2N_MSGTYPE_SIM_STATE:
+            eventqueue_push(new NodeEvent_STATE(msg), EVENT_CLASS_CONTROL);
             break;
             
         case SMN2N_MSGTYPE_SYS_PORT_CONNECT:
             // Request from the SMN to connect ports
-            eventqueue_push(new NodeEvent_PORT_CONNECT(msg));
+            eventqueue_push(new NodeEvent_PORT_CONNECT(msg), EVENT_CLASS_CONTROL);
+            break;
+            
+        case SMN2N_MSGTYPE_SYS_PORT_DECIMATE:
+            eventqueue_push(new NodeEvent_PORT_DECIMATE(msg), EVENT_CLASS_CONTROL);
+            break;
+            
+        case SMN2N_MSGTYPE_SYS_PORT_PRECISION:
+            eventqueue_push(new NodeEvent_PORT_PRECISION(msg), EVENT_CLASS_CONTROL);
             break;
             
         case SMN2N_MSGTYPE_SYS_REQUEST_STOP_ACK:
@@ -513,6 +616,8 @@ void NodeBase::NodeEvent_UPDATEX::executeMain(NodeBase* pnode) {
     
     basic_processing(pnode);
     
+    pnode->_microstep = _microstep;
+    
     // Call the callback to perform UPDATE_X
     pnode->onUpdateX(_updates);
 }
@@ -536,26 +641,28 @@ void NodeBase::NodeEvent_UPDATEY::executeMain(NodeBase* pnode) {
     // Save the current update type mask, just in case UPDATE_X needs it
     // pnode->_current_updates = _updates;
     
+    pnode->_window_iteration = _iteration;
+    pnode->_window_converged = true;
+    pnode->_microstep = _microstep;
+    
     // Call the callback to perform UPDATE_Y
     pnode->onUpdateY(_updates);
 }
 
 /** Handle UPDATE_Y events: Post. */
 void NodeBase::NodeEvent_UPDATEY::executePost(NodeBase* pnode) {
-    // Send out values from output ports which have been updated
-    for (auto port: pnode->_output_ports) {
-        if (port.first->isChanged()) {
-            //TODO: Should change this to asynchronous send.
-            port.first->sendSync();
-            if (pnode->hasError()) {
-                break;
-            }
-        }
-    }
+    // Send out values from output ports which have been updated; a decimated port is only published at the multiples of its period (always in a micro-step)
+    // Only the changed ports are walked, not all outputs of the node
+    pnode->sendChangedOutputs(pnode->_microstep == 0);
     
     // Send ACK to the SMN, regardless of whether it had an error or not
     // If an error happened and the node should stop, it should also send an error message to the SMN to notify it
-    pnode->sendACK(OBNSimMsg::N2SMN_MSGTYPE_SIM_Y_ACK);
+    // A non-zero value asks the GC to repeat the time window (waveform relaxation)
+    if (pnode->_window_converged) {
+        pnode->sendACK(OBNSimMsg::N2SMN_MSGTYPE_SIM_Y_ACK);
+    } else {
+        pnode->sendACK(OBNSimMsg::N2SMN_MSGTYPE_SIM_Y_ACK, 1);
+    }
 }
 
 /** Handle Initialization before simulation: Main. */
@@ -597,6 +704,15 @@ void NodeBase::NodeEvent_INITIALIZE::executeMain(NodeBase* pnode) {
     if (_run_result < 0) {
         _run_result = pnode->onInitialization();
     }
+    
+    // Set the initial state given by the SMN, if any
+    if (_run_result == 0 && _has_state) {
+        std::vector<double> state;
+        if (!OBNsim::Utils::decodeState(_state, state) || !pnode->onSetState(state)) {
+            pnode->onOBNWarning("The node can't set its initial state given by the SMN.");
+            _run_result = 2;
+        }
+    }
 }
 
 /** Handle Initialization before simulation: Post. */
@@ -617,15 +733,7 @@ void NodeBase::NodeEvent_INITIALIZE::executePost(NodeBase* pnode) {
     // Then send an ACK message to the SMN.
     if (pnode->_node_state == NodeBase::NODE_RUNNING) {
         // Send out values from output ports if they have been set / updated
-        for (auto port: pnode->_output_ports) {
-            //TODO: Should change this to asynchronous send.
-            if (port.first->isChanged()) {
-                port.first->sendSync();
-                if (pnode->hasError()) {
-                    break;
-                }
-            }
-        }
+        pnode->sendChangedOutputs(false);
         
         pnode->sendACK(OBNSimMsg::N2SMN::MSGTYPE::N2SMN_MSGTYPE_SIM_INIT_ACK);
     } else {
@@ -634,6 +742,26 @@ void NodeBase::NodeEvent_INITIALIZE::executePost(NodeBase* pnode) {
     }
 }
 
+/** Handle request of the state of the node. */
+void NodeBase::NodeEvent_STATE::executeMain(NodeBase* pnode) {
+    std::vector<double> state;
+    bool ok = (pnode->_node_state == NodeBase::NODE_RUNNING) && pnode->onGetState(state);
+    
+    pnode->_n2smn_message.Clear();
+    pnode->_n2smn_message.set_msgtype(OBNSimMsg::N2SMN_MSGTYPE_SIM_STATE_ACK);
+    pnode->_n2smn_message.set_id(pnode->_node_id);
+    
+    OBNSimMsg::MSGDATA* pData = new OBNSimMsg::MSGDATA();
+    if (ok) {
+        pData->set_b(OBNsim::Utils::encodeState(state));
+    } else {
+        pData->set_i(1);
+    }
+    pnode->_n2smn_message.set_allocated_data(pData);
+    
+    pnode->sendN2SMNMsg();
+}
+
 /** Handle Termination: Main. */
 void NodeBase::NodeEvent_TERMINATE::executeMain(NodeBase* pnode) {
     // Skip if the node is not RUNNING
@@ -694,20 +822,34 @@ void NodeBase::NodeEvent_PORT_CONNECT::executeMain(NodeBase* pnode) {
     std::pair<int, std::string> result{_valid_msg?-1:-3, ""};
     
     if (_valid_msg) {
-        // Find the port on this node
-        PortBase* myport = nullptr;
-        for (const auto& p: pnode->_input_ports) {
-            if (p.first->getPortName() == _myport) {
-                myport = p.first;
-                break;
+        // Find a port on this node; a request to an output port assigns its topic (only supported by some communication protocols, e.g. MQTT)
+        auto find_port = [pnode](const std::string& name) -> PortBase* {
+            for (const auto& p: pnode->_input_ports) {
+                if (p.first->getPortName() == name) {
+                    return p.first;
+                }
             }
-        }
-        
-        // Do not find the port in the list of physical output ports
+            for (const auto& p: pnode->_output_ports) {
+                if (p.first->getPortName() == name) {
+                    return p.first;
+                }
+            }
+            return nullptr;
+        };
         
+        PortBase* myport = find_port(_myport);
         if (myport) {
             // Found --> ask the port to connect
             result = myport->connect_from_port(_otherport);
+        } else {
+            // A request to element k of a port array, named "port[k]" (at most 9 digits)
+            auto bracket = _myport.find('[');
+            if (bracket != std::string::npos && bracket > 0 && _myport.back() == ']' && bracket + 2 < _myport.size() && _myport.size() - bracket - 2 <= 9 &&
+                std::all_of(_myport.begin() + bracket + 1, _myport.end() - 1, [](char c) { return c >= '0' && c <= '9'; }) &&
+                (myport = find_port(_myport.substr(0, bracket))))
+            {
+                result = myport->connect_element_from_port(std::stoul(_myport.substr(bracket + 1, _myport.size() - bracket - 2)), _otherport);
+            }
         }
     }
     
@@ -731,6 +873,69 @@ void NodeBase::NodeEvent_PORT_CONNECT::executeMain(NodeBase* pnode) {
     pnode->sendN2SMNMsg();
 }
 
+/** Handle output decimation request. */
+void NodeBase::NodeEvent_PORT_DECIMATE::executeMain(NodeBase* pnode) {
+    int result = _valid_msg?-1:-3;
+    
+    if (_valid_msg) {
+        // Find the output port on this node
+        for (const auto& p: pnode->_output_ports) {
+            if (p.first->getPortName() == _myport) {
+                p.first->setPublishPeriod(_period);
+                result = 0;
+                break;
+            }
+        }
+    }
+    
+    // Prepare the ACK message
+    pnode->_n2smn_message.Clear();
+    pnode->_n2smn_message.set_msgtype(OBNSimMsg::N2SMN_MSGTYPE_SYS_PORT_DECIMATE_ACK);
+    if (_hasID) {
+        pnode->_n2smn_message.set_id(_id);
+    }
+    
+    // Only need Data field if not successful
+    if (result != 0) {
+        OBNSimMsg::MSGDATA* pData = new OBNSimMsg::MSGDATA();
+        pData->set_i(result);
+        pnode->_n2smn_message.set_allocated_data(pData);
+    }
+    
+    pnode->sendN2SMNMsg();
+}
+
+/** Handle output precision request. */
+void NodeBase::NodeEvent_PORT_PRECISION::executeMain(NodeBase* pnode) {
+    int result = _valid_msg?-1:-3;
+    
+    if (_valid_msg) {
+        // Find the output port on this node; -2 if it does not support the precision
+        for (const auto& p: pnode->_output_ports) {
+            if (p.first->getPortName() == _myport) {
+                result = p.first->setPrecision(_precision)?0:-2;
+                break;
+            }
+        }
+    }
+    
+    // Prepare the ACK message
+    pnode->_n2smn_message.Clear();
+    pnode->_n2smn_message.set_msgtype(OBNSimMsg::N2SMN_MSGTYPE_SYS_PORT_PRECISION_ACK);
+    if (_hasID) {
+        pnode->_n2smn_message.set_id(_id);
+    }
+    
+    // Only need Data field if not successful
+    if (result != 0) {
+        OBNSimMsg::MSGDATA* pData = new OBNSimMsg::MSGDATA();
+        pData->set_i(result);
+        pnode->_n2smn_message.set_allocated_data(pData);
+    }
+    
+    pnode->sendN2SMNMsg();
+}
+
 void NodeBase::NodeEventCallback::executeMain(OBNnode::NodeBase *pnode) {
     m_callback_func();
 }
@@ -8,11 +8,139 @@
  * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
  */
 
+#include <string>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
 #include <obnsim_basic.h>
 #include <obnnode_ext.h>
+#include <obnnode_ext_internal.h>
+#include <obnnode_shareddata.h>
+
+namespace {
+    /** A shared data block held by the host. */
+    struct SharedDataHandle {
+        std::shared_ptr<const OBNnode::SharedData> data;
+    };
+    
+    /** The key of a block, combined with the content of the file if given. */
+    std::string sharedDataKey(const char* key, const char* file) {
+        return file?OBNnode::SharedData::fileKey(file, key):std::string(key);
+    }
+    
+    // The build locks held by this process, by key, between sharedDataOpen (block not found) and sharedDataCreate or sharedDataCancel
+    std::mutex g_build_locks_mutex;
+    std::map<std::string, std::unique_ptr<OBNnode::SharedData::BuildLock> > g_build_locks;
+    
+    bool sharedDataBuilding(const std::string& k) {
+        std::lock_guard<std::mutex> lock(g_build_locks_mutex);
+        return g_build_locks.count(k) > 0;
+    }
+    
+    void sharedDataEndBuild(const std::string& k) {
+        std::lock_guard<std::mutex> lock(g_build_locks_mutex);
+        g_build_locks.erase(k);     // Releases the lock
+    }
+    
+    void sharedDataReturn(const std::shared_ptr<const OBNnode::SharedData>& p, size_t* id, const char** pData, size_t* size) {
+        *id = OBNNodeExtInt::Session<SharedDataHandle>::create(new SharedDataHandle{p});
+        *pData = p->data();
+        if (size) {
+            *size = p->size();
+        }
+    }
+}
+
+template class OBNNodeExtInt::Session<SharedDataHandle>;
 
 // Returns the maximum ID allowed for an update type.
 EXPORT
 int maxUpdateID() {
     return OBNsim::MAX_UPDATE_INDEX;
-}
\ No newline at end of file
+}
+
+
+// Map the block of a key if it is in the host-wide cache.
+EXPORT
+int sharedDataOpen(const char* key, const char* file, size_t* id, const char** pData, size_t* size) {
+    if (key == nullptr || id == nullptr || pData == nullptr) {
+        return -1000;
+    }
+    try {
+        auto k = sharedDataKey(key, file);
+        if (sharedDataBuilding(k)) {
+            // This process is already building the block: don't wait for our own lock
+            auto p = OBNnode::SharedData::find(k);
+            if (!p) {
+                return 1;
+            }
+            sharedDataReturn(p, id, pData, size);
+            return 0;
+        }
+        
+        // Same as SharedData::get(): if the block is not found, the lock is held until the host creates the block
+        std::unique_ptr<OBNnode::SharedData::BuildLock> buildlock(new OBNnode::SharedData::BuildLock);
+        auto p = OBNnode::SharedData::acquire(k, *buildlock);
+        if (!p) {
+            std::lock_guard<std::mutex> lock(g_build_locks_mutex);
+            g_build_locks[k] = std::move(buildlock);
+            return 1;
+        }
+        sharedDataReturn(p, id, pData, size);
+    }
+    catch (std::exception& e) {
+        reportError(e.what());
+        return -1;
+    }
+    return 0;
+}
+
+// Store a block in the host-wide cache and map it.
+EXPORT
+int sharedDataCreate(const char* key, const char* file, const char* data, size_t size, size_t* id, const char** pData) {
+    if (key == nullptr || (data == nullptr && size > 0) || id == nullptr || pData == nullptr) {
+        return -1000;
+    }
+    try {
+        auto k = sharedDataKey(key, file);
+        std::shared_ptr<const OBNnode::SharedData> p;
+        try {
+            p = OBNnode::SharedData::put(k, data, size);
+        }
+        catch (...) {
+            sharedDataEndBuild(k);
+            throw;
+        }
+        sharedDataEndBuild(k);
+        sharedDataReturn(p, id, pData, nullptr);
+    }
+    catch (std::exception& e) {
+        reportError(e.what());
+        return -1;
+    }
+    return 0;
+}
+
+// Give up building a block after sharedDataOpen did not find it.
+EXPORT
+int sharedDataCancel(const char* key, const char* file) {
+    if (key == nullptr) {
+        return -1000;
+    }
+    try {
+        sharedDataEndBuild(sharedDataKey(key, file));
+    }
+    catch (std::exception& e) {
+        reportError(e.what());
+        return -1;
+    }
+    return 0;
+}
+
+// Release a shared data block.
+EXPORT
+int sharedDataRelease(size_t id) {
+    return (OBNNodeExtInt::Session<SharedDataHandle>::destroy(id))?0:-1;
+}
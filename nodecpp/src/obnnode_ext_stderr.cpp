@@ -12,8 +12,9 @@
 #include <obnnode_ext.h>
 
 #define MAXMSGLEN 255
-static char error_message[MAXMSGLEN+1] = "";
-static char warning_message[MAXMSGLEN+1] = "";
+// The messages are per thread, so that the nodes driven by different threads don't overwrite each other's messages
+static thread_local char error_message[MAXMSGLEN+1] = "";
+static thread_local char warning_message[MAXMSGLEN+1] = "";
 
 
 // Report an error and may terminate.
@@ -17,6 +17,14 @@
 #include <functional>
 #include <utility>      // std::pair
 
+#ifndef _WIN32
+#include <unistd.h>     // read, write, close, pipe
+#include <fcntl.h>
+#include <cerrno>
+#endif
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 #include <obnnode.h>    // node.C++ framework
 #include <obnnode_extmqtt.h>
@@ -99,6 +107,14 @@ int MQTTNodeExt::createInputPort(const std::string &name,
             }
             break;
             
+        case OBNEI_Container_SparseMatrix:
+            if (strict) {
+                port = YNM_PORT_CLASS_BY_NAME_STRICT(InputPortBase,MQTTInput,obn_sparse_matrix,element,true,name);
+            } else {
+                port = YNM_PORT_CLASS_BY_NAME_STRICT(InputPortBase,MQTTInput,obn_sparse_matrix,element,false,name);
+            }
+            break;
+            
         case OBNEI_Container_Binary:
             if (strict) {
                 port = new MQTTInput<OBN_BIN,bool,true>(name);
@@ -157,6 +173,10 @@ int MQTTNodeExt::createOutputPort(const std::string &name,
             port = YNM_PORT_CLASS_BY_NAME(MQTTOutputPortBase,MQTTOutput,obn_matrix_raw,element,name);
             break;
             
+        case OBNEI_Container_SparseMatrix:
+            port = YNM_PORT_CLASS_BY_NAME(MQTTOutputPortBase,MQTTOutput,obn_sparse_matrix,element,name);
+            break;
+            
         case OBNEI_Container_Binary:
             port = new MQTTOutput<OBN_BIN,bool>(name);
             break;
@@ -188,10 +208,90 @@ MQTTNodeExt::~MQTTNodeExt() {
     // If the node is still running, we need to stop it first
     stopSimulation();
     
+    // The gauge of the event queue must not outlive the queue
+    metrics_unregister();
+    
+    // Stop using the trace (the last node of the process stops it)
+    traceRelease();
+    
     // We need to delete all port objects belonging to this node (in _all_ports vector) because if we don't, they will be deleted in ~NodeBase() when the MQTTClient object (which belongs to the child class MQTTNodeBase) is already deleted --> access to the MQTT client will cause an error.
     for (auto p:_all_ports) {
         delete p.port;
     }
+    
+#ifndef _WIN32
+    // Close the event descriptor
+    if (m_event_fd[0] >= 0) {
+        close(m_event_fd[0]);
+    }
+    if (m_event_fd[1] >= 0 && m_event_fd[1] != m_event_fd[0]) {
+        close(m_event_fd[1]);
+    }
+#endif
+}
+
+
+/** The descriptor is an eventfd on Linux and a non-blocking pipe on other POSIX systems.
+ It is readable while the node's event queue or port event queue is non-empty, so a host can multiplex many nodes and its own I/O in one thread.
+ */
+int MQTTNodeExt::eventFD() {
+#ifdef _WIN32
+    return -1;
+#else
+    if (m_event_fd_enabled) {
+        return m_event_fd[0];
+    }
+    
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    m_event_fd[0] = m_event_fd[1] = fd;
+#else
+    if (pipe(m_event_fd) != 0) {
+        return -1;
+    }
+    for (int fd: m_event_fd) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    
+    // From now on, pushing events signals the descriptor; signal the events that are already pending
+    m_event_fd_enabled.store(true, std::memory_order_release);
+    rearmEventFD();
+    return m_event_fd[0];
+#endif
+}
+
+void MQTTNodeExt::writeEventFD() {
+#ifndef _WIN32
+    // If the descriptor is already readable, the write may fail (full pipe) but that doesn't matter
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t r = write(m_event_fd[1], &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t r = write(m_event_fd[1], &one, 1);
+#endif
+    (void)r;
+#endif
+}
+
+void MQTTNodeExt::rearmEventFD() {
+#ifndef _WIN32
+    if (!m_event_fd_enabled.load(std::memory_order_acquire)) {
+        return;
+    }
+    
+    // Drain the descriptor first, then check the queues: an event pushed after the check signals the descriptor again, so no event is missed
+    char buf[64];
+    while (read(m_event_fd[0], buf, sizeof(buf)) > 0) { }
+    if (!_event_queue.empty() || !m_port_events.empty()) {
+        writeEventFD();
+    }
+#endif
 }
 
 
@@ -200,6 +300,15 @@ MQTTNodeExt::~MQTTNodeExt() {
  \return 0 if everything is going well and there is an event pending, 1 if timeout (but the simulation won't stop automatically, it's still running), 2 if the simulation has stopped (properly, not because of an error), 3 if the simulation has stopped due to an error (the node's state becomes NODE_ERROR)
  */
 int MQTTNodeExt::runStep(double timeout) {
+    // Whatever the way this method returns, the event descriptor must reflect the remaining events
+    struct RearmGuard {
+        MQTTNodeExt* node;
+        ~RearmGuard() { node->rearmEventFD(); }
+    } rearm_guard{this};
+    
+    // The events of this node go to its own track, as several nodes may run in the same thread
+    OBNsim::Trace::TrackScope trace_scope(m_trace_track);
+    
     if (_node_state == NODE_ERROR) {
         // We can't continue in error state
         reportError("Node is in error state; can't continue simulation; please stop the node to clear the error state before continuing.");
@@ -208,6 +317,11 @@ int MQTTNodeExt::runStep(double timeout) {
 
     // If there is a pending event, which means the current event has just been processed in Matlab, we must resume the execution of the event object to finish it, then we can continue
     if (_ml_pending_event) {
+        if (m_trace_external_start >= 0) {
+            // Time spent by the external code handling the event
+            OBNsim::Trace::complete("external", "node", m_trace_external_start, OBNsim::Trace::now() - m_trace_external_start,
+                                    "\"event\":" + std::to_string(_ml_current_event.type));
+        }
         if (_current_node_event) {
             // If there is a valid event object, set the event processing result and call the post execution method
             _current_node_event->set_result(_ml_event_result);
@@ -274,6 +388,7 @@ int MQTTNodeExt::runStep(double timeout) {
                 // if _node_is_stopping = true then the node is stopping (we've just pushed the TERM event to external interface, now we need to actually stop it)
                 if (_node_is_stopping) {
                     _node_is_stopping = false;
+                    traceRelease();
                     return 2;
                 }
                 // Otherwise, start the simulation from beginning
@@ -288,6 +403,20 @@ int MQTTNodeExt::runStep(double timeout) {
                 // Initialize the node's state
                 initializeForSimulation();
                 
+                // Trace the execution if requested by the environment (OBN_TRACE_DIR); the first node of the process names the trace,
+                // each node has its own track in it, and the last node to terminate stops the trace
+                if (!m_trace_acquired && OBNsim::Trace::acquireFromEnvironment(full_name())) {
+                    m_trace_acquired = true;
+                    m_trace_track = OBNsim::Trace::newTrack(full_name());
+                    OBNsim::Trace::setThreadTrack(m_trace_track);
+                }
+                
+                // Likewise for the live metrics (OBN_METRICS_DIR); the server is shared by all nodes of the process
+                if (!OBNsim::Metrics::enabled()) {
+                    OBNsim::Metrics::startServerFromEnvironment(full_name());
+                }
+                metrics_register();
+                
                 // Switch to STARTED to wait for INIT message from the SMN
                 _node_state = NODE_STARTED;
                 break;
@@ -307,6 +436,7 @@ int MQTTNodeExt::runStep(double timeout) {
     // Return appropriate value depending on the current state
     if (_node_state == NODE_STOPPED && !_node_is_stopping) {
         // Stopped (properly) but not when the node is stopping (we still need to push a TERM event to external interface)
+        traceRelease();
         return 2;
     } else if (_node_state == NODE_ERROR) {
         // error
@@ -314,6 +444,7 @@ int MQTTNodeExt::runStep(double timeout) {
     }
     
     // this can only be reached if there is a pending event
+    m_trace_external_start = OBNsim::Trace::enabled()?OBNsim::Trace::now():-1;
     return 0;
 }
 
@@ -322,10 +453,9 @@ int MQTTNodeExt::runStep(double timeout) {
  \return A unique_ptr to the event object (of type PortEvent); the pointer is null if there was no pending event when the timeout was up.
  */
 std::unique_ptr<MQTTNodeExt::PortEvent> MQTTNodeExt::getNextPortEvent(double timeout) {
-    if (timeout <= 0.0) {
-        return m_port_events.try_pop();
-    }
-    return m_port_events.wait_and_pop_timeout(timeout);
+    auto evt = (timeout <= 0.0)?m_port_events.try_pop():m_port_events.wait_and_pop_timeout(timeout);
+    rearmEventFD();
+    return evt;
 }
 
 /* ============ The external interface ===============*/
@@ -333,6 +463,12 @@ std::unique_ptr<MQTTNodeExt::PortEvent> MQTTNodeExt::getNextPortEvent(double tim
 // Create a new node
 EXPORT
 int createOBNNode(const char* name, const char* workspace, const char* addr, size_t* id) {
+    return createOBNNodeWithOptions(name, workspace, addr, 0, id);
+}
+
+// Create a new node with options
+EXPORT
+int createOBNNodeWithOptions(const char* name, const char* workspace, const char* addr, unsigned int options, size_t* id) {
     if (!name) {
         return -1;      // Empty name
     }
@@ -371,6 +507,9 @@ int createOBNNode(const char* name, const char* workspace, const char* addr, siz
         }
     }
     
+    // Topic aliases must be set before the client starts
+    y->setTopicAliases((options & OBNEI_NodeOption_MQTTTopicAliases) != 0);
+    
     // For MQTT, we start the client immediately
     if (y->startMQTT()) {
         *id = OBNNodeExtInt::Session<MQTTNodeExt>::create(y);
@@ -391,6 +530,25 @@ int deleteOBNNode(size_t id) {
 }
 
 
+// Get the pollable event descriptor of a node
+EXPORT
+int nodeEventFD(size_t nodeid, int* fd) {
+    // Find node
+    MQTTNodeExt* pnode = OBNNodeExtInt::Session<MQTTNodeExt>::get(nodeid);
+    if (!pnode) {
+        reportError(OBNNodeExtInt::StdMsgs::NODE_NOT_EXIST);
+        return -1;
+    }
+    
+    *fd = pnode->eventFD();
+    if (*fd < 0) {
+        reportError("Could not create the event descriptor of the node.");
+        return -2;
+    }
+    return 0;
+}
+
+
 // Request/notify the SMN to stop, then terminate the node's simulation
 EXPORT
 int nodeStopSimulation(size_t nodeid) {
@@ -619,6 +777,73 @@ int simRequestFutureUpdate(size_t nodeid, OBNSimTimeType t, OBNUpdateMask mask,
 }
 
 
+// Returns the iteration number of the current time window (waveform relaxation).
+EXPORT
+int simWindowIteration(size_t nodeid, unsigned int* iteration) {
+    if (!iteration) {
+        return -2;
+    }
+    
+    // Find node
+    MQTTNodeExt* pnode = OBNNodeExtInt::Session<MQTTNodeExt>::get(nodeid);
+    if (!pnode) {
+        reportError(OBNNodeExtInt::StdMsgs::NODE_NOT_EXIST);
+        return -1;
+    }
+    
+    *iteration = pnode->windowIteration();
+    return 0;
+}
+
+
+// Requests a repetition of the current time window (waveform relaxation).
+EXPORT
+int simRequestWindowIteration(size_t nodeid) {
+    // Find node
+    MQTTNodeExt* pnode = OBNNodeExtInt::Session<MQTTNodeExt>::get(nodeid);
+    if (!pnode) {
+        reportError(OBNNodeExtInt::StdMsgs::NODE_NOT_EXIST);
+        return -1;
+    }
+    
+    pnode->requestWindowIteration();
+    return 0;
+}
+
+
+// Requests an update at the current time, in a micro-step.
+EXPORT
+int simRequestMicroStep(size_t nodeid, OBNUpdateMask mask, double timeout) {
+    // Find node
+    MQTTNodeExt* pnode = OBNNodeExtInt::Session<MQTTNodeExt>::get(nodeid);
+    if (!pnode) {
+        reportError(OBNNodeExtInt::StdMsgs::NODE_NOT_EXIST);
+        return -1001;
+    }
+    
+    return pnode->resultFutureUpdate(pnode->requestMicroStep(mask, false), timeout);
+}
+
+
+// Returns the micro-step index of the current update.
+EXPORT
+int simMicroStep(size_t nodeid, unsigned int* microstep) {
+    if (!microstep) {
+        return -2;
+    }
+    
+    // Find node
+    MQTTNodeExt* pnode = OBNNodeExtInt::Session<MQTTNodeExt>::get(nodeid);
+    if (!pnode) {
+        reportError(OBNNodeExtInt::StdMsgs::NODE_NOT_EXIST);
+        return -1;
+    }
+    
+    *microstep = pnode->microStep();
+    return 0;
+}
+
+
 
 // Create a new input port on a node
 // Arguments: node ID, port's name, format type, container type, element type, strict or not
@@ -711,7 +936,10 @@ int outputSendSync(size_t nodeid, size_t portid) {
     // Cast the pointer to an output port object and send
     MQTTOutputPortBase *p = dynamic_cast<MQTTOutputPortBase*>(portinfo.port);
     if (p) {
-        p->sendSync();
+        // A decimated port is only published at the multiples of its period (see OutputPortBase::setPublishPeriod())
+        if (pnode->microStep() > 0 || p->isPublishedAt(pnode->currentSimulationTime())) {
+            p->sendSync();
+        }
     } else {
         reportError(OBNNodeExtInt::StdMsgs::INTERNAL_PORT_NOT_MATCH_DECL_TYPE);
         return -4;
@@ -1325,6 +1553,242 @@ void inputMatrixUInt64Release(void* pMan, uint64_t* pBuf) {
 }
 
 
+// Generic (template) function to read from sparse matrix input port - the *GET function
+template <typename ETYPE>
+int read_input_sparse_matrix_get(size_t nodeid, size_t portid, void** pMan, const ETYPE** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz)
+{
+    // Sanity check
+    if (pMan == nullptr || nrows == nullptr || ncols == nullptr || nnz == nullptr) {
+        return -1000;
+    }
+    
+    // Find node
+    MQTTNodeExt* pnode = OBNNodeExtInt::Session<MQTTNodeExt>::get(nodeid);
+    if (!pnode) {
+        reportError(OBNNodeExtInt::StdMsgs::NODE_NOT_EXIST);
+        return -1;
+    }
+    
+    // Find port
+    if (portid >= pnode->_all_ports.size()) {
+        reportError(OBNNodeExtInt::StdMsgs::INVALID_PORT_ID);
+        return -2;
+    }
+    
+    // Obtain the port's info
+    MQTTNodeExt::PortInfo portinfo = pnode->_all_ports[portid];
+    
+    if (portinfo.type != OBNEI_Port_Input) {
+        reportError(OBNNodeExtInt::StdMsgs::PORT_NOT_INPUT);
+        return -3;
+    }
+    
+    if (portinfo.container != OBNEI_Container_SparseMatrix) {
+        reportError(OBNNodeExtInt::StdMsgs::INTERNAL_PORT_NOT_MATCH_DECL_TYPE);
+        return -4;
+    }
+    
+    // The sparse matrix values are always stored in compressed mode by the port
+    const typename obn_sparse_matrix<ETYPE>::input_data_type* pMatrix = nullptr;
+    
+    // Query its value based on its type
+    if (portinfo.strict) {
+        MQTTInput<OBN_PB,obn_sparse_matrix<ETYPE>,true> *p = dynamic_cast<MQTTInput<OBN_PB,obn_sparse_matrix<ETYPE>,true>*>(portinfo.port);
+        
+        if (p) {
+            if (p->isValuePending()) {
+                // Get unique_ptr to a sparse matrix, and take it from the unique_ptr
+                auto pv = p->pop();
+                typename obn_sparse_matrix<ETYPE>::input_data_type* pContainer = pv.release();
+                
+                if (!pContainer) {
+                    reportError(OBNNodeExtInt::StdMsgs::INTERNAL_INVALID_VALUE_FROM_PORT);
+                    return -5;
+                }
+                
+                // Returns the pointer pMan which wraps pContainer
+                void* pContainerVoid = static_cast<void*>(pContainer);
+                *pMan = static_cast<void*>(new AccessManagementWrapper(portinfo.strict, pContainerVoid));
+                
+                // Lock the pointers so that it will remain in memory
+                OBNNodeExtInt::lockPointer(pContainerVoid);
+                OBNNodeExtInt::lockPointer(*pMan);
+                
+                pMatrix = pContainer;
+            } else {
+                // No value
+                return 1;
+            }
+        } else {
+            reportError(OBNNodeExtInt::StdMsgs::INTERNAL_PORT_NOT_MATCH_DECL_TYPE);
+            return -4;
+        }
+        
+    } else {
+        using ThisPortType = MQTTInput<OBN_PB,obn_sparse_matrix<ETYPE>,false>;
+        ThisPortType* p = dynamic_cast<ThisPortType*>(portinfo.port);
+        
+        if (p) {
+            // Get direct access to values via a LockedAccess object
+            // Create a new dynamic LockedAccess object, which will be wrapped in pMan
+            typename ThisPortType::LockedAccess* locked_access = new typename ThisPortType::LockedAccess(p->lock_and_get());
+            
+            // Returns the pointer pMan which wraps locked_access
+            void* locked_access_void = static_cast<void*>(locked_access);
+            *pMan = static_cast<void*>(new AccessManagementWrapper(portinfo.strict, locked_access_void));
+            
+            // Lock the pointer so that it will remain in memory
+            OBNNodeExtInt::lockPointer(locked_access_void);
+            OBNNodeExtInt::lockPointer(*pMan);
+            
+            pMatrix = &(**locked_access);
+        } else {
+            reportError(OBNNodeExtInt::StdMsgs::INTERNAL_PORT_NOT_MATCH_DECL_TYPE);
+            return -4;
+        }
+    }
+    
+    // Dimensions and number of non-zeros
+    *nrows = pMatrix->rows();
+    *ncols = pMatrix->cols();
+    *nnz = pMatrix->nonZeros();
+    
+    // Returns the arrays if requested
+    if (pVals) {
+        *pVals = pMatrix->valuePtr();
+    }
+    if (pRowIdx) {
+        *pRowIdx = pMatrix->innerIndexPtr();
+    }
+    if (pColPtr) {
+        *pColPtr = pMatrix->outerIndexPtr();
+    }
+    
+    return 0;
+}
+
+// Copy the CSC arrays of a compressed sparse matrix to the given buffers (if not null)
+template <typename ETYPE>
+void copy_sparse_matrix_to_buffers(const typename obn_sparse_matrix<ETYPE>::input_data_type& m, ETYPE* pVals, int32_t* pRowIdx, int32_t* pColPtr) {
+    auto nnz = m.nonZeros();
+    if (pVals && nnz > 0) {
+        std::copy_n(m.valuePtr(), nnz, pVals);
+    }
+    if (pRowIdx && nnz > 0) {
+        std::copy_n(m.innerIndexPtr(), nnz, pRowIdx);
+    }
+    if (pColPtr) {
+        std::copy_n(m.outerIndexPtr(), m.outerSize() + 1, pColPtr);
+    }
+}
+
+// Generic (template) function to copy/release the management object for reading from a sparse matrix input port - the *RELEASE function
+template <typename ETYPE>
+void read_input_sparse_matrix_copy_release(void* pMan, ETYPE* pVals, int32_t* pRowIdx, int32_t* pColPtr) {
+    if (!pMan) {
+        return;
+    }
+    
+    // Cast it back to the wrapper type
+    AccessManagementWrapper* wrapper = static_cast<AccessManagementWrapper*>(pMan);
+    
+    if (wrapper->first) {
+        // Strict port
+        using AccessObjectType = typename obn_sparse_matrix<ETYPE>::input_data_type;
+        AccessObjectType* access_obj = static_cast<AccessObjectType*>(wrapper->second);
+        
+        // Copy the values
+        copy_sparse_matrix_to_buffers<ETYPE>(*access_obj, pVals, pRowIdx, pColPtr);
+        
+        // Unlock and delete the access object
+        OBNNodeExtInt::unlockPointer(wrapper->second);
+        delete access_obj;
+    } else {
+        // Non-strict port
+        using AccessObjectType = typename MQTTInput<OBN_PB,obn_sparse_matrix<ETYPE>,false>::LockedAccess;
+        AccessObjectType* access_obj = static_cast<AccessObjectType*>(wrapper->second);
+        
+        // Copy the values
+        copy_sparse_matrix_to_buffers<ETYPE>(**access_obj, pVals, pRowIdx, pColPtr);
+        
+        // Unlock and delete the access object
+        OBNNodeExtInt::unlockPointer(wrapper->second);
+        delete access_obj;
+    }
+    
+    // Unlock and delete the managegement objects (wrapper)
+    OBNNodeExtInt::unlockPointer(pMan);
+    delete wrapper;
+}
+
+
+// Float64
+EXPORT
+int inputSparseMatrixDoubleGet(size_t nodeid, size_t portid, void** pMan, const double** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz) {
+    return read_input_sparse_matrix_get(nodeid, portid, pMan, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+EXPORT
+void inputSparseMatrixDoubleRelease(void* pMan, double* pVals, int32_t* pRowIdx, int32_t* pColPtr) {
+    read_input_sparse_matrix_copy_release(pMan, pVals, pRowIdx, pColPtr);
+}
+
+// C++ bool (1 byte)
+EXPORT
+int inputSparseMatrixBoolGet(size_t nodeid, size_t portid, void** pMan, const bool** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz) {
+    return read_input_sparse_matrix_get(nodeid, portid, pMan, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+EXPORT
+void inputSparseMatrixBoolRelease(void* pMan, bool* pVals, int32_t* pRowIdx, int32_t* pColPtr) {
+    read_input_sparse_matrix_copy_release(pMan, pVals, pRowIdx, pColPtr);
+}
+
+// Int32
+EXPORT
+int inputSparseMatrixInt32Get(size_t nodeid, size_t portid, void** pMan, const int32_t** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz) {
+    return read_input_sparse_matrix_get(nodeid, portid, pMan, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+EXPORT
+void inputSparseMatrixInt32Release(void* pMan, int32_t* pVals, int32_t* pRowIdx, int32_t* pColPtr) {
+    read_input_sparse_matrix_copy_release(pMan, pVals, pRowIdx, pColPtr);
+}
+
+// Int64
+EXPORT
+int inputSparseMatrixInt64Get(size_t nodeid, size_t portid, void** pMan, const int64_t** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz) {
+    return read_input_sparse_matrix_get(nodeid, portid, pMan, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+EXPORT
+void inputSparseMatrixInt64Release(void* pMan, int64_t* pVals, int32_t* pRowIdx, int32_t* pColPtr) {
+    read_input_sparse_matrix_copy_release(pMan, pVals, pRowIdx, pColPtr);
+}
+
+// UInt32
+EXPORT
+int inputSparseMatrixUInt32Get(size_t nodeid, size_t portid, void** pMan, const uint32_t** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz) {
+    return read_input_sparse_matrix_get(nodeid, portid, pMan, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+EXPORT
+void inputSparseMatrixUInt32Release(void* pMan, uint32_t* pVals, int32_t* pRowIdx, int32_t* pColPtr) {
+    read_input_sparse_matrix_copy_release(pMan, pVals, pRowIdx, pColPtr);
+}
+
+// UInt64
+EXPORT
+int inputSparseMatrixUInt64Get(size_t nodeid, size_t portid, void** pMan, const uint64_t** pVals, const int32_t** pRowIdx, const int32_t** pColPtr, size_t* nrows, size_t* ncols, size_t* nnz) {
+    return read_input_sparse_matrix_get(nodeid, portid, pMan, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+EXPORT
+void inputSparseMatrixUInt64Release(void* pMan, uint64_t* pVals, int32_t* pRowIdx, int32_t* pColPtr) {
+    read_input_sparse_matrix_copy_release(pMan, pVals, pRowIdx, pColPtr);
+}
+
+
 EXPORT
 int inputBinaryGet(size_t nodeid, size_t portid, void** pMan, const char** pVals, size_t* nbytes)
 {
@@ -1725,6 +2189,94 @@ int outputMatrixUInt64Set(size_t nodeid, size_t portid, const uint64_t* pval, si
 }
 
 
+// Generic (template) function to write a sparse matrix value to a sparse matrix output port
+template <typename ETYPE>
+int write_output_sparse_matrix_helper(size_t nodeid, size_t portid, const ETYPE* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz) {
+    // Sanity check
+    if (!pColPtr || (nnz > 0 && (!pVals || !pRowIdx))) {
+        return -1000;
+    }
+    
+    // Find node
+    MQTTNodeExt* pnode = OBNNodeExtInt::Session<MQTTNodeExt>::get(nodeid);
+    if (!pnode) {
+        reportError(OBNNodeExtInt::StdMsgs::NODE_NOT_EXIST);
+        return -1;
+    }
+    
+    // Find port
+    if (portid >= pnode->_all_ports.size()) {
+        reportError(OBNNodeExtInt::StdMsgs::INVALID_PORT_ID);
+        return -2;
+    }
+    
+    // Obtain the port's info
+    MQTTNodeExt::PortInfo portinfo = pnode->_all_ports[portid];
+    
+    if (portinfo.type != OBNEI_Port_Output) {
+        reportError(OBNNodeExtInt::StdMsgs::PORT_NOT_OUTPUT);
+        return -3;
+    }
+    
+    if (portinfo.container != OBNEI_Container_SparseMatrix) {
+        reportError(OBNNodeExtInt::StdMsgs::INTERNAL_PORT_NOT_MATCH_DECL_TYPE);
+        return -4;
+    }
+    
+    // Cast the port to the actual object
+    MQTTOutput< OBN_PB,obn_sparse_matrix<ETYPE> > *p = dynamic_cast<MQTTOutput< OBN_PB,obn_sparse_matrix<ETYPE> >*>(portinfo.port);
+    
+    if (p) {
+        // copy values over, directly to the Eigen::SparseMatrix in the port
+        if (!obn_sparse_matrix<ETYPE>::assignCSC(*(*p), nrows, ncols, nnz, pColPtr, pRowIdx, pVals)) {
+            reportError("Invalid sparse matrix in compressed sparse column format.");
+            return -5;
+        }
+        return 0;
+    } else {
+        reportError(OBNNodeExtInt::StdMsgs::INTERNAL_PORT_NOT_MATCH_DECL_TYPE);
+        return -4;
+    }
+}
+
+
+// Float64
+EXPORT
+int outputSparseMatrixDoubleSet(size_t nodeid, size_t portid, const double* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz) {
+    return write_output_sparse_matrix_helper(nodeid, portid, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+// C++ bool (1 byte)
+EXPORT
+int outputSparseMatrixBoolSet(size_t nodeid, size_t portid, const bool* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz) {
+    return write_output_sparse_matrix_helper(nodeid, portid, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+// Int32
+EXPORT
+int outputSparseMatrixInt32Set(size_t nodeid, size_t portid, const int32_t* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz) {
+    return write_output_sparse_matrix_helper(nodeid, portid, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+// Int64
+EXPORT
+int outputSparseMatrixInt64Set(size_t nodeid, size_t portid, const int64_t* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz) {
+    return write_output_sparse_matrix_helper(nodeid, portid, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+// UInt32
+EXPORT
+int outputSparseMatrixUInt32Set(size_t nodeid, size_t portid, const uint32_t* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz) {
+    return write_output_sparse_matrix_helper(nodeid, portid, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+// UInt64
+EXPORT
+int outputSparseMatrixUInt64Set(size_t nodeid, size_t portid, const uint64_t* pVals, const int32_t* pRowIdx, const int32_t* pColPtr, size_t nrows, size_t ncols, size_t nnz) {
+    return write_output_sparse_matrix_helper(nodeid, portid, pVals, pRowIdx, pColPtr, nrows, ncols, nnz);
+}
+
+
 EXPORT
 int outputBinarySet(size_t nodeid, size_t portid, const char* pval, size_t nbytes) {
     // Sanity check
@@ -65,7 +65,7 @@ void MQTTNodeBase::removePort(InputPortBase* port) {
     // remove all associated subscriptions if this is an MQTT input port
     MQTTInputPortBase* mqttport = dynamic_cast<MQTTInputPortBase*>(port);
     if (mqttport) {
-        mqtt_client.removeSubscription(mqttport);
+        mqttport->remove_subscriptions(mqtt_client);
     }
     
     NodeBase::removePort(port); // actually remove the port
@@ -165,6 +165,23 @@ MQTTNodeBase::WaitForCondition* MQTTNodeBase::requestFutureUpdate(simtime_t t, u
         return nullptr;
     }
     
+    return requestUpdate(t, m, waiting);
+}
+
+/** This method requests an update at the current simulation time, which the GC runs in a micro-step right after the current step, without advancing the time (superdense time).
+ It is typically called in UPDATE_Y or UPDATE_X to run the next iteration of an iterative algorithm; microStep() tells the index of the micro-step during the update.
+ The request is sent and acknowledged as in requestFutureUpdate(); it is rejected (error code 3 in the ACK) if the GC runs in the conservative mode, if micro-steps are disabled or if the maximum number of micro-steps at a time instant has been reached.
+ Several requests of the same node for the same micro-step are merged.
+ \param m The update mask requested for the micro-step.
+ \param waiting Whether the method should wait (blocking/synchronously) for the ACK to receive [default: true].
+ \return A pointer to the wait-for condition, which is used to wait for the ACK.
+ */
+MQTTNodeBase::WaitForCondition* MQTTNodeBase::requestMicroStep(updatemask_t m, bool waiting) {
+    return requestUpdate(_current_sim_time, m, waiting);
+}
+
+/** Send a request for an update at a given time to the SMN and register the wait-for condition of its ACK. */
+MQTTNodeBase::WaitForCondition* MQTTNodeBase::requestUpdate(simtime_t t, updatemask_t m, bool waiting) {
     // Send request to the SMN
     _n2smn_message.set_msgtype(OBNSimMsg::N2SMN_MSGTYPE_SIM_EVENT);
     _n2smn_message.set_id(_node_id);
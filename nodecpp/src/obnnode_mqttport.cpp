@@ -28,7 +28,8 @@ bool MQTTClient::initialize() {
     std::cout << "MQTT with address: " << m_server_address << " and Client ID: " << m_client_id << std::endl;
 #endif
     
-    if ((rc = MQTTAsync_create(&m_client, m_server_address.c_str(), m_client_id.c_str(), MQTTCLIENT_PERSISTENCE_NONE, NULL)) != MQTTASYNC_SUCCESS)
+    // Topic aliases require MQTT v5
+    if ((rc = OBNsim::MQTT5::createClient(&m_client, m_server_address, m_client_id, m_use_topic_aliases)) != MQTTASYNC_SUCCESS)
     {
         return false;
     }
@@ -48,13 +49,7 @@ bool MQTTClient::start() {
     int rc;
     
     // Connect
-    MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
-    conn_opts.keepAliveInterval = 20;
-    conn_opts.cleansession = 1;
-    conn_opts.onSuccess = &MQTTClient::onConnect;
-    conn_opts.onFailure = &MQTTClient::onConnectFailure;
-    conn_opts.context = this;
-    if ((rc = MQTTAsync_connect(m_client, &conn_opts)) != MQTTASYNC_SUCCESS)
+    if ((rc = connect(false)) != MQTTASYNC_SUCCESS)
     {
 #ifdef MQTT_PRINT_DEBUG
         std::cout << "[MQTT] Request to connect failed: " << rc << std::endl;
@@ -77,6 +72,17 @@ bool MQTTClient::start() {
 }
 
 
+int MQTTClient::connect(bool reconnect) {
+    OBNsim::MQTT5::ConnectCallbacks callbacks;
+    if (reconnect) {
+        callbacks = {&MQTTClient::onReconnect, &MQTTClient::onReconnectFailure, &MQTTClient::onReconnect5, &MQTTClient::onReconnectFailure5};
+    } else {
+        callbacks = {&MQTTClient::onConnect, &MQTTClient::onConnectFailure, &MQTTClient::onConnect5, &MQTTClient::onConnectFailure5};
+    }
+    return OBNsim::MQTT5::connect(m_client, m_use_topic_aliases, callbacks, this);
+}
+
+
 void MQTTClient::stop() {
     if (!isRunning()) {
         return;
@@ -114,8 +120,13 @@ bool MQTTClient::sendData(void *data, int size, const std::string& topic, int re
     pubmsg.qos = MQTTClient::QOS;
     pubmsg.retained = retained;
     
-    // Request to send the message
-    return (MQTTAsync_sendMessage(m_client, topic.c_str(), &pubmsg, &opts) == MQTTASYNC_SUCCESS);
+    if (!m_use_topic_aliases) {
+        // Request to send the message
+        return (MQTTAsync_sendMessage(m_client, topic.c_str(), &pubmsg, &opts) == MQTTASYNC_SUCCESS);
+    }
+    
+    // Request to send the message with the alias of its topic
+    return (m_topic_aliases.send(m_client, topic, pubmsg, &opts) == MQTTASYNC_SUCCESS);
 }
 
 
@@ -275,16 +286,7 @@ void MQTTClient::on_connection_lost(void *context, char *cause)
     MQTTClient* client = static_cast<MQTTClient*>(context);
     
     // Retry to connect once
-    MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
-    conn_opts.keepAliveInterval = 20;
-    conn_opts.cleansession = 1;
-    
-    conn_opts.onSuccess = &MQTTClient::onReconnect;
-    conn_opts.onFailure = &MQTTClient::onReconnectFailure;
-    conn_opts.context = context;
-    
-    int rc;
-    if ((rc = MQTTAsync_connect(client->m_client, &conn_opts)) != MQTTASYNC_SUCCESS)
+    if (client->connect(true) != MQTTASYNC_SUCCESS)
     {
         // At this point, the client is not running
         client->onPermanentConnectionLost();
@@ -312,6 +314,9 @@ int MQTTClient::on_message_arrived(void *context, char *topicName, int topicLen,
         if (found != client->m_topics.end()) {
             // Ask the subscribing ports to process the message
             for (auto& port: found->second) {
+                if (OBNsim::Metrics::enabled()) {
+                    port->count_message(message->payloadlen);
+                }
                 port->parse_message(message->payload, message->payloadlen);
             }
         } else {
@@ -348,6 +353,20 @@ void MQTTClient::onConnect(void* context, MQTTAsync_successData* response)
 }
 
 
+void MQTTClient::onConnect5(void* context, MQTTAsync_successData5* response)
+{
+    MQTTClient* client = static_cast<MQTTClient*>(context);
+    client->m_topic_aliases.reset(response?&response->properties:nullptr);
+    
+#ifdef MQTT_PRINT_DEBUG
+    std::cout << "[MQTT] Connected with MQTT v5, topic alias maximum: " << client->m_topic_aliases.max() << std::endl;
+#endif
+    
+    // Try to subscribe to topics
+    client->subscribeAllTopics();
+}
+
+
 void MQTTClient::onConnectFailure(void* context, MQTTAsync_failureData* response)
 {
 #ifdef MQTT_PRINT_DEBUG
@@ -371,6 +390,13 @@ void MQTTClient::onConnectFailure(void* context, MQTTAsync_failureData* response
 }
 
 
+void MQTTClient::onConnectFailure5(void* context, MQTTAsync_failureData5* response)
+{
+    MQTTAsync_failureData data = OBNsim::MQTT5::failureData(response);
+    onConnectFailure(context, &data);
+}
+
+
 void MQTTClient::onSubscribe(void* context, MQTTAsync_successData* response) {
 #ifdef MQTT_PRINT_DEBUG
     std::cout << "[MQTT] Subscribed.\n";
@@ -415,6 +441,15 @@ void MQTTClient::onReconnect(void* context, MQTTAsync_successData* response)
     client->subscribeAllTopics(true);
 }
 
+void MQTTClient::onReconnect5(void* context, MQTTAsync_successData5* response)
+{
+    MQTTClient* client = static_cast<MQTTClient*>(context);
+    client->m_topic_aliases.reset(response?&response->properties:nullptr);
+    
+    // Try to resubscribe to topics, without waiting (see onReconnect)
+    client->subscribeAllTopics(true);
+}
+
 void MQTTClient::onReconnectFailure(void* context, MQTTAsync_failureData* response)
 {
     // std::cout << "Reconnect failed.\n";
@@ -425,6 +460,12 @@ void MQTTClient::onReconnectFailure(void* context, MQTTAsync_failureData* respon
     client->onPermanentConnectionLost();
 }
 
+void MQTTClient::onReconnectFailure5(void* context, MQTTAsync_failureData5* response)
+{
+    MQTTAsync_failureData data = OBNsim::MQTT5::failureData(response);
+    onReconnectFailure(context, &data);
+}
+
 void MQTTClient::onReSubscribeFailure(void* context, MQTTAsync_failureData* response) {
     MQTTClient* client = static_cast<MQTTClient*>(context);
     
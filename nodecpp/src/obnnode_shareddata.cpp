@@ -0,0 +1,516 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Implementation of the host-wide cache of read-only shared data.
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>   // flock
+#endif
+
+#include <obnnode_shareddata.h>
+
+using namespace OBNnode;
+
+namespace {
+    const char BLOCK_MAGIC[8] = {'O','B','N','D','A','T','A','1'};
+    const char TABLE_MAGIC[8] = {'O','B','N','T','B','L','1','\0'};
+
+    /** Header of a cache file, followed by the key (padded to 8 bytes) and the data. */
+    struct BlockHeader {
+        char magic[8];
+        uint64_t key_size;
+        uint64_t data_size;
+        uint64_t data_offset;
+    };
+
+    /** Header of a table, followed by the row indices, the cells and the string pool. */
+    struct TableHeader {
+        char magic[8];
+        uint64_t nrows;
+        uint64_t ncells;
+        uint64_t strings_size;
+    };
+
+    // 64-bit FNV-1a hash
+    const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    uint64_t fnv1a(const char* p, std::size_t n, uint64_t h = FNV_OFFSET) {
+        for (std::size_t i = 0; i < n; ++i) {
+            h ^= static_cast<unsigned char>(p[i]);
+            h *= FNV_PRIME;
+        }
+        return h;
+    }
+
+    std::string to_hex(uint64_t h) {
+        char s[17];
+        std::snprintf(s, sizeof(s), "%016llx", static_cast<unsigned long long>(h));
+        return std::string(s);
+    }
+
+    // Blocks mapped in this process, by key
+    std::mutex g_blocks_mutex;
+    std::map<std::string, std::weak_ptr<const SharedData> > g_blocks;
+
+    std::shared_ptr<const SharedData> find_mapped(const std::string& key) {
+        std::lock_guard<std::mutex> lock(g_blocks_mutex);
+        auto it = g_blocks.find(key);
+        return (it != g_blocks.end())?it->second.lock():nullptr;
+    }
+
+    std::shared_ptr<const SharedData> remember(const std::shared_ptr<const SharedData>& p) {
+        std::lock_guard<std::mutex> lock(g_blocks_mutex);
+        auto& w = g_blocks[p->key()];
+        auto existing = w.lock();
+        if (existing) {
+            return existing;    // Another thread of this process mapped it first
+        }
+        w = p;
+        return p;
+    }
+
+#ifndef _WIN32
+    const std::string BLOCK_EXT(".obndata");
+    const std::string LOCK_EXT(".lock");
+
+    bool ends_with(const std::string& s, const std::string& ext) {
+        return s.size() > ext.size() && s.compare(s.size() - ext.size(), ext.size(), ext) == 0;
+    }
+
+    /** Create the cache directory if it does not exist, and check that it is a private directory of the user, so that no other user can plant or read blocks. */
+    std::string cache_directory() {
+        auto dir = SharedData::cacheDirectory();
+        if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+            throw std::runtime_error("SharedData: could not create the cache directory '" + dir + "': " + std::strerror(errno));
+        }
+        struct stat st;
+        if (lstat(dir.c_str(), &st) != 0) {
+            throw std::runtime_error("SharedData: could not access the cache directory '" + dir + "': " + std::strerror(errno));
+        }
+        if (!S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 07777) != 0700) {
+            throw std::runtime_error("SharedData: the cache directory '" + dir + "' must be a directory owned by the user with mode 0700.");
+        }
+        return dir;
+    }
+
+    /** Name of the cache file of a key, without extension. */
+    std::string block_path(const std::string& dir, const std::string& key) {
+        return dir + "/" + to_hex(fnv1a(key.data(), key.size()));
+    }
+
+    /** Maximum total size of the blocks in bytes, from OBN_DATA_CACHE_SIZE (in MiB); 0 for no limit. */
+    uint64_t cache_size_limit() {
+        const char* env = std::getenv("OBN_DATA_CACHE_SIZE");
+        uint64_t mib = 1024;
+        if (env && *env) {
+            char* end;
+            auto v = std::strtoull(env, &end, 10);
+            if (*end == '\0') {
+                mib = v;
+            }
+        }
+        return mib << 20;
+    }
+
+    /** Remove the oldest blocks so that the blocks and a new block of the given size take at most the size limit; also remove the temporary files left by failed writers. */
+    void trim_cache(const std::string& dir, uint64_t incoming) {
+        DIR* d = opendir(dir.c_str());
+        if (!d) {
+            return;
+        }
+        struct Block {
+            std::string path;
+            uint64_t size;
+            std::time_t mtime;
+        };
+        std::vector<Block> blocks;
+        uint64_t total = incoming;
+        auto stale = std::time(nullptr) - 3600;
+        while (auto e = readdir(d)) {
+            std::string name(e->d_name);
+            if (name == "." || name == ".." || ends_with(name, LOCK_EXT)) {
+                continue;   // Lock files are kept, as they may be held by other processes
+            }
+            std::string path(dir + '/' + name);
+            struct stat st;
+            if (lstat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+                continue;
+            }
+            if (ends_with(name, BLOCK_EXT)) {
+                blocks.push_back(Block{path, uint64_t(st.st_size), st.st_mtime});
+                total += uint64_t(st.st_size);
+            } else if (st.st_mtime < stale) {
+                unlink(path.c_str());
+            }
+        }
+        closedir(d);
+
+        auto limit = cache_size_limit();
+        if (limit == 0 || total <= limit) {
+            return;
+        }
+        std::sort(blocks.begin(), blocks.end(), [](const Block& a, const Block& b) { return a.mtime < b.mtime; });
+        for (const auto& b: blocks) {
+            if (total <= limit) {
+                break;
+            }
+            if (unlink(b.path.c_str()) == 0) {
+                total -= b.size;
+            }
+        }
+    }
+#endif
+}
+
+
+SharedData::~SharedData() {
+#ifndef _WIN32
+    if (m_map) {
+        munmap(m_map, m_map_size);
+    }
+#endif
+}
+
+
+std::string SharedData::cacheDirectory() {
+    const char* env = std::getenv("OBN_DATA_CACHE_DIR");
+    if (env && *env) {
+        return std::string(env);
+    }
+#ifndef _WIN32
+    struct stat st;
+    std::string dir((stat("/dev/shm", &st) == 0 && S_ISDIR(st.st_mode))?"/dev/shm":"/tmp");
+    return dir + "/obn-data-" + std::to_string(getuid());
+#else
+    return std::string();
+#endif
+}
+
+
+std::string SharedData::fileKey(const std::string& file, const std::string& kind) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("SharedData: could not read the file '" + file + "'.");
+    }
+
+    uint64_t h = FNV_OFFSET;
+    uint64_t n = 0;
+    char buf[65536];
+    while (in) {
+        in.read(buf, sizeof(buf));
+        auto got = in.gcount();
+        h = fnv1a(buf, std::size_t(got), h);
+        n += uint64_t(got);
+    }
+    if (in.bad()) {
+        throw std::runtime_error("SharedData: error while reading the file '" + file + "'.");
+    }
+    return kind + '|' + to_hex(h) + ':' + std::to_string(n);
+}
+
+
+std::shared_ptr<const SharedData> SharedData::map(const std::string& key) {
+#ifndef _WIN32
+    int fd = open((block_path(cache_directory(), key) + BLOCK_EXT).c_str(), O_RDONLY | O_NOFOLLOW);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && std::size_t(st.st_size) >= sizeof(BlockHeader)) {
+        p = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);  // The mapping remains valid
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::shared_ptr<SharedData> block(new SharedData(key));
+    block->m_map = p;
+    block->m_map_size = std::size_t(st.st_size);
+
+    // Check the header and the key: a different key with the same hash, or a damaged file, is treated as a miss
+    const BlockHeader* header = static_cast<const BlockHeader*>(p);
+    const char* base = static_cast<const char*>(p);
+    if (std::memcmp(header->magic, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) != 0 ||
+        header->key_size != key.size() ||
+        header->data_offset < sizeof(BlockHeader) + key.size() ||
+        header->data_offset > block->m_map_size ||
+        header->data_size > block->m_map_size - header->data_offset ||
+        key.compare(0, key.size(), base + sizeof(BlockHeader), key.size()) != 0)
+    {
+        return nullptr;
+    }
+    block->m_data = base + header->data_offset;
+    block->m_size = std::size_t(header->data_size);
+    return block;
+#else
+    return nullptr;
+#endif
+}
+
+
+std::shared_ptr<const SharedData> SharedData::find(const std::string& key) {
+    auto p = find_mapped(key);
+    if (p) {
+        return p;
+    }
+    p = map(key);
+    return p?remember(p):nullptr;
+}
+
+
+std::shared_ptr<const SharedData> SharedData::put(const std::string& key, const void* data, std::size_t size) {
+#ifndef _WIN32
+    auto dir = cache_directory();
+
+    BlockHeader header;
+    std::memcpy(header.magic, BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+    header.key_size = key.size();
+    header.data_size = size;
+    header.data_offset = (sizeof(BlockHeader) + key.size() + 7) & ~uint64_t(7);     // The data are 8-byte aligned
+
+    // Make room for the block
+    trim_cache(dir, header.data_offset + size);
+
+    // Write to a temporary file, then rename it so that the block appears complete
+    auto path = block_path(dir, key);
+    std::string tmp(path + ".XXXXXX");
+    int fd = mkstemp(&tmp[0]);
+    if (fd < 0) {
+        throw std::runtime_error("SharedData: could not create a file in the cache directory '" + dir + "': " + std::strerror(errno));
+    }
+
+    std::string head(reinterpret_cast<const char*>(&header), sizeof(header));
+    head += key;
+    head.resize(std::size_t(header.data_offset), '\0');
+
+    bool ok = true;
+    for (auto part: {std::make_pair(head.data(), head.size()), std::make_pair(static_cast<const char*>(data), size)}) {
+        while (ok && part.second > 0) {
+            auto n = write(fd, part.first, part.second);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            ok = (n > 0);
+            if (ok) {
+                part.first += n;
+                part.second -= std::size_t(n);
+            }
+        }
+    }
+    fchmod(fd, 0644);
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), (path + BLOCK_EXT).c_str()) != 0) {
+        unlink(tmp.c_str());
+        throw std::runtime_error("SharedData: could not write the cache file for '" + key + "'.");
+    }
+
+    // The block of the key in this process, if any, is replaced
+    auto p = map(key);
+    if (!p) {
+        throw std::runtime_error("SharedData: could not map the cache file for '" + key + "'.");
+    }
+    std::lock_guard<std::mutex> lock(g_blocks_mutex);
+    g_blocks[key] = p;
+    return p;
+#else
+    std::shared_ptr<SharedData> p(new SharedData(key));
+    p->m_copy.assign(static_cast<const char*>(data), size);
+    p->m_data = p->m_copy.data();
+    p->m_size = size;
+    std::lock_guard<std::mutex> lock(g_blocks_mutex);
+    g_blocks[key] = p;
+    return p;
+#endif
+}
+
+
+void SharedData::BuildLock::unlock() {
+#ifndef _WIN32
+    if (m_fd >= 0) {
+        flock(m_fd, LOCK_UN);
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+
+std::shared_ptr<const SharedData> SharedData::acquire(const std::string& key, BuildLock& lock) {
+    lock.unlock();
+    auto p = find(key);
+    if (p) {
+        return p;
+    }
+
+#ifndef _WIN32
+    // Serialize the builders of the same key on this host, so that only the first process builds the block
+    lock.m_fd = open((block_path(cache_directory(), key) + LOCK_EXT).c_str(), O_RDWR | O_CREAT | O_NOFOLLOW, 0600);
+    if (lock.m_fd >= 0) {
+        while (flock(lock.m_fd, LOCK_EX) != 0 && errno == EINTR) { }
+    }
+
+    // The block may have been stored while waiting for the lock
+    p = find(key);
+    if (p) {
+        lock.unlock();
+    }
+#endif
+    return p;
+}
+
+
+std::shared_ptr<const SharedData> SharedData::get(const std::string& key, const Builder& build) {
+    BuildLock lock;
+    auto p = acquire(key, lock);
+    if (p) {
+        return p;
+    }
+
+    std::string content;
+    build(content);
+    return put(key, content.data(), content.size());
+}
+
+
+/***************************
+ * SharedTable
+ ***************************/
+
+void SharedTable::Writer::new_row() {
+    m_rows.push_back(m_cells.size() / sizeof(Cell));
+}
+
+void SharedTable::Writer::add_cell(uint32_t type, uint32_t len, uint64_t value) {
+    if (m_rows.empty()) {
+        new_row();
+    }
+    Cell c;
+    c.type = type;
+    c.len = len;
+    c.offset = value;
+    auto p = reinterpret_cast<const char*>(&c);
+    m_cells.insert(m_cells.end(), p, p + sizeof(c));
+}
+
+void SharedTable::Writer::add_double(double d) {
+    uint64_t v;
+    std::memcpy(&v, &d, sizeof(v));
+    add_cell(DOUBLE, 0, v);
+}
+
+void SharedTable::Writer::add_int(int64_t i) {
+    add_cell(INT, 0, uint64_t(i));
+}
+
+void SharedTable::Writer::add_string(const std::string& s) {
+    add_cell(STRING, uint32_t(s.size()), m_strings.size());
+    m_strings += s;
+}
+
+void SharedTable::Writer::write(std::string& out) const {
+    TableHeader header;
+    std::memcpy(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    header.nrows = m_rows.size();
+    header.ncells = m_cells.size() / sizeof(Cell);
+    header.strings_size = m_strings.size();
+
+    out.assign(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(reinterpret_cast<const char*>(m_rows.data()), m_rows.size() * sizeof(uint64_t));
+    uint64_t end = header.ncells;
+    out.append(reinterpret_cast<const char*>(&end), sizeof(end));
+    out.append(m_cells.data(), m_cells.size());
+    out += m_strings;
+}
+
+
+SharedTable::SharedTable(std::shared_ptr<const SharedData> t_data): m_data(std::move(t_data)) {
+    if (!m_data || m_data->size() < sizeof(TableHeader)) {
+        throw std::runtime_error("SharedTable: the data block is not a table.");
+    }
+    TableHeader header;
+    std::memcpy(&header, m_data->data(), sizeof(header));
+    if (std::memcmp(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0 ||
+        (m_data->size() - sizeof(TableHeader)) / sizeof(uint64_t) <= header.nrows ||
+        (m_data->size() - sizeof(TableHeader) - (header.nrows + 1) * sizeof(uint64_t)) / sizeof(Cell) < header.ncells ||
+        m_data->size() - sizeof(TableHeader) - (header.nrows + 1) * sizeof(uint64_t) - header.ncells * sizeof(Cell) != header.strings_size)
+    {
+        throw std::runtime_error("SharedTable: the data block is not a valid table.");
+    }
+
+    m_nrows = std::size_t(header.nrows);
+    m_rows = reinterpret_cast<const uint64_t*>(m_data->data() + sizeof(TableHeader));
+    m_cells = reinterpret_cast<const Cell*>(m_rows + m_nrows + 1);
+    m_strings = reinterpret_cast<const char*>(m_cells + header.ncells);
+
+    // Check the row indices and the strings once, so that the accessors need not
+    for (std::size_t r = 0; r < m_nrows; ++r) {
+        if (m_rows[r] > m_rows[r+1]) {
+            throw std::runtime_error("SharedTable: the data block is not a valid table.");
+        }
+    }
+    if (m_rows[0] != 0 || m_rows[m_nrows] != header.ncells) {
+        throw std::runtime_error("SharedTable: the data block is not a valid table.");
+    }
+    for (uint64_t k = 0; k < header.ncells; ++k) {
+        const Cell& c = m_cells[k];
+        if (c.type == STRING && (c.offset > header.strings_size || c.len > header.strings_size - c.offset)) {
+            throw std::runtime_error("SharedTable: the data block is not a valid table.");
+        }
+    }
+}
+
+double SharedTable::get_double(std::size_t r, std::size_t c) const {
+    const Cell& x = cell(r, c);
+    switch (x.type) {
+        case DOUBLE:
+            return x.d;
+        case INT:
+            return double(x.i);
+        default:
+            throw std::out_of_range("SharedTable: the cell is not a number.");
+    }
+}
+
+int64_t SharedTable::get_int(std::size_t r, std::size_t c) const {
+    const Cell& x = cell(r, c);
+    switch (x.type) {
+        case DOUBLE:
+            return int64_t(x.d);
+        case INT:
+            return x.i;
+        default:
+            throw std::out_of_range("SharedTable: the cell is not a number.");
+    }
+}
+
+std::string SharedTable::get_string(std::size_t r, std::size_t c) const {
+    const Cell& x = cell(r, c);
+    if (x.type != STRING) {
+        throw std::out_of_range("SharedTable: the cell is not a string.");
+    }
+    return std::string(m_strings + x.offset, x.len);
+}
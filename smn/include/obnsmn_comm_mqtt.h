@@ -23,6 +23,7 @@
 #include <condition_variable>
 #include <atomic>
 #include <unordered_set>
+#include <unordered_map>
 
 #include <regex>    // For checking topic names
 
@@ -31,6 +32,7 @@
 #include <obnsmn_gc.h>
 
 #include "MQTTAsync.h"
+#include <obnsim_mqtt5.h>
 
 
 namespace OBNsmn {
@@ -52,6 +54,12 @@ namespace OBNsmn {
             
             std::atomic_int m_msgout_count{0};      ///< Keep track of the current number of out messages
             
+            bool m_use_topic_aliases{false};    ///< Whether to connect with MQTT v5 and use topic aliases when publishing
+            OBNsim::MQTT5::TopicAliases m_topic_aliases;  ///< Topic aliases of the current connection (MQTT v5)
+            
+            /** \brief Start connecting to the server, with the MQTT version and the callbacks for a new connection or a reconnection. */
+            int connect(bool reconnect);
+            
             // The result variable, mutex and condition variable is used by MQTT callbacks to notify the main execution.
             bool m_notify_done;
             int m_notify_result;    // Result of the action, typically 0 means success
@@ -142,6 +150,17 @@ namespace OBNsmn {
                 m_server_address = addr;
             }
             
+            /** Use MQTT v5 and topic aliases for publishing, if the broker accepts them.
+             Must be set before start(); the broker must support MQTT v5.
+             */
+            void setTopicAliases(bool b) {
+                m_use_topic_aliases = b;
+            }
+            
+            bool topicAliases() const {
+                return m_use_topic_aliases;
+            }
+            
             /** \brief Open the port.
              \return True if successful.
              */
@@ -212,10 +231,16 @@ namespace OBNsmn {
 
             /** Called when the connection with the server is established successfully. */
             static void onConnect(void* context, MQTTAsync_successData* response);
+            
+            /** Called when the connection with the server is established successfully, in MQTT v5. */
+            static void onConnect5(void* context, MQTTAsync_successData5* response);
 
             /** Called when a connection attempt failed. */
             static void onConnectFailure(void* context, MQTTAsync_failureData* response);
             
+            /** Called when a connection attempt failed, in MQTT v5. */
+            static void onConnectFailure5(void* context, MQTTAsync_failureData5* response);
+            
             /** Called when subscription succeeds. */
             static void onSubscribe(void* context, MQTTAsync_successData* response);
             
@@ -225,9 +250,15 @@ namespace OBNsmn {
             /** Called when the re-connection with the server is established successfully. */
             static void onReconnect(void* context, MQTTAsync_successData* response);
             
+            /** Called when the re-connection with the server is established successfully, in MQTT v5. */
+            static void onReconnect5(void* context, MQTTAsync_successData5* response);
+            
             /** Called when a re-connection attempt failed. */
             static void onReconnectFailure(void* context, MQTTAsync_failureData* response);
             
+            /** Called when a re-connection attempt failed, in MQTT v5. */
+            static void onReconnectFailure5(void* context, MQTTAsync_failureData5* response);
+            
             /** Called when resubscription fails. */
             static void onReSubscribeFailure(void* context, MQTTAsync_failureData* response);
             
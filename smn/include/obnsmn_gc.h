@@ -21,11 +21,13 @@
 #define OBNSIM_GC_H_
 
 #include <mutex>
+#include <atomic>
 #include <functional>
 #include <vector>
 #include <memory>
 #include <chrono>
 #include <utility>  // pair
+#include <unordered_map>
 #include <ctime>    // For wall-clock time
 
 #include <sharedqueue.h>    // Thread-safe shared event queue
@@ -127,6 +129,41 @@ namespace OBNsmn {
          */
         int ack_timeout = 0;
         
+        /** Whether to run the simulation in the conservative (decoupled) mode.
+         Instead of stepping all nodes in lockstep, each node is advanced as soon as the lookahead of its connected nodes guarantees that it can't receive an out-of-order value (see obnsmn_gc_conservative.cpp).
+         If the system is not suitable for this mode (e.g. it has triggers), the GC falls back to the lockstep algorithm.
+         */
+        bool conservative_mode = false;
+        
+        /** Maximum number of repetitions of a time instant in the waveform relaxation coupling.
+         Nodes coupled by waveform relaxation compute, in UPDATE_Y, the trajectories of their outputs over a time window, and report in their SIM_Y_ACK if these have not converged.
+         The GC then repeats all UPDATE_Y of the time instant, with the iteration number in the data of the messages, until all nodes report convergence or this number of repetitions is reached.
+         All nodes updated at the time instant are repeated, not only those which reported non-convergence: the trajectories are exchanged through ports, which the GC does not know,
+         so a node which has converged may still receive new trajectories from another node, and must then be updated again, as must the nodes depending on its outputs.
+         If it is 0 (default), the time instants are never repeated.
+         */
+        int relaxation_max_iterations = 0;
+        
+        /** Maximum number of micro-steps at one simulation time instant (superdense time).
+         A node can request an irregular update at the current simulation time (e.g. for the next iteration of an iterative algorithm); the GC then runs the requested blocks in a micro-step
+         right after the current step, without advancing the time, and the SIM_Y and SIM_X messages carry the micro-step index in their data.
+         Requests beyond this number of micro-steps are rejected; if it is 0 (default), micro-steps are disabled.
+         Micro-steps are only supported in the lockstep mode.
+         */
+        unsigned int microstep_max_iterations = 0;
+        
+        /** Whether the GC prepares the next simulation step while the nodes run the UPDATE_X of the current step (lockstep mode).
+         The update list of the next step (scan of the schedules and trigger expansion) and its run-time dependency graph are computed right after the UPDATE_X messages are sent,
+         instead of after all their ACKs are received. They are used when the step starts, unless an irregular update accepted in between is due at or before the prepared time,
+         in which case the next step is computed again. The simulation is the same either way.
+         */
+        bool pipelined_steps = true;
+        
+        /** Whether the GC requests the states of all nodes (SIM_STATE) at the end of the simulation, before terminating them.
+         The states are available from getFinalState() after the GC thread has finished; a node which can't give its state is reported but doesn't stop the simulation.
+         */
+        bool collect_final_states = false;
+        
         /** Set the simulation time unit.
          \param T The simulation time unit, in number of microseconds.
          \return true if successful.
@@ -168,6 +205,49 @@ namespace OBNsmn {
             return false;
         }
         
+        /** Set the initial simulation time, from which the simulation starts (default: 0).
+         The periodic updates keep their schedules from time 0, so a simulation can be run as several consecutive time slices.
+         \return true if successful.
+         */
+        bool setInitialSimulationTime(simtime_t T) {
+            // Only set the time when the GC is not (yet) running.
+            if ((T >= 0) && (!_gcthread)) {
+                initial_sim_time = T;
+                return true;
+            }
+            
+            return false;
+        }
+        
+        /** Set the initial state of a node, sent to it in the SIM_INIT message (see OBNsim::Utils::encodeState()).
+         \param id ID of the node.
+         \param state The encoded state; empty to clear it.
+         \return true if successful.
+         */
+        bool setInitialState(std::size_t id, const std::string& state) {
+            if (_gcthread || id >= _nodes.size()) {
+                return false;
+            }
+            if (initial_states.size() < _nodes.size()) {
+                initial_states.resize(_nodes.size());
+            }
+            initial_states[id] = state;
+            return true;
+        }
+        
+        /** Get the state of a node at the end of the last simulation (see collect_final_states).
+         \param id ID of the node.
+         \param state The encoded state.
+         \return true if the state of the node was collected.
+         */
+        bool getFinalState(std::size_t id, std::string& state) const {
+            if (_gcthread || id >= final_states_valid.size() || !final_states_valid[id]) {
+                return false;
+            }
+            state = final_states[id];
+            return true;
+        }
+        
         
         ///@{
         /** Set the node dependency graph.
@@ -208,6 +288,9 @@ namespace OBNsmn {
         /** Return number of nodes in the node list. */
         int numberOfNodes() const { return _nodes.size(); }
         
+        /** Return the name of a node, given its ID which must be valid. */
+        const std::string& nodeName(std::size_t id) const { return _nodes.at(id)->name; }
+        
         /** Add a new triggering from srcNode with srcMask blocks to tgtNode with tgtMask blocks.
          \return 0 if successful; 1 if srcNode doesn't exist; 2 if tgtNode doesn't exist; 3 if either srcMask or tgtMask is zero.
          */
@@ -221,6 +304,21 @@ namespace OBNsmn {
             return 0;
         }
         
+        /** Register a data connection from srcNode to tgtNode.
+         All connections, including those without direct feedthrough, are needed by the conservative mode to determine which nodes must wait for each other.
+         \return 0 if successful; 1 if srcNode doesn't exist; 2 if tgtNode doesn't exist.
+         */
+        int addConnection(std::size_t srcNode, std::size_t tgtNode) {
+            auto validMaxID = _nodes.size() - 1;
+            if (srcNode > validMaxID) return 1;
+            if (tgtNode > validMaxID) return 2;
+            
+            if (srcNode != tgtNode) {
+                cmb_connections.emplace_back(srcNode, tgtNode);
+            }
+            return 0;
+        }
+        
         typedef std::function<bool(const OBNSimMsg::SMN2N&)> TSendMsgToSysPortFunc;   ///< A function type to send a SMN2N message to the system port (instead of a node's port)
         
         /** Set the function to send an SMN2N message to the system port (_gc_) */
@@ -323,7 +421,42 @@ namespace OBNsmn {
          */
         std::pair<int, std::string> request_port_connect(std::size_t idx, const std::string& target, const std::string& source, unsigned int timeout = 5000);
         
+        /** \brief Request a node to publish an output port only at the multiples of a period.
+         
+         This method uses the system message SMN2N:SYS_PORT_DECIMATE, in the same way as request_port_connect().
+         It is used when all the consumers of the output sample it at the multiples of the period, so the values produced in between would never be read.
+         
+         \param idx The index of the node.
+         \param port The name of the output port on the node.
+         \param period The period, in the simulation time unit; 0 to publish every change.
+         \param timeout The timeout value in milliseconds (default: 5000 = 5s).
+         \return A pair of the result of the request (int) and an error message (if available).
+         
+         Result code: 0 if successful; -1 if the output port does not exist on this node; other negative codes as in request_port_connect().
+         */
+        std::pair<int, std::string> request_port_decimation(std::size_t idx, const std::string& port, simtime_t period, unsigned int timeout = 5000);
+        
+        /** \brief Request a node to send the values of an output port with a given precision.
+         
+         This method uses the system message SMN2N:SYS_PORT_PRECISION, in the same way as request_port_connect().
+         Only double vectors and matrices can be sent with reduced precision; the receiving nodes widen the values automatically.
+         
+         \param idx The index of the node.
+         \param port The name of the output port on the node.
+         \param mode The precision mode: 0 = full, 1 = float32, 2 = fixed point.
+         \param scale The quantization step of the fixed point mode (must be positive in that mode).
+         \param max_abs_error,max_rel_error The maximum absolute and relative errors of each value, 0 if not checked.
+         \param timeout The timeout value in milliseconds (default: 5000 = 5s).
+         \return A pair of the result of the request (int) and an error message (if available).
+         
+         Result code: 0 if successful; -1 if the output port does not exist on this node; -2 if the port does not support the precision; other negative codes as in request_port_connect().
+         */
+        std::pair<int, std::string> request_port_precision(std::size_t idx, const std::string& port, int mode, double scale, double max_abs_error, double max_rel_error, unsigned int timeout = 5000);
+        
     private:
+        /** Send a system request to a node and wait for its ACK of the given type; used by request_port_connect() and request_port_decimation(). */
+        std::pair<int, std::string> request_node_system(std::size_t idx, OBNSimMsg::SMN2N& msg, OBNSimMsg::N2SMN::MSGTYPE ack_type, unsigned int timeout);
+        
         // =========== Event queue ============
 
         typedef shared_queue<OBNsmn::SMNNodeEvent> OBNEventQueueType;
@@ -380,6 +513,16 @@ namespace OBNsmn {
         /** The initial wall clock time at the start of the simulation. */
         std::time_t initial_wallclock = 0;
         
+        /** The initial simulation time. */
+        simtime_t initial_sim_time = 0;
+        
+        /** Encoded initial states of the nodes, indexed by node ID; an empty string if a node has no initial state. */
+        std::vector<std::string> initial_states;
+        
+        /** Encoded final states of the nodes and whether they were collected, indexed by node ID (see collect_final_states). */
+        std::vector<std::string> final_states;
+        std::vector<bool> final_states_valid;
+        
         /** \brief Initialize the simulation before it can start. */
         bool initialize();
         
@@ -410,6 +553,12 @@ namespace OBNsmn {
         //bool gc_wait_for_ack(std::function<bool (const OBNsmn::SMNNodeEvent*)> f = [](const OBNsmn::SMNNodeEvent* ev) {return true;});
         bool gc_wait_for_ack();
         
+        /** \brief Send SIM_INIT, with their initial states, to all nodes and start waiting for their ACKs. */
+        bool gc_send_init();
+        
+        /** \brief Request the states of all nodes at the end of the simulation and wait for them. */
+        bool gc_collect_final_states();
+        
         /** \brief Default node event processing function. */
         bool gc_process_node_events(OBNsmn::SMNNodeEvent* pEv);
         
@@ -491,6 +640,27 @@ namespace OBNsmn {
             return true;
         }
         
+        /** Whether a node has reported non-converged outputs in its SIM_Y_ACK in the current iteration (waveform relaxation); protected by gc_waitfor_mutex. */
+        bool gc_relax_repeat = false;
+        
+        /** Current iteration of the current time instant (waveform relaxation), sent with UPDATE_Y if positive. */
+        int gc_relax_iteration = 0;
+        
+        /** Index of the current micro-step at the current simulation time (0 for a regular step), sent with UPDATE_Y and UPDATE_X if positive. */
+        unsigned int gc_microstep = 0;
+        
+        /** Update masks requested by the nodes for the next micro-step, indexed by node ID. */
+        std::vector<updatemask_t> gc_microstep_masks;
+        
+        /** Whether each node has requested the next micro-step, indexed by node ID. */
+        std::vector<bool> gc_microstep_pending;
+        
+        /** IDs of the nodes which requested the next micro-step, in the order of their requests. */
+        std::vector<int> gc_microstep_nodes;
+        
+        /** Accept a request for the next micro-step; returns false if it is rejected (micro-steps disabled or too many of them). */
+        bool gc_request_microstep(int id, updatemask_t mask);
+        
         /** Process ACK messages for waitfor. */
         bool gc_waitfor_process_ACK(const OBNSimMsg::N2SMN& msg, int ID);
         
@@ -523,6 +693,20 @@ namespace OBNsmn {
          \sa gc_update_list
          */
         size_t gc_update_size;
+        
+        /** The update list of the next step, with its size and time (< 0 if there is no next update), computed by scanNextUpdate(). */
+        NodeUpdateInfoList gc_next_update_list;
+        size_t gc_next_update_size;
+        simtime_t gc_next_update_time;
+        
+        /** Whether the next update list has been prepared ahead of the next step (see pipelined_steps). */
+        bool gc_next_prepared = false;
+        
+        /** Whether rtNodeGraph has been prepared for the next update list. */
+        bool gc_next_graph_ready = false;
+        
+        /** IDs of the nodes whose irregular updates have been accepted since the next update list was prepared. */
+        std::vector<int> gc_next_changed_nodes;
 
         /* Number of irregular updates.
         size_t gc_update_irregular_size; */
@@ -532,6 +716,18 @@ namespace OBNsmn {
         
         /** \brief Start the next update. */
         bool startNextUpdate();
+        
+        /** \brief Compute the next update list from the schedules of the nodes, without starting it. */
+        void scanNextUpdate();
+        
+        /** \brief Prepare the next update list and its run-time graph ahead of the next step. */
+        void prepareNextUpdate();
+        
+        /** \brief Start the next micro-step at the current simulation time, with the nodes which requested it. */
+        void startNextMicroStep();
+        
+        /** \brief Add the blocks triggered by the updates in the given list, whose masks are set. */
+        void addTriggeredUpdates(NodeUpdateInfoList& list, size_t& size);
         ///@}
         
         
@@ -573,6 +769,99 @@ namespace OBNsmn {
         void gc_timer_reset() {
             gc_timer_active = false;
         }
+        
+        
+        // ============ Live metrics =============
+        
+        /** The metrics of the GC; all null if the metrics server was not running when the simulation started. */
+        struct GCMetrics {
+            OBNsim::Metrics::Counter* steps = nullptr;          ///< Simulation steps (time instants) completed
+            OBNsim::Metrics::Counter* waves_y = nullptr;        ///< UPDATE_Y waves sent
+            OBNsim::Metrics::Counter* waves_x = nullptr;        ///< UPDATE_X waves sent
+            OBNsim::Metrics::Counter* node_updates = nullptr;   ///< Node updates completed
+            OBNsim::Metrics::Counter* rescans = nullptr;        ///< Prepared steps which had to be computed again
+            OBNsim::Metrics::Histogram* ack_latency = nullptr;  ///< Time from sending an update message to receiving its ACK
+        } gc_metrics;
+        
+        /** Time (Trace::now()) at which the current wave was sent in the lockstep mode; read by the communication threads when ACKs arrive. */
+        std::atomic<int64_t> gc_metrics_wave_start{-1};
+        
+        /** Register the metrics of the GC if the metrics server is running. */
+        void gc_metrics_register();
+        
+        /** Remove the gauges of the GC, which use this object, and reset gc_metrics. */
+        void gc_metrics_unregister();
+        
+        
+        // ============ Conservative (decoupled) execution =============
+        
+        /** State of a node in the conservative mode. */
+        struct CMBNodeState {
+            enum {
+                IDLE,       ///< Not updating; next is its next update time
+                UPDATE_Y,   ///< Waiting for the ACK of an UPDATE_Y wave
+                WAIT_X,     ///< All UPDATE_Y waves are done, waiting for its inputs before UPDATE_X
+                UPDATE_X    ///< Waiting for the ACK of UPDATE_X
+            } phase;
+            simtime_t time;     ///< Time of the current update (if not IDLE) or of the last update (if IDLE, -1 if none)
+            simtime_t next;     ///< Next update time if IDLE, < 0 or > final time if there is none
+            updatemask_t mask;  ///< Update mask of the current update
+            int64_t sent;       ///< Time (Trace::now()) at which the last update message was sent, for the ACK latency metric
+            const std::vector<updatemask_t>* waves;     ///< Masks of the UPDATE_Y waves of the current update, in order
+            std::size_t wave;                           ///< Index of the current UPDATE_Y wave
+            std::unordered_map<updatemask_t, std::vector<updatemask_t> > wave_cache;  ///< UPDATE_Y waves computed for each update mask of this node
+            std::vector<int> sources;           ///< Nodes that send values to this node
+            std::vector<int> feedthrough;       ///< Sources on which the outputs of this node depend directly
+            std::vector<int> consumers;         ///< Nodes that receive values from this node
+        };
+        
+        /** All data connections (source node, target node) between different nodes. */
+        std::vector< std::pair<int, int> > cmb_connections;
+        
+        /** States of all nodes in the conservative mode. */
+        std::vector<CMBNodeState> cmb_nodes;
+        
+        /** Number of nodes currently updating (not IDLE) in the conservative mode. */
+        int cmb_busy;
+        
+        /** Whether the conservative mode is running; read by the communication threads to route the ACKs. */
+        std::atomic_bool cmb_running{false};
+        
+        /** Whether the GC can run the current system in the conservative mode, and prepare its data. */
+        bool gc_cmb_prepare();
+        
+        /** Main loop of the conservative mode; returns false if the simulation was stopped by an error. */
+        bool gc_cmb_main();
+        
+        /** Start all updates at times <= limit which are safe to be executed; returns false if there is an error. */
+        bool gc_cmb_dispatch(simtime_t limit);
+        
+        /** Start the next update of an idle node; returns false if there is an error. */
+        bool gc_cmb_start_update(int id);
+        
+        /** Finish the current update of a node and make it idle. */
+        void gc_cmb_finish_update(int id);
+        
+        /** The earliest time of all current and pending updates, or -1 if there is none. */
+        simtime_t gc_cmb_global_time() const;
+        
+        /** Process an ACK in the conservative mode. */
+        bool gc_cmb_process_ack(const OBNsmn::SMNNodeEvent* pEv);
+        
+        /** Read the next update of an idle node. */
+        void gc_cmb_read_next_update(int id);
+        
+        /** Whether all UPDATE_Y of node id at times <= t are done (its outputs at time t are final). */
+        bool gc_cmb_outputs_final(int id, simtime_t t) const;
+        
+        /** Whether node id has finished reading its inputs at all times < t. */
+        bool gc_cmb_inputs_read(int id, simtime_t t) const;
+        
+        /** Whether an irregular update of node id at time t can still be accepted. */
+        bool gc_cmb_accept_irregular(int id, simtime_t t) const;
+        
+        /** Send an UPDATE_Y or UPDATE_X message to a node. */
+        bool gc_cmb_send(int id, OBNSimMsg::SMN2N::MSGTYPE type, updatemask_t mask);
     };
 }
 
@@ -26,10 +26,27 @@ inline void OBNsmn::GCThread::gc_process_msg_sim_event(OBNsmn::SMNNodeEvent* pEv
     if (pEv->has_t) {
         data->set_t(pEv->t);
         
-        if (pEv->t > current_sim_time) {
+        // In the lockstep mode, a request at the current time is for the next micro-step (superdense time)
+        if (!cmb_running && pEv->t == current_sim_time) {
+            if (gc_request_microstep(pEv->nodeID, (pEv->has_i)?pEv->i:0)) {
+                data->set_i(0);  // OK
+            } else {
+                report_warning(0, "A micro-step request from node " + std::to_string(pEv->nodeID) +
+                               " (" + _nodes[pEv->nodeID]->name + ") is rejected: micro-steps are disabled or the maximum number of micro-steps has been reached.");
+                data->set_i(3);  // Error code 3 = micro-step rejected
+            }
+        }
+        // In the conservative mode, nodes have different times (see gc_cmb_accept_irregular())
+        else if (cmb_running?gc_cmb_accept_irregular(pEv->nodeID, pEv->t):(pEv->t > current_sim_time)) {
             // Requested time is in the future: it's accepted
             data->set_i(0);  // OK
             _nodes[pEv->nodeID]->insertIrregularUpdate(pEv->t, (pEv->has_i)?pEv->i:0);
+            if (gc_next_prepared) {
+                gc_next_changed_nodes.push_back(pEv->nodeID);   // The prepared next step may be invalid
+            }
+            if (cmb_running && cmb_nodes[pEv->nodeID].phase == CMBNodeState::IDLE) {
+                gc_cmb_read_next_update(pEv->nodeID);
+            }
             //report_info(0, "Accept event for node " + _nodes[pEv->nodeID]->name + " for mask " + std::to_string((pEv->has_i)?pEv->i:0) + " at time " + std::to_string(pEv->t));
         }
         else {
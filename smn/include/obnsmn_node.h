@@ -93,6 +93,7 @@ namespace OBNsmn {
             simtime_t period;   ///< Sampling period of the update, <=0 if not periodic, >0 if periodic.
             updatemask_t mask;  ///< Bit mask that represents this update type
             simtime_t next_update;   ///< Next time instant when this group will be updated (periodic case)
+            simtime_t offset;   ///< Phase offset of a periodic update: it is updated at offset + k*period
         };
         
         std::vector<UpdateType> update_types; ///< Vector of all update types
@@ -130,9 +131,18 @@ namespace OBNsmn {
         void setUpdateType(size_t idx, simtime_t period, updatemask_t mask) {
             update_types[idx].period = period;
             update_types[idx].next_update = 0;
+            update_types[idx].offset = 0;
             update_types[idx].mask = mask;
         }
         
+        /** \brief Set the phase offset of a periodic update type, so that it is updated at offset + k*period instead of k*period.
+         \param idx Index of the update type, which must have been configured.
+         \param offset The phase offset, >= 0.
+         */
+        void setUpdateOffset(size_t idx, simtime_t offset) {
+            update_types[idx].offset = offset;
+        }
+        
         /** \brief Configure an update type with automatic mask.
          Configure an update type with a given period and automatic bit mask where the bit corresponding to the index is set to 1.
          
@@ -166,8 +176,8 @@ namespace OBNsmn {
         void addTrigger(updatemask_t srcBlks, int tgtNode, updatemask_t tgtBlks);
         
     private:
-        /** \brief Initialize the node to (re)start a simulation. */
-        bool initialize();
+        /** \brief Initialize the node to (re)start a simulation from a given simulation time. */
+        bool initialize(simtime_t start = 0);
  
         /** \brief Calculate next update/sync instants. */
         void finishCurrentUpdate();
@@ -109,6 +109,13 @@ namespace OBNsmn {
          \return Pointer to a RTNodeDepGraph object
          */
         virtual RTNodeDepGraph* getRTNodeDepGraph(GCUpdateListIterator itbegin, size_t n) = 0;
+        
+        /** \brief Return the dependencies between different nodes, ignoring the update masks.
+         
+         Dependencies of a node on itself (between its own update types) are not included.
+         \return Vector of pairs (s, t) where node t depends on node s; each pair appears once.
+         */
+        virtual std::vector< std::pair<int, int> > getNodeDependencies() const = 0;
     };
     
     
@@ -203,6 +210,9 @@ namespace OBNsmn {
         /** \brief Return a runtime node dependency graph, keeping only updating nodes. */
         virtual RTNodeDepGraph* getRTNodeDepGraph(GCUpdateListIterator itbegin, size_t n);
         
+        /** \brief Return the dependencies between different nodes. */
+        virtual std::vector< std::pair<int, int> > getNodeDependencies() const;
+        
         /* ======== Implementation of the RTNodeDepGraph interface ========= */
         /** \brief Return and remove independent nodes. */
         virtual std::vector< std::pair<int, updatemask_t> > const& getAndRemoveIndependentNodes();
@@ -178,6 +178,12 @@ public:
     {
         return mData.empty();
     }
+    
+    std::size_t size() const ///< Number of items in the queue.
+    {
+        std::lock_guard<std::mutex> lock(mMut);
+        return mData.size();
+    }
 
     /** \brief Return the mutex used to lock/unlock access to this queue. */
     std::mutex& getMutex() const { return mMut; }
@@ -28,7 +28,8 @@ bool MQTTClient::start() {
     int rc;
     
     // Start the client and immediately subscribe to the main GC topic
-    if ((rc = MQTTAsync_create(&m_client, m_server_address.c_str(), m_client_id.c_str(), MQTTCLIENT_PERSISTENCE_NONE, NULL)) != MQTTASYNC_SUCCESS) {
+    // Topic aliases require MQTT v5
+    if ((rc = OBNsim::MQTT5::createClient(&m_client, m_server_address, m_client_id, m_use_topic_aliases)) != MQTTASYNC_SUCCESS) {
         OBNsmn::report_error(0, "MQTT error: could not create MQTT client with error code = " + std::to_string(rc));
         return false;
     }
@@ -41,13 +42,7 @@ bool MQTTClient::start() {
     }
     
     // Connect and subscribe
-    MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
-    conn_opts.keepAliveInterval = 20;
-    conn_opts.cleansession = 1;
-    conn_opts.onSuccess = &MQTTClient::onConnect;
-    conn_opts.onFailure = &MQTTClient::onConnectFailure;
-    conn_opts.context = this;
-    if ((rc = MQTTAsync_connect(m_client, &conn_opts)) != MQTTASYNC_SUCCESS)
+    if ((rc = connect(false)) != MQTTASYNC_SUCCESS)
     {
         OBNsmn::report_error(0, "MQTT error: could not start connect with error code = " + std::to_string(rc));
         return false;
@@ -64,6 +59,17 @@ bool MQTTClient::start() {
 }
 
 
+int MQTTClient::connect(bool reconnect) {
+    OBNsim::MQTT5::ConnectCallbacks callbacks;
+    if (reconnect) {
+        callbacks = {&MQTTClient::onReconnect, &MQTTClient::onReconnectFailure, &MQTTClient::onReconnect5, &MQTTClient::onReconnectFailure5};
+    } else {
+        callbacks = {&MQTTClient::onConnect, &MQTTClient::onConnectFailure, &MQTTClient::onConnect5, &MQTTClient::onConnectFailure5};
+    }
+    return OBNsim::MQTT5::connect(m_client, m_use_topic_aliases, callbacks, this);
+}
+
+
 void MQTTClient::stop() {
     if (!m_running) {
         return;
@@ -110,8 +116,13 @@ int MQTTClient::sendMessage(char* msg, std::size_t msglen, const std::string& to
     
     ++m_msgout_count;   // Increase the message count (assuming the next function will be successful).
     
-    // Request to send the message
-    return MQTTAsync_sendMessage(m_client, topic.c_str(), &pubmsg, &opts);
+    if (!m_use_topic_aliases) {
+        // Request to send the message
+        return MQTTAsync_sendMessage(m_client, topic.c_str(), &pubmsg, &opts);
+    }
+    
+    // Request to send the message with the alias of its topic
+    return m_topic_aliases.send(m_client, topic, pubmsg, &opts);
 }
 
 
@@ -217,16 +228,8 @@ void MQTTClient::on_connection_lost(void *context, char *cause)
     MQTTClient* client = static_cast<MQTTClient*>(context);
     
     // Retry to connect once
-    MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
-    conn_opts.keepAliveInterval = 20;
-    conn_opts.cleansession = 1;
-    
-    conn_opts.onSuccess = &MQTTClient::onReconnect;
-    conn_opts.onFailure = &MQTTClient::onReconnectFailure;
-    conn_opts.context = context;
-    
     int rc;
-    if ((rc = MQTTAsync_connect(client->m_client, &conn_opts)) != MQTTASYNC_SUCCESS)
+    if ((rc = client->connect(true)) != MQTTASYNC_SUCCESS)
     {
         // At this point, the client is not running
         client->m_running = false;
@@ -325,6 +328,19 @@ void MQTTClient::onConnect(void* context, MQTTAsync_successData* response)
 }
 
 
+void MQTTClient::onConnect5(void* context, MQTTAsync_successData5* response)
+{
+    MQTTClient* client = static_cast<MQTTClient*>(context);
+    client->m_topic_aliases.reset(response?&response->properties:nullptr);
+    if (client->m_topic_aliases.max() <= 0) {
+        OBNsmn::report_warning(0, "MQTT: the broker does not accept topic aliases.");
+    }
+    
+    // Subscribe to the main GC topic
+    onConnect(context, nullptr);
+}
+
+
 void MQTTClient::onConnectFailure(void* context, MQTTAsync_failureData* response)
 {
     MQTTClient* client = static_cast<MQTTClient*>(context);
@@ -333,6 +349,13 @@ void MQTTClient::onConnectFailure(void* context, MQTTAsync_failureData* response
 }
 
 
+void MQTTClient::onConnectFailure5(void* context, MQTTAsync_failureData5* response)
+{
+    MQTTAsync_failureData data = OBNsim::MQTT5::failureData(response);
+    onConnectFailure(context, &data);
+}
+
+
 void MQTTClient::onSubscribe(void* context, MQTTAsync_successData* response) {
     OBNsmn::report_info(0, "MQTT subscribed.");
     MQTTClient* client = static_cast<MQTTClient*>(context);
@@ -368,6 +391,15 @@ void MQTTClient::onReconnect(void* context, MQTTAsync_successData* response)
     }
 }
 
+void MQTTClient::onReconnect5(void* context, MQTTAsync_successData5* response)
+{
+    MQTTClient* client = static_cast<MQTTClient*>(context);
+    client->m_topic_aliases.reset(response?&response->properties:nullptr);
+    
+    // Resubscribe to the main GC topic
+    onReconnect(context, nullptr);
+}
+
 void MQTTClient::onReconnectFailure(void* context, MQTTAsync_failureData* response)
 {
     MQTTClient* client = static_cast<MQTTClient*>(context);
@@ -378,6 +410,12 @@ void MQTTClient::onReconnectFailure(void* context, MQTTAsync_failureData* respon
     client->onPermanentConnectionLost();
 }
 
+void MQTTClient::onReconnectFailure5(void* context, MQTTAsync_failureData5* response)
+{
+    MQTTAsync_failureData data = OBNsim::MQTT5::failureData(response);
+    onReconnectFailure(context, &data);
+}
+
 void MQTTClient::onReSubscribeFailure(void* context, MQTTAsync_failureData* response) {
     MQTTClient* client = static_cast<MQTTClient*>(context);
     // At this point, the client is not running
@@ -28,6 +28,17 @@ bool OBNsmn::GCThread::gc_waitfor_process_ACK(const OBNSimMsg::N2SMN& msg, int I
         mWakeupCondition.notify_all();
         return true;
     }
+    if (type == OBNSimMsg::N2SMN::SIM_Y_ACK && msg.has_data() && msg.data().i() != 0) {
+        // The outputs of the node have not converged (waveform relaxation)
+        gc_relax_repeat = true;
+    }
+    if (OBNsim::Trace::enabled()) {
+        OBNsim::Trace::instant("ACK", "gc", "\"node\":\"" + _nodes[ID]->name + "\",\"type\":" + std::to_string(type));
+    }
+    if (gc_metrics.ack_latency) {
+        gc_metrics.ack_latency->observe(OBNsim::Trace::now() - gc_metrics_wave_start.load(std::memory_order_relaxed));
+    }
+    
     // This ACK message has been checked -> check it in the bit array
     if (!gc_waitfor_bits[ID]) {
         gc_waitfor_bits[ID] = true;
@@ -71,8 +82,14 @@ bool OBNsmn::GCThread::pushNodeEvent(const OBNSimMsg::N2SMN& msg, int defaultID,
             case OBNSimMsg::N2SMN::SIM_Y_ACK:
             case OBNSimMsg::N2SMN::SIM_X_ACK:
             case OBNSimMsg::N2SMN::SIM_INIT_ACK:
+            case OBNSimMsg::N2SMN::SIM_STATE_ACK:
                 // pushEvent(new SMNNodeEvent(type, OBNsmn::SMNNodeEvent::EVT_ACK, ID));
                 // return true;
+                // In the conservative mode, the GC processes the ACKs of updates as events
+                if (cmb_running && (type == OBNSimMsg::N2SMN::SIM_Y_ACK || type == OBNSimMsg::N2SMN::SIM_X_ACK)) {
+                    pushEvent(new OBNsmn::SMNNodeEvent(type, OBNsmn::SMNNodeEvent::EVT_ACK, ID));
+                    return true;
+                }
                 // Process wait-for here
                 return gc_waitfor_process_ACK(msg, ID);
                 
@@ -81,6 +81,8 @@ using namespace std;
 // This function is the entry point for the GC thread.
 void GCThread::GCThreadMain() {
     // std::cout << "The GC thread." << std::endl;
+    OBNsim::Trace::setThreadName("GC");
+    gc_metrics_register();
 
     // Set to false if there is a critical error that the simulation should terminate immediately,
     //  even without sending TERM signals, but still does necessary cleanups.
@@ -89,53 +91,78 @@ void GCThread::GCThreadMain() {
     bool continueSimulation = true; // whether the simulation continues
     
     // Send the SIM_INIT message to all nodes to start the simulation
-    {
-        OBNSimMsg::MSGDATA *pMsgData = new OBNSimMsg::MSGDATA();
-        pMsgData->set_t(initial_wallclock); // initial wallclock time
-        
-        int64_t time_unit = sim_time_unit;  // simulation time unit, in microseconds
-        
-        noCriticalError = gc_send_to_all(0, OBNSimMsg::SMN2N_MSGTYPE_SIM_INIT, OBNSimMsg::N2SMN_MSGTYPE_SIM_INIT_ACK, &time_unit, pMsgData,
-                                         [this](const OBNSimMsg::N2SMN& msg) {
-                                             if (!msg.has_id()) {
-                                                 return false;
-                                             }
-                                             if (msg.has_data() && msg.data().has_i() && msg.data().i() != 0) {
-                                                 report_error(0, "Node \"" + _nodes[msg.id()]->name + "\" had initialization error #" + std::to_string(msg.data().i()));
-                                                 return false;
-                                             }
-                                             return true;
-                                         });
-    }
+    noCriticalError = gc_send_init();
     
     // Wait for ACKs from all nodes, checking for initialization errors
     if (noCriticalError) {
         continueSimulation = gc_wait_for_ack();
     }
     
+    // Run in the conservative mode if it's enabled and the system is suitable; the lockstep loop below is then skipped
+    if (continueSimulation && noCriticalError && gc_cmb_prepare()) {
+        gc_cmb_main();
+        continueSimulation = false;
+    }
+    
     // Running while the current state is not STOPPED
     while (continueSimulation && noCriticalError && gc_exec_state != GCSTATE_TERMINATING) {
-        if (!startNextUpdate()) {
+        int64_t trace_step_start = OBNsim::Trace::enabled()?OBNsim::Trace::now():-1;
+        
+        // Micro-steps requested during the previous step are run first, at the same time instant
+        bool microstep = !gc_microstep_nodes.empty();
+        if (microstep) {
+            startNextMicroStep();
+        } else if (!startNextUpdate()) {
             // Error, can't continue simulation
             break;
         }
 
         // Update-Y
         if (gc_update_size > 0) {
-            // Create the run-time node graph, for regular updates
-            rtNodeGraph = _nodeGraph->getRTNodeDepGraph(gc_update_list.begin(), gc_update_size);
+            bool success = true;
             
-            // Send regular UPDATE_Y messages to nodes in the run-time graph, in correct order
-            bool success;
-            while (!rtNodeGraph->empty()) {
-                if (!(success = gc_send_update_y())) {
-                    // Error, stop simulation
+            // The UPDATE_Y of this time instant are repeated while some nodes report non-converged outputs (waveform relaxation)
+            // All updating nodes are repeated, because the GC doesn't know which nodes receive the trajectories of the non-converged nodes (see relaxation_max_iterations)
+            for (gc_relax_iteration = 0; ; ++gc_relax_iteration) {
+                {
+                    std::lock_guard<std::mutex> lock(gc_waitfor_mutex);
+                    gc_relax_repeat = false;
+                }
+                
+                // Create the run-time node graph, for regular updates, unless it was prepared with the update list
+                if (gc_relax_iteration > 0 || !gc_next_graph_ready) {
+                    rtNodeGraph = _nodeGraph->getRTNodeDepGraph(gc_update_list.begin(), gc_update_size);
+                }
+                gc_next_graph_ready = false;
+                
+                // Send regular UPDATE_Y messages to nodes in the run-time graph, in correct order
+                while (!rtNodeGraph->empty()) {
+                    OBNsim::Trace::Scope trace_wave("UPDATE_Y", "gc");     // One wave of UPDATE_Y, until all its ACKs are received
+                    
+                    if (!(success = gc_send_update_y())) {
+                        // Error, stop simulation
+                        break;
+                    }
+                    
+                    // Wait for ACKs while processing all events: returns true if there is an error (e.g. timeout)
+                    if (!gc_wait_for_ack()) {
+                        success = false;
+                        break;
+                    }
+                }
+                if (!success) {
                     break;
                 }
                 
-                // Wait for ACKs while processing all events: returns true if there is an error (e.g. timeout)
-                if (!gc_wait_for_ack()) {
-                    success = false;
+                std::lock_guard<std::mutex> lock(gc_waitfor_mutex);
+                if (!gc_relax_repeat) {
+                    break;
+                }
+                if (gc_relax_iteration >= relaxation_max_iterations) {
+                    if (relaxation_max_iterations > 0) {
+                        report_warning(0, "The time window at simulation time " + std::to_string(current_sim_time) +
+                                       " has not converged after " + std::to_string(relaxation_max_iterations) + " iterations.");
+                    }
                     break;
                 }
             }
@@ -145,22 +172,48 @@ void GCThread::GCThreadMain() {
         }
         
         // Send UPDATE_X to all nodes that are updated in this iteration
+        int64_t trace_x_start = OBNsim::Trace::enabled()?OBNsim::Trace::now():-1;
         if (!gc_send_update_x()) {
             // Error, stop simulation
             break;
         }
         
+        // While the nodes run their UPDATE_X, advance the schedules and prepare the next step, which do not depend on these ACKs
+        if (pipelined_steps) {
+            if (!microstep) {
+                for (auto i = 0; i < gc_update_size; ++i) {
+                    _nodes[gc_update_list[i].nodeID]->finishCurrentUpdate();
+                }
+            }
+            prepareNextUpdate();
+        }
+        
         // Wait for ACKs while processing all events: returns false if the simulation should stop (e.g. timeout)
         if (!gc_wait_for_ack()) {
             break;
         }
+        
+        if (trace_step_start >= 0) {
+            auto trace_end = OBNsim::Trace::now();
+            OBNsim::Trace::complete("UPDATE_X", "gc", trace_x_start, trace_end - trace_x_start);
+            OBNsim::Trace::complete(microstep?"microstep":"step", "gc", trace_step_start, trace_end - trace_step_start,
+                                    "\"t\":" + std::to_string(current_sim_time) + ",\"nodes\":" + std::to_string(gc_update_size) +
+                                    ",\"microstep\":" + std::to_string(gc_microstep));
+        }
 
         gc_timer_reset();   // Turn off the timer, just in case
         
         
-        // Update nodes in the update list to their next regular updates.
-        for (auto i = 0; i < gc_update_size; ++i) {
-            _nodes[gc_update_list[i].nodeID]->finishCurrentUpdate();
+        // Update nodes in the update list to their next regular updates; a micro-step does not consume any scheduled update.
+        if (!microstep && !pipelined_steps) {
+            for (auto i = 0; i < gc_update_size; ++i) {
+                _nodes[gc_update_list[i].nodeID]->finishCurrentUpdate();
+            }
+        }
+        
+        if (gc_metrics.steps) {
+            gc_metrics.steps->inc();
+            gc_metrics.node_updates->inc(gc_update_size);
         }
         
         
@@ -207,6 +260,11 @@ void GCThread::GCThreadMain() {
 
     }
     
+    // Collect the final states of the nodes before they are terminated
+    if (noCriticalError && collect_final_states) {
+        noCriticalError = gc_collect_final_states();
+    }
+    
     // The simulation is going to be terminated, send terminating messages to all nodes, unless there was a critical error
     if (noCriticalError) {
         noCriticalError = gc_send_to_all(current_sim_time, OBNSimMsg::SMN2N_MSGTYPE_SIM_TERM);
@@ -215,10 +273,60 @@ void GCThread::GCThreadMain() {
     // Signal simple threads, which are associated with this GC, to terminate
     simple_thread_terminate = true;
     
+    gc_metrics_unregister();
     gc_exec_state = GCSTATE_STOPPED;
 }
 
 
+/** Register the metrics of the GC, if the metrics server is running.
+ Counters and histograms are shared by successive simulations; the gauges read this object and are removed by gc_metrics_unregister().
+ */
+void GCThread::gc_metrics_register() {
+    if (!OBNsim::Metrics::enabled()) {
+        return;
+    }
+    
+    gc_metrics.steps = &OBNsim::Metrics::counter("obn_gc_steps_total", "", "Simulation steps (time instants) completed by the GC.");
+    gc_metrics.waves_y = &OBNsim::Metrics::counter("obn_gc_waves_total", "type=\"Y\"", "Update waves sent by the GC.");
+    gc_metrics.waves_x = &OBNsim::Metrics::counter("obn_gc_waves_total", "type=\"X\"");
+    gc_metrics.node_updates = &OBNsim::Metrics::counter("obn_gc_node_updates_total", "", "Node updates completed.");
+    gc_metrics.rescans = &OBNsim::Metrics::counter("obn_gc_step_rescans_total", "", "Steps prepared ahead which had to be computed again because of irregular updates.");
+    gc_metrics.ack_latency = &OBNsim::Metrics::histogram("obn_gc_ack_latency_seconds", "", "Time from sending an update message to a node to receiving its ACK.");
+    
+    OBNsim::Metrics::gauge("obn_gc_event_queue_depth", "", [this]() { return double(OBNEventQueue.size()); },
+                           "Number of node events waiting in the GC event queue.");
+    
+    // The step rate is computed over the interval between two reads of the metrics
+    struct RateState {
+        std::mutex mutex;
+        uint64_t steps = 0;
+        std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+    };
+    auto state = std::make_shared<RateState>();
+    auto steps = gc_metrics.steps;
+    state->steps = steps->value();
+    OBNsim::Metrics::gauge("obn_gc_steps_per_second", "", [state, steps]() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto now = std::chrono::steady_clock::now();
+        auto n = steps->value();
+        std::chrono::duration<double> dur = now - state->time;
+        double rate = (dur.count() > 0.0)?(double(n - state->steps) / dur.count()):0.0;
+        state->steps = n;
+        state->time = now;
+        return rate;
+    }, "Simulation steps per second since the previous read of the metrics.");
+}
+
+
+void GCThread::gc_metrics_unregister() {
+    if (gc_metrics.steps) {
+        OBNsim::Metrics::removeGauge("obn_gc_event_queue_depth");
+        OBNsim::Metrics::removeGauge("obn_gc_steps_per_second");
+    }
+    gc_metrics = GCMetrics();
+}
+
+
 /**
  Initialize the simulation before it can start, e.g. reset the clock, reset the node's state.
  
@@ -245,6 +353,12 @@ bool GCThread::initialize() {
         return false;
     }
     
+    // Check initial time
+    if (initial_sim_time > final_sim_time) {
+        report_error(0, "The initial simulation time (" + std::to_string(initial_sim_time) + ") is after the final simulation time (" + std::to_string(final_sim_time) + ").");
+        return false;
+    }
+    
     // Check that _nodeGraph is set, but doesn't check if the graph is valid
     if (!_nodeGraph) {
         report_error(0, "Internal error: There is no node dependency graph.");
@@ -253,7 +367,7 @@ bool GCThread::initialize() {
     
     // Initialize all the nodes
     for (auto it = _nodes.begin(); it != _nodes.end(); ++it) {
-        if (!(*it)->initialize()) {
+        if (!(*it)->initialize(initial_sim_time)) {
             return false;
         }
     }
@@ -263,9 +377,13 @@ bool GCThread::initialize() {
     
     resetSysRequest();
     
-    // Start the simulation clock at < 0 to ensure that the next update will be at t=0,
+    // Start the simulation clock before the initial time to ensure that the next update can be at the initial time,
     // otherwise it will be an error (no progress).
-    current_sim_time = -1;
+    current_sim_time = initial_sim_time - 1;
+    
+    // Reset the final states
+    final_states.assign(_nodes.size(), std::string());
+    final_states_valid.assign(_nodes.size(), false);
     
     // Reset the wait-for mechanism
     {
@@ -281,26 +399,88 @@ bool GCThread::initialize() {
     // Pre-allocate the update info list
     gc_update_list.resize(_nodes.size());
     gc_update_size = 0;
+    gc_next_update_list.resize(_nodes.size());
+    gc_next_update_size = 0;
+    gc_next_update_time = -1;
+    gc_next_prepared = false;
+    gc_next_graph_ready = false;
+    gc_next_changed_nodes.clear();
+    
+    // No micro-steps requested
+    gc_microstep = 0;
+    gc_microstep_masks.assign(_nodes.size(), 0);
+    gc_microstep_pending.assign(_nodes.size(), false);
+    gc_microstep_nodes.clear();
     
     return true;
 }
 
 
 /** This method starts a new update iteration of the GC algorithm by
- - Calculate the next update time and the list of update details.
+ - Calculate the next update time and the list of update details, or take them from the next step prepared during the previous step.
  - Determine if the simulation will continue at that next update time.
  - Update the current simulation time.
  
  \return true if the simulation can continue
  */
 bool GCThread::startNextUpdate() {
-    // All nodes should have already updated their next update times
+    // The prepared step is still valid unless a node has requested, since it was prepared, an irregular update at or before its time
+    bool valid = gc_next_prepared;
+    for (auto id: gc_next_changed_nodes) {
+        if (!valid) {
+            break;
+        }
+        simtime_t t_node = _nodes[id]->getNextUpdate();
+        if (t_node >= 0 && (t_node <= gc_next_update_time || gc_next_update_time < 0)) {
+            valid = false;
+        }
+    }
+    if (gc_next_prepared && !valid && gc_metrics.rescans) {
+        gc_metrics.rescans->inc();
+    }
+    gc_next_prepared = false;
+    gc_next_changed_nodes.clear();
+    
+    if (!valid) {
+        // All nodes should have already updated their next update times
+        scanNextUpdate();
+        gc_next_graph_ready = false;
+    }
+    
+    simtime_t t = gc_next_update_time;
+    
+    // Continue if and only if not exceeding end time and there is progress (i.e. there is a next update time)
+    if (gc_next_update_size == 0 || t <= current_sim_time) {
+        report_error(0, "There is no progress (no next update time) after simulation time " + std::to_string(current_sim_time));
+        return false;
+    }
+    if (t > final_sim_time) {
+        report_info(0, "Reached final simulation time; stop now.");
+        return false;
+    }
+    
+    // The next update list becomes the current one
+    std::swap(gc_update_list, gc_next_update_list);
+    gc_update_size = gc_next_update_size;
+    
+    // Update simulation time, and continue the simulation
+    current_sim_time = t;
+    gc_microstep = 0;
+    
+    return true;
+}
+
+
+/** This method calculates the next update time (gc_next_update_time) and fills in the next update list (gc_next_update_list), including the triggered blocks.
+ The current update list and the simulation time are not changed.
+ */
+void GCThread::scanNextUpdate() {
     simtime_t t = -1;
     simtime_t t_node;
     
     // Reset the update info list
-    gc_update_size = 0;
-    auto updateIt = gc_update_list.begin();
+    gc_next_update_size = 0;
+    auto updateIt = gc_next_update_list.begin();
     
     // Iterate the node list and find the next update time, while filling in the update info list
     int nodeID = 0;
@@ -311,42 +491,102 @@ bool GCThread::startNextUpdate() {
         if (t_node >= 0) {
             if (t_node == t) {
                 // Add the node to the list
-                gc_update_size++;  // increase total nodes
+                gc_next_update_size++;  // increase total nodes
                 
                 (updateIt++)->nodeID = nodeID;
             }
             else if ((t_node < t) || (t < 0)) {
                 // Found earlier update (or first one), reset everything and add node
                 t = t_node;
-                gc_update_size = 1;
+                gc_next_update_size = 1;
                 
-                //*(gc_update_list.begin()) = *updateIt;  // copy record to first
-                updateIt = gc_update_list.begin();      // reset pointer
+                updateIt = gc_next_update_list.begin();      // reset pointer
                 (updateIt++)->nodeID = nodeID;
             }
         }
         nodeID++;
     }
+    gc_next_update_time = t;
     
-    // Continue if and only if not exceeding end time and there is progress (i.e. there is a next update time)
-    if (gc_update_size == 0 || t <= current_sim_time) {
-        report_error(0, "There is no progress (no next update time) after simulation time " + std::to_string(current_sim_time));
-        return false;
+    // Now that the list of updating nodes is determined, we populate the update type masks of these nodes into the list.
+    updateIt = gc_next_update_list.begin();
+    for (auto k = 0; k < gc_next_update_size; ++k, ++updateIt) {
+        updateIt->updateMask = _nodes[updateIt->nodeID]->getNextUpdateMask();
     }
-    if (t > final_sim_time) {
-        report_info(0, "Reached final simulation time; stop now.");
-        return false;
+    
+    // Add the triggered blocks
+    addTriggeredUpdates(gc_next_update_list, gc_next_update_size);
+}
+
+
+/** This method prepares the next step while the nodes run the UPDATE_X of the current step (see pipelined_steps): the next update list,
+ and its run-time graph if the step will be run, which is possible because the run-time graph of the current step is no longer used.
+ Irregular updates accepted afterwards are recorded in gc_next_changed_nodes, so that startNextUpdate() can check the prepared step.
+ */
+void GCThread::prepareNextUpdate() {
+    scanNextUpdate();
+    gc_next_prepared = true;
+    gc_next_changed_nodes.clear();
+    
+    gc_next_graph_ready = gc_next_update_size > 0 && gc_next_update_time > current_sim_time && gc_next_update_time <= final_sim_time;
+    if (gc_next_graph_ready) {
+        rtNodeGraph = _nodeGraph->getRTNodeDepGraph(gc_next_update_list.begin(), gc_next_update_size);
+    }
+}
+
+
+/** This method starts a micro-step at the current simulation time: the updating nodes and their masks are those requested for the micro-step (plus the triggered blocks).
+ The schedule of the nodes is not scanned, and the requests are cleared.
+ */
+void GCThread::startNextMicroStep() {
+    assert(!gc_microstep_nodes.empty());
+    
+    ++gc_microstep;
+    
+    gc_update_size = 0;
+    auto updateIt = gc_update_list.begin();
+    for (auto id: gc_microstep_nodes) {
+        *(updateIt++) = {id, gc_microstep_masks[id]};
+        ++gc_update_size;
+        gc_microstep_masks[id] = 0;
+        gc_microstep_pending[id] = false;
     }
+    gc_microstep_nodes.clear();
     
-    // Now that the list of updating nodes is determined, we populate the update type masks of these nodes into the list.
-    // We also check if triggers are added and build a list of triggers.
+    addTriggeredUpdates(gc_update_list, gc_update_size);
+    
+    // The micro-step builds its own run-time graph
+    gc_next_graph_ready = false;
+}
+
+
+/** Accept a request of a node for the next micro-step, merging it with its previous requests for the same micro-step.
+ \return false if the request is rejected because micro-steps are disabled or the maximum number of micro-steps has been reached.
+ */
+bool GCThread::gc_request_microstep(int id, updatemask_t mask) {
+    if (gc_microstep >= microstep_max_iterations) {
+        return false;
+    }
+    if (!gc_microstep_pending[id]) {
+        gc_microstep_pending[id] = true;
+        gc_microstep_nodes.push_back(id);
+    }
+    gc_microstep_masks[id] |= mask;
+    return true;
+}
+
+
+/** This method adds the blocks triggered by the updates in a list (gc_update_list or gc_next_update_list), whose masks must have been set, to the list, until no new triggers are added.
+ \param list The update list.
+ \param size The number of updates in the list, which is increased by the added nodes.
+ */
+void GCThread::addTriggeredUpdates(NodeUpdateInfoList& list, size_t& size) {
+    // Build the list of triggers of the current updates.
     OBNsmn::OBNNode::TriggerListType trigger_list;
     
-    updateIt = gc_update_list.begin();
-    for (auto k = 0; k < gc_update_size; ++k, ++updateIt) {
-        auto curMask = _nodes[updateIt->nodeID]->getNextUpdateMask();
-        updateIt->updateMask = curMask;
-        _nodes[updateIt->nodeID]->triggerBlocks(curMask, trigger_list);
+    auto updateIt = list.begin();
+    for (auto k = 0; k < size; ++k, ++updateIt) {
+        _nodes[updateIt->nodeID]->triggerBlocks(updateIt->updateMask, trigger_list);
     }
     
     // Update the list of updating nodes with active triggers -> loop until no new triggers are added
@@ -357,8 +597,8 @@ bool GCThread::startNextUpdate() {
             listAdjusted = false;
             
             // Loop through the updating list and adjust the current nodes with triggered blocks
-            updateIt = gc_update_list.begin();
-            for (auto k = 0; k < gc_update_size; ++k, ++updateIt) {
+            updateIt = list.begin();
+            for (auto k = 0; k < size; ++k, ++updateIt) {
                 auto trgIt = trigger_list.find(updateIt->nodeID);
                 if (trgIt != trigger_list.end()) {
                     // New blocks of the node may be triggered -> adjust its mask
@@ -374,12 +614,12 @@ bool GCThread::startNextUpdate() {
                 }
             }
         }
-        // At this point, updateIt points to just beyond the current end of gc_update_list
+        // At this point, updateIt points to just beyond the current end of the list
         
         // Remaining nodes in trigger_list are not in updating list -> add them
         auto beginUpdateIt = updateIt;
         for (auto&& trg: trigger_list) {
-            gc_update_size++;
+            size++;
             *(updateIt++) = {trg.first, trg.second};
         }
         auto endUpdateIt = updateIt;
@@ -391,11 +631,6 @@ bool GCThread::startNextUpdate() {
             _nodes[updateIt->nodeID]->triggerBlocks(updateIt->updateMask, trigger_list);
         }
     }
-    
-    // Update simulation time, and continue the simulation
-    current_sim_time = t;
-    
-    return true;
 }
 
 /**
@@ -642,12 +877,25 @@ bool GCThread::gc_send_update_y() {
     OBNSimMsg::SMN2N msg;
     msg.set_msgtype(OBNSimMsg::SMN2N_MSGTYPE_SIM_Y);
     msg.set_time(current_sim_time);
+    if (gc_relax_iteration > 0) {
+        // Repetition of the time window (waveform relaxation)
+        msg.mutable_data()->set_i(gc_relax_iteration);
+    }
+    if (gc_microstep > 0) {
+        // Micro-step at the current time (superdense time)
+        msg.mutable_data()->set_t(gc_microstep);
+    }
     
     // Set up wait-for now because otherwise, for large number of nodes, ACK messages may start coming in soon and not registered.
     if (!gc_waitfor_start(updateList, OBNSimMsg::N2SMN::SIM_Y_ACK)) {
         return false;
     }
     
+    if (gc_metrics.waves_y) {
+        gc_metrics.waves_y->inc();
+        gc_metrics_wave_start = OBNsim::Trace::now();
+    }
+    
     for (const auto & node: updateList) {
         // Each node is a pair (node-ID, updatemask)
         int thisNodeID = node.first;
@@ -657,6 +905,10 @@ bool GCThread::gc_send_update_y() {
         msg.set_i(node.second); // Set the update mask specified in the update list
 
         _nodes[thisNodeID]->sendMessage(thisNodeID, msg);
+        
+        if (OBNsim::Trace::enabled()) {
+            OBNsim::Trace::instant("SIM_Y", "gc", "\"node\":\"" + _nodes[thisNodeID]->name + "\",\"mask\":" + std::to_string(node.second));
+        }
     }
     
     // Set up timeout if necessary
@@ -791,10 +1043,19 @@ bool GCThread::gc_send_update_x() {
         return true;
     }
     
+    if (gc_metrics.waves_x) {
+        gc_metrics.waves_x->inc();
+        gc_metrics_wave_start = OBNsim::Trace::now();
+    }
+    
     // Send the UPDATE_X messages to all nodes in gc_update_list
     OBNSimMsg::SMN2N msg;
     msg.set_msgtype(OBNSimMsg::SMN2N_MSGTYPE_SIM_X);
     msg.set_time(current_sim_time);
+    if (gc_microstep > 0) {
+        // Micro-step at the current time (superdense time)
+        msg.mutable_data()->set_t(gc_microstep);
+    }
 
     for (size_t k = 0; k < gc_update_size; ++k) {
         auto ID = gc_update_list[k].nodeID;
@@ -805,6 +1066,10 @@ bool GCThread::gc_send_update_x() {
 
             msg.set_i(gc_update_list[k].updateMask);    // Set the update mask specified in the update list
             _nodes[ID]->sendMessage(ID, msg);
+            
+            if (OBNsim::Trace::enabled()) {
+                OBNsim::Trace::instant("SIM_X", "gc", "\"node\":\"" + _nodes[ID]->name + "\"");
+            }
         }
     }
     
@@ -857,6 +1122,83 @@ bool GCThread::gc_send_to_all(simtime_t t, OBNSimMsg::SMN2N::MSGTYPE msgtype, in
 }
 
 
+/** Sends the SIM_INIT message to all nodes at the initial simulation time and starts wait-for event for their ACKs, checking for initialization errors.
+ The message carries the initial wall-clock time and the simulation time unit, and the initial state of the node if it has one.
+ It also resets the timer.
+ \return true if successful; false if not (error)
+ */
+bool GCThread::gc_send_init() {
+    if (!gc_waitfor_start_all(OBNSimMsg::N2SMN_MSGTYPE_SIM_INIT_ACK,
+                              [this](const OBNSimMsg::N2SMN& msg) {
+                                  if (!msg.has_id()) {
+                                      return false;
+                                  }
+                                  if (msg.has_data() && msg.data().has_i() && msg.data().i() != 0) {
+                                      report_error(0, "Node \"" + _nodes[msg.id()]->name + "\" had initialization error #" + std::to_string(msg.data().i()));
+                                      return false;
+                                  }
+                                  return true;
+                              })) {
+        report_error(0, "Internal error: wait-for event is active before sending SIM_INIT messages to all nodes.");
+        return false;
+    }
+    
+    OBNSimMsg::SMN2N msg;
+    msg.set_msgtype(OBNSimMsg::SMN2N_MSGTYPE_SIM_INIT);
+    msg.set_time(initial_sim_time);
+    msg.set_i(sim_time_unit);   // simulation time unit, in microseconds
+    
+    OBNSimMsg::MSGDATA *pMsgData = msg.mutable_data();
+    pMsgData->set_t(initial_wallclock); // initial wallclock time
+    
+    for (int k = 0; k <= maxID; ++k) {
+        if (k < static_cast<int>(initial_states.size()) && !initial_states[k].empty()) {
+            pMsgData->set_b(initial_states[k]);
+        } else {
+            pMsgData->clear_b();
+        }
+        
+        if (!_nodes[k]->sendMessage(k, msg)) {
+            report_error(0, "Error while sending message (" + std::to_string(OBNSimMsg::SMN2N_MSGTYPE_SIM_INIT) +
+                         ") to node #" + std::to_string(k) +
+                         " (" + _nodes[k]->name + ").");
+            return false;
+        }
+    }
+    
+    // Set up timeout if necessary
+    gc_timer_reset();
+    if (ack_timeout > 0) {
+        gc_timer_start(ack_timeout);
+    }
+    
+    return true;
+}
+
+
+/** Requests the states of all nodes at the end of the simulation (SIM_STATE) and waits for them.
+ The states are saved in final_states; a node which can't give its state is reported as a warning.
+ \return true if successful; false if there is a critical error.
+ */
+bool GCThread::gc_collect_final_states() {
+    bool success = gc_send_to_all(current_sim_time, OBNSimMsg::SMN2N_MSGTYPE_SIM_STATE, OBNSimMsg::N2SMN_MSGTYPE_SIM_STATE_ACK, nullptr, nullptr,
+                                  [this](const OBNSimMsg::N2SMN& msg) {
+                                      if (!msg.has_id()) {
+                                          return false;
+                                      }
+                                      if (msg.has_data() && msg.data().has_b() && !(msg.data().has_i() && msg.data().i() != 0)) {
+                                          final_states[msg.id()] = msg.data().b();
+                                          final_states_valid[msg.id()] = true;
+                                      } else {
+                                          report_warning(0, "Node \"" + _nodes[msg.id()]->name + "\" can't give its final state.");
+                                      }
+                                      return true;
+                                  });
+    
+    return success && gc_wait_for_ack();
+}
+
+
 /** Sends a given simple message to all nodes and starts wait-for event (for all nodes).
  The message is simple with no custom data.
  It also resets the timer.
@@ -923,6 +1265,69 @@ std::pair<int, std::string> GCThread::request_port_connect(std::size_t idx, cons
     pData->set_b(target + source);
     msg.set_allocated_data(pData);
     
+    return request_node_system(idx, msg, OBNSimMsg::N2SMN_MSGTYPE_SYS_PORT_CONNECT_ACK, timeout);
+}
+
+
+/* Request an output port on a node to be published only at the multiples of a period. */
+std::pair<int, std::string> GCThread::request_port_decimation(std::size_t idx, const std::string& port, simtime_t period, unsigned int timeout) {
+    assert(!port.empty() && period >= 0);
+    
+    // Only run when the simulation is not running
+    if (gc_exec_state != GCSTATE_STOPPED) {
+        return std::make_pair(-15, "Port decimation can only be requested when the simulation is not running.");
+    }
+    
+    if (idx >= _nodes.size()) {
+        return std::make_pair(-10, std::string());
+    }
+    
+    // Prepare the request message
+    OBNSimMsg::SMN2N msg;
+    msg.set_time(current_sim_time);
+    msg.set_msgtype(OBNSimMsg::SMN2N_MSGTYPE_SYS_PORT_DECIMATE);
+    
+    OBNSimMsg::MSGDATA* pData = new OBNSimMsg::MSGDATA();
+    pData->set_t(period);
+    pData->set_b(port);
+    msg.set_allocated_data(pData);
+    
+    return request_node_system(idx, msg, OBNSimMsg::N2SMN_MSGTYPE_SYS_PORT_DECIMATE_ACK, timeout);
+}
+
+
+/* Request an output port on a node to send its values with a given precision. */
+std::pair<int, std::string> GCThread::request_port_precision(std::size_t idx, const std::string& port, int mode, double scale, double max_abs_error, double max_rel_error, unsigned int timeout) {
+    assert(!port.empty());
+    
+    // Only run when the simulation is not running
+    if (gc_exec_state != GCSTATE_STOPPED) {
+        return std::make_pair(-15, "Port precision can only be requested when the simulation is not running.");
+    }
+    
+    if (idx >= _nodes.size()) {
+        return std::make_pair(-10, std::string());
+    }
+    
+    // Prepare the request message
+    OBNSimMsg::SMN2N msg;
+    msg.set_time(current_sim_time);
+    msg.set_msgtype(OBNSimMsg::SMN2N_MSGTYPE_SYS_PORT_PRECISION);
+    
+    OBNSimMsg::MSGDATA* pData = new OBNSimMsg::MSGDATA();
+    pData->set_i(mode);
+    pData->set_b(port);
+    pData->add_d(scale);
+    pData->add_d(max_abs_error);
+    pData->add_d(max_rel_error);
+    msg.set_allocated_data(pData);
+    
+    return request_node_system(idx, msg, OBNSimMsg::N2SMN_MSGTYPE_SYS_PORT_PRECISION_ACK, timeout);
+}
+
+
+/* Send a system request to a node, then wait for the next incoming message, which must be its ACK. */
+std::pair<int, std::string> GCThread::request_node_system(std::size_t idx, OBNSimMsg::SMN2N& msg, OBNSimMsg::N2SMN::MSGTYPE ack_type, unsigned int timeout) {
     if (!_nodes[idx]->sendMessage(idx, msg)) {
         // Communication error
         return std::make_pair(-11, std::string());
@@ -948,7 +1353,7 @@ std::pair<int, std::string> GCThread::request_port_connect(std::size_t idx, cons
     // Process the event
     if (ev) {
         if (ev->category == SMNNodeEvent::EVT_SYS &&
-            ev->type == OBNSimMsg::N2SMN_MSGTYPE_SYS_PORT_CONNECT_ACK &&
+            ev->type == ack_type &&
             ev->has_id && ev->nodeID == idx)
         {
             // Get the result
@@ -0,0 +1,450 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Implement the conservative (decoupled) mode of the Global clock.
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#include <algorithm>
+#include <obnsmn_gc.h>
+#include <obnsmn_report.h>
+
+
+/** \file
+ # Conservative mode
+
+ In the normal (lockstep) mode, the GC steps all nodes together: all updates at time t must be finished before any update at the next time instant can start.
+ Nodes which are not connected, or whose connections have enough slack, therefore wait for each other at every time step.
+
+ In the conservative mode, which follows the conservative (Chandy-Misra-Bryant) approach of parallel discrete event simulation, each node has its own clock and is advanced as soon as it is safe to do so.
+ The output of a node only changes at its updates, so the lookahead of a connection from node s is given by the next update time of s, which the GC knows from the update periods and the requested irregular updates of s.
+ A node is safe to start its update at time t when:
+
+ - all nodes on which its outputs depend directly (the feedthrough links in the dependency graph) have finished their UPDATE_Y at all times <= t, i.e. their values at t are final; and
+ - all nodes receiving its outputs have finished reading their inputs (UPDATE_X) at all times < t, so that a newer value doesn't overwrite an older one which is still needed.
+
+ After its UPDATE_Y, a node gets its UPDATE_X only when all its sources, with or without feedthrough, have final values at its time.
+ The GC is only involved in dispatching the updates, processing the irregular update requests and terminating the simulation; the values are still exchanged directly between the nodes.
+
+ An irregular update request from a node is accepted only if it is later than the current (or last) update of the node, of all the nodes receiving its outputs, because these may have already used its outputs up to their current times,
+ and of all its sources, because these may have already overwritten their outputs at the requested time with newer values (they were allowed to advance up to the node's next update).
+
+ This mode is used only if:
+
+ - there are no triggers, because a triggered update can't be predicted;
+ - the waveform relaxation coupling is disabled, because it repeats time instants; and
+ - the dependency graph between different nodes is acyclic, so that the updates at the same time instant can be ordered node by node.
+ The dependencies between the update types of the same node are kept by splitting its UPDATE_Y into waves, exactly as in the lockstep mode.
+ Otherwise the GC falls back to the lockstep mode.
+
+ The ACKs of UPDATE_Y and UPDATE_X are pushed to the event queue by the communication threads, rather than processed by the wait-for mechanism.
+ */
+
+
+using namespace OBNsmn;
+using namespace std;
+
+
+/** Check if the system can be simulated in the conservative mode, and if so, prepare the states of the nodes.
+ \return true if the conservative mode will be used.
+ */
+bool GCThread::gc_cmb_prepare() {
+    if (!conservative_mode) {
+        return false;
+    }
+
+    // The time instants can't be repeated by the waveform relaxation coupling
+    if (relaxation_max_iterations > 0) {
+        report_warning(0, "The conservative mode does not support the waveform relaxation coupling; the simulation runs in the lockstep mode.");
+        return false;
+    }
+    
+    // Triggers can't be predicted, so they are not supported
+    for (const auto& node: _nodes) {
+        if (node->has_trigger_list) {
+            report_warning(0, "The conservative mode does not support triggers; the simulation runs in the lockstep mode.");
+            return false;
+        }
+    }
+
+    cmb_nodes.clear();
+    cmb_nodes.resize(_nodes.size());
+
+    // Build the lists of sources, feedthrough sources and consumers of the nodes
+    auto connections(cmb_connections);
+    auto dependencies(_nodeGraph->getNodeDependencies());
+    connections.insert(connections.end(), dependencies.begin(), dependencies.end());  // a dependency implies a connection
+    std::sort(connections.begin(), connections.end());
+    connections.erase(std::unique(connections.begin(), connections.end()), connections.end());
+
+    for (const auto& conn: connections) {
+        cmb_nodes[conn.second].sources.push_back(conn.first);
+        cmb_nodes[conn.first].consumers.push_back(conn.second);
+    }
+
+    // Check that the dependencies between the nodes are acyclic (Kahn's algorithm)
+    std::vector<int> indegree(_nodes.size(), 0);
+    for (const auto& dep: dependencies) {
+        cmb_nodes[dep.second].feedthrough.push_back(dep.first);
+        ++indegree[dep.second];
+    }
+
+    std::vector<int> independent;
+    for (int id = 0; id <= maxID; ++id) {
+        if (indegree[id] == 0) {
+            independent.push_back(id);
+        }
+    }
+    int nSorted = 0;
+    while (!independent.empty()) {
+        int id = independent.back();
+        independent.pop_back();
+        ++nSorted;
+        for (const auto& dep: dependencies) {
+            if (dep.first == id && --indegree[dep.second] == 0) {
+                independent.push_back(dep.second);
+            }
+        }
+    }
+    if (nSorted <= maxID) {
+        report_warning(0, "The dependency graph between nodes has a cycle, which is not supported by the conservative mode; the simulation runs in the lockstep mode.");
+        return false;
+    }
+
+    // All nodes start idle
+    for (int id = 0; id <= maxID; ++id) {
+        auto& n = cmb_nodes[id];
+        n.phase = CMBNodeState::IDLE;
+        n.time = -1;
+        n.mask = 0;
+        n.sent = 0;
+        n.waves = nullptr;
+        n.wave = 0;
+        gc_cmb_read_next_update(id);
+    }
+    cmb_busy = 0;
+
+    return true;
+}
+
+
+/** Run the simulation in the conservative mode until it reaches the final time, or it is stopped.
+ While running, the ACKs of UPDATE_Y and UPDATE_X are pushed to the event queue (cmb_running is true).
+ \return false if the simulation was stopped because of an error.
+ */
+bool GCThread::gc_cmb_main() {
+    OBNEventQueueType::item_type ev;    // To receive the node event
+    OBNSysRequestType sysreq;  // To receive the system request
+
+    simtime_t step_limit = -1;  // When paused, updates up to this time can still be started (by SYSREQ_STEP)
+    bool success = true;
+
+    report_info(0, "Running the simulation in the conservative mode.");
+
+    {
+        // The wait-for mechanism is not used in this mode
+        std::lock_guard<std::mutex> lock(gc_waitfor_mutex);
+        gc_waitfor_status = GC_WAITFOR_RESULT_NONE;
+    }
+    cmb_running = true;
+
+    while (true) {
+        // Start all updates that are safe now
+        if (gc_exec_state == GCSTATE_RUNNING || gc_exec_state == GCSTATE_PAUSED) {
+            if (!gc_cmb_dispatch((gc_exec_state == GCSTATE_RUNNING)?final_sim_time:std::min(step_limit, final_sim_time))) {
+                success = false;
+                break;
+            }
+        }
+
+        auto t = gc_cmb_global_time();
+        if (t >= 0) {
+            if (gc_metrics.steps && t > current_sim_time) {
+                gc_metrics.steps->inc();    // The global time has advanced to a new time instant
+            }
+            current_sim_time = t;
+        }
+
+        if (cmb_busy == 0) {
+            gc_timer_reset();
+
+            if (gc_exec_state == GCSTATE_TERMINATING) {
+                break;
+            }
+            if (gc_exec_state == GCSTATE_RUNNING) {
+                // Nothing is running and nothing can be started: all updates are beyond the final time
+                if (t >= 0) {
+                    // This should not happen because the dependencies are acyclic
+                    report_error(0, "No update can be started in the conservative mode at simulation time " + std::to_string(t));
+                    success = false;
+                } else {
+                    report_info(0, "Reached final simulation time; stop now.");
+                }
+                break;
+            }
+        }
+
+        if (!gc_wait_for_next_event(ev, sysreq)) {
+            report_error(0, "Timeout while waiting for ACKs at simulation time " + std::to_string(current_sim_time));
+            success = false;
+            break;
+        }
+
+        // Process some urgent system request
+        if (sysreq == SYSREQ_TERMINATE) {
+            // stop the simulation immediately
+            break;
+        }
+
+        // Process the node event
+        if (ev) {
+            if (ev->category == OBNsmn::SMNNodeEvent::EVT_ACK) {
+                if (!gc_cmb_process_ack(ev.get())) {
+                    success = false;
+                    break;
+                }
+            } else if (!gc_process_node_events(ev.get())) {
+                break;
+            }
+        }
+
+        // Process the system request
+        if (sysreq != SYSREQ_NONE) {
+            gc_process_sysreq(sysreq);
+            if (sysreq == SYSREQ_STEP) {
+                // Run all updates at the next time instant
+                step_limit = gc_cmb_global_time();
+            }
+            resetSysRequest();
+        }
+    }
+
+    cmb_running = false;
+    return success;
+}
+
+
+/** Start every update at a time <= limit that is safe, and UPDATE_X of every node whose inputs have become final.
+ Starting an update never makes another update safe, so one pass is enough.
+ \return false if there is an error.
+ */
+bool GCThread::gc_cmb_dispatch(simtime_t limit) {
+    for (int id = 0; id <= maxID; ++id) {
+        auto& n = cmb_nodes[id];
+
+        if (n.phase == CMBNodeState::IDLE) {
+            if (n.next < 0 || n.next > limit) {
+                continue;
+            }
+
+            auto t = n.next;
+            bool safe = std::all_of(n.feedthrough.begin(), n.feedthrough.end(),
+                                    [this,t](int s) { return gc_cmb_outputs_final(s, t); }) &&
+                        std::all_of(n.consumers.begin(), n.consumers.end(),
+                                    [this,t](int c) { return gc_cmb_inputs_read(c, t); });
+            if (safe && !gc_cmb_start_update(id)) {
+                return false;
+            }
+        }
+        else if (n.phase == CMBNodeState::WAIT_X) {
+            auto t = n.time;
+            if (std::all_of(n.sources.begin(), n.sources.end(),
+                            [this,t](int s) { return gc_cmb_outputs_final(s, t); }))
+            {
+                n.phase = CMBNodeState::UPDATE_X;
+                if (!gc_cmb_send(id, OBNSimMsg::SMN2N_MSGTYPE_SIM_X, n.mask)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/** Start the next update of an idle node: split it into UPDATE_Y waves and send the first one.
+ \return false if there is an error.
+ */
+bool GCThread::gc_cmb_start_update(int id) {
+    auto& n = cmb_nodes[id];
+    assert(n.phase == CMBNodeState::IDLE && n.next >= 0);
+
+    n.time = n.next;
+    n.mask = _nodes[id]->getNextUpdateMask();
+
+    // The waves only depend on the update mask, so they are computed once for each mask
+    auto it = n.wave_cache.find(n.mask);
+    if (it == n.wave_cache.end()) {
+        std::vector<updatemask_t> waves;
+        NodeUpdateInfoList thisUpdate(1, NodeUpdateInfo{id, n.mask});
+        auto *rtGraph = _nodeGraph->getRTNodeDepGraph(thisUpdate.begin(), 1);
+        while (!rtGraph->empty()) {
+            const auto & updateList = rtGraph->getAndRemoveIndependentNodes();
+            if (updateList.empty()) {
+                report_error(0, "An algebraic loop (dependency cycle) occurs in node " + _nodes[id]->name +
+                             " at time " + std::to_string(n.time));
+                return false;
+            }
+            waves.push_back(updateList.front().second);
+        }
+        it = n.wave_cache.emplace(n.mask, std::move(waves)).first;
+    }
+
+    n.waves = &(it->second);
+    n.wave = 0;
+    n.phase = CMBNodeState::UPDATE_Y;
+    ++cmb_busy;
+
+    return gc_cmb_send(id, OBNSimMsg::SMN2N_MSGTYPE_SIM_Y, n.waves->front());
+}
+
+
+/** Finish the current update of a node, calculate its next update and make it idle. */
+void GCThread::gc_cmb_finish_update(int id) {
+    _nodes[id]->finishCurrentUpdate();
+    cmb_nodes[id].phase = CMBNodeState::IDLE;
+    gc_cmb_read_next_update(id);
+    --cmb_busy;
+    
+    if (gc_metrics.node_updates) {
+        gc_metrics.node_updates->inc();
+    }
+}
+
+
+/** Process an ACK of UPDATE_Y or UPDATE_X: send the next wave, wait for UPDATE_X, or finish the update.
+ \return false if there is an error.
+ */
+bool GCThread::gc_cmb_process_ack(const OBNsmn::SMNNodeEvent* pEv) {
+    auto id = pEv->nodeID;
+    auto& n = cmb_nodes[id];
+
+    if (OBNsim::Trace::enabled()) {
+        OBNsim::Trace::instant("ACK", "gc", "\"node\":\"" + _nodes[id]->name + "\",\"type\":" + std::to_string(pEv->type));
+    }
+    if (gc_metrics.ack_latency) {
+        gc_metrics.ack_latency->observe(OBNsim::Trace::now() - n.sent);
+    }
+
+    if (pEv->type == OBNSimMsg::N2SMN::SIM_Y_ACK && n.phase == CMBNodeState::UPDATE_Y) {
+        if (++n.wave < n.waves->size()) {
+            return gc_cmb_send(id, OBNSimMsg::SMN2N_MSGTYPE_SIM_Y, (*n.waves)[n.wave]);
+        }
+        if (_nodes[id]->needUPDATEX) {
+            n.phase = CMBNodeState::WAIT_X;
+        } else {
+            gc_cmb_finish_update(id);
+        }
+    }
+    else if (pEv->type == OBNSimMsg::N2SMN::SIM_X_ACK && n.phase == CMBNodeState::UPDATE_X) {
+        gc_cmb_finish_update(id);
+    }
+    else {
+        report_warning(0, "Unexpected ACK received from node " + std::to_string(id) + " with type " + std::to_string(pEv->type));
+        return true;
+    }
+
+    // Restart the timeout while some nodes are still updating
+    if (ack_timeout > 0 && cmb_busy > 0) {
+        gc_timer_start(ack_timeout);
+    }
+    return true;
+}
+
+
+/** Read the next update time of an idle node from its regular and irregular updates. */
+void GCThread::gc_cmb_read_next_update(int id) {
+    auto t = _nodes[id]->getNextUpdate();
+    cmb_nodes[id].next = (t > final_sim_time)?-1:t;
+}
+
+
+/** The outputs of a node at time t are final if it has done its UPDATE_Y at t (if any), and has no update before t which hasn't been done.
+ For an idle node, this is guaranteed by its next update time, which is the lookahead of its outputs.
+ */
+bool GCThread::gc_cmb_outputs_final(int id, simtime_t t) const {
+    const auto& n = cmb_nodes[id];
+    switch (n.phase) {
+        case CMBNodeState::IDLE:
+            return n.next < 0 || n.next > t;
+        case CMBNodeState::UPDATE_Y:
+            return n.time > t;
+        default:
+            // Its next update, which will be > n.time, is not known yet
+            return n.time >= t;
+    }
+}
+
+
+/** A node has read its inputs at all times < t if its current or next update is not earlier than t. */
+bool GCThread::gc_cmb_inputs_read(int id, simtime_t t) const {
+    const auto& n = cmb_nodes[id];
+    if (n.phase == CMBNodeState::IDLE) {
+        return n.next < 0 || n.next >= t;
+    }
+    return n.time >= t;
+}
+
+
+/** An irregular update at time t of a node is accepted if t is later than the current (or last) update of the node, of all the nodes receiving its outputs, which may have used its outputs up to their times,
+ and of all its sources, which may have already sent newer values than those at t.
+ */
+bool GCThread::gc_cmb_accept_irregular(int id, simtime_t t) const {
+    const auto& n = cmb_nodes[id];
+    if (t <= n.time) {
+        return false;
+    }
+    auto earlier = [this,t](int other) { return cmb_nodes[other].time < t; };
+    return std::all_of(n.consumers.begin(), n.consumers.end(), earlier) && std::all_of(n.sources.begin(), n.sources.end(), earlier);
+}
+
+
+/** The global simulation time in the conservative mode is the earliest current or pending update of all nodes.
+ \return The global time, or -1 if no node is updating and there is no more update.
+ */
+simtime_t GCThread::gc_cmb_global_time() const {
+    simtime_t t = -1;
+    for (const auto& n: cmb_nodes) {
+        simtime_t tn = (n.phase == CMBNodeState::IDLE)?n.next:n.time;
+        if (tn >= 0 && (t < 0 || tn < t)) {
+            t = tn;
+        }
+    }
+    return t;
+}
+
+
+/** Send an UPDATE_Y or UPDATE_X message with the node's current time and the given mask, and restart the timeout.
+ \return true if successful.
+ */
+bool GCThread::gc_cmb_send(int id, OBNSimMsg::SMN2N::MSGTYPE type, updatemask_t mask) {
+    OBNSimMsg::SMN2N msg;
+    msg.set_msgtype(type);
+    msg.set_time(cmb_nodes[id].time);
+    msg.set_i(mask);
+
+    if (!_nodes[id]->sendMessage(id, msg)) {
+        report_error(0, "Error while sending message (" + std::to_string(type) + ") to node #" + std::to_string(id) +
+                     " (" + _nodes[id]->name + ").");
+        return false;
+    }
+
+    if (OBNsim::Trace::enabled()) {
+        OBNsim::Trace::instant((type == OBNSimMsg::SMN2N_MSGTYPE_SIM_Y)?"SIM_Y":"SIM_X", "gc",
+                               "\"node\":\"" + _nodes[id]->name + "\",\"mask\":" + std::to_string(mask) +
+                               ",\"t\":" + std::to_string(cmb_nodes[id].time));
+    }
+    if (gc_metrics.waves_y) {
+        ((type == OBNSimMsg::SMN2N_MSGTYPE_SIM_Y)?gc_metrics.waves_y:gc_metrics.waves_x)->inc();
+        cmb_nodes[id].sent = OBNsim::Trace::now();
+    }
+
+    if (ack_timeout > 0) {
+        gc_timer_start(ack_timeout);
+    }
+    return true;
+}
@@ -103,21 +103,31 @@ simtime_t OBNNode::getNextUpdate() {
 /**
  Initialize the node's state to (re)start a simulation.
  Mostly concern with resetting internal clocks and memory variables of the node.
+ The first update of each periodic output group is the first instant of its schedule (phase offset plus multiples of its period) at or after the start time,
+ so a simulation started from a later time (e.g. a time slice of a longer simulation) keeps the same schedule.
  
+ \param start The initial simulation time.
  \return True if successful.
  */
-bool OBNsmn::OBNNode::initialize() {
+bool OBNsmn::OBNNode::initialize(simtime_t start) {
     // std::cout << "Initialize node..." << std::endl;
     
     next_regupdate_mask = 0;
     next_regupdate_time = -1;  // initialized to -1, in case all update types are irregular
     
-    // Reset the next update time of all output groups, and collect the mask bits of all periodic groups
+    // Reset the next update time of all output groups to their phase offsets (moved forward to the start time), and collect the mask bits of the earliest periodic groups
     for (auto it = update_types.begin(); it != update_types.end(); ++it) {
-        it->next_update = 0;
+        it->next_update = it->offset;
         if (it->period > 0) {
-            next_regupdate_mask |= it->mask;
-            next_regupdate_time = 0;
+            if (it->next_update < start) {
+                it->next_update += ((start - it->next_update + it->period - 1) / it->period) * it->period;
+            }
+            if (it->next_update == next_regupdate_time) {
+                next_regupdate_mask |= it->mask;
+            } else if (it->next_update < next_regupdate_time || next_regupdate_time < 0) {
+                next_regupdate_mask = it->mask;
+                next_regupdate_time = it->next_update;
+            }
         }
     }
     
@@ -352,3 +352,23 @@ RTNodeDepGraph* NodeDepGraph_BGL::getRTNodeDepGraph(GCUpdateListIterator itnode,
     
     return this;
 }
+
+
+/** Return the list of dependencies (s, t) between different nodes, regardless of their update masks.
+ Because parallel links between two nodes are stored in a single edge, each pair appears only once.
+ */
+std::vector< std::pair<int, int> > NodeDepGraph_BGL::getNodeDependencies() const {
+    std::vector< std::pair<int, int> > result;
+    
+    GraphT::edge_iterator eit, eitend;
+    tie(eit, eitend) = edges(_graph);
+    
+    for (; eit != eitend; ++eit) {
+        auto s = static_cast<int>(source(*eit, _graph)), t = static_cast<int>(target(*eit, _graph));
+        if (s != t) {
+            result.emplace_back(s, t);
+        }
+    }
+    
+    return result;
+}
@@ -87,6 +87,11 @@ namespace SMNChai {
         bool dockerlist{false};     ///< Whether to generate node list for Docker
         std::string dockerlistfile; ///< File name to write the node list for Docker
         bool dryrun{false};         ///< Whether the user specifies dry-run option in the command-line
+        double start_time{-1.0};    ///< Initial simulation time in microseconds, overriding that of the script (< 0 if not given)
+        double stop_time{-1.0};     ///< The simulation stops before this time in microseconds, overriding the final time of the script (< 0 if not given)
+        std::string state_in;       ///< File of the initial states of the nodes (empty if not given)
+        std::string state_out;      ///< File to write the final states of the nodes to (empty if not given)
+        std::string workspace_suffix;   ///< Suffix appended to the workspace name
     };
     
     /** The function to load the Chaiscript simulation file.
@@ -33,6 +33,9 @@
 #endif
 
 #include <smnchai.h>
+#include <smnchai_launcher.h>
+#include <smnchai_perfmodel.h>
+#include <smnchai_parareal.h>
 
 namespace chaiscript {
     class ChaiScript;
@@ -79,6 +82,12 @@ namespace SMNChai {
         const std::string port_name;
         const enum PortType { INPUT = 0, OUTPUT = 1, DATA = 2 } port_type;
         const CommProtocol comm;        
+        const int element = -1;     ///< Index of an element of a port array, -1 for the whole port (see Node::port(const std::string&, int))
+        
+        /** The name of the port in connection requests: "port[k]" for element k of a port array. */
+        std::string wire_name() const {
+            return (element < 0)?port_name:(port_name + '[' + std::to_string(element) + ']');
+        }
     };
     
     class WorkSpace;
@@ -122,6 +131,7 @@ namespace SMNChai {
         /** Details of a block. */
         struct BlockDef {
             double sampling_time{0.0};
+            double phase_tolerance{0.0};    // Maximum phase offset (in microseconds) the SMN may give to this periodic block
             std::unordered_set<unsigned int> dependencies;  // Set of other blocks on which this block depends
             BlockDef(double t): sampling_time(t) { }
         };
@@ -214,6 +224,14 @@ namespace SMNChai {
          */
         void add_internal_dependency(unsigned int t_idsrc, unsigned int t_idtgt);
         
+        /** \brief Set the phase tolerance of a periodic block.
+         If phase offsets are enabled in the settings, the SMN may delay all periodic updates of the block by the same offset, up to this tolerance, to balance the work per step.
+         \param t_id The ID of the block, must be valid and already exist.
+         \param t_tolerance The maximum phase offset in microseconds, non-negative; 0 (the default) means the block is never shifted.
+         \exception smnchai_exception an error happens, e.g. ID is invalid, tolerance is negative.
+         */
+        void set_phase_tolerance(unsigned int t_id, double t_tolerance);
+        
         /** \brief Specify that an input port to trigger a block.
          \param t_id The ID of the block.
          \param t_port Name of the input port, which must have direct feedthrough to this block.
@@ -228,6 +246,18 @@ namespace SMNChai {
          */
         PortInfo port(const std::string &t_port) const;
         
+        /** \brief Return a PortInfo object for connecting an element of a port array.
+         
+         A port array on a node (e.g. MQTTInputArray or MQTTOutputArray in node.C++) holds N vectors; element k can be connected to an ordinary vector port,
+         e.g. each of N local nodes sends its vector to element k of an input array of a hub node, or receives element k of an output array of the hub.
+         Only MQTT supports port arrays.
+         \param t_port Port name
+         \param t_element Index of the element, from 0
+         \return The PortInfo object
+         \exception smnchai_exception If the port name is invalid or does not exist, if it's a data port, or if the index is negative.
+         */
+        PortInfo port(const std::string &t_port, int t_element) const;
+        
 #ifdef OBNSIM_COMM_YARP
         /** \brief Create an Yarp node object for this node associated with the given system port.
          Note that the new Yarp node object will own the port object, i.e. when the node is destructed, it will also delete the port.
@@ -383,6 +413,7 @@ namespace SMNChai {
     /** Class that represents a workspace, which contains nodes and their connections. */
     class WorkSpace {
         std::string m_name;     ///< Name of the workspace: all nodes will be under this name
+        std::string m_name_suffix;  ///< Suffix appended to the name given to set_name()
         
         /** Mapping nodes' names to Node objects, their IDs (to be used later on), and pointers to the Node object. */
         struct NodeInfo {
@@ -396,6 +427,17 @@ namespace SMNChai {
         /** List of all connections between ports in this workspace. */
         std::forward_list< std::pair<PortInfo, PortInfo> > m_connections;
         
+        /** Precision on the wire of an output port (see OBNnode::obn_precision), set by port_precision(). */
+        struct PortPrecision {
+            int mode;               ///< 0 = full, 1 = float32, 2 = fixed point
+            double scale;           ///< Quantization step of the fixed point mode
+            double max_abs_error;   ///< Maximum absolute error of each value, 0 if not checked
+            double max_rel_error;   ///< Maximum relative error of each value, 0 if not checked
+        };
+        
+        /** Precisions of the output ports (node name, port name) which are not sent in full precision. */
+        std::map<std::pair<std::string, std::string>, PortPrecision> m_port_precisions;
+        
         SMNChai::SMNChaiComm& m_comm;   // reference to the comm structure of the main SMN
         OBNsmn::GCThread& m_gcthread;   // the GC thread object
         
@@ -409,14 +451,30 @@ namespace SMNChai {
             // System settings
             bool m_sys_run_simulation = true;   ///< System (force) setting similar to m_run_simulation which overrides that setting; not accessible to users
             bool m_dockerlist = false;          ///< Whether to generate node list for Docker
+            double m_sys_start_time = -1.0;     ///< Initial simulation time in microseconds given to the program, overriding m_initial_time (< 0 if not given)
+            double m_sys_stop_time = -1.0;      ///< Time in microseconds before which the simulation stops, given to the program, overriding m_final_time (< 0 if not given)
+            std::string m_sys_state_in;         ///< File of the initial states of the nodes given to the program
+            std::string m_sys_state_out;        ///< File to write the final states of the nodes to, given to the program
             
             int m_ack_timeout = 0;        ///< Timeout for ACK, in milliseconds.
+            bool m_conservative = false;  ///< Whether to run the simulation in the conservative (decoupled) mode.
+            int m_relaxation_iterations = 0;  ///< Maximum number of repetitions of a time instant in the waveform relaxation coupling (0 = disabled).
+            int m_microsteps = 0;             ///< Maximum number of micro-steps at a time instant requested by the nodes (0 = disabled).
+            bool m_pipelined_steps = true;    ///< Whether the GC prepares the next step while the nodes run the UPDATE_X of the current step.
             double m_final_time = std::numeric_limits<OBNsim::simtime_t>::max();      ///< The final time of simulation, real number in microseconds.
+            double m_initial_time = 0.0;      ///< The initial time of simulation, real number in microseconds.
             unsigned int m_time_unit = 1;     ///< The atomic time unit, positive integer number in microseconds [default = 1 microseconds]
             bool m_run_simulation = true;     ///< Whether automatically run the simulation after loading it
             std::time_t m_wallclock = 0;      ///< The initial wall clock time, in Epoch/UNIX time
             CommProtocol m_comm = COMM_MQTT;
             std::string m_mqtt_server{"tcp://localhost:1883"};  ///< The MQTT server address
+            bool m_mqtt_topic_aliases = false;  ///< Whether the SMN uses MQTT v5 and topic aliases
+            bool m_compact_topics = false;      ///< Whether the MQTT output ports publish on compact numeric topics assigned at connection time
+            bool m_output_decimation = false;   ///< Whether the output ports are published only at the steps their consumers sample them
+            bool m_phase_offsets = false;       ///< Whether the SMN assigns phase offsets to periodic blocks within their tolerances to balance the work per step
+            double m_phase_resolution = 0.0;    ///< Step of the phase offsets in microseconds (0 = the time unit)
+            int m_launch_concurrency = 0;       ///< Maximum number of nodes being launched at the same time by launch_all_nodes (0 = number of CPU cores)
+            bool m_launch_pinning = false;      ///< Whether local nodes launched without an explicit CPU are pinned round-robin over the CPU cores
             
             /* Set the default communication protocol. */
             void default_comm(const std::string& t_comm);
@@ -433,6 +491,44 @@ namespace SMNChai {
                 return m_ack_timeout;
             }
             
+            /* Conservative (decoupled) mode of the GC. */
+            void conservative(bool b) {
+                m_conservative = b;
+            }
+            
+            bool conservative() const {
+                return m_conservative;
+            }
+            
+            /* Maximum number of iterations of the waveform relaxation coupling. */
+            void relaxation_iterations(int n) {
+                if (n < 0) { throw smnchai_exception("The number of relaxation iterations must be non-negative, but " + std::to_string(n) + " is given."); }
+                m_relaxation_iterations = n;
+            }
+            
+            int relaxation_iterations() const {
+                return m_relaxation_iterations;
+            }
+            
+            /* Maximum number of micro-steps at a time instant (superdense time). */
+            void microsteps(int n) {
+                if (n < 0) { throw smnchai_exception("The number of micro-steps must be non-negative, but " + std::to_string(n) + " is given."); }
+                m_microsteps = n;
+            }
+            
+            int microsteps() const {
+                return m_microsteps;
+            }
+            
+            /* Preparation of the next step during the UPDATE_X of the current step. */
+            void pipelined_steps(bool b) {
+                m_pipelined_steps = b;
+            }
+            
+            bool pipelined_steps() const {
+                return m_pipelined_steps;
+            }
+            
             /* Final simulation time, in microseconds. */
             void final_time(double t) {
                 if (t <= 0.0) { throw smnchai_exception("Final simulation time must be positive, but " + std::to_string(t) + " is given."); }
@@ -443,6 +539,16 @@ namespace SMNChai {
                 return m_final_time;
             }
             
+            /* Initial simulation time, in microseconds. */
+            void initial_time(double t) {
+                if (t < 0.0) { throw smnchai_exception("Initial simulation time must be non-negative, but " + std::to_string(t) + " is given."); }
+                m_initial_time = t;
+            }
+            
+            double initial_time() const {
+                return m_initial_time;
+            }
+            
             /* Atomic time unit, in microseconds. */
             void time_unit(unsigned int t) {
                 if (t < 1) { throw smnchai_exception("Time unit must be positive, but " + std::to_string(t) + " is given."); }
@@ -466,6 +572,71 @@ namespace SMNChai {
                 return m_mqtt_server;
             }
             
+            /* MQTT v5 topic aliases for the messages of the SMN. */
+            void MQTT_topic_aliases(bool b) {
+                m_mqtt_topic_aliases = b;
+            }
+            
+            bool MQTT_topic_aliases() const {
+                return m_mqtt_topic_aliases;
+            }
+            
+            /* Compact topics of the MQTT output ports. */
+            void compact_topics(bool b) {
+                m_compact_topics = b;
+            }
+            
+            bool compact_topics() const {
+                return m_compact_topics;
+            }
+            
+            /* Output decimation: output ports are published only at the steps their consumers sample them. */
+            void output_decimation(bool b) {
+                m_output_decimation = b;
+            }
+            
+            bool output_decimation() const {
+                return m_output_decimation;
+            }
+            
+            /* Phase offsets: periodic blocks are shifted within their phase tolerances to balance the work per step. */
+            void phase_offsets(bool b) {
+                m_phase_offsets = b;
+            }
+            
+            bool phase_offsets() const {
+                return m_phase_offsets;
+            }
+            
+            /* Step of the phase offsets, in microseconds. */
+            void phase_resolution(double t) {
+                if (t < 0.0) { throw smnchai_exception("The phase resolution must be non-negative, but " + std::to_string(t) + " is given."); }
+                m_phase_resolution = t;
+            }
+            
+            double phase_resolution() const {
+                return m_phase_resolution;
+            }
+            
+            /* Maximum number of nodes being launched at the same time. */
+            void launch_concurrency(int n) {
+                if (n < 0) { throw smnchai_exception("The launch concurrency must be non-negative, but " + std::to_string(n) + " is given."); }
+                m_launch_concurrency = n;
+            }
+            
+            int launch_concurrency() const {
+                return m_launch_concurrency;
+            }
+            
+            /* Automatic CPU pinning of the launched local nodes. */
+            void launch_pinning(bool b) {
+                m_launch_pinning = b;
+            }
+            
+            bool launch_pinning() const {
+                return m_launch_pinning;
+            }
+            
             /* Check if the simulation will run. */
             bool will_run_simulation() const {
                 return m_sys_run_simulation && m_run_simulation;
@@ -491,18 +662,42 @@ namespace SMNChai {
                                       OBNsmn::GCThread &gc, OBNsmn::MQTT::MQTTClient *mqttclient);
 #endif
         
+        // Request the output ports, whose consumers all sample them at the multiples of a longer period than their own, to be published only at these multiples. Used by generate_obn_system().
+        void generate_output_decimation(OBNsmn::GCThread &gc);
+        
+        // Assign phase offsets to the periodic blocks within their tolerances, to balance the work per step. Used by generate_obn_system().
+        void generate_phase_offsets();
+        
+        /* Phase offsets of the periodic blocks (node name and block ID to offset in time unit); blocks not in the map are not shifted. */
+        std::map<std::pair<std::string, unsigned int>, OBNsim::simtime_t> m_phase_offsets;
+        
     public:
         /** Construct a workspace object with a given name. */
         WorkSpace(const std::string &t_name, SMNChai::SMNChaiComm& t_comm, OBNsmn::GCThread& gc): m_comm(t_comm), m_gcthread(gc) {
             set_name(t_name);
         }
         
-        /** Set the workspace's name (throw an exception if invalid name). Empty is a valid name. */
+        /** Set the workspace's name (throw an exception if invalid name). Empty is a valid name.
+         The name suffix, if any, is appended to the name (without its leading underscores if the name is empty).
+         */
         void set_name(const std::string &t_name) {
             if (!t_name.empty() && !OBNsim::Utils::isValidIdentifier(t_name)) {
                 throw smnchai_exception("Workspace name '" + t_name + "' is invalid.");
             }
-            m_name = t_name;
+            m_name = t_name + m_name_suffix;
+            if (t_name.empty() && !m_name.empty()) {
+                m_name.erase(0, m_name.find_first_not_of('_'));
+            }
+        }
+        
+        /** Set the suffix appended to the workspace's name by set_name(), e.g. to run several instances of the same system at the same time.
+         The suffix consists of letters, digits and underscores (throw an exception otherwise); it applies to the names set after this call.
+         */
+        void set_name_suffix(const std::string &t_suffix) {
+            if (t_suffix.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") != std::string::npos) {
+                throw smnchai_exception("Workspace name suffix '" + t_suffix + "' is invalid.");
+            }
+            m_name_suffix = t_suffix;
         }
         
         /** Get the workspace's name. */
@@ -545,6 +740,19 @@ namespace SMNChai {
          */
         void connect(const std::string &from_node, const std::string &from_port, const std::string &to_node, const std::string &to_port);
         
+        /** \brief Set the precision of the values of an output port on the wire, for all its connections.
+         
+         Double vectors and matrices can be sent as float32 or in fixed point; the receiving nodes widen the values automatically, and no node needs to be changed.
+         A message whose values can't be represented within the error bounds is sent in full precision.
+         The SMN sends the precision to the node when the system is generated; it's an error if the port doesn't support it.
+         \param t_port The output port.
+         \param mode "full", "float32" or "fixed".
+         \param scale The quantization step of the fixed point mode (must be positive in that mode; ignored otherwise).
+         \param max_abs_error,max_rel_error The maximum absolute and relative errors of each value, 0 if not checked.
+         \exception smnchai_exception an error happenned, e.g. the port is not an output, invalid mode or values.
+         */
+        void port_precision(const PortInfo &t_port, const std::string &mode, double scale, double max_abs_error, double max_rel_error);
+        
         /** Utility function to print workspace's details to std::cout. */
         void print() const;
         
@@ -574,6 +782,12 @@ namespace SMNChai {
          */
         OBNsim::simtime_t get_time_value(double t) const;
         
+        /** Returns the phase offset, in time unit, assigned to a block of a node by generate_obn_system(); 0 if the block is not shifted. */
+        OBNsim::simtime_t get_phase_offset(const std::string &t_node, unsigned int t_id) const {
+            auto it = m_phase_offsets.find(std::make_pair(t_node, t_id));
+            return (it == m_phase_offsets.end())?0:it->second;
+        }
+        
         /** \brief Check if the given node is online.
          
          This function checks if the given node is online yet by checking the availability of its GC system port.
@@ -622,6 +836,95 @@ namespace SMNChai {
          */
         void waitfor_all_nodes_online(double timeout);
         
+        /** \brief Queue a node to be launched by launch_all_nodes().
+         
+         If the simulation is not going to run, this function does nothing.
+         \param t_node The node to launch.
+         \param t_prog The program that runs the node.
+         \param t_args The arguments of the program, interpreted by the shell.
+         \param t_host Remote host to run the node on via SSH; empty to run it on the local computer.
+         \param t_workdir Optional working directory.
+         \param t_cpu CPU core to pin the node to; -1 for no pinning (or automatic pinning, see Settings::launch_pinning).
+         */
+        void launch_node(const Node &t_node, const std::string &t_prog, const std::string &t_args, const std::string &t_host = "", const std::string &t_workdir = "", int t_cpu = -1);
+        
+        /** \brief Launch all queued nodes in parallel and wait until they are online.
+         
+         At most Settings::launch_concurrency nodes are being launched at the same time; the progress is reported as the nodes go online.
+         If the simulation is not going to run, the queue is cleared and this function returns immediately.
+         \param timeout The timeout value in seconds for each node to go online after being started; it's ignored if timeout <= 0.
+         \exception smnchai_exception A node could not be started, its process exited before it went online, or a timeout occurred.
+         */
+        void launch_all_nodes(double timeout);
+        
+        /* Performance model of the network, to forecast its throughput without running it (see PerfModel).
+         Costs and latencies are in microseconds of wall-clock time.
+         */
+        
+        /** Set the mean and standard deviation of the durations of the UPDATE_Y and UPDATE_X events of a node in the performance model. */
+        void perf_node_cost(const Node &t_node, double t_ymean, double t_ystddev, double t_xmean, double t_xstddev);
+        
+        /** Set the costs of the nodes without their own costs in the performance model. */
+        void perf_default_cost(double t_ymean, double t_ystddev, double t_xmean, double t_xstddev);
+        
+        /** Place a node on a host in the performance model; an empty name is the host of the SMN, where all nodes are by default. */
+        void perf_node_host(const Node &t_node, const std::string &t_host);
+        
+        /** Set the number of cores of a host in the performance model. */
+        void perf_host_cores(const std::string &t_host, int t_cores);
+        
+        /** Override the sampling period (in microseconds, 0 for non-periodic) of a block of a node in the performance model, to forecast the effect of changing it. */
+        void perf_block_period(const Node &t_node, unsigned int t_id, double t_period);
+        
+        /** Set the costs of the GC to send a message and to process an ACK, and the one-way latencies of the messages to nodes on the host of the SMN and on other hosts. */
+        void perf_messaging(double t_send, double t_ack, double t_local, double t_remote);
+        
+        /** \brief Calibrate the performance model from the execution traces of a previous run.
+         
+         The traces are those written to a directory by the SMN (option --trace) and by the nodes (environment variable OBN_TRACE_DIR).
+         The costs of the nodes are estimated from their UPDATE_Y and UPDATE_X events, then the latencies from the round trips of the UPDATE_Y messages in the trace of the SMN.
+         The hosts of the nodes must have been set before, to separate local and remote latencies.
+         \param t_dir The directory of the trace files.
+         \return The number of nodes whose costs have been calibrated.
+         */
+        int perf_calibrate(const std::string &t_dir);
+        
+        /** \brief Forecast the execution of the simulation with the performance model and print the forecast.
+         
+         The GC scheduling of the nodes, blocks, dependencies and triggers of this workspace is replayed with the costs, placement and latencies of the performance model.
+         \param t_duration The duration of simulation time, in microseconds; if <= 0, the final time of the simulation is used.
+         \return The predicted number of simulation steps per second.
+         \exception smnchai_exception The duration is not given and there is no final time, or the network can't be forecast.
+         */
+        double perf_forecast(double t_duration);
+        
+        /* Time-parallel (Parareal) simulation of a system by instances of SMNChai (see Parareal).
+         Times are in microseconds.
+         */
+        
+        /** Set the script of the system and the script arguments (key=value, interpreted by the shell) of its coarse and fine configurations. */
+        void parareal_configure(const std::string &t_script, const std::string &t_coarse_args, const std::string &t_fine_args);
+        
+        /** Set the number of time slices and the maximum number of fine instances running at the same time (0 for all slices). */
+        void parareal_slices(int t_slices, int t_concurrency);
+        
+        /** Set the tolerance of the corrections of the boundary states and the maximum number of iterations (0 for the number of slices). */
+        void parareal_convergence(double t_tolerance, int t_max_iterations);
+        
+        /** Set the work directory of the state and log files, and the optional file of the states at the start time (empty if the nodes start from their initialization). */
+        void parareal_files(const std::string &t_work_dir, const std::string &t_initial_states);
+        
+        /** \brief Run the Parareal simulation from the start time to the final time.
+         
+         The boundaries of the slices are multiples of the time unit of this workspace. The final states are written to the file final.states in the work directory.
+         The simulation of this workspace is not run (as by run_simulation(false)).
+         \param t_start The start time.
+         \param t_final The final (stop) time; if <= 0, the final time of the simulation is used.
+         \return The number of iterations, or -1 if the corrections did not converge; 0 if nothing is run (dry run).
+         \exception smnchai_exception The settings are invalid or an instance of the simulation fails.
+         */
+        int parareal_run(double t_start, double t_final);
+        
 #ifdef OBNSIM_COMM_MQTT
         /** \brief Start the MQTTClient in the comm structure of the SMN.
          
@@ -664,6 +967,20 @@ namespace SMNChai {
         };
         
         std::list<DockerNodeInfo> m_docker_nodelist;
+        
+        /* The parallel launcher of nodes and the nodes queued in it. */
+        NodeLauncher m_launcher;
+        std::map<std::string, Node> m_launch_nodes;
+        
+        /* The performance model and its overridden periods of blocks (node name and block ID to period in microseconds). */
+        PerfModel m_perfmodel;
+        std::map<std::pair<std::string, unsigned int>, double> m_perf_periods;
+        
+        /* The Parareal orchestrator. */
+        Parareal m_parareal;
+        
+        /* Check that a node is in this workspace for the performance model. */
+        void perf_check_node(const Node &t_node) const;
     public:
         // Register a Docker node
         void obndocker_node(const SMNChai::Node& node, const std::string& machine, const std::string& image, const std::string& cmd, const std::string& src, const std::string& extra = "");
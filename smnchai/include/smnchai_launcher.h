@@ -0,0 +1,123 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Parallel launcher of node processes for SMNChai.
+ *
+ * Requires a POSIX system (posix_spawn).
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#ifndef SMNCHAI_SMNCHAI_LAUNCHER_H
+#define SMNCHAI_SMNCHAI_LAUNCHER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <sys/types.h>  // pid_t
+
+
+namespace SMNChai {
+
+    /** Quote a string for the POSIX shell. */
+    std::string shell_quote(const std::string& s);
+
+    /** \brief Start a shell command with posix_spawn() (/bin/sh -c) and return the PID of the process.
+     \param cmd The command; it should "exec" the program so that the PID is that of the program.
+     \param what Description of the process for the error message.
+     \exception smnchai_exception The process could not be started.
+     */
+    pid_t spawn_shell(const std::string& cmd, const std::string& what);
+
+    /** Terminate the given processes (SIGTERM, then SIGKILL after a grace period) and reap them. */
+    void terminate_processes(const std::vector<pid_t>& pids);
+
+    /** \brief Launcher of many node processes in parallel.
+
+     Launch jobs are queued with add() and then started by run().
+     Each job is started with posix_spawn(), either directly on the local computer or through SSH on a remote host (the SSH client is spawned locally, so many remote hosts are reached in parallel).
+     A remote node does not die with its SSH client: the remote shell writes the PID of the node to a file in /tmp on the remote host, and the node is killed through another SSH session when needed.
+     The remote host must therefore provide a POSIX shell (sh).
+     At most a given number of jobs are "in flight" (started but not yet online) at any time; a new job is started as soon as a previous one goes online, so the total bring-up time is close to that of the slowest nodes rather than the sum of all nodes.
+     Readiness of a node is checked by a user-provided function (typically WorkSpace::is_node_online).
+     */
+    class NodeLauncher {
+    public:
+        /** A launch job: a node and the command that runs it. */
+        struct Job {
+            std::string node;       ///< Name of the node (as in the workspace)
+            std::string prog;       ///< The program to run
+            std::string args;       ///< The arguments, as a single string interpreted by the shell
+            std::string host;       ///< Remote host to run the program on via SSH; empty for the local computer
+            std::string workdir;    ///< Optional working directory
+            int cpu = -1;           ///< CPU core to pin the node process to; -1 for no pinning (or automatic pinning)
+        };
+
+        /** Function type that checks whether a node is online. */
+        typedef std::function<bool (const std::string&)> ReadyFunc;
+
+        std::string ssh_command{"ssh -o BatchMode=yes"};   ///< The SSH command (and options) used for remote hosts
+        bool auto_pinning = false;      ///< If true, local jobs without an explicit CPU are pinned round-robin over the CPU cores
+        bool verbose = true;            ///< Report the progress (nodes going online) to the standard output
+
+        ~NodeLauncher();
+
+        /** Queue a launch job. */
+        void add(const Job& job) {
+            m_jobs.push_back(job);
+        }
+
+        /** Number of queued jobs. */
+        std::size_t size() const {
+            return m_jobs.size();
+        }
+
+        /** Remove all queued jobs. */
+        void clear() {
+            m_jobs.clear();
+        }
+
+        /** \brief Start all queued jobs in parallel and wait until their nodes are online.
+
+         Jobs whose nodes are already online are skipped.
+         If the launch fails, all processes started by it are killed and reaped before the exception is rethrown.
+         Remote nodes are killed on their hosts; those that could not be killed (e.g. the host can't be reached any more) are reported on the standard error.
+         The queue is emptied when this function returns (successfully or not).
+         \param isReady The function to check if a node is online.
+         \param max_concurrency Maximum number of jobs in flight at the same time; if <= 0, the number of CPU cores is used.
+         \param timeout Timeout in seconds for each node to go online after being started; ignored if <= 0.
+         \exception smnchai_exception A process could not be started, exited before its node went online, or a timeout occurred.
+         */
+        void run(const ReadyFunc& isReady, int max_concurrency, double timeout);
+
+    private:
+        std::vector<Job> m_jobs;            ///< The queued jobs
+        std::vector<pid_t> m_processes;     ///< The processes started by this launcher, to be reaped later
+
+        /** A node started on a remote host. */
+        struct RemoteProcess {
+            std::string node;       ///< Name of the node
+            std::string host;       ///< The remote host
+            std::string pidfile;    ///< File on the remote host containing the PID of the node
+        };
+        std::map<pid_t, RemoteProcess> m_remote;    ///< The remote nodes, by the PID of their local SSH clients
+        unsigned int m_next_remote = 0;             ///< Counter for unique PID file names
+
+        /** Spawn the process for a job; returns its PID (of the SSH client for a remote job). */
+        pid_t spawn(const Job& job, int cpu);
+
+        /** Kill the remote nodes of the given SSH clients on their hosts; report those that could not be killed. */
+        void kill_remote(const std::vector<pid_t>& pids);
+
+        /** Reap the processes that have terminated. */
+        void reap();
+
+        /** Terminate the given processes started by this launcher and reap them. */
+        void terminate(const std::vector<pid_t>& pids);
+    };
+}
+
+#endif  // SMNCHAI_SMNCHAI_LAUNCHER_H
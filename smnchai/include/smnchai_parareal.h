@@ -0,0 +1,106 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Time-parallel (Parareal) execution of long simulations with SMNChai.
+ *
+ * Requires a POSIX system (posix_spawn).
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#ifndef SMNCHAI_SMNCHAI_PARAREAL_H
+#define SMNCHAI_SMNCHAI_PARAREAL_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sys/types.h>  // pid_t
+
+
+namespace SMNChai {
+
+    /** \brief Orchestrator of a time-parallel (Parareal) simulation.
+
+     The simulation interval is split into time slices. A cheap coarse configuration of the system predicts the states of the nodes at the boundaries of the slices,
+     sequentially; then instances of the fine configuration simulate all slices concurrently, each from its predicted initial states.
+     The predictions are corrected by U[k+1] = G(U[k]) + F(U[k]) - G_old(U[k]), where F and G are the final states of a slice simulated by the fine and the coarse configurations,
+     and the fine slices are simulated again from the corrected states, until the corrections of all boundary states are within a tolerance.
+     After k iterations, the first k slices are exact, so the method ends after at most as many iterations as slices; it pays off when it converges in a few iterations.
+
+     Each instance is a separate SMNChai process running a script with the script arguments of its configuration, on its own workspace (the workspace name gets a suffix),
+     so the instances can run at the same time on the same communication server. The script must create and launch its nodes (e.g. with launch_node()) and choose the coarse or fine configuration from its arguments.
+     The instances are run with the options --start-time, --stop-time, --state-in, --state-out and --workspace-suffix; their outputs are written to log files in the work directory, with the state files.
+     All nodes must support getting and setting their states (see OBNnode::NodeBase::onGetState() and onSetState()), with the same nodes and state sizes in both configurations.
+     All times are in microseconds.
+     */
+    class Parareal {
+    public:
+        /** States of the nodes: a vector of doubles for each node name. */
+        typedef std::map<std::string, std::vector<double> > States;
+
+        /** Result of a Parareal simulation. */
+        struct Result {
+            unsigned int iterations = 0;    ///< Number of Parareal iterations (after the initial coarse prediction)
+            bool converged = false;         ///< Whether the corrections converged within the tolerance
+            double correction = 0.0;        ///< Largest correction of a boundary state in the last iteration
+            States final_states;            ///< States of the nodes at the final time
+        };
+
+        std::string program;            ///< The SMNChai program run by the instances; empty for this program
+        std::string script;             ///< The script of the system
+        std::string coarse_args;        ///< Script arguments (key=value, interpreted by the shell) of the coarse configuration
+        std::string fine_args;          ///< Script arguments of the fine configuration
+        std::string work_dir{"parareal"};   ///< Directory of the state and log files, created if it doesn't exist
+        std::string initial_states;     ///< Optional file of the states at the start time; if empty, the first slice starts from the initialization of the nodes
+        unsigned int slices = 4;        ///< Number of time slices
+        unsigned int concurrency = 0;   ///< Maximum number of fine instances running at the same time; 0 for all slices
+        unsigned int max_iterations = 0;    ///< Maximum number of iterations; 0 for the number of slices
+        double tolerance = 1e-6;        ///< Tolerance of the largest correction of a boundary state
+        double time_unit = 1.0;         ///< The boundaries of the slices are multiples of this time unit
+
+        /** \brief Run the Parareal simulation.
+         \param start_time The start time of the simulation.
+         \param final_time The final (stop) time of the simulation, after the start time.
+         \return The result, also reported to the standard output.
+         \exception smnchai_exception The settings are invalid, an instance fails, or the states of the two configurations don't match.
+         */
+        Result run(double start_time, double final_time);
+
+        /** \brief Read states from a file.
+         Each line of the file is the name of a node followed by the values of its state, separated by spaces; empty lines are ignored.
+         \return true if successful.
+         */
+        static bool read_states(const std::string& filename, States& states);
+
+        /** \brief Write states to a file, in the format of read_states(), with all the digits of the values.
+         \return true if successful.
+         */
+        static bool write_states(const std::string& filename, const States& states);
+
+    private:
+        /** An instance of the simulation of a time slice. */
+        struct Instance {
+            std::string suffix;     ///< Suffix of the workspace name
+            const std::string* args;    ///< Script arguments of its configuration
+            double start;
+            double stop;
+            std::string state_in;   ///< File of its initial states; empty if none
+            std::string state_out;  ///< File of its final states
+            std::string log;        ///< File of its output
+        };
+
+        std::string m_program;  ///< The resolved program
+
+        /** Spawn the process of an instance; returns its PID. */
+        pid_t spawn(const Instance& inst) const;
+
+        /** Run instances, at most max_running at the same time, and read their final states.
+         \exception smnchai_exception An instance can't be started, fails or doesn't write its final states.
+         */
+        std::vector<States> run_instances(const std::vector<Instance>& instances, unsigned int max_running) const;
+    };
+}
+
+#endif  // SMNCHAI_SMNCHAI_PARAREAL_H
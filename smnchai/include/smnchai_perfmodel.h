@@ -0,0 +1,157 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Performance model of a simulation network, to forecast its throughput without running it.
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#ifndef SMNCHAI_SMNCHAI_PERFMODEL_H
+#define SMNCHAI_SMNCHAI_PERFMODEL_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <obnsim_basic.h>
+
+
+namespace SMNChai {
+
+    /** \brief Performance model of a simulation network.
+
+     The model replays the scheduling of the (lockstep) GC on a discrete-event model of the network, without running the nodes:
+     at each simulation step, the updating nodes and their triggered blocks are determined as by the GC, the UPDATE_Y messages are sent in waves
+     given by the dependency graph (the same NodeDepGraph_BGL as in the GC), each wave waiting for all its ACKs, and then UPDATE_X is sent to all updating nodes.
+     Each message takes the GC a fixed cost to send and its ACK a fixed cost to process; it reaches its node after a latency which depends on whether the node
+     runs on the host of the SMN or on a remote host. The node then computes for a random duration drawn from its cost distribution, on one of the cores of its host,
+     waiting if all the cores are busy with other nodes.
+
+     The forecast gives the number of steps per second of wall-clock time, the real-time factor, the nodes on the critical path (those whose ACKs the GC waited for last)
+     and the utilization of the hosts. What-if studies (more cores, nodes moved to other hosts, other sampling periods) are done by changing the model and forecasting again.
+     Costs are either given or calibrated from the execution traces of a previous run (see calibrate_node() and calibrate_gc()).
+     Irregular updates requested by the nodes, micro-steps, relaxation iterations and the conservative mode are not modelled.
+     All durations are in microseconds of wall-clock time.
+     */
+    class PerfModel {
+    public:
+        /** Distribution of a duration, drawn from a normal distribution truncated at 0. */
+        struct Cost {
+            double mean = 0.0;
+            double stddev = 0.0;
+        };
+
+        /** Compute costs of a node. */
+        struct NodeCost {
+            Cost y;     ///< Duration of an UPDATE_Y event on the node, including sending its outputs
+            Cost x;     ///< Duration of an UPDATE_X event on the node
+        };
+
+        /** \brief The network to be forecast: nodes, their blocks, dependencies and triggers, as given to the GC. */
+        struct Network {
+            struct NodeDef {
+                std::string name;
+                std::map<unsigned int, OBNsim::simtime_t> periods;     ///< Periods of the blocks, in time units; 0 if the block is not periodic
+                std::map<unsigned int, OBNsim::simtime_t> offsets;     ///< Phase offsets of the periodic blocks, in time units (a block is updated at offset + k*period); 0 if not given
+                bool updateX = true;
+            };
+
+            /** A dependency or a trigger from some blocks of a node to some blocks of another (or the same) node. */
+            struct Link {
+                int source;
+                int target;
+                OBNsim::updatemask_t smask;
+                OBNsim::updatemask_t tmask;
+            };
+
+            std::vector<NodeDef> nodes;     ///< The nodes; the index of a node is its ID
+            std::vector<Link> dependencies;
+            std::vector<Link> triggers;
+            double time_unit = 1.0;         ///< The time unit, in microseconds of simulation time
+        };
+
+        /** Statistics of a node in a forecast. */
+        struct NodeStats {
+            std::string name;
+            std::size_t updates = 0;        ///< Number of UPDATE_Y and UPDATE_X messages to the node
+            std::size_t critical = 0;       ///< Number of waves in which the GC waited for the node last
+            double critical_time = 0.0;     ///< Total duration of these waves
+        };
+
+        /** Result of a forecast. */
+        struct Forecast {
+            std::size_t steps = 0;          ///< Number of simulation steps
+            std::size_t waves = 0;          ///< Number of waves of UPDATE_Y and UPDATE_X
+            double sim_time = 0.0;          ///< Simulated time, in seconds
+            double wall_time = 0.0;         ///< Predicted wall-clock time, in seconds
+            std::vector<NodeStats> nodes;   ///< Nodes in decreasing order of their critical time
+            std::map<std::string, double> host_utilization;    ///< Average fraction of busy cores of each host
+
+            /** Predicted number of steps per second. */
+            double steps_per_second() const {
+                return (wall_time > 0.0)?(steps / wall_time):0.0;
+            }
+
+            /** Predicted ratio of simulated time to wall-clock time. */
+            double realtime_factor() const {
+                return (wall_time > 0.0)?(sim_time / wall_time):0.0;
+            }
+
+            /** A human-readable report, listing at most max_nodes critical nodes. */
+            std::string report(std::size_t max_nodes = 10) const;
+        };
+
+        NodeCost default_cost;          ///< Cost of the nodes without their own cost
+        double send_cost = 5.0;         ///< Cost for the GC to send a message
+        double ack_cost = 5.0;          ///< Cost for the GC to process an ACK
+        double local_latency = 50.0;    ///< One-way latency of a message between the SMN and a node on the same host
+        double remote_latency = 200.0;  ///< One-way latency of a message between the SMN and a node on another host
+        unsigned int default_cores = 0; ///< Number of cores of the hosts without their own number; 0 for the number of cores of this computer
+        unsigned int seed = 1;          ///< Seed of the random costs, so that forecasts are reproducible
+
+        /** Set the compute costs of a node. */
+        void set_node_cost(const std::string& node, const NodeCost& cost) {
+            m_costs[node] = cost;
+        }
+
+        /** Place a node on a host; an empty name is the host of the SMN, where all nodes are by default. */
+        void set_node_host(const std::string& node, const std::string& host) {
+            m_hosts[node] = host;
+        }
+
+        /** Set the number of cores of a host (empty name for the host of the SMN).
+         \exception smnchai_exception The number is 0.
+         */
+        void set_host_cores(const std::string& host, unsigned int cores);
+
+        /** \brief Estimate the compute costs of a node from its execution trace.
+         \param node Name of the node.
+         \param filename The trace file of the node.
+         \return true if the file contains UPDATE_Y events; false if it can't be read or contains none.
+         */
+        bool calibrate_node(const std::string& node, const std::string& filename);
+
+        /** \brief Estimate the latencies of the messages from the execution trace of the SMN.
+         The round trip of each UPDATE_Y message, less the compute cost of its node, gives twice its latency; this must be called after the nodes are calibrated.
+         \return true if the latencies have been estimated.
+         */
+        bool calibrate_gc(const std::string& filename);
+
+        /** \brief Forecast the execution of a network over a duration of simulated time.
+         \param net The network.
+         \param final_time The final simulation time, in time units.
+         \return The forecast.
+         \exception smnchai_exception The network is empty or has no periodic block.
+         */
+        Forecast forecast(const Network& net, OBNsim::simtime_t final_time) const;
+
+    private:
+        std::map<std::string, NodeCost> m_costs;
+        std::map<std::string, std::string> m_hosts;
+        std::map<std::string, unsigned int> m_cores;
+    };
+}
+
+#endif  // SMNCHAI_SMNCHAI_PERFMODEL_H
@@ -44,12 +44,14 @@ void SMNChai::registerSMNAPI(ChaiScript &chai, SMNChai::WorkSpace &ws) {
     chai.add(fun(&Node::input_to_update), "input_to_block");
     chai.add(fun(&Node::output_from_update), "output_from_block");
     chai.add(fun(&Node::add_internal_dependency), "add_internal_dependency");
+    chai.add(fun(&Node::set_phase_tolerance), "set_phase_tolerance");
     chai.add(fun(&Node::input_triggers_block), "input_triggers_block");
 
     // PortInfo from a node: used for connecting ports, and methods to access it
     chai.add(user_type<SMNChai::PortInfo>(), "PortInfo");
     bootstrap::copy_constructor<SMNChai::PortInfo>("PortInfo", *module);
-    chai.add(fun(&Node::port), "port");
+    chai.add(fun(static_cast<PortInfo (Node::*)(const std::string &) const>(&Node::port)), "port");
+    chai.add(fun(static_cast<PortInfo (Node::*)(const std::string &, int) const>(&Node::port)), "port");   // port(name, k): element k of a port array
     // Returns the type of a PortInfo: 0 = input, 1 = output, 2 = data
     //chai.add(fun<int (const SMNChai::PortInfo&)>([](const SMNChai::PortInfo& p) { return p.port_type; }), "port_type");
     chai.add(fun([](const SMNChai::PortInfo& p) { return static_cast<int>(p.port_type); }), "port_type"); // need to cast from enum value to int for automatic deduction of type signature
@@ -90,6 +92,11 @@ void SMNChai::registerSMNAPI(ChaiScript &chai, SMNChai::WorkSpace &ws) {
     chai.add(fun([&ws](PortInfo s, PortInfo t) { ws.connect(std::move(s), std::move(t)); }), "connect");
     chai.add(fun<void (WorkSpace::*)(const std::string &, const std::string &, const std::string &, const std::string &)>(&WorkSpace::connect, &ws), "connect");
     
+    // Precision of an output port on the wire: port_precision(port, "float32"|"full"), port_precision(port, "fixed", scale), optionally followed by the maximum absolute and relative errors
+    chai.add(fun(&WorkSpace::port_precision, &ws), "port_precision");
+    chai.add(fun([&ws](const PortInfo& p, const std::string& mode) { ws.port_precision(p, mode, 0.0, 0.0, 0.0); }), "port_precision");
+    chai.add(fun([&ws](const PortInfo& p, const std::string& mode, double scale) { ws.port_precision(p, mode, scale, 0.0, 0.0); }), "port_precision");
+    
     // Function to change the name of the workspace: workspace(new_name)
     chai.add(fun(&WorkSpace::set_name, &ws), "workspace");
     
@@ -128,6 +135,36 @@ void SMNChai::registerSMNAPI(ChaiScript &chai, SMNChai::WorkSpace &ws) {
     
     chai.add(fun(&WorkSpace::waitfor_all_nodes_online, &ws), "waitfor_all_nodes");
     
+    // Parallel launcher: launch_node(node, prog, args[, host[, workdir[, cpu]]]) queues a node, launch_all_nodes(timeout) starts them and waits for them
+    chai.add(fun(&WorkSpace::launch_node, &ws), "launch_node");
+    chai.add(fun([&ws](const SMNChai::Node &n, const std::string &p, const std::string &a) {
+        ws.launch_node(n, p, a);
+    }), "launch_node");
+    chai.add(fun([&ws](const SMNChai::Node &n, const std::string &p, const std::string &a, const std::string &h) {
+        ws.launch_node(n, p, a, h);
+    }), "launch_node");
+    chai.add(fun([&ws](const SMNChai::Node &n, const std::string &p, const std::string &a, const std::string &h, const std::string &w) {
+        ws.launch_node(n, p, a, h, w);
+    }), "launch_node");
+    chai.add(fun(&WorkSpace::launch_all_nodes, &ws), "launch_all_nodes");
+    
+    // Performance model: perf_forecast(duration) replays the GC scheduling with the costs, placement and latencies set by the other perf_ functions
+    chai.add(fun(&WorkSpace::perf_node_cost, &ws), "perf_node_cost");
+    chai.add(fun(&WorkSpace::perf_default_cost, &ws), "perf_default_cost");
+    chai.add(fun(&WorkSpace::perf_node_host, &ws), "perf_node_host");
+    chai.add(fun(&WorkSpace::perf_host_cores, &ws), "perf_host_cores");
+    chai.add(fun(&WorkSpace::perf_block_period, &ws), "perf_block_period");
+    chai.add(fun(&WorkSpace::perf_messaging, &ws), "perf_messaging");
+    chai.add(fun(&WorkSpace::perf_calibrate, &ws), "perf_calibrate");
+    chai.add(fun(&WorkSpace::perf_forecast, &ws), "perf_forecast");
+    
+    // Time-parallel simulation: parareal_run(start, final) runs instances of the script configured by the other parareal_ functions, instead of this simulation
+    chai.add(fun(&WorkSpace::parareal_configure, &ws), "parareal_configure");
+    chai.add(fun(&WorkSpace::parareal_slices, &ws), "parareal_slices");
+    chai.add(fun(&WorkSpace::parareal_convergence, &ws), "parareal_convergence");
+    chai.add(fun(&WorkSpace::parareal_files, &ws), "parareal_files");
+    chai.add(fun(&WorkSpace::parareal_run, &ws), "parareal_run");
+    
     // *********************************************
     // Functions to generate node list for Docker
     // *********************************************
@@ -215,9 +252,29 @@ void SMNChai::WorkSpace::register_settings_with_Chaiscript(ChaiScript &chai) {
     chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(int)>(&SMNChai::WorkSpace::Settings::ack_timeout)), "ack_timeout");
     chai.add(fun(static_cast<int (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::ack_timeout)), "ack_timeout");
     
+    /* Set/get the conservative mode: nodes are advanced as far as the lookahead of their connections allows, instead of in lockstep. */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(bool)>(&SMNChai::WorkSpace::Settings::conservative)), "conservative");
+    chai.add(fun(static_cast<bool (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::conservative)), "conservative");
+    
+    /* Set/get the maximum number of iterations of the waveform relaxation coupling: a time instant is repeated while some nodes report non-converged outputs. */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(int)>(&SMNChai::WorkSpace::Settings::relaxation_iterations)), "relaxation_iterations");
+    chai.add(fun(static_cast<int (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::relaxation_iterations)), "relaxation_iterations");
+    
+    /* Set/get the maximum number of micro-steps at a time instant, which nodes can request to run updates without advancing the time (0 = disabled, the default). */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(int)>(&SMNChai::WorkSpace::Settings::microsteps)), "microsteps");
+    chai.add(fun(static_cast<int (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::microsteps)), "microsteps");
+    
+    /* Set/get whether the GC prepares the next step while the nodes run the UPDATE_X of the current step. */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(bool)>(&SMNChai::WorkSpace::Settings::pipelined_steps)), "pipelined_steps");
+    chai.add(fun(static_cast<bool (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::pipelined_steps)), "pipelined_steps");
+    
     /* Set/get final simulation time. */
     chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(double)>(&SMNChai::WorkSpace::Settings::final_time)), "final_time");
     chai.add(fun(static_cast<double (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::final_time)), "final_time");
+    
+    /* Set/get initial simulation time: the periodic blocks keep their schedules from time 0. */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(double)>(&SMNChai::WorkSpace::Settings::initial_time)), "initial_time");
+    chai.add(fun(static_cast<double (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::initial_time)), "initial_time");
 
     /* Atomic time unit, in microseconds. */
     chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(unsigned int)>(&SMNChai::WorkSpace::Settings::time_unit)), "time_unit");
@@ -241,4 +298,30 @@ void SMNChai::WorkSpace::register_settings_with_Chaiscript(ChaiScript &chai) {
     /* Set/get MQTT server. */
     chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(const std::string&)>(&SMNChai::WorkSpace::Settings::MQTT_server)), "MQTT_server");
     chai.add(fun(static_cast<std::string (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::MQTT_server)), "MQTT_server");
+    
+    /* Set/get whether the SMN connects with MQTT v5 and uses topic aliases; must be set before the MQTT client starts. */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(bool)>(&SMNChai::WorkSpace::Settings::MQTT_topic_aliases)), "MQTT_topic_aliases");
+    chai.add(fun(static_cast<bool (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::MQTT_topic_aliases)), "MQTT_topic_aliases");
+    
+    /* Set/get whether the connected MQTT output ports publish on compact numeric topics instead of their full names. */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(bool)>(&SMNChai::WorkSpace::Settings::compact_topics)), "compact_topics");
+    chai.add(fun(static_cast<bool (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::compact_topics)), "compact_topics");
+    
+    /* Set/get whether the output ports are published only at the steps their consumers sample them. */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(bool)>(&SMNChai::WorkSpace::Settings::output_decimation)), "output_decimation");
+    chai.add(fun(static_cast<bool (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::output_decimation)), "output_decimation");
+    
+    /* Set/get whether the SMN shifts periodic blocks within their phase tolerances to balance the work per step, and the step of the offsets in microseconds (0 = time unit). */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(bool)>(&SMNChai::WorkSpace::Settings::phase_offsets)), "phase_offsets");
+    chai.add(fun(static_cast<bool (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::phase_offsets)), "phase_offsets");
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(double)>(&SMNChai::WorkSpace::Settings::phase_resolution)), "phase_resolution");
+    chai.add(fun(static_cast<double (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::phase_resolution)), "phase_resolution");
+    
+    /* Set/get the maximum number of nodes being launched at the same time by launch_all_nodes (0 = number of CPU cores). */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(int)>(&SMNChai::WorkSpace::Settings::launch_concurrency)), "launch_concurrency");
+    chai.add(fun(static_cast<int (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::launch_concurrency)), "launch_concurrency");
+    
+    /* Set/get whether launched local nodes without an explicit CPU are pinned round-robin over the CPU cores. */
+    chai.add(fun(static_cast<void (SMNChai::WorkSpace::Settings::*)(bool)>(&SMNChai::WorkSpace::Settings::launch_pinning)), "launch_pinning");
+    chai.add(fun(static_cast<bool (SMNChai::WorkSpace::Settings::*)() const>(&SMNChai::WorkSpace::Settings::launch_pinning)), "launch_pinning");
 }
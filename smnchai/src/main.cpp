@@ -17,12 +17,14 @@
 #include <chrono>
 #include <vector>
 #include <map>
+#include <algorithm>
 
 #include <boost/filesystem.hpp>     // manipulate paths
 #include <boost/program_options.hpp>    // To parse program options (command-line arguments)
 
 #include <chaiscript/chaiscript.hpp>
 #include <smnchai.h>
+#include <smnchai_parareal.h>
 
 // At least one of the communication protocols must be supported
 #if !defined(OBNSIM_COMM_YARP) && !defined(OBNSIM_COMM_MQTT)
@@ -194,6 +196,13 @@ int main(int argc, char* argv[]) {
     ("help,h", "Show help")
     ("dry-run", "Force dry-run (no simulation)")
     ("dockerlist", po::value<std::string>(), "Generate node list for Docker without running simulation")
+    ("trace", po::value<std::string>(), "Write a trace of the simulation execution to the given directory (nodes trace if OBN_TRACE_DIR is set)")
+    ("metrics", po::value<std::string>(), "Serve live metrics on the given localhost TCP port or unix:PATH socket (nodes serve theirs if OBN_METRICS_DIR is set)")
+    ("start-time", po::value<double>(), "Start the simulation at the given time in microseconds, overriding the script")
+    ("stop-time", po::value<double>(), "Stop the simulation before the given time in microseconds, overriding the final time of the script")
+    ("state-in", po::value<std::string>(), "Initialize the nodes with the states in the given file")
+    ("state-out", po::value<std::string>(), "Write the states of the nodes at the end of the simulation to the given file")
+    ("workspace-suffix", po::value<std::string>(), "Append the given suffix to the workspace name, to run several instances of the same system at the same time")
     ;
     
     // Hidden options, will not be shown to the user
@@ -254,6 +263,30 @@ int main(int argc, char* argv[]) {
     sys_settings.dockerlist = args_map.count("dockerlist") != 0;     // Whether we want to generate the list of nodes for Docker
     sys_settings.dryrun = args_map.count("dry-run") != 0;
 
+    if (args_map.count("start-time")) {
+        sys_settings.start_time = args_map["start-time"].as<double>();
+        if (sys_settings.start_time < 0.0) {
+            std::cerr << "ERROR: The start time must be non-negative.\n";
+            return 2;
+        }
+    }
+    if (args_map.count("stop-time")) {
+        sys_settings.stop_time = args_map["stop-time"].as<double>();
+        if (sys_settings.stop_time <= std::max(sys_settings.start_time, 0.0)) {
+            std::cerr << "ERROR: The stop time must be after the start time.\n";
+            return 2;
+        }
+    }
+    if (args_map.count("state-in")) {
+        sys_settings.state_in = args_map["state-in"].as<std::string>();
+    }
+    if (args_map.count("state-out")) {
+        sys_settings.state_out = args_map["state-out"].as<std::string>();
+    }
+    if (args_map.count("workspace-suffix")) {
+        sys_settings.workspace_suffix = args_map["workspace-suffix"].as<std::string>();
+    }
+    
     if (sys_settings.dockerlist) {
         // Check output file
         sys_settings.dockerlistfile = args_map["dockerlist"].as<std::string>();
@@ -277,6 +310,8 @@ int main(int argc, char* argv[]) {
         sigaction (SIGTERM, &action, NULL);
     }
     
+    int exit_code = 0;
+    
     {
         // The Global clock thread
         OBNsmn::GCThread gc;
@@ -295,6 +330,20 @@ int main(int argc, char* argv[]) {
         
         auto simulation_start = std::chrono::steady_clock::now();
         
+        if (args_map.count("trace")) {
+            auto trace_file = args_map["trace"].as<std::string>() + "/_smn_.trace.json";
+            if (!OBNsim::Trace::start(trace_file, "SMN")) {
+                std::cerr << "WARNING: Could not open the trace file " << trace_file << "; continue without tracing.\n";
+            }
+        }
+        
+        if (args_map.count("metrics")) {
+            auto metrics_address = args_map["metrics"].as<std::string>();
+            if (!OBNsim::Metrics::startServer(metrics_address)) {
+                std::cerr << "WARNING: Could not serve metrics on " << metrics_address << "; continue without metrics.\n";
+            }
+        }
+        
         // Start running the GC thread
         if (!gc.startThread()) {
             std::cerr << "ERROR: could not start GC thread. Shutting down..." << std::endl;
@@ -318,11 +367,31 @@ int main(int argc, char* argv[]) {
         //Join the threads with the main thread
         gc.joinThread();
         
+        OBNsim::Trace::stop();
+        OBNsim::Metrics::stopServer();
+        
         // The simulation officially stops at this point => measure the duration
         auto simulation_duration = std::chrono::steady_clock::now() - simulation_start;
         std::cout << "Simulation duration is about: " <<
             std::chrono::duration_cast<std::chrono::seconds>(simulation_duration).count() << "seconds.\n";
         
+        // Write the final states of the nodes, which must all be available
+        if (!sys_settings.state_out.empty()) {
+            SMNChai::Parareal::States states;
+            for (int id = 0; id < gc.numberOfNodes(); ++id) {
+                std::string bytes;
+                if (!gc.getFinalState(id, bytes) || !OBNsim::Utils::decodeState(bytes, states[gc.nodeName(id)])) {
+                    std::cerr << "ERROR: The final state of node " << gc.nodeName(id) << " is not available.\n";
+                    exit_code = 1;
+                    break;
+                }
+            }
+            if (exit_code == 0 && !SMNChai::Parareal::write_states(sys_settings.state_out, states)) {
+                std::cerr << "ERROR: Could not write the final states to " << sys_settings.state_out << ".\n";
+                exit_code = 1;
+            }
+        }
+        
         // Shutdown communications
         shutdown_communication_threads(gc);
         
@@ -337,5 +406,5 @@ int main(int argc, char* argv[]) {
     std::cout << "SHUTTING DOWN THE SERVER..." << std::endl;
     shutdown_SMN();
     
-    return 0;
+    return exit_code;
 }
@@ -17,6 +17,7 @@
 #include <sstream>
 #include <fstream>
 #include <iomanip>
+#include <set>
 
 #include <chaiscript/utility/json.hpp>
 
@@ -139,6 +140,7 @@ bool SMNChai::WorkSpace::start_mqtt_client() {
     m_comm.mqttClient->setClientID(get_name());
     m_comm.mqttClient->setPortName(get_full_path("_smn_", OBNsim::NODE_GC_PORT_NAME));
     m_comm.mqttClient->setServerAddress(m_settings.m_mqtt_server);
+    m_comm.mqttClient->setTopicAliases(m_settings.m_mqtt_topic_aliases);
     
     // Start MQTT communication
     bool success = m_comm.mqttClient->start();
@@ -250,6 +252,46 @@ void SMNChai::WorkSpace::waitfor_all_nodes_online(double timeout) {
     }
 }
 
+void SMNChai::WorkSpace::launch_node(const SMNChai::Node &t_node, const std::string &t_prog, const std::string &t_args, const std::string &t_host, const std::string &t_workdir, int t_cpu) {
+    if (!m_settings.will_run_simulation()) {
+        return;
+    }
+    if (t_prog.empty()) {
+        throw smnchai_exception("launch_node error: the program of node '" + t_node.get_name() + "' must be non-empty.");
+    }
+    
+    NodeLauncher::Job job;
+    job.node = t_node.get_name();
+    job.prog = t_prog;
+    job.args = t_args;
+    job.host = t_host;
+    job.workdir = t_workdir;
+    job.cpu = t_cpu;
+    m_launcher.add(job);
+    m_launch_nodes.emplace(job.node, t_node);
+}
+
+void SMNChai::WorkSpace::launch_all_nodes(double timeout) {
+    if (!m_settings.will_run_simulation()) {
+        m_launcher.clear();
+        m_launch_nodes.clear();
+        return;
+    }
+    
+    m_launcher.auto_pinning = m_settings.m_launch_pinning;
+    try {
+        m_launcher.run([this](const std::string &t_name) {
+            auto it = m_launch_nodes.find(t_name);
+            assert(it != m_launch_nodes.end());
+            return is_node_online(it->second);
+        }, m_settings.m_launch_concurrency, timeout);
+    } catch (...) {
+        m_launch_nodes.clear();
+        throw;
+    }
+    m_launch_nodes.clear();
+}
+
 bool SMNChai::WorkSpace::are_all_nodes_online() {
     for (auto it = m_nodes.begin(); it != m_nodes.end(); ++it) {
         if (!is_node_online(it->second.node)) {
@@ -275,6 +317,7 @@ OBNsmn::YARP::OBNNodeYARP* SMNChai::Node::create_yarp_node(OBNsmn::YARP::YARPPor
     // Note that time values are stored as real numbers of microseconds, which must be converted to integer values in time unit
     for (auto myupdate = m_updates.begin(); myupdate != m_updates.end(); ++myupdate) {
         p_node->setUpdateType(myupdate->first, ws.get_time_value(myupdate->second.sampling_time));
+        p_node->setUpdateOffset(myupdate->first, ws.get_phase_offset(m_name, myupdate->first));
     }
     
     return p_node;
@@ -291,6 +334,7 @@ OBNsmn::MQTT::OBNNodeMQTT* SMNChai::Node::create_mqtt_node(OBNsmn::MQTT::MQTTCli
     // Note that time values are stored as real numbers of microseconds, which must be converted to integer values in time unit
     for (auto myupdate = m_updates.begin(); myupdate != m_updates.end(); ++myupdate) {
         p_node->setUpdateType(myupdate->first, ws.get_time_value(myupdate->second.sampling_time));
+        p_node->setUpdateOffset(myupdate->first, ws.get_phase_offset(m_name, myupdate->first));
     }
     
     return p_node;
@@ -471,6 +515,18 @@ void SMNChai::Node::add_internal_dependency(unsigned int t_idsrc, unsigned int t
     m_updates.at(t_idtgt).dependencies.insert(t_idsrc);    // Target block depends on source blocks
 }
 
+void SMNChai::Node::set_phase_tolerance(unsigned int t_id, double t_tolerance) {
+    // Check that ID is valid and already exists
+    if (t_id > OBNsim::MAX_UPDATE_INDEX || m_updates.count(t_id) == 0) {
+        throw smnchai_exception("In set_phase_tolerance, block ID=" + std::to_string(t_id) + " on node '" + m_name + "' is invalid or not existing.");
+    }
+    if (t_tolerance < 0.0) {
+        throw smnchai_exception("In set_phase_tolerance, the tolerance of block ID=" + std::to_string(t_id) + " on node '" + m_name + "' must be non-negative.");
+    }
+    
+    m_updates.at(t_id).phase_tolerance = t_tolerance;
+}
+
 
 SMNChai::PortInfo SMNChai::Node::port(const std::string &t_port) const {
     if (!OBNsim::Utils::isValidIdentifier(t_port)) {
@@ -503,6 +559,17 @@ SMNChai::PortInfo SMNChai::Node::port(const std::string &t_port) const {
     throw smnchai_exception("Port name '" + t_port + "' not found in node '" + m_name + "'.");
 }
 
+SMNChai::PortInfo SMNChai::Node::port(const std::string &t_port, int t_element) const {
+    auto p = port(t_port);
+    if (p.port_type == SMNChai::PortInfo::DATA) {
+        throw smnchai_exception("Data port '" + t_port + "' in node '" + m_name + "' can't be a port array.");
+    }
+    if (t_element < 0) {
+        throw smnchai_exception("Element index " + std::to_string(t_element) + " of port '" + t_port + "' in node '" + m_name + "' must be non-negative.");
+    }
+    return SMNChai::PortInfo{p.node_name, p.port_name, p.port_type, p.comm, t_element};
+}
+
 
 ////////////////////////////////////////////////////
 // Implementation of Workspace::Settings class
@@ -562,8 +629,8 @@ void SMNChai::WorkSpace::connect(const SMNChai::PortInfo &t_from, const SMNChai:
     // Check if this connection has already existed
     bool bNotExist = std::none_of(m_connections.begin(), m_connections.end(),
                                   [t_from,t_to](const std::pair<PortInfo, PortInfo>& p) {
-                                      return (p.first.node_name == t_from.node_name) && (p.first.port_name == t_from.port_name) &&
-                                      (p.second.node_name == t_to.node_name) && (p.second.port_name == t_to.port_name);
+                                      return (p.first.node_name == t_from.node_name) && (p.first.port_name == t_from.port_name) && (p.first.element == t_from.element) &&
+                                      (p.second.node_name == t_to.node_name) && (p.second.port_name == t_to.port_name) && (p.second.element == t_to.element);
                                   });
     if (bNotExist) {
         m_connections.emplace_front(t_from, t_to);
@@ -586,6 +653,35 @@ void SMNChai::WorkSpace::connect(const std::string &from_node, const std::string
     connect(itsrc->second.node.port(from_port), ittgt->second.node.port(to_port));
 }
 
+void SMNChai::WorkSpace::port_precision(const SMNChai::PortInfo &t_port, const std::string &mode, double scale, double max_abs_error, double max_rel_error) {
+    if (t_port.port_type != SMNChai::PortInfo::OUTPUT) {
+        throw smnchai_exception("The precision can only be set on an output port, but " + t_port.node_name + '/' + t_port.port_name + " is not.");
+    }
+    
+    PortPrecision prec{0, 0.0, max_abs_error, max_rel_error};
+    if (mode == "float32") {
+        prec.mode = 1;
+    } else if (mode == "fixed") {
+        prec.mode = 2;
+        prec.scale = scale;
+        if (!(scale > 0.0)) {
+            throw smnchai_exception("The scale of the fixed point precision of " + t_port.node_name + '/' + t_port.port_name + " must be positive.");
+        }
+    } else if (mode != "full") {
+        throw smnchai_exception("Unknown precision '" + mode + "' of " + t_port.node_name + '/' + t_port.port_name + "; must be full, float32 or fixed.");
+    }
+    if (!(max_abs_error >= 0.0 && max_rel_error >= 0.0)) {
+        throw smnchai_exception("The error bounds of the precision of " + t_port.node_name + '/' + t_port.port_name + " must be non-negative.");
+    }
+    
+    auto key = std::make_pair(t_port.node_name, t_port.port_name);
+    if (prec.mode == 0) {
+        m_port_precisions.erase(key);   // full precision is the default
+    } else {
+        m_port_precisions[key] = prec;
+    }
+}
+
 
 void SMNChai::WorkSpace::print() const {
     print_settings();
@@ -602,7 +698,7 @@ void SMNChai::WorkSpace::print() const {
     }
     std::cout << "\n\nList of connections:" << std::endl;
     for (auto c: m_connections) {
-        std::cout << c.first.node_name << '/' << c.first.port_name << " -> " << c.second.node_name << '/' << c.second.port_name << std::endl;
+        std::cout << c.first.node_name << '/' << c.first.wire_name() << " -> " << c.second.node_name << '/' << c.second.wire_name() << std::endl;
     }
 }
 
@@ -610,11 +706,23 @@ void SMNChai::WorkSpace::print_settings() const {
     std::cout << "Settings:\n" <<
     "+ Workspace: '" << m_name << "'" << std::endl <<
     "+ Time unit (in us): " << m_settings.m_time_unit << std::endl <<
+    "+ Initial time (in us): " << m_settings.m_initial_time << std::endl <<
     "+ Final time (in us): " << m_settings.m_final_time << std::endl <<
     "+ ACK timeout (in ms): " << m_settings.m_ack_timeout << std::endl <<
+    "+ Conservative mode: " << (m_settings.m_conservative?"on":"off") << std::endl <<
+    "+ Relaxation iterations: " << m_settings.m_relaxation_iterations << std::endl <<
+    "+ Micro-steps: " << m_settings.m_microsteps << std::endl <<
+    "+ Pipelined steps: " << (m_settings.m_pipelined_steps?"on":"off") << std::endl <<
     "+ Begin wallclock: " << std::ctime(&m_settings.m_wallclock) <<
     "+ Default communication: " << CommProtocolNames[int(m_settings.m_comm)] << std::endl <<
-    "+ MQTT server: " << m_settings.m_mqtt_server << std::endl;
+    "+ MQTT server: " << m_settings.m_mqtt_server << std::endl <<
+    "+ MQTT topic aliases: " << (m_settings.m_mqtt_topic_aliases?"on":"off") << std::endl <<
+    "+ Compact topics: " << (m_settings.m_compact_topics?"on":"off") << std::endl <<
+    "+ Output decimation: " << (m_settings.m_output_decimation?"on":"off") << std::endl <<
+    "+ Phase offsets: " << (m_settings.m_phase_offsets?"on":"off") << std::endl <<
+    "+ Phase resolution (in us): " << m_settings.m_phase_resolution << std::endl <<
+    "+ Launch concurrency: " << m_settings.m_launch_concurrency << std::endl <<
+    "+ Launch pinning: " << (m_settings.m_launch_pinning?"on":"off") << std::endl;
 }
 
 std::string SMNChai::WorkSpace::get_full_path(const std::string &t_obj1, const std::string &t_obj2) const {
@@ -624,7 +732,7 @@ std::string SMNChai::WorkSpace::get_full_path(const std::string &t_obj1, const s
 
 
 std::string SMNChai::WorkSpace::get_full_path(const SMNChai::PortInfo &t_port) const {
-    return get_full_path(t_port.node_name, t_port.port_name);
+    return get_full_path(t_port.node_name, t_port.wire_name());
 }
 
 
@@ -738,6 +846,12 @@ void SMNChai::WorkSpace::generate_obn_system(OBNsmn::GCThread &gc, SMNChai::SMNC
         throw smnchai_exception("There is no node in workspace '" + m_name + "' to generate its OBN system.");
     }
     
+    // The phase offsets are needed to create the node objects
+    m_phase_offsets.clear();
+    if (m_settings.m_phase_offsets) {
+        generate_phase_offsets();
+    }
+    
     // Create GC ports and node objects, add them to the GC object and save their IDs
     for (auto mynode = m_nodes.begin(); mynode != m_nodes.end(); ++mynode) {
         if (mynode->second.node.m_comm_protocol == SMNChai::COMM_YARP ||
@@ -768,9 +882,65 @@ void SMNChai::WorkSpace::generate_obn_system(OBNsmn::GCThread &gc, SMNChai::SMNC
     // ASSUME that all ports have already been created, i.e. nodes are already started.
     OBNsmn::NodeDepGraph* nodeGraph = new OBNsmn::NodeDepGraph_BGL(m_nodes.size());
     
+    // The communication protocol actually used by a port
+    auto port_comm = [this](const SMNChai::PortInfo& port) {
+        auto comm = port.comm;
+        if (comm == SMNChai::COMM_DEFAULT) {
+            comm = m_nodes.at(port.node_name).node.m_comm_protocol;
+        }
+        return (comm == SMNChai::COMM_DEFAULT)?m_settings.m_comm:comm;
+    };
+    
+    // Only MQTT supports port arrays
+    for (auto& myconn: m_connections) {
+        if ((myconn.first.element >= 0 && port_comm(myconn.first) != SMNChai::COMM_MQTT) ||
+            (myconn.second.element >= 0 && port_comm(myconn.second) != SMNChai::COMM_MQTT))
+        {
+            throw smnchai_exception("Could not connect " + get_full_path(myconn.first) + " to " + get_full_path(myconn.second) + ": port arrays are only supported by MQTT.");
+        }
+    }
+    
+    // Output port arrays whose elements are connected: the topics of these elements, and of the whole array if it is also connected, are assigned by connection requests to the array
+    std::set<std::pair<std::string, std::string> > scattered_outputs;
+    for (auto& myconn: m_connections) {
+        if (myconn.first.port_type == PortInfo::OUTPUT && myconn.first.element >= 0) {
+            scattered_outputs.emplace(myconn.first.node_name, myconn.first.port_name);
+        }
+    }
+    
+    // Topics of the MQTT output ports assigned by connection requests (if compact topics are used, or for port arrays): the topic of an output port is assigned at its first connection
+    std::map<std::string, std::string> port_topics;
+    
     for (auto myconn = m_connections.begin(); myconn != m_connections.end(); ++myconn) {        
         auto& target = m_nodes.at(myconn->second.node_name);    // The target node must exist
-        auto result = gc.request_port_connect(target.index, myconn->second.port_name, get_full_path(myconn->first));
+        auto source = get_full_path(myconn->first);
+        
+        if (myconn->first.port_type == PortInfo::OUTPUT &&
+            (m_settings.m_compact_topics || scattered_outputs.count(std::make_pair(myconn->first.node_name, myconn->first.port_name)) > 0) &&
+            port_comm(myconn->first) == SMNChai::COMM_MQTT && port_comm(myconn->second) == SMNChai::COMM_MQTT)
+        {
+            auto found = port_topics.find(source);
+            if (found == port_topics.end()) {
+                // A connection request to an output port (or to an element of an output port array) assigns its topic
+                auto topic = m_settings.m_compact_topics?get_full_path("_p_", std::to_string(port_topics.size())):source;
+                auto result = gc.request_port_connect(m_nodes.at(myconn->first.node_name).index, myconn->first.wire_name(), topic);
+                if (result.first < 0) {
+                    if (myconn->first.element >= 0) {
+                        throw smnchai_exception("Could not connect from " + source + " with Error code " + std::to_string(result.first) +
+                                                (result.second.empty()?"; is it a port array?":(" (" + result.second + ").")));
+                    }
+                    // The node does not support compact topics: keep the full name
+                    if (m_settings.m_compact_topics) {
+                        OBNsmn::report_warning(0, "Could not assign a compact topic to " + source + "; its full name is used.");
+                    }
+                    topic = source;
+                }
+                found = port_topics.emplace(source, topic).first;
+            }
+            source = found->second;
+        }
+        
+        auto result = gc.request_port_connect(target.index, myconn->second.wire_name(), source);
         // If result.first >= 0 then it's successful (even though the connection may have already existed)
         if (result.first < 0) {
             // Error
@@ -797,6 +967,11 @@ void SMNChai::WorkSpace::generate_obn_system(OBNsmn::GCThread &gc, SMNChai::SMNC
             nodeGraph->addDependency(src_node.index, tgt_node.index, src_mask, tgt_mask);
         }
         
+        // Record the connection between the nodes, used by the conservative mode
+        if (myconn->first.port_type == PortInfo::OUTPUT && myconn->second.port_type == PortInfo::INPUT) {
+            gc.addConnection(src_node.index, tgt_node.index);
+        }
+        
         // Add triggering if there is any
         tgt_mask = tgt_node.node.input_triggermask(myconn->second.port_name);
         if (myconn->first.port_type == PortInfo::OUTPUT && myconn->second.port_type == PortInfo::INPUT &&
@@ -825,8 +1000,32 @@ void SMNChai::WorkSpace::generate_obn_system(OBNsmn::GCThread &gc, SMNChai::SMNC
 
     gc.setDependencyGraph(nodeGraph);   // Set the dependency graph for the GC
     
+    if (m_settings.m_output_decimation) {
+        generate_output_decimation(gc);
+    }
+    
+    // Send the precisions of the output ports which are not sent in full precision
+    for (auto& myprec: m_port_precisions) {
+        auto itnode = m_nodes.find(myprec.first.first);
+        if (itnode == m_nodes.end()) {
+            throw smnchai_exception("Node '" + myprec.first.first + "' of a port precision does not exist.");
+        }
+        const auto& prec = myprec.second;
+        auto result = gc.request_port_precision(itnode->second.index, myprec.first.second, prec.mode, prec.scale, prec.max_abs_error, prec.max_rel_error);
+        if (result.first < 0) {
+            // Error
+            throw smnchai_exception("Could not set the precision of " + myprec.first.first + '/' + myprec.first.second +
+                                    " with Error code " + std::to_string(result.first) +
+                                    (result.second.empty()?".":(" (" + result.second + ").")));
+        }
+    }
+    
     // Copy the settings to GC
     gc.ack_timeout = m_settings.m_ack_timeout;
+    gc.conservative_mode = m_settings.m_conservative;
+    gc.relaxation_max_iterations = m_settings.m_relaxation_iterations;
+    gc.microstep_max_iterations = m_settings.m_microsteps;
+    gc.pipelined_steps = m_settings.m_pipelined_steps;
     
     if (!gc.setSimulationTimeUnit(m_settings.m_time_unit)) {
         throw smnchai_exception("Error while setting simulation time unit.");
@@ -837,12 +1036,503 @@ void SMNChai::WorkSpace::generate_obn_system(OBNsmn::GCThread &gc, SMNChai::SMNC
     }
     
     // Note that time values are mostly real numbers in microseconds, so we need to convert them to integer numbers in the time unit.
-    if (!gc.setFinalSimulationTime(get_time_value(m_settings.m_final_time))) {
+    // The start and stop times given to the program (e.g. for a time slice) override those of the script; the simulation stops before the stop time.
+    OBNsim::simtime_t final_time = (m_settings.m_sys_stop_time >= 0.0)?(get_time_value(m_settings.m_sys_stop_time) - 1):get_time_value(m_settings.m_final_time);
+    if (!gc.setFinalSimulationTime(final_time)) {
         throw smnchai_exception("Error while setting final simulation time.");
     }
+    
+    if (!gc.setInitialSimulationTime(get_time_value((m_settings.m_sys_start_time >= 0.0)?m_settings.m_sys_start_time:m_settings.m_initial_time))) {
+        throw smnchai_exception("Error while setting initial simulation time.");
+    }
+    
+    // Initial states of the nodes, and collection of their final states
+    if (!m_settings.m_sys_state_in.empty()) {
+        Parareal::States states;
+        if (!Parareal::read_states(m_settings.m_sys_state_in, states)) {
+            throw smnchai_exception("Could not read the initial states of the nodes from " + m_settings.m_sys_state_in);
+        }
+        for (auto& mystate: states) {
+            auto mynode = m_nodes.find(mystate.first);
+            if (mynode == m_nodes.end()) {
+                throw smnchai_exception("The initial state of node '" + mystate.first + "' is given but the node does not exist.");
+            }
+            gc.setInitialState(mynode->second.index, OBNsim::Utils::encodeState(mystate.second));
+        }
+    }
+    gc.collect_final_states = !m_settings.m_sys_state_out.empty();
 }
 
 
+/* An output port only needs to be published at the steps its consumers sample it.
+ If every block of every consumer node is periodic, the consumers sample the output only at the multiples of the GCD Q of their periods.
+ If moreover every block producing the output is periodic with a period dividing Q, the output is recomputed at each of these multiples
+ before it is read (the dependency graph orders the producer first for direct feedthrough, and UPDATE_X comes after all UPDATE_Y),
+ so the values produced in between are never read and the producer is asked to publish the port only at the multiples of Q.
+ Outputs which trigger blocks, feed data ports, or are connected to nodes with irregular blocks are always published.
+ The consumers must not request irregular updates or micro-steps of their periodic blocks, which would sample the output at other times.
+ Blocks shifted by phase offsets are not updated at the multiples of their periods, so they are treated as non-periodic.
+ */
+void SMNChai::WorkSpace::generate_output_decimation(OBNsmn::GCThread &gc) {
+    auto gcd = [](OBNsim::simtime_t a, OBNsim::simtime_t b) {
+        while (b != 0) {
+            auto r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    };
+    
+    // GCD of the periods of the blocks of a node in a mask (all blocks if the mask is 0); 0 if any of these blocks is not periodic
+    auto blocks_period = [this, &gcd](const SMNChai::Node& node, OBNsim::updatemask_t mask) {
+        OBNsim::simtime_t q = 0;
+        for (auto& myupdate: node.m_updates) {
+            if (mask != 0 && (mask & (OBNsim::updatemask_t(1) << myupdate.first)) == 0) {
+                continue;
+            }
+            auto p = get_time_value(myupdate.second.sampling_time);
+            if (p <= 0 || get_phase_offset(node.get_name(), myupdate.first) != 0) {
+                return OBNsim::simtime_t(0);
+            }
+            q = gcd(p, q);
+        }
+        return q;
+    };
+    
+    // The sampling period of each output port (node name, port name) by all its consumers; 0 if it can't be decimated
+    std::map<std::pair<std::string, std::string>, OBNsim::simtime_t> sampling;
+    for (auto& myconn: m_connections) {
+        if (myconn.first.port_type != PortInfo::OUTPUT) {
+            continue;
+        }
+        auto key = std::make_pair(myconn.first.node_name, myconn.first.port_name);
+        auto it = sampling.emplace(key, OBNsim::simtime_t(-1)).first;     // -1 = no consumer yet
+        if (it->second == 0) {
+            continue;
+        }
+        
+        const auto& consumer = m_nodes.at(myconn.second.node_name).node;
+        OBNsim::simtime_t q = 0;
+        if (myconn.second.port_type == PortInfo::INPUT && consumer.input_triggermask(myconn.second.port_name) == 0) {
+            q = blocks_period(consumer, 0);
+        }
+        it->second = (q > 0 && it->second > 0)?gcd(it->second, q):q;
+    }
+    
+    int ndecimated = 0;
+    for (auto& port: sampling) {
+        auto q = port.second;
+        if (q <= 0) {
+            continue;
+        }
+        
+        const auto& producer = m_nodes.at(port.first.first);
+        auto p = blocks_period(producer.node, producer.node.output_updatemask(port.first.second));
+        if (p <= 0 || q % p != 0 || q == p) {
+            // Some producing blocks are not recomputed at every sample, or there is nothing to decimate
+            continue;
+        }
+        
+        auto result = gc.request_port_decimation(producer.index, port.first.second, q);
+        if (result.first < 0) {
+            // The node does not support output decimation: the port is published at every change
+            OBNsmn::report_warning(0, "Could not decimate the output " + port.first.first + "/" + port.first.second + "; it is published at every change.");
+        } else {
+            ++ndecimated;
+        }
+    }
+    
+    if (ndecimated > 0) {
+        OBNsmn::report_info(0, "Decimated " + std::to_string(ndecimated) + " output ports.");
+    }
+}
+
+
+/* Periodic blocks sharing a period all update at the same steps, so the GC sends long waves of UPDATE_Y at these steps and none in between.
+ A periodic block may be delayed by a phase offset up to its tolerance (see Node::set_phase_tolerance), i.e. updated at offset + k*period.
+ To preserve the dependency semantics, the blocks linked by a direct feedthrough, a trigger or an internal dependency are shifted together,
+ so they are still updated at the same steps and ordered by the dependency graph: these groups are the connected components of the links.
+ The offset of a group is bounded by the smallest tolerance of its blocks and is less than its smallest period; a group with an irregular block is not shifted.
+ The groups are placed greedily, the largest first, each at the multiple of the phase resolution which minimizes the number of updates of already placed blocks
+ at the same steps (per unit of time); ties are broken by the smallest offset.
+ */
+void SMNChai::WorkSpace::generate_phase_offsets() {
+    auto gcd = [](OBNsim::simtime_t a, OBNsim::simtime_t b) {
+        while (b != 0) {
+            auto r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    };
+    
+    // All blocks of all nodes, with their periods and tolerances in time unit
+    struct Block {
+        std::string node;
+        unsigned int id;
+        OBNsim::simtime_t period;       // 0 if the block is not periodic
+        OBNsim::simtime_t tolerance;
+    };
+    std::vector<Block> blocks;
+    std::map<std::pair<std::string, unsigned int>, std::size_t> block_index;
+    for (auto& mynode: m_nodes) {
+        for (auto& myupdate: mynode.second.node.m_updates) {
+            block_index.emplace(std::make_pair(mynode.first, myupdate.first), blocks.size());
+            blocks.push_back(Block{mynode.first, myupdate.first, get_time_value(myupdate.second.sampling_time),
+                OBNsim::simtime_t(std::floor(myupdate.second.phase_tolerance / double(m_settings.m_time_unit)))});
+        }
+    }
+    
+    // Union-find of the groups of blocks
+    std::vector<std::size_t> parent(blocks.size());
+    for (std::size_t k = 0; k < parent.size(); ++k) {
+        parent[k] = k;
+    }
+    auto find = [&parent](std::size_t k) {
+        while (parent[k] != k) {
+            parent[k] = parent[parent[k]];
+            k = parent[k];
+        }
+        return k;
+    };
+    
+    // Merge the blocks in the masks of two nodes into one group
+    auto merge = [&](const std::string& node1, OBNsim::updatemask_t mask1, const std::string& node2, OBNsim::updatemask_t mask2) {
+        std::size_t root = blocks.size();   // not yet found
+        auto merge_mask = [&](const std::string& node, OBNsim::updatemask_t mask) {
+            for (unsigned int id = 0; id <= OBNsim::MAX_UPDATE_INDEX; ++id) {
+                if ((mask & (OBNsim::updatemask_t(1) << id)) == 0) {
+                    continue;
+                }
+                auto it = block_index.find(std::make_pair(node, id));
+                if (it == block_index.end()) {
+                    continue;
+                }
+                auto k = find(it->second);
+                if (root == blocks.size()) {
+                    root = k;
+                } else {
+                    parent[k] = root;
+                }
+            }
+        };
+        merge_mask(node1, mask1);
+        merge_mask(node2, mask2);
+    };
+    
+    for (auto& myconn: m_connections) {
+        if (myconn.first.port_type != PortInfo::OUTPUT || myconn.second.port_type != PortInfo::INPUT) {
+            continue;
+        }
+        const auto& src_node = m_nodes.at(myconn.first.node_name).node;
+        const auto& tgt_node = m_nodes.at(myconn.second.node_name).node;
+        OBNsim::updatemask_t src_mask = src_node.output_updatemask(myconn.first.port_name);
+        OBNsim::updatemask_t tgt_mask = tgt_node.input_updatemask(myconn.second.port_name) | tgt_node.input_triggermask(myconn.second.port_name);
+        if (src_mask != 0 && tgt_mask != 0) {
+            merge(myconn.first.node_name, src_mask, myconn.second.node_name, tgt_mask);
+        }
+    }
+    
+    for (auto& mynode: m_nodes) {
+        for (auto& myupdate: mynode.second.node.m_updates) {
+            for (unsigned int src: myupdate.second.dependencies) {
+                merge(mynode.first, OBNsim::updatemask_t(1) << src, mynode.first, OBNsim::updatemask_t(1) << myupdate.first);
+            }
+        }
+    }
+    
+    // Collect the groups and the bounds of their offsets
+    struct Group {
+        std::vector<std::size_t> blocks;    // The periodic blocks of the group
+        OBNsim::simtime_t max_offset = -1;  // -1 = not yet bounded
+        bool fixed = false;                 // Whether the group has an irregular block
+    };
+    std::map<std::size_t, Group> groups;
+    for (std::size_t k = 0; k < blocks.size(); ++k) {
+        auto& g = groups[find(k)];
+        if (blocks[k].period <= 0) {
+            g.fixed = true;
+            continue;
+        }
+        g.blocks.push_back(k);
+        auto bound = std::min(blocks[k].tolerance, blocks[k].period - 1);
+        g.max_offset = (g.max_offset < 0)?bound:std::min(g.max_offset, bound);
+    }
+    
+    // The groups which are not shifted are placed first, then the others in decreasing order of their sizes
+    std::vector<Group*> order;
+    for (auto& g: groups) {
+        if (g.second.fixed || g.second.max_offset <= 0) {
+            g.second.max_offset = 0;
+            order.push_back(&g.second);
+        }
+    }
+    auto nfixed = order.size();
+    for (auto& g: groups) {
+        if (g.second.max_offset > 0) {
+            order.push_back(&g.second);
+        }
+    }
+    std::stable_sort(order.begin() + nfixed, order.end(), [](const Group* a, const Group* b) { return a->blocks.size() > b->blocks.size(); });
+    
+    // Number of placed blocks of each period and phase (offset modulo period)
+    std::map<std::pair<OBNsim::simtime_t, OBNsim::simtime_t>, std::size_t> load;
+    
+    // Number of updates per unit of time of the placed blocks at the same steps as the blocks of a group, if the group is shifted by an offset
+    // (two blocks of periods p and q and offsets a and b update together once every p*q/gcd(p,q) iff a and b are congruent modulo gcd(p,q))
+    auto coincidences = [&](const Group& g, OBNsim::simtime_t offset) {
+        double c = 0.0;
+        for (auto k: g.blocks) {
+            auto p = blocks[k].period;
+            for (auto& l: load) {
+                auto q = gcd(p, l.first.first);
+                if ((offset - l.first.second) % q == 0) {
+                    c += double(l.second) * double(q) / (double(p) * double(l.first.first));
+                }
+            }
+        }
+        return c;
+    };
+    
+    const OBNsim::simtime_t MAX_CANDIDATES = 64;    // Maximum number of offsets tried for a group
+    OBNsim::simtime_t resolution = std::max<OBNsim::simtime_t>(1, std::llround(m_settings.m_phase_resolution / double(m_settings.m_time_unit)));
+    
+    std::size_t nperiodic = 0, nshifted = 0;
+    for (auto g: order) {
+        OBNsim::simtime_t best = 0;
+        if (g->max_offset > 0) {
+            auto step = resolution;
+            if (g->max_offset / step > MAX_CANDIDATES) {
+                step = resolution * ((g->max_offset / resolution + MAX_CANDIDATES - 1) / MAX_CANDIDATES);
+            }
+            double best_cost = coincidences(*g, 0);
+            for (auto offset = step; offset <= g->max_offset; offset += step) {
+                auto c = coincidences(*g, offset);
+                if (c < best_cost) {
+                    best_cost = c;
+                    best = offset;
+                }
+            }
+        }
+        
+        for (auto k: g->blocks) {
+            ++load[std::make_pair(blocks[k].period, best % blocks[k].period)];
+            if (best > 0) {
+                m_phase_offsets[std::make_pair(blocks[k].node, blocks[k].id)] = best;
+                ++nshifted;
+            }
+        }
+        nperiodic += g->blocks.size();
+    }
+    
+    OBNsmn::report_info(0, "Phase offsets: shifted " + std::to_string(nshifted) + " of " + std::to_string(nperiodic) + " periodic blocks.");
+}
+
+
+void SMNChai::WorkSpace::perf_check_node(const SMNChai::Node &t_node) const {
+    if (m_nodes.count(t_node.get_name()) == 0) {
+        throw smnchai_exception("Node '" + t_node.get_name() + "' is not in the workspace.");
+    }
+}
+
+void SMNChai::WorkSpace::perf_node_cost(const SMNChai::Node &t_node, double t_ymean, double t_ystddev, double t_xmean, double t_xstddev) {
+    perf_check_node(t_node);
+    if (t_ymean < 0.0 || t_ystddev < 0.0 || t_xmean < 0.0 || t_xstddev < 0.0) {
+        throw smnchai_exception("The costs of node '" + t_node.get_name() + "' must be non-negative.");
+    }
+    PerfModel::NodeCost cost;
+    cost.y.mean = t_ymean;
+    cost.y.stddev = t_ystddev;
+    cost.x.mean = t_xmean;
+    cost.x.stddev = t_xstddev;
+    m_perfmodel.set_node_cost(t_node.get_name(), cost);
+}
+
+void SMNChai::WorkSpace::perf_default_cost(double t_ymean, double t_ystddev, double t_xmean, double t_xstddev) {
+    if (t_ymean < 0.0 || t_ystddev < 0.0 || t_xmean < 0.0 || t_xstddev < 0.0) {
+        throw smnchai_exception("The default costs of the nodes must be non-negative.");
+    }
+    m_perfmodel.default_cost.y.mean = t_ymean;
+    m_perfmodel.default_cost.y.stddev = t_ystddev;
+    m_perfmodel.default_cost.x.mean = t_xmean;
+    m_perfmodel.default_cost.x.stddev = t_xstddev;
+}
+
+void SMNChai::WorkSpace::perf_node_host(const SMNChai::Node &t_node, const std::string &t_host) {
+    perf_check_node(t_node);
+    m_perfmodel.set_node_host(t_node.get_name(), t_host);
+}
+
+void SMNChai::WorkSpace::perf_host_cores(const std::string &t_host, int t_cores) {
+    if (t_cores <= 0) {
+        throw smnchai_exception("The number of cores of host '" + t_host + "' must be positive, but " + std::to_string(t_cores) + " is given.");
+    }
+    m_perfmodel.set_host_cores(t_host, t_cores);
+}
+
+void SMNChai::WorkSpace::perf_block_period(const SMNChai::Node &t_node, unsigned int t_id, double t_period) {
+    perf_check_node(t_node);
+    if (m_nodes.at(t_node.get_name()).node.m_updates.count(t_id) == 0) {
+        throw smnchai_exception("Block " + std::to_string(t_id) + " does not exist on node '" + t_node.get_name() + "'.");
+    }
+    if (t_period < 0.0) {
+        throw smnchai_exception("The period of a block must be non-negative.");
+    }
+    m_perf_periods[std::make_pair(t_node.get_name(), t_id)] = t_period;
+}
+
+void SMNChai::WorkSpace::perf_messaging(double t_send, double t_ack, double t_local, double t_remote) {
+    if (t_send < 0.0 || t_ack < 0.0 || t_local < 0.0 || t_remote < 0.0) {
+        throw smnchai_exception("The messaging costs and latencies must be non-negative.");
+    }
+    m_perfmodel.send_cost = t_send;
+    m_perfmodel.ack_cost = t_ack;
+    m_perfmodel.local_latency = t_local;
+    m_perfmodel.remote_latency = t_remote;
+}
+
+int SMNChai::WorkSpace::perf_calibrate(const std::string &t_dir) {
+    // The trace file of a process is named after it, with slashes replaced by dots (see OBNsim::Trace::startFromEnvironment)
+    auto trace_file = [&t_dir](std::string name) {
+        std::replace(name.begin(), name.end(), '/', '.');
+        return t_dir + '/' + name + ".trace.json";
+    };
+    
+    int ncalibrated = 0;
+    for (auto& mynode: m_nodes) {
+        if (m_perfmodel.calibrate_node(mynode.first, trace_file(get_full_path(mynode.first)))) {
+            ++ncalibrated;
+        } else {
+            OBNsmn::report_warning(0, "Could not calibrate the costs of node " + mynode.first + " from its trace.");
+        }
+    }
+    
+    if (!m_perfmodel.calibrate_gc(trace_file("_smn_"))) {
+        OBNsmn::report_warning(0, "Could not calibrate the message latencies from the trace of the SMN.");
+    }
+    return ncalibrated;
+}
+
+double SMNChai::WorkSpace::perf_forecast(double t_duration) {
+    if (t_duration <= 0.0) {
+        t_duration = m_settings.m_final_time;
+        if (t_duration >= double(std::numeric_limits<OBNsim::simtime_t>::max())) {
+            throw smnchai_exception("The duration of the forecast must be given because the final time of the simulation is not set.");
+        }
+    }
+    
+    // The phase offsets as they will be given to the GC
+    m_phase_offsets.clear();
+    if (m_settings.m_phase_offsets) {
+        generate_phase_offsets();
+    }
+    
+    // The network as it will be given to the GC (see generate_obn_system), with the nodes indexed in their order in the workspace
+    PerfModel::Network net;
+    net.time_unit = m_settings.m_time_unit;
+    std::map<std::string, int> index;
+    for (auto& mynode: m_nodes) {
+        index[mynode.first] = static_cast<int>(net.nodes.size());
+        PerfModel::Network::NodeDef def;
+        def.name = mynode.first;
+        def.updateX = mynode.second.node.m_updateX;
+        for (auto& myupdate: mynode.second.node.m_updates) {
+            auto period = m_perf_periods.find(std::make_pair(mynode.first, myupdate.first));
+            def.periods[myupdate.first] = get_time_value((period != m_perf_periods.end())?period->second:myupdate.second.sampling_time);
+            def.offsets[myupdate.first] = get_phase_offset(mynode.first, myupdate.first);
+        }
+        net.nodes.push_back(def);
+    }
+    
+    for (auto& myconn: m_connections) {
+        if (myconn.first.port_type != PortInfo::OUTPUT || myconn.second.port_type != PortInfo::INPUT) {
+            continue;
+        }
+        const auto& src_node = m_nodes.at(myconn.first.node_name).node;
+        const auto& tgt_node = m_nodes.at(myconn.second.node_name).node;
+        OBNsim::updatemask_t src_mask = src_node.output_updatemask(myconn.first.port_name);
+        OBNsim::updatemask_t tgt_mask = tgt_node.input_updatemask(myconn.second.port_name);
+        OBNsim::updatemask_t trg_mask = tgt_node.input_triggermask(myconn.second.port_name);
+        int src = index.at(myconn.first.node_name), tgt = index.at(myconn.second.node_name);
+        if (src_mask != 0 && tgt_mask != 0) {
+            net.dependencies.push_back(PerfModel::Network::Link{src, tgt, src_mask, tgt_mask});
+        }
+        if (src_mask != 0 && trg_mask != 0) {
+            net.triggers.push_back(PerfModel::Network::Link{src, tgt, src_mask, trg_mask});
+        }
+    }
+    
+    for (auto& mynode: m_nodes) {
+        int id = index.at(mynode.first);
+        for (auto& myupdate: mynode.second.node.m_updates) {
+            if (!myupdate.second.dependencies.empty()) {
+                OBNsim::updatemask_t src_mask = 0;
+                for (unsigned int src: myupdate.second.dependencies) {
+                    src_mask |= (OBNsim::updatemask_t(1) << src);
+                }
+                net.dependencies.push_back(PerfModel::Network::Link{id, id, src_mask, OBNsim::updatemask_t(1) << myupdate.first});
+            }
+        }
+    }
+    
+    auto result = m_perfmodel.forecast(net, get_time_value(t_duration));
+    std::cout << result.report();
+    return result.steps_per_second();
+}
+
+void SMNChai::WorkSpace::parareal_configure(const std::string &t_script, const std::string &t_coarse_args, const std::string &t_fine_args) {
+    if (t_script.empty()) {
+        throw smnchai_exception("The script of the Parareal simulation must be non-empty.");
+    }
+    m_parareal.script = t_script;
+    m_parareal.coarse_args = t_coarse_args;
+    m_parareal.fine_args = t_fine_args;
+}
+
+void SMNChai::WorkSpace::parareal_slices(int t_slices, int t_concurrency) {
+    if (t_slices <= 0 || t_concurrency < 0) {
+        throw smnchai_exception("The number of Parareal time slices must be positive and the concurrency non-negative.");
+    }
+    m_parareal.slices = t_slices;
+    m_parareal.concurrency = t_concurrency;
+}
+
+void SMNChai::WorkSpace::parareal_convergence(double t_tolerance, int t_max_iterations) {
+    if (t_tolerance < 0.0 || t_max_iterations < 0) {
+        throw smnchai_exception("The Parareal tolerance and maximum number of iterations must be non-negative.");
+    }
+    m_parareal.tolerance = t_tolerance;
+    m_parareal.max_iterations = t_max_iterations;
+}
+
+void SMNChai::WorkSpace::parareal_files(const std::string &t_work_dir, const std::string &t_initial_states) {
+    if (t_work_dir.empty()) {
+        throw smnchai_exception("The Parareal work directory must be non-empty.");
+    }
+    m_parareal.work_dir = t_work_dir;
+    m_parareal.initial_states = t_initial_states;
+}
+
+int SMNChai::WorkSpace::parareal_run(double t_start, double t_final) {
+    // The orchestrator doesn't run the simulation of its workspace, and nothing is run in a dry run
+    bool dryrun = !m_settings.will_run_simulation();
+    m_settings.m_run_simulation = false;
+    if (dryrun) {
+        return 0;
+    }
+    
+    if (t_final <= 0.0) {
+        t_final = m_settings.m_final_time;
+        if (t_final >= double(std::numeric_limits<OBNsim::simtime_t>::max())) {
+            throw smnchai_exception("The final time of the Parareal simulation must be given because the final time of the simulation is not set.");
+        }
+    }
+    
+    m_parareal.time_unit = m_settings.m_time_unit;
+    auto result = m_parareal.run(t_start, t_final);
+    return result.converged?int(result.iterations):-1;
+}
+
 void SMNChai::WorkSpace::obndocker_node(const SMNChai::Node& node, const std::string& machine, const std::string& image, const std::string& cmd, const std::string& src, const std::string& extra)
 {
     // name, machine, image, cmd, src
@@ -0,0 +1,298 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Implementation of the parallel launcher of node processes for SMNChai.
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <thread>
+#include <iostream>
+
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>     // getpid, gethostname
+#include <cstring>      // strerror
+
+#include <smnchai_api.h>
+#include <smnchai_launcher.h>
+
+extern char **environ;
+
+using namespace SMNChai;
+
+std::string SMNChai::shell_quote(const std::string& s) {
+    std::string r("'");
+    for (char c: s) {
+        if (c == '\'') {
+            r += "'\\''";
+        } else {
+            r += c;
+        }
+    }
+    r += '\'';
+    return r;
+}
+
+pid_t SMNChai::spawn_shell(const std::string& cmd, const std::string& what) {
+    std::string command(cmd);
+    char sh[] = "/bin/sh";
+    char opt[] = "-c";
+    char *argv[] = {sh, opt, &command[0], nullptr};
+
+    pid_t pid;
+    int rc = posix_spawn(&pid, "/bin/sh", nullptr, nullptr, argv, environ);
+    if (rc != 0) {
+        throw smnchai_exception("Could not start " + what + ": " + std::strerror(rc));
+    }
+    return pid;
+}
+
+void SMNChai::terminate_processes(const std::vector<pid_t>& pids) {
+    for (auto pid: pids) {
+        kill(pid, SIGTERM);
+    }
+
+    // Give the processes a moment to exit cleanly, then kill those still running
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    std::vector<pid_t> running(pids);
+    while (!running.empty()) {
+        running.erase(std::remove_if(running.begin(), running.end(), [](pid_t pid) {
+            int status;
+            return waitpid(pid, &status, WNOHANG) != 0;
+        }), running.end());
+        if (running.empty()) {
+            break;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            for (auto pid: running) {
+                kill(pid, SIGKILL);
+                int status;
+                waitpid(pid, &status, 0);
+            }
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+SMNChai::NodeLauncher::~NodeLauncher() {
+    reap();
+}
+
+void SMNChai::NodeLauncher::reap() {
+    m_processes.erase(std::remove_if(m_processes.begin(), m_processes.end(), [this](pid_t pid) {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) != 0) {
+            m_remote.erase(pid);
+            return true;
+        }
+        return false;
+    }), m_processes.end());
+}
+
+pid_t SMNChai::NodeLauncher::spawn(const Job& job, int cpu) {
+    // The command to run the node, on the local computer or on the remote host
+    std::string cmd;
+    if (!job.workdir.empty()) {
+        cmd = "cd " + shell_quote(job.workdir) + " && ";
+    }
+    cmd += "exec ";
+    if (cpu >= 0) {
+        // The node is pinned with taskset, on the local computer as on a remote host, so it is pinned from its start
+        cmd += "taskset -c " + std::to_string(cpu) + ' ';
+    }
+    cmd += job.prog;
+    if (!job.args.empty()) {
+        cmd += ' ' + job.args;
+    }
+
+    RemoteProcess remote;
+    if (!job.host.empty()) {
+        // The SSH client runs locally and executes the command on the remote host.
+        // Killing the SSH client doesn't stop the remote node, so the remote shell runs the node in the background and writes its PID to a file, for kill_remote().
+        char hostname[256] = "";
+        gethostname(hostname, sizeof(hostname) - 1);
+        remote.node = job.node;
+        remote.host = job.host;
+        remote.pidfile = "/tmp/smnchai-" + std::string(hostname) + '-' + std::to_string(getpid()) + '-' + std::to_string(m_next_remote++) + ".pid";
+
+        std::string script = "f=" + shell_quote(remote.pidfile) + "; (" + cmd + ") & p=$!; echo $p > \"$f\"; wait $p; r=$?; rm -f \"$f\"; exit $r";
+        cmd = "exec " + ssh_command + ' ' + shell_quote(job.host) + ' ' + shell_quote("sh -c " + shell_quote(script));
+    }
+
+    pid_t pid = spawn_shell(cmd, "the process of node '" + job.node + "'");
+    m_processes.push_back(pid);
+    if (!job.host.empty()) {
+        m_remote[pid] = remote;
+    }
+
+    return pid;
+}
+
+void SMNChai::NodeLauncher::kill_remote(const std::vector<pid_t>& pids) {
+    auto report = [](const RemoteProcess& r) {
+        std::cerr << "WARNING: The process of node '" << r.node << "' on host " << r.host <<
+            " could not be killed and may still be running; its PID is in " << r.pidfile << " on that host." << std::endl;
+    };
+
+    // Kill the nodes on all the hosts in parallel: SIGTERM, then SIGKILL if the node is still running after a few seconds
+    std::vector< std::pair<pid_t, RemoteProcess> > killers;
+    for (auto pid: pids) {
+        auto it = m_remote.find(pid);
+        if (it == m_remote.end()) {
+            continue;
+        }
+        const RemoteProcess& r = it->second;
+        std::string script = "f=" + shell_quote(r.pidfile) + "; [ -f \"$f\" ] || exit 0; p=$(cat \"$f\"); kill -TERM $p 2>/dev/null; "
+            "for i in 1 2 3; do kill -0 $p 2>/dev/null || break; sleep 1; done; kill -KILL $p 2>/dev/null; rm -f \"$f\"; exit 0";
+        try {
+            pid_t killer = spawn_shell("exec " + ssh_command + ' ' + shell_quote(r.host) + ' ' + shell_quote("sh -c " + shell_quote(script)),
+                                       "the SSH client to kill node '" + r.node + "'");
+            killers.emplace_back(killer, r);
+        } catch (smnchai_exception&) {
+            report(r);
+        }
+        m_remote.erase(it);
+    }
+
+    // Wait for the SSH clients; a client that fails or hangs means the node may have been left running
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+    while (!killers.empty()) {
+        killers.erase(std::remove_if(killers.begin(), killers.end(), [&report](const std::pair<pid_t, RemoteProcess>& k) {
+            int status;
+            pid_t rc = waitpid(k.first, &status, WNOHANG);
+            if (rc == 0) {
+                return false;
+            }
+            if (rc < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                report(k.second);
+            }
+            return true;
+        }), killers.end());
+        if (killers.empty()) {
+            break;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            for (auto& k: killers) {
+                kill(k.first, SIGKILL);
+                int status;
+                waitpid(k.first, &status, 0);
+                report(k.second);
+            }
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+void SMNChai::NodeLauncher::terminate(const std::vector<pid_t>& pids) {
+    kill_remote(pids);
+    terminate_processes(pids);
+    m_processes.erase(std::remove_if(m_processes.begin(), m_processes.end(), [&pids](pid_t pid) {
+        return std::find(pids.begin(), pids.end(), pid) != pids.end();
+    }), m_processes.end());
+}
+
+void SMNChai::NodeLauncher::run(const ReadyFunc& isReady, int max_concurrency, double timeout) {
+    // Take the jobs out of the queue, so that it is empty whatever happens
+    std::vector<Job> jobs;
+    jobs.swap(m_jobs);
+
+    reap();
+
+    unsigned int ncpus = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t max_inflight = (max_concurrency > 0)?std::size_t(max_concurrency):std::size_t(ncpus);
+
+    // The jobs started but whose nodes are not online yet
+    struct InFlight {
+        std::size_t job;
+        pid_t pid;
+        std::chrono::steady_clock::time_point start;
+    };
+    std::list<InFlight> inflight;
+    std::vector<pid_t> started;     // The processes started by this run, killed if it fails
+
+    std::size_t next = 0;       // Next job to start
+    std::size_t nstarted = 0, nonline = 0;
+    int next_cpu = 0;           // Next CPU for automatic pinning
+    auto start_all = std::chrono::steady_clock::now();
+
+    try {
+        while (next < jobs.size() || !inflight.empty()) {
+            // Fill the free slots with new jobs
+            while (inflight.size() < max_inflight && next < jobs.size()) {
+                const Job& job = jobs[next];
+                if (isReady(job.node)) {
+                    // Skip the nodes that are already online
+                    if (verbose) {
+                        std::cout << "Node " << job.node << " is already online." << std::endl;
+                    }
+                } else {
+                    int cpu = job.cpu;
+                    if (cpu < 0 && auto_pinning && job.host.empty()) {
+                        cpu = (next_cpu++) % ncpus;
+                    }
+                    pid_t pid = spawn(job, cpu);
+                    started.push_back(pid);
+                    inflight.push_back(InFlight{next, pid, std::chrono::steady_clock::now()});
+                    ++nstarted;
+                }
+                ++next;
+            }
+
+            if (inflight.empty()) {
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            // Check the jobs in flight
+            auto now = std::chrono::steady_clock::now();
+            for (auto it = inflight.begin(); it != inflight.end(); ) {
+                const Job& job = jobs[it->job];
+                if (isReady(job.node)) {
+                    ++nonline;
+                    if (verbose) {
+                        std::chrono::duration<double> dur = now - it->start;
+                        std::cout << "Node " << job.node << " is online after " << dur.count() << " s (" << nonline << '/' << nstarted << " started nodes)." << std::endl;
+                    }
+                    it = inflight.erase(it);
+                    continue;
+                }
+
+                int status;
+                if (waitpid(it->pid, &status, WNOHANG) == it->pid) {
+                    // Already reaped, so it must not be killed (a remote node has exited too, as its shell waits for it)
+                    m_processes.erase(std::remove(m_processes.begin(), m_processes.end(), it->pid), m_processes.end());
+                    m_remote.erase(it->pid);
+                    started.erase(std::remove(started.begin(), started.end(), it->pid), started.end());
+                    throw smnchai_exception("The process of node '" + job.node + "' exited" +
+                                            (WIFEXITED(status)?(" with code " + std::to_string(WEXITSTATUS(status))):std::string()) +
+                                            " before the node went online.");
+                }
+
+                std::chrono::duration<double> dur = now - it->start;
+                if (timeout > 0.0 && dur.count() > timeout) {
+                    throw smnchai_exception("Waiting for node '" + job.node + "' to go online after starting it but timeout occurred.");
+                }
+                ++it;
+            }
+        }
+    } catch (...) {
+        // The launch failed: don't leave the started nodes behind
+        terminate(started);
+        throw;
+    }
+
+    if (verbose && nstarted > 0) {
+        std::chrono::duration<double> dur = std::chrono::steady_clock::now() - start_all;
+        std::cout << "Started " << nstarted << " nodes in " << dur.count() << " s." << std::endl;
+    }
+}
@@ -144,6 +144,19 @@ std::pair<bool, int> SMNChai::smnchai_loadscript(const std::string& script_file,
         ws.m_settings.m_sys_run_simulation = false;     // Force no-simulation
         ws.m_settings.m_dockerlist = sys_settings.dockerlist;
     }
+    ws.m_settings.m_sys_start_time = sys_settings.start_time;
+    ws.m_settings.m_sys_stop_time = sys_settings.stop_time;
+    ws.m_settings.m_sys_state_in = sys_settings.state_in;
+    ws.m_settings.m_sys_state_out = sys_settings.state_out;
+    if (!sys_settings.workspace_suffix.empty()) {
+        try {
+            ws.set_name_suffix(sys_settings.workspace_suffix);
+            ws.set_name(default_workspace);
+        } catch (const SMNChai::smnchai_exception &e) {
+            std::cerr << "SMNChai error:\n" << e.what() << std::endl;
+            return std::make_pair(false, 2);
+        }
+    }
     
     SMNChai::registerSMNAPI(chai, ws);
     
@@ -0,0 +1,341 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Implementation of the time-parallel (Parareal) orchestrator of SMNChai.
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <sys/wait.h>
+
+#include <boost/filesystem.hpp>
+
+#include <smnchai_api.h>
+#include <smnchai_launcher.h>     // shell_quote, spawn_shell, terminate_processes
+#include <smnchai_parareal.h>
+
+extern std::string SMNChai_program_name;
+
+using namespace SMNChai;
+
+namespace {
+    // Format a time value with all its digits
+    std::string time_string(double t) {
+        std::ostringstream os;
+        os << std::setprecision(17) << t;
+        return os.str();
+    }
+
+    // Compute the corrected states G + F - Gold for every node
+    Parareal::States correct_states(const Parareal::States& G, const Parareal::States& F, const Parareal::States& Gold) {
+        if (G.size() != F.size() || Gold.size() != F.size()) {
+            throw smnchai_exception("Parareal: the coarse and the fine configurations don't have the same nodes with states.");
+        }
+
+        Parareal::States result;
+        for (const auto& f: F) {
+            auto g = G.find(f.first), gold = Gold.find(f.first);
+            if (g == G.end() || gold == Gold.end() || g->second.size() != f.second.size() || gold->second.size() != f.second.size()) {
+                throw smnchai_exception("Parareal: the state of node '" + f.first + "' doesn't have the same size in the coarse and the fine configurations.");
+            }
+
+            std::vector<double>& v = result[f.first];
+            v.resize(f.second.size());
+            for (std::size_t i = 0; i < v.size(); ++i) {
+                v[i] = g->second[i] + f.second[i] - gold->second[i];
+            }
+        }
+        return result;
+    }
+
+    // The largest difference between two states; infinite if they don't have the same nodes and sizes
+    double max_difference(const Parareal::States& A, const Parareal::States& B) {
+        if (A.size() != B.size()) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double delta = 0.0;
+        for (const auto& a: A) {
+            auto b = B.find(a.first);
+            if (b == B.end() || b->second.size() != a.second.size()) {
+                return std::numeric_limits<double>::infinity();
+            }
+            for (std::size_t i = 0; i < a.second.size(); ++i) {
+                delta = std::max(delta, std::abs(a.second[i] - b->second[i]));
+            }
+        }
+        return delta;
+    }
+}
+
+bool SMNChai::Parareal::read_states(const std::string& filename, States& states) {
+    std::ifstream file(filename);
+    if (!file) {
+        return false;
+    }
+
+    states.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream is(line);
+        std::string name;
+        if (!(is >> name)) {
+            continue;   // Empty line
+        }
+        std::vector<double>& v = states[name];
+        v.clear();
+        double d;
+        while (is >> d) {
+            v.push_back(d);
+        }
+        if (!is.eof()) {
+            return false;   // Not a number
+        }
+    }
+    return true;
+}
+
+bool SMNChai::Parareal::write_states(const std::string& filename, const States& states) {
+    std::ofstream file(filename);
+    if (!file) {
+        return false;
+    }
+
+    file << std::setprecision(17);
+    for (const auto& s: states) {
+        file << s.first;
+        for (double d: s.second) {
+            file << ' ' << d;
+        }
+        file << '\n';
+    }
+    file.close();
+    return !file.fail();
+}
+
+pid_t SMNChai::Parareal::spawn(const Instance& inst) const {
+    std::string cmd = "exec " + shell_quote(m_program) +
+        " --start-time " + time_string(inst.start) +
+        " --stop-time " + time_string(inst.stop) +
+        " --state-out " + shell_quote(inst.state_out) +
+        " --workspace-suffix " + inst.suffix;
+    if (!inst.state_in.empty()) {
+        cmd += " --state-in " + shell_quote(inst.state_in);
+    }
+    cmd += ' ' + shell_quote(script);
+    if (!inst.args->empty()) {
+        cmd += ' ' + *inst.args;
+    }
+    cmd += " > " + shell_quote(inst.log) + " 2>&1";
+
+    return spawn_shell(cmd, "the Parareal instance " + inst.suffix);
+}
+
+std::vector<Parareal::States> SMNChai::Parareal::run_instances(const std::vector<Instance>& instances, unsigned int max_running) const {
+    std::vector<States> results(instances.size());
+    std::vector<pid_t> running;     // PIDs of the running instances
+    std::vector<std::size_t> running_index;
+    std::size_t next = 0;
+
+    // Stop the running instances if one fails
+    auto stop_all = [&running]() {
+        terminate_processes(running);
+    };
+
+    while (next < instances.size() || !running.empty()) {
+        // Start new instances in the free slots
+        while (running.size() < max_running && next < instances.size()) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(instances[next].state_out, ec);   // Don't read stale states
+            try {
+                running.push_back(spawn(instances[next]));
+            } catch (...) {
+                stop_all();
+                throw;
+            }
+            running_index.push_back(next);
+            ++next;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // Check the running instances
+        for (std::size_t i = 0; i < running.size(); ) {
+            int status;
+            if (waitpid(running[i], &status, WNOHANG) != running[i]) {
+                ++i;
+                continue;
+            }
+
+            std::size_t idx = running_index[i];
+            const Instance& inst = instances[idx];
+            running.erase(running.begin() + i);
+            running_index.erase(running_index.begin() + i);
+
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !read_states(inst.state_out, results[idx])) {
+                stop_all();
+                throw smnchai_exception("Parareal: the instance " + inst.suffix + " (from " + time_string(inst.start) + " to " + time_string(inst.stop) +
+                                        ") failed or didn't give the final states; see " + inst.log);
+            }
+        }
+    }
+
+    return results;
+}
+
+SMNChai::Parareal::Result SMNChai::Parareal::run(double start_time, double final_time) {
+    if (script.empty()) {
+        throw smnchai_exception("Parareal: the script of the system must be given.");
+    }
+    if (slices < 1) {
+        throw smnchai_exception("Parareal: the number of time slices must be positive.");
+    }
+    if (start_time < 0.0 || final_time <= start_time) {
+        throw smnchai_exception("Parareal: the final time must be after the start time.");
+    }
+    if (time_unit <= 0.0 || tolerance < 0.0) {
+        throw smnchai_exception("Parareal: the time unit must be positive and the tolerance non-negative.");
+    }
+
+    // The program run by the instances: this program by default
+    m_program = program;
+    if (m_program.empty()) {
+        boost::system::error_code ec;
+        auto self = boost::filesystem::read_symlink("/proc/self/exe", ec);
+        m_program = ec?SMNChai_program_name:self.string();
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(work_dir, ec);
+    if (ec) {
+        throw smnchai_exception("Parareal: could not create the work directory " + work_dir + ": " + ec.message());
+    }
+    auto path = [this](const std::string& name) {
+        return work_dir + '/' + name;
+    };
+
+    // The boundaries of the slices, at multiples of the time unit
+    const unsigned int N = slices;
+    std::vector<double> T(N+1);
+    T[0] = start_time;
+    T[N] = final_time;
+    for (unsigned int k = 1; k < N; ++k) {
+        T[k] = std::round((start_time + (final_time - start_time) * k / N) / time_unit) * time_unit;
+        if (T[k] <= T[k-1]) {
+            throw smnchai_exception("Parareal: too many time slices for the simulation interval and the time unit.");
+        }
+    }
+    if (T[N] <= T[N-1]) {
+        throw smnchai_exception("Parareal: too many time slices for the simulation interval and the time unit.");
+    }
+
+    // Boundary states U[k], coarse predictions G[k] and fine results F[k] of the slices
+    std::vector<States> U(N+1), G(N), F(N);
+    if (!initial_states.empty() && !read_states(initial_states, U[0])) {
+        throw smnchai_exception("Parareal: could not read the initial states from " + initial_states);
+    }
+
+    // The instance simulating slice k in a configuration, from the current U[k]
+    auto instance = [&](unsigned int k, bool fine) {
+        Instance inst;
+        inst.suffix = std::string(fine?"_pf":"_pg") + std::to_string(k);
+        inst.args = fine?&fine_args:&coarse_args;
+        inst.start = T[k];
+        inst.stop = T[k+1];
+        if (k > 0) {
+            inst.state_in = path("u" + std::to_string(k) + ".states");
+            if (!write_states(inst.state_in, U[k])) {
+                throw smnchai_exception("Parareal: could not write the states to " + inst.state_in);
+            }
+        } else {
+            inst.state_in = initial_states;
+        }
+        inst.state_out = path((fine?"f":"g") + std::to_string(k) + ".states");
+        inst.log = path((fine?"f":"g") + std::to_string(k) + ".log");
+        return inst;
+    };
+
+    // Initial prediction by the coarse configuration, sequentially
+    auto wall_start = std::chrono::steady_clock::now();
+    std::cout << "Parareal: " << N << " time slices from " << start_time << " to " << final_time << " us; initial coarse prediction..." << std::endl;
+    for (unsigned int k = 0; k < N; ++k) {
+        G[k] = run_instances(std::vector<Instance>{instance(k, false)}, 1)[0];
+        U[k+1] = G[k];
+    }
+
+    Result result;
+    std::vector<bool> changed(N+1, true);   // Whether U[k] changed since slice k was last simulated by the fine configuration
+    unsigned int max_iter = (max_iterations > 0)?max_iterations:N;
+    unsigned int max_running = (concurrency > 0)?concurrency:N;
+
+    while (result.iterations < max_iter) {
+        ++result.iterations;
+
+        // Fine simulations of the slices whose initial states changed, concurrently
+        std::vector<Instance> instances;
+        std::vector<unsigned int> fine_slices;
+        for (unsigned int k = 0; k < N; ++k) {
+            if (changed[k]) {
+                instances.push_back(instance(k, true));
+                fine_slices.push_back(k);
+            }
+        }
+        auto fine_results = run_instances(instances, max_running);
+        for (std::size_t i = 0; i < fine_slices.size(); ++i) {
+            F[fine_slices[i]] = std::move(fine_results[i]);
+            changed[fine_slices[i]] = false;
+        }
+
+        // Sequential correction: the coarse configuration is run again only on slices whose initial states changed,
+        // otherwise the correction is the fine result itself
+        result.correction = 0.0;
+        bool input_changed = false;     // Whether U[k] changed in this correction
+        unsigned int coarse_runs = 0;
+        for (unsigned int k = 0; k < N; ++k) {
+            States Unew;
+            if (input_changed) {
+                States Gk = run_instances(std::vector<Instance>{instance(k, false)}, 1)[0];
+                ++coarse_runs;
+                Unew = correct_states(Gk, F[k], G[k]);
+                G[k] = std::move(Gk);
+            } else {
+                Unew = F[k];
+            }
+
+            result.correction = std::max(result.correction, max_difference(Unew, U[k+1]));
+            input_changed = (Unew != U[k+1]);
+            if (input_changed) {
+                changed[k+1] = true;
+            }
+            U[k+1] = std::move(Unew);
+        }
+
+        std::cout << "Parareal iteration " << result.iterations << ": " << fine_slices.size() << " fine and " << coarse_runs << " coarse slices simulated; largest correction = " << result.correction << std::endl;
+
+        if (result.correction <= tolerance) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    result.final_states = U[N];
+    if (!write_states(path("final.states"), result.final_states)) {
+        OBNsmn::report_warning(0, "Parareal: could not write the final states to " + path("final.states"));
+    }
+
+    std::chrono::duration<double> dur = std::chrono::steady_clock::now() - wall_start;
+    std::cout << "Parareal " << (result.converged?"converged":"did not converge") << " after " << result.iterations << " iterations in " << dur.count() << " s." << std::endl;
+
+    return result;
+}
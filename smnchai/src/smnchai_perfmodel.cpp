@@ -0,0 +1,410 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Implementation of the performance model of a simulation network.
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>      // atof
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+
+#include <obnsmn_nodegraph.h>
+#include <smnchai_api.h>
+#include <smnchai_perfmodel.h>
+
+using namespace SMNChai;
+
+namespace {
+    // Get the value of a field in a line of a trace file (one JSON object written by OBNsim::Trace); false if the field is not found
+    bool trace_field(const std::string& line, const std::string& key, std::string& value) {
+        auto pos = line.find('"' + key + "\":");
+        if (pos == std::string::npos) {
+            return false;
+        }
+        pos += key.size() + 3;
+        value.clear();
+        if (pos < line.size() && line[pos] == '"') {
+            // A string, whose escaped characters are kept as they are
+            for (++pos; pos < line.size() && line[pos] != '"'; ++pos) {
+                if (line[pos] == '\\' && pos + 1 < line.size()) {
+                    value += line[pos++];
+                }
+                value += line[pos];
+            }
+        } else {
+            // A number
+            for (; pos < line.size() && line[pos] != ',' && line[pos] != '}'; ++pos) {
+                value += line[pos];
+            }
+        }
+        return true;
+    }
+
+    // Mean and standard deviation of samples
+    struct Moments {
+        std::size_t n = 0;
+        double sum = 0.0, sumsq = 0.0;
+
+        void add(double x) {
+            ++n;
+            sum += x;
+            sumsq += x*x;
+        }
+
+        double mean() const {
+            return (n > 0)?(sum / n):0.0;
+        }
+
+        double stddev() const {
+            if (n < 2) {
+                return 0.0;
+            }
+            double m = mean();
+            return std::sqrt(std::max(0.0, (sumsq - n*m*m) / (n - 1)));
+        }
+    };
+}
+
+
+void SMNChai::PerfModel::set_host_cores(const std::string& host, unsigned int cores) {
+    if (cores == 0) {
+        throw smnchai_exception("The number of cores of host '" + host + "' must be positive.");
+    }
+    m_cores[host] = cores;
+}
+
+
+bool SMNChai::PerfModel::calibrate_node(const std::string& node, const std::string& filename) {
+    std::ifstream input(filename);
+    if (!input) {
+        return false;
+    }
+
+    Moments y, x;
+    std::string line, name, ph, dur;
+    while (std::getline(input, line)) {
+        if (!trace_field(line, "name", name) || !trace_field(line, "ph", ph) || ph != "X" || !trace_field(line, "dur", dur)) {
+            continue;
+        }
+        if (name == "UPDATE_Y") {
+            y.add(std::atof(dur.c_str()));
+        } else if (name == "UPDATE_X") {
+            x.add(std::atof(dur.c_str()));
+        }
+    }
+
+    if (y.n == 0) {
+        return false;
+    }
+
+    NodeCost cost;
+    cost.y.mean = y.mean();
+    cost.y.stddev = y.stddev();
+    if (x.n > 0) {
+        cost.x.mean = x.mean();
+        cost.x.stddev = x.stddev();
+    } else {
+        cost.x = default_cost.x;
+    }
+    m_costs[node] = cost;
+    return true;
+}
+
+
+bool SMNChai::PerfModel::calibrate_gc(const std::string& filename) {
+    std::ifstream input(filename);
+    if (!input) {
+        return false;
+    }
+
+    // Round trips of the UPDATE_Y messages of each node: an ACK following a SIM_Y of a node is its ACK, because the GC waits for it before sending more
+    std::map<std::string, double> sent;         // Time a SIM_Y is sent to a node, not yet acknowledged
+    std::map<std::string, Moments> roundtrips;
+    std::string line, name, ts, node;
+    while (std::getline(input, line)) {
+        if (!trace_field(line, "name", name) || (name != "SIM_Y" && name != "SIM_X" && name != "ACK") ||
+            !trace_field(line, "ts", ts) || !trace_field(line, "node", node)) {
+            continue;
+        }
+        double t = std::atof(ts.c_str());
+        if (name == "SIM_Y") {
+            sent[node] = t;
+        } else if (name == "SIM_X") {
+            sent.erase(node);
+        } else {
+            auto it = sent.find(node);
+            if (it != sent.end()) {
+                roundtrips[node].add(t - it->second);
+                sent.erase(it);
+            }
+        }
+    }
+
+    // The one-way latency of a node is half of its average round trip less its compute cost
+    Moments local, remote;
+    for (auto& rt: roundtrips) {
+        auto cost = m_costs.find(rt.first);
+        double latency = std::max(0.0, 0.5*(rt.second.mean() - ((cost != m_costs.end())?cost->second.y.mean:default_cost.y.mean)));
+        auto host = m_hosts.find(rt.first);
+        if (host == m_hosts.end() || host->second.empty()) {
+            local.add(latency);
+        } else {
+            remote.add(latency);
+        }
+    }
+
+    if (local.n > 0) {
+        local_latency = local.mean();
+    }
+    if (remote.n > 0) {
+        remote_latency = remote.mean();
+    }
+    return local.n > 0 || remote.n > 0;
+}
+
+
+SMNChai::PerfModel::Forecast SMNChai::PerfModel::forecast(const Network& net, OBNsim::simtime_t final_time) const {
+    const int nnodes = static_cast<int>(net.nodes.size());
+    if (nnodes == 0) {
+        throw smnchai_exception("There is no node in the network to forecast.");
+    }
+
+    Forecast result;
+    result.nodes.resize(nnodes);
+
+    // The dependency graph, exactly as in the GC
+    OBNsmn::NodeDepGraph_BGL graph(nnodes);
+    for (auto& dep: net.dependencies) {
+        graph.addDependency(dep.source, dep.target, dep.smask, dep.tmask);
+    }
+
+    // The hosts of the nodes, with the time each of their cores becomes free
+    struct Host {
+        std::string name;
+        std::vector<double> cores;
+        double busy = 0.0;
+    };
+    std::vector<Host> hosts;
+    std::vector<std::size_t> node_host(nnodes);
+    std::vector<const NodeCost*> node_cost(nnodes);
+    std::vector<double> node_latency(nnodes);
+    unsigned int ncores = (default_cores > 0)?default_cores:std::max(1u, std::thread::hardware_concurrency());
+    for (int id = 0; id < nnodes; ++id) {
+        const auto& name = net.nodes[id].name;
+        result.nodes[id].name = name;
+
+        auto cost = m_costs.find(name);
+        node_cost[id] = (cost != m_costs.end())?&cost->second:&default_cost;
+
+        auto h = m_hosts.find(name);
+        std::string host = (h != m_hosts.end())?h->second:std::string();
+        node_latency[id] = host.empty()?local_latency:remote_latency;
+        auto found = std::find_if(hosts.begin(), hosts.end(), [&host](const Host& x) { return x.name == host; });
+        if (found == hosts.end()) {
+            auto c = m_cores.find(host);
+            hosts.emplace_back();
+            hosts.back().name = host;
+            hosts.back().cores.assign((c != m_cores.end())?c->second:ncores, 0.0);
+            found = hosts.end() - 1;
+        }
+        node_host[id] = found - hosts.begin();
+    }
+
+    std::mt19937 rng(seed);
+    auto draw = [&rng](const Cost& c) {
+        if (c.stddev <= 0.0) {
+            return std::max(0.0, c.mean);
+        }
+        return std::max(0.0, std::normal_distribution<double>(c.mean, c.stddev)(rng));
+    };
+
+    // Execute a wave of messages from the GC starting at wall-clock time t, returning the time all their ACKs have been processed
+    std::vector<std::pair<double, int> > acks;
+    auto wave = [&](const std::vector<int>& ids, bool updateY, double t) {
+        acks.clear();
+        double gc = t;
+        for (int id: ids) {
+            gc += send_cost;
+            double arrival = gc + node_latency[id];
+
+            // The node computes on the first free core of its host
+            auto& host = hosts[node_host[id]];
+            auto core = std::min_element(host.cores.begin(), host.cores.end());
+            double start = std::max(arrival, *core);
+            double dur = draw(updateY?node_cost[id]->y:node_cost[id]->x);
+            *core = start + dur;
+            host.busy += dur;
+
+            acks.emplace_back(start + dur + node_latency[id], id);
+            ++result.nodes[id].updates;
+        }
+
+        // The GC processes the ACKs in their order of arrival
+        std::sort(acks.begin(), acks.end());
+        for (auto& ack: acks) {
+            gc = std::max(gc, ack.first) + ack_cost;
+        }
+
+        // The node whose ACK came last is on the critical path of this wave
+        auto& critical = result.nodes[acks.back().second];
+        ++critical.critical;
+        critical.critical_time += gc - t;
+        ++result.waves;
+        return gc;
+    };
+
+    // The next update time of each periodic block, starting at its phase offset
+    std::vector<std::map<unsigned int, OBNsim::simtime_t> > next_update(nnodes);
+    for (int id = 0; id < nnodes; ++id) {
+        const auto& offsets = net.nodes[id].offsets;
+        for (auto& blk: net.nodes[id].periods) {
+            if (blk.second > 0) {
+                auto offset = offsets.find(blk.first);
+                next_update[id].emplace(blk.first, (offset != offsets.end())?offset->second:0);
+            }
+        }
+    }
+
+    OBNsmn::NodeUpdateInfoList update_list;
+    std::vector<OBNsim::updatemask_t> masks(nnodes);
+    std::vector<int> ids;
+    double wall = 0.0;
+    OBNsim::simtime_t t = 0;
+    while (true) {
+        // The next update time and the updating blocks, as in GCThread::startNextUpdate()
+        t = -1;
+        for (int id = 0; id < nnodes; ++id) {
+            for (auto& blk: next_update[id]) {
+                if (t < 0 || blk.second < t) {
+                    t = blk.second;
+                }
+            }
+        }
+        if (t < 0) {
+            throw smnchai_exception("There is no periodic block in the network to forecast.");
+        }
+        if (t > final_time) {
+            break;
+        }
+
+        std::fill(masks.begin(), masks.end(), 0);
+        std::vector<int> pending;
+        for (int id = 0; id < nnodes; ++id) {
+            for (auto& blk: next_update[id]) {
+                if (blk.second == t) {
+                    masks[id] |= OBNsim::updatemask_t(1) << blk.first;
+                }
+            }
+            if (masks[id]) {
+                pending.push_back(id);
+            }
+        }
+
+        // Add the triggered blocks until no new block is triggered, as in GCThread::addTriggeredUpdates()
+        std::vector<OBNsim::updatemask_t> added(masks);
+        while (!pending.empty()) {
+            int id = pending.back();
+            pending.pop_back();
+            OBNsim::updatemask_t newblocks = added[id];
+            added[id] = 0;
+            for (auto& trg: net.triggers) {
+                if (trg.source == id && (trg.smask & newblocks)) {
+                    OBNsim::updatemask_t diff = trg.tmask & ~masks[trg.target];
+                    if (diff) {
+                        masks[trg.target] |= diff;
+                        if (added[trg.target] == 0) {
+                            pending.push_back(trg.target);
+                        }
+                        added[trg.target] |= diff;
+                    }
+                }
+            }
+        }
+
+        update_list.clear();
+        for (int id = 0; id < nnodes; ++id) {
+            if (masks[id]) {
+                update_list.push_back(OBNsmn::NodeUpdateInfo{id, masks[id]});
+            }
+        }
+
+        // UPDATE_Y in waves given by the dependency graph, then UPDATE_X
+        auto rtgraph = graph.getRTNodeDepGraph(update_list.begin(), update_list.size());
+        while (!rtgraph->empty()) {
+            ids.clear();
+            for (auto& node: rtgraph->getAndRemoveIndependentNodes()) {
+                ids.push_back(node.first);
+            }
+            if (ids.empty()) {
+                throw smnchai_exception("The dependency graph of the network has a cycle at simulation time " + std::to_string(t) + ".");
+            }
+            wall = wave(ids, true, wall);
+        }
+
+        ids.clear();
+        for (auto& node: update_list) {
+            if (net.nodes[node.nodeID].updateX) {
+                ids.push_back(node.nodeID);
+            }
+        }
+        if (!ids.empty()) {
+            wall = wave(ids, false, wall);
+        }
+
+        ++result.steps;
+
+        // The periodic blocks move to their next update times
+        for (int id = 0; id < nnodes; ++id) {
+            for (auto& blk: next_update[id]) {
+                if (blk.second == t) {
+                    blk.second += net.nodes[id].periods.at(blk.first);
+                }
+            }
+        }
+    }
+
+    result.sim_time = std::max(OBNsim::simtime_t(0), std::min(t, final_time)) * net.time_unit * 1e-6;
+    result.wall_time = wall * 1e-6;
+    for (auto& host: hosts) {
+        result.host_utilization[host.name] = (wall > 0.0)?(host.busy / (wall * host.cores.size())):0.0;
+    }
+    std::stable_sort(result.nodes.begin(), result.nodes.end(), [](const NodeStats& a, const NodeStats& b) {
+        return a.critical_time > b.critical_time;
+    });
+
+    return result;
+}
+
+
+std::string SMNChai::PerfModel::Forecast::report(std::size_t max_nodes) const {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    os << "Forecast of " << steps << " steps over " << sim_time << " s of simulation time:\n";
+    os << "  Wall-clock time: " << wall_time << " s\n";
+    os << "  Steps per second: " << steps_per_second() << '\n';
+    os << "  Real-time factor: " << realtime_factor() << '\n';
+    if (steps > 0) {
+        os << "  Waves per step: " << double(waves) / steps << '\n';
+    }
+
+    os << "Critical nodes (share of the wall-clock time the GC waited for them last):\n";
+    for (std::size_t k = 0; k < nodes.size() && k < max_nodes && nodes[k].critical > 0; ++k) {
+        os << "  " << nodes[k].name << ": " << std::setprecision(1) << ((wall_time > 0.0)?(100.0 * nodes[k].critical_time * 1e-6 / wall_time):0.0) <<
+        "% (" << nodes[k].critical << " of " << nodes[k].updates << " updates)\n" << std::setprecision(3);
+    }
+
+    os << "Host utilization:\n";
+    for (auto& host: host_utilization) {
+        os << "  " << (host.first.empty()?std::string("(SMN host)"):host.first) << ": " << std::setprecision(1) << 100.0 * host.second << "%\n" << std::setprecision(3);
+    }
+    return os.str();
+}
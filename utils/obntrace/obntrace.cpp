@@ -0,0 +1,68 @@
+/* -*- mode: C++; indent-tabs-mode: nil; -*- */
+/** \file
+ * \brief Merge the execution traces of the SMN and the nodes into one trace.
+ *
+ * The SMN (option --trace) and the nodes (environment variable OBN_TRACE_DIR) each write a file of trace events
+ * in the Chrome trace event format, one event per line. This tool merges them into a single JSON trace, giving each
+ * file its own process track, which can be opened in chrome://tracing or https://ui.perfetto.dev
+ *
+ * Usage: obntrace OUTPUT INPUT1 [INPUT2 ...]
+ *
+ * Timestamps are from the monotonic clock of each host, so the tracks are only aligned for processes on the same host.
+ *
+ * This file is part of the openBuildNet simulation framework
+ * (OBN-Sim) developed at EPFL.
+ *
+ * \author Truong X. Nghiem (xuan.nghiem@epfl.ch)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " OUTPUT INPUT1 [INPUT2 ...]\n" <<
+        "Merge trace files (*.trace.json) of the SMN and nodes into one Chrome trace / Perfetto file OUTPUT.\n";
+        return 1;
+    }
+    
+    std::ofstream output(argv[1], std::ios::out | std::ios::trunc);
+    if (!output) {
+        std::cerr << "ERROR: Could not open output file " << argv[1] << '\n';
+        return 2;
+    }
+    
+    output << "{\"traceEvents\":[\n";
+    
+    bool first = true;
+    std::size_t nevents = 0;
+    for (int k = 2; k < argc; ++k) {
+        std::ifstream input(argv[k]);
+        if (!input) {
+            std::cerr << "WARNING: Could not open input file " << argv[k] << "; skipped.\n";
+            continue;
+        }
+        
+        // Each file is a process in the merged trace
+        std::string pid = std::to_string(k - 1);
+        std::string line;
+        while (std::getline(input, line)) {
+            // Each event is a JSON object on its own line; the last line may be incomplete if the process was killed
+            if (line.size() < 2 || line.front() != '{' || line.back() != '}') {
+                continue;
+            }
+            if (!first) {
+                output << ",\n";
+            }
+            first = false;
+            output << "{\"pid\":" << pid << ',' << line.substr(1);
+            ++nevents;
+        }
+    }
+    
+    output << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    
+    std::cout << "Merged " << nevents << " events from " << (argc - 2) << " files into " << argv[1] << '\n';
+    return 0;
+}